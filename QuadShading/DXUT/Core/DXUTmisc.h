@@ -9,6 +9,12 @@
 #ifndef DXUT_MISC_H
 #define DXUT_MISC_H
 
+// Only the PROFILE perf-event macros below call the CPU profiler, which lives in
+// DXUT\Optional; Core doesn't otherwise depend on it
+#ifdef PROFILE
+#include "DXUTprofiler.h"
+#endif
+
 #ifndef MAX_FVF_DECL_SIZE
 #define MAX_FVF_DECL_SIZE MAXD3DDECLLENGTH + 1 // +1 for END
 #endif
@@ -307,12 +313,15 @@ const D3DCOLOR              DXUT_PERFEVENTCOLOR3 = D3DCOLOR_XRGB( 100, 100, 200
 //     Debug (nonoptimized code, asserts active, PROFILE defined to assist debugging)
 //     Profile (optimized code, asserts disabled, PROFILE defined to assist optimization)
 //     Release (optimized code, asserts disabled, PROFILE not defined)
+//
+// With PROFILE defined the events are also recorded by the CPU profiler (DXUTprofiler.h)
+// so they can be exported as a Chrome trace without attaching a GPU tool.
 //--------------------------------------------------------------------------------------
 #ifdef PROFILE
-// PROFILE is defined, so these macros call the D3DPERF functions
-#define DXUT_BeginPerfEvent( color, pstrMessage )   DXUT_Dynamic_D3DPERF_BeginEvent( color, pstrMessage )
-#define DXUT_EndPerfEvent()                         DXUT_Dynamic_D3DPERF_EndEvent()
-#define DXUT_SetPerfMarker( color, pstrMessage )    DXUT_Dynamic_D3DPERF_SetMarker( color, pstrMessage )
+// PROFILE is defined, so these macros call the D3DPERF functions and the CPU profiler
+#define DXUT_BeginPerfEvent( color, pstrMessage )   ( DXUTProfilerBegin( pstrMessage ), DXUT_Dynamic_D3DPERF_BeginEvent( color, pstrMessage ) )
+#define DXUT_EndPerfEvent()                         ( DXUT_Dynamic_D3DPERF_EndEvent(), DXUTProfilerEnd() )
+#define DXUT_SetPerfMarker( color, pstrMessage )    ( DXUTProfilerMarker( pstrMessage ), DXUT_Dynamic_D3DPERF_SetMarker( color, pstrMessage ) )
 #else
 // PROFILE is not defined, so these macros do nothing
 #define DXUT_BeginPerfEvent( color, pstrMessage )   (__noop)
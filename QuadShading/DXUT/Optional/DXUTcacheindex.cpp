@@ -0,0 +1,218 @@
+//--------------------------------------------------------------------------------------
+// File: DXUTcacheindex.cpp
+//
+// Hash index and path keys for the resource caches.
+//--------------------------------------------------------------------------------------
+#include "DXUTcacheindex.h"
+
+#include <ctype.h>
+#include <stddef.h>
+#include <wctype.h>
+
+
+//--------------------------------------------------------------------------------------
+// CDXUTCacheIndex
+//--------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------
+CDXUTCacheIndex::CDXUTCacheIndex()
+{
+    m_pSlots = NULL;
+    m_nCapacity = 0;
+    m_nCount = 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+CDXUTCacheIndex::~CDXUTCacheIndex()
+{
+    delete[] m_pSlots;
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTCacheIndex::RemoveAll()
+{
+    for( int i = 0; i < m_nCapacity; ++i )
+        m_pSlots[i].iEntry = -1;
+    m_nCount = 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTCacheIndex::Grow()
+{
+    int nNewCapacity = ( m_nCapacity == 0 ) ? 64 : m_nCapacity * 2;
+    Slot* pNewSlots = new Slot[ nNewCapacity ];
+    if( !pNewSlots )
+        return false;
+
+    for( int i = 0; i < nNewCapacity; ++i )
+        pNewSlots[i].iEntry = -1;
+
+    // Re-insert the existing slots with linear probing
+    for( int i = 0; i < m_nCapacity; ++i )
+    {
+        if( m_pSlots[i].iEntry < 0 )
+            continue;
+
+        int iSlot = m_pSlots[i].dwHash & ( nNewCapacity - 1 );
+        while( pNewSlots[iSlot].iEntry >= 0 )
+            iSlot = ( iSlot + 1 ) & ( nNewCapacity - 1 );
+        pNewSlots[iSlot] = m_pSlots[i];
+    }
+
+    delete[] m_pSlots;
+    m_pSlots = pNewSlots;
+    m_nCapacity = nNewCapacity;
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTCacheIndex::Insert( uint32_t dwHash, int iEntry )
+{
+    // Keep the load factor below 1/2 so probe sequences stay short
+    if( ( m_nCount + 1 ) * 2 > m_nCapacity && !Grow() )
+        return false;
+
+    int iSlot = dwHash & ( m_nCapacity - 1 );
+    while( m_pSlots[iSlot].iEntry >= 0 )
+        iSlot = ( iSlot + 1 ) & ( m_nCapacity - 1 );
+
+    m_pSlots[iSlot].dwHash = dwHash;
+    m_pSlots[iSlot].iEntry = iEntry;
+    ++m_nCount;
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+int CDXUTCacheIndex::FirstMatch( uint32_t dwHash, int* piSlot ) const
+{
+    if( m_nCount == 0 )
+        return -1;
+
+    *piSlot = ( dwHash & ( m_nCapacity - 1 ) ) - 1;
+    return NextMatch( dwHash, piSlot );
+}
+
+
+//--------------------------------------------------------------------------------------
+int CDXUTCacheIndex::NextMatch( uint32_t dwHash, int* piSlot ) const
+{
+    // Continue probing until an empty slot terminates the sequence
+    for( int iSlot = ( *piSlot + 1 ) & ( m_nCapacity - 1 ); m_pSlots[iSlot].iEntry >= 0;
+         iSlot = ( iSlot + 1 ) & ( m_nCapacity - 1 ) )
+    {
+        if( m_pSlots[iSlot].dwHash == dwHash )
+        {
+            *piSlot = iSlot;
+            return m_pSlots[iSlot].iEntry;
+        }
+    }
+
+    return -1;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Cache key helpers
+//--------------------------------------------------------------------------------------
+static inline uint32_t DXUTNormalizePathChar( wchar_t c )
+{
+    if( c == L'/' )
+        return L'\\';
+#ifdef _WIN32
+    return ( uint32_t )towlower( c );
+#else
+    return ( uint32_t )c;
+#endif
+}
+
+
+//--------------------------------------------------------------------------------------
+static inline uint32_t DXUTNormalizePathChar( char c )
+{
+    if( c == '/' )
+        return '\\';
+#ifdef _WIN32
+    return ( uint32_t )tolower( ( unsigned char )c );
+#else
+    return ( uint32_t )( unsigned char )c;
+#endif
+}
+
+
+//--------------------------------------------------------------------------------------
+// Called at the start of each segment; ".\" says nothing about the file
+//--------------------------------------------------------------------------------------
+template<typename CHAR>
+static inline const CHAR* DXUTSkipCurrentDirs( const CHAR* pPath )
+{
+    while( pPath[0] == '.' && ( pPath[1] == '/' || pPath[1] == '\\' ) )
+        pPath += 2;
+    return pPath;
+}
+
+
+//--------------------------------------------------------------------------------------
+uint32_t DXUTHashValue( uint32_t dwHash, uint64_t Value )
+{
+    // FNV-1a, one byte at a time
+    for( int i = 0; i < 8; ++i )
+    {
+        dwHash ^= ( uint32_t )( Value & 0xff );
+        dwHash *= 16777619u;
+        Value >>= 8;
+    }
+    return dwHash;
+}
+
+
+//--------------------------------------------------------------------------------------
+template<typename CHAR>
+static uint32_t DXUTHashPathT( uint32_t dwHash, const CHAR* pPath )
+{
+    for( pPath = DXUTSkipCurrentDirs( pPath ); *pPath; )
+    {
+        // Two bytes per character, as the wide paths always have been
+        uint32_t c = DXUTNormalizePathChar( *pPath++ );
+        dwHash ^= c & 0xff;
+        dwHash *= 16777619u;
+        dwHash ^= ( c >> 8 ) & 0xff;
+        dwHash *= 16777619u;
+
+        if( c == '\\' )
+            pPath = DXUTSkipCurrentDirs( pPath );
+    }
+    return dwHash;
+}
+
+uint32_t DXUTHashPath( uint32_t dwHash, const wchar_t* pPath ) { return DXUTHashPathT( dwHash, pPath ); }
+uint32_t DXUTHashPath( uint32_t dwHash, const char* pPath )    { return DXUTHashPathT( dwHash, pPath ); }
+
+
+//--------------------------------------------------------------------------------------
+template<typename CHAR>
+static bool DXUTPathsEqualT( const CHAR* pA, const CHAR* pB )
+{
+    pA = DXUTSkipCurrentDirs( pA );
+    pB = DXUTSkipCurrentDirs( pB );
+    while( *pA && *pB )
+    {
+        uint32_t c = DXUTNormalizePathChar( *pA++ );
+        if( c != DXUTNormalizePathChar( *pB++ ) )
+            return false;
+
+        if( c == '\\' )
+        {
+            pA = DXUTSkipCurrentDirs( pA );
+            pB = DXUTSkipCurrentDirs( pB );
+        }
+    }
+    return *pA == *pB;
+}
+
+bool DXUTPathsEqual( const wchar_t* pA, const wchar_t* pB ) { return DXUTPathsEqualT( pA, pB ); }
+bool DXUTPathsEqual( const char* pA, const char* pB )       { return DXUTPathsEqualT( pA, pB ); }
@@ -0,0 +1,60 @@
+//--------------------------------------------------------------------------------------
+// File: DXUTcacheindex.h
+//
+// Hash index and path keys for the resource caches.
+//
+// This file has no Direct3D or DXUT dependencies so that offline tools can share the
+// caches' path normalization and time their lookups without a device.
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef DXUT_CACHEINDEX_H
+#define DXUT_CACHEINDEX_H
+
+#include <stdint.h>
+
+#define DXUT_HASH_BASIS 2166136261u     // FNV-1a offset basis
+
+//--------------------------------------------------------------------------------------
+// Open-addressed hash index mapping key hashes to positions in one of the
+// CDXUTResourceCache arrays.  Several entries may share a hash, so callers
+// walk all candidates with FirstMatch/NextMatch and confirm the full key.
+//--------------------------------------------------------------------------------------
+class CDXUTCacheIndex
+{
+public:
+                            CDXUTCacheIndex();
+                            ~CDXUTCacheIndex();
+
+    bool                    Insert( uint32_t dwHash, int iEntry );
+    int                     FirstMatch( uint32_t dwHash, int* piSlot ) const;
+    int                     NextMatch( uint32_t dwHash, int* piSlot ) const;
+    void                    RemoveAll();
+
+protected:
+    struct Slot
+    {
+        uint32_t dwHash;
+        int iEntry;     // -1 when the slot is empty
+    };
+
+    bool                    Grow();
+
+    Slot* m_pSlots;
+    int m_nCapacity;    // always a power of two
+    int m_nCount;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Cache key helpers.  Source paths are normalized for slash direction and ".\"
+// segments, and for case on Windows, so "Media\Rock.dds", "media/rock.dds" and
+// ".\Media\Rock.dds" resolve to the same entry.  Narrow and wide spellings of the
+// same ASCII path hash the same.
+//--------------------------------------------------------------------------------------
+uint32_t DXUTHashValue( uint32_t dwHash, uint64_t Value );
+uint32_t DXUTHashPath( uint32_t dwHash, const wchar_t* pPath );
+uint32_t DXUTHashPath( uint32_t dwHash, const char* pPath );
+bool DXUTPathsEqual( const wchar_t* pA, const wchar_t* pB );
+bool DXUTPathsEqual( const char* pA, const char* pB );
+
+#endif
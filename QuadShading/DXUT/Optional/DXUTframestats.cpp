@@ -0,0 +1,383 @@
+//--------------------------------------------------------------------------------------
+// File: DXUTframestats.cpp
+//
+// Portable high-resolution clock and rolling frame-time statistics.
+//--------------------------------------------------------------------------------------
+#include "DXUTframestats.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#define DXUT_FRAMESTATS_EMPTY_SLOT UINT64_MAX
+
+
+//--------------------------------------------------------------------------------------
+uint64_t DXUTGetHighResTimeNs()
+{
+#ifdef _WIN32
+    static LONGLONG s_llTicksPerSec = 0;
+    if( s_llTicksPerSec == 0 )
+    {
+        LARGE_INTEGER qwTicksPerSec;
+        QueryPerformanceFrequency( &qwTicksPerSec );
+        s_llTicksPerSec = qwTicksPerSec.QuadPart;
+    }
+
+    LARGE_INTEGER qwTime;
+    QueryPerformanceCounter( &qwTime );
+
+    // Split the conversion to avoid overflowing 64 bits for long uptimes
+    uint64_t Seconds = qwTime.QuadPart / s_llTicksPerSec;
+    uint64_t Remainder = qwTime.QuadPart % s_llTicksPerSec;
+    return Seconds * 1000000000ull + ( Remainder * 1000000000ull ) / s_llTicksPerSec;
+#else
+    timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ( uint64_t )ts.tv_sec * 1000000000ull + ( uint64_t )ts.tv_nsec;
+#endif
+}
+
+
+//--------------------------------------------------------------------------------------
+// CDXUTLatencyHistogram
+//--------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------
+CDXUTLatencyHistogram::CDXUTLatencyHistogram()
+{
+    Reset();
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTLatencyHistogram::Reset()
+{
+    for( int i = 0; i < DXUT_FRAMESTATS_NUM_BUCKETS; ++i )
+        m_Buckets[i].store( 0, std::memory_order_relaxed );
+}
+
+
+//--------------------------------------------------------------------------------------
+int CDXUTLatencyHistogram::GetBucket( uint64_t ns )
+{
+    if( ns < 64 )
+        return ( int )ns;
+
+    int iMsb = 63;
+    while( !( ns & ( 1ull << iMsb ) ) )
+        --iMsb;
+
+    int iSub = ( int )( ns >> ( iMsb - 5 ) );   // in [32, 63]
+    return 64 + ( iMsb - 6 ) * 32 + ( iSub - 32 );
+}
+
+
+//--------------------------------------------------------------------------------------
+uint64_t CDXUTLatencyHistogram::GetBucketLowerBound( int iBucket )
+{
+    if( iBucket < 64 )
+        return ( uint64_t )iBucket;
+
+    int iMsb = 6 + ( iBucket - 64 ) / 32;
+    uint64_t Sub = 32 + ( iBucket - 64 ) % 32;
+    return Sub << ( iMsb - 5 );
+}
+
+
+//--------------------------------------------------------------------------------------
+uint64_t CDXUTLatencyHistogram::GetBucketUpperBound( int iBucket )
+{
+    if( iBucket < 64 )
+        return ( uint64_t )iBucket;
+
+    int iMsb = 6 + ( iBucket - 64 ) / 32;
+    return GetBucketLowerBound( iBucket ) + ( 1ull << ( iMsb - 5 ) ) - 1;
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTLatencyHistogram::Add( uint64_t ns )
+{
+    m_Buckets[GetBucket( ns )].fetch_add( 1, std::memory_order_relaxed );
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTLatencyHistogram::Remove( uint64_t ns )
+{
+    m_Buckets[GetBucket( ns )].fetch_sub( 1, std::memory_order_relaxed );
+}
+
+
+//--------------------------------------------------------------------------------------
+uint64_t CDXUTLatencyHistogram::GetCount() const
+{
+    uint64_t Count = 0;
+    for( int i = 0; i < DXUT_FRAMESTATS_NUM_BUCKETS; ++i )
+        Count += m_Buckets[i].load( std::memory_order_relaxed );
+    return Count;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Returns the midpoint of the bucket holding the requested rank
+//--------------------------------------------------------------------------------------
+uint64_t CDXUTLatencyHistogram::GetPercentile( double fFraction ) const
+{
+    // Snapshot the buckets so a concurrent writer can't make the walk inconsistent
+    static const int nBuckets = DXUT_FRAMESTATS_NUM_BUCKETS;
+    uint32_t Snapshot[nBuckets];
+    uint64_t Count = 0;
+    for( int i = 0; i < nBuckets; ++i )
+    {
+        Snapshot[i] = m_Buckets[i].load( std::memory_order_relaxed );
+        Count += Snapshot[i];
+    }
+
+    if( Count == 0 )
+        return 0;
+
+    uint64_t Rank = ( uint64_t )( fFraction * Count + 0.5 );
+    if( Rank < 1 )
+        Rank = 1;
+    if( Rank > Count )
+        Rank = Count;
+
+    uint64_t Seen = 0;
+    for( int i = 0; i < nBuckets; ++i )
+    {
+        Seen += Snapshot[i];
+        if( Seen >= Rank )
+            return ( GetBucketLowerBound( i ) + GetBucketUpperBound( i ) ) / 2;
+    }
+
+    return GetBucketUpperBound( nBuckets - 1 );
+}
+
+
+//--------------------------------------------------------------------------------------
+// CDXUTFrameStats
+//--------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------
+CDXUTFrameStats::CDXUTFrameStats( const uint32_t* pWindowFrames, uint32_t nNumWindows )
+{
+    if( nNumWindows > DXUT_FRAMESTATS_MAX_WINDOWS )
+        nNumWindows = DXUT_FRAMESTATS_MAX_WINDOWS;
+
+    m_nNumWindows = 0;
+    for( uint32_t i = 0; i < nNumWindows; ++i )
+    {
+        if( pWindowFrames[i] == 0 )
+            continue;
+
+        Window& W = m_Windows[m_nNumWindows++];
+        W.Frames = pWindowFrames[i];
+        W.pRing = new std::atomic<uint64_t>[ W.Frames ];
+    }
+
+    for( uint32_t i = m_nNumWindows; i < DXUT_FRAMESTATS_MAX_WINDOWS; ++i )
+    {
+        m_Windows[i].Frames = 0;
+        m_Windows[i].pRing = NULL;
+    }
+
+    m_FrameStartNs = 0;
+    Reset();
+}
+
+
+//--------------------------------------------------------------------------------------
+CDXUTFrameStats::~CDXUTFrameStats()
+{
+    for( uint32_t i = 0; i < m_nNumWindows; ++i )
+        delete[] m_Windows[i].pRing;
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTFrameStats::Reset()
+{
+    m_Lifetime.Reset();
+    m_LifetimeSumNs = 0;
+    m_LifetimeMinNs = UINT64_MAX;
+    m_LifetimeMaxNs = 0;
+
+    for( uint32_t i = 0; i < m_nNumWindows; ++i )
+    {
+        Window& W = m_Windows[i];
+        for( uint32_t j = 0; j < W.Frames; ++j )
+            W.pRing[j] = DXUT_FRAMESTATS_EMPTY_SLOT;
+        W.WriteIndex = 0;
+        W.SumNs = 0;
+        W.Histogram.Reset();
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTFrameStats::BeginFrame()
+{
+    m_FrameStartNs = DXUTGetHighResTimeNs();
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTFrameStats::EndFrame()
+{
+    if( m_FrameStartNs == 0 )
+        return;
+
+    AddSample( DXUTGetHighResTimeNs() - m_FrameStartNs );
+    m_FrameStartNs = 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTFrameStats::AddSample( uint64_t ns )
+{
+    if( ns == DXUT_FRAMESTATS_EMPTY_SLOT )
+        --ns;
+
+    m_Lifetime.Add( ns );
+    m_LifetimeSumNs.fetch_add( ns, std::memory_order_relaxed );
+
+    uint64_t Prev = m_LifetimeMinNs.load( std::memory_order_relaxed );
+    while( ns < Prev && !m_LifetimeMinNs.compare_exchange_weak( Prev, ns ) )
+        ;
+    Prev = m_LifetimeMaxNs.load( std::memory_order_relaxed );
+    while( ns > Prev && !m_LifetimeMaxNs.compare_exchange_weak( Prev, ns ) )
+        ;
+
+    for( uint32_t i = 0; i < m_nNumWindows; ++i )
+    {
+        Window& W = m_Windows[i];
+
+        // Each writer claims a unique slot; whatever it displaces leaves the window
+        uint64_t Index = W.WriteIndex.fetch_add( 1, std::memory_order_relaxed );
+        uint64_t Old = W.pRing[Index % W.Frames].exchange( ns );
+
+        W.Histogram.Add( ns );
+        W.SumNs.fetch_add( ns, std::memory_order_relaxed );
+        if( Old != DXUT_FRAMESTATS_EMPTY_SLOT )
+        {
+            W.Histogram.Remove( Old );
+            W.SumNs.fetch_sub( Old, std::memory_order_relaxed );
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Window 0 is the lifetime of the collector, 1..N are the sliding windows
+//--------------------------------------------------------------------------------------
+void CDXUTFrameStats::GetSummary( uint32_t iWindow, DXUTFrameStatsSummary* pSummary ) const
+{
+    const CDXUTLatencyHistogram* pHistogram;
+    uint64_t SumNs;
+    uint64_t MinNs;
+    uint64_t MaxNs;
+
+    if( iWindow == 0 || iWindow > m_nNumWindows )
+    {
+        pSummary->WindowFrames = 0;
+        pHistogram = &m_Lifetime;
+        SumNs = m_LifetimeSumNs.load();
+        MinNs = m_LifetimeMinNs.load();
+        MaxNs = m_LifetimeMaxNs.load();
+    }
+    else
+    {
+        // Extremes can't be maintained incrementally as samples leave the window,
+        // so scan the ring; reports are rare compared to samples.
+        const Window& W = m_Windows[iWindow - 1];
+        pSummary->WindowFrames = W.Frames;
+        pHistogram = &W.Histogram;
+        SumNs = W.SumNs.load();
+        MinNs = UINT64_MAX;
+        MaxNs = 0;
+        for( uint32_t i = 0; i < W.Frames; ++i )
+        {
+            uint64_t ns = W.pRing[i].load( std::memory_order_relaxed );
+            if( ns == DXUT_FRAMESTATS_EMPTY_SLOT )
+                continue;
+            if( ns < MinNs )
+                MinNs = ns;
+            if( ns > MaxNs )
+                MaxNs = ns;
+        }
+    }
+
+    pSummary->Count = pHistogram->GetCount();
+    if( pSummary->Count == 0 )
+    {
+        pSummary->fMinMs = pSummary->fMeanMs = 0.0;
+        pSummary->fP50Ms = pSummary->fP95Ms = pSummary->fP99Ms = 0.0;
+        pSummary->fMaxMs = 0.0;
+        return;
+    }
+
+    // Bucket midpoints can fall outside the observed range, so clamp them
+    double Percentiles[3] = { 0.50, 0.95, 0.99 };
+    double Values[3];
+    for( int i = 0; i < 3; ++i )
+    {
+        uint64_t ns = pHistogram->GetPercentile( Percentiles[i] );
+        if( ns < MinNs )
+            ns = MinNs;
+        if( ns > MaxNs )
+            ns = MaxNs;
+        Values[i] = ns * 1e-6;
+    }
+
+    pSummary->fMinMs = MinNs * 1e-6;
+    pSummary->fMeanMs = ( SumNs * 1e-6 ) / pSummary->Count;
+    pSummary->fP50Ms = Values[0];
+    pSummary->fP95Ms = Values[1];
+    pSummary->fP99Ms = Values[2];
+    pSummary->fMaxMs = MaxNs * 1e-6;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTFrameStats::WriteCSV( FILE* pFile ) const
+{
+    if( fprintf( pFile, "window_frames,count,min_ms,mean_ms,p50_ms,p95_ms,p99_ms,max_ms\n" ) < 0 )
+        return false;
+
+    for( uint32_t i = 0; i < GetNumWindows(); ++i )
+    {
+        DXUTFrameStatsSummary S;
+        GetSummary( i, &S );
+        if( fprintf( pFile, "%u,%llu,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f\n", S.WindowFrames,
+                     ( unsigned long long )S.Count, S.fMinMs, S.fMeanMs, S.fP50Ms, S.fP95Ms, S.fP99Ms,
+                     S.fMaxMs ) < 0 )
+            return false;
+    }
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTFrameStats::WriteJSON( FILE* pFile ) const
+{
+    if( fprintf( pFile, "[\n" ) < 0 )
+        return false;
+
+    for( uint32_t i = 0; i < GetNumWindows(); ++i )
+    {
+        DXUTFrameStatsSummary S;
+        GetSummary( i, &S );
+        if( fprintf( pFile, "  { \"window_frames\": %u, \"count\": %llu, \"min_ms\": %.4f, \"mean_ms\": %.4f, "
+                     "\"p50_ms\": %.4f, \"p95_ms\": %.4f, \"p99_ms\": %.4f, \"max_ms\": %.4f }%s\n",
+                     S.WindowFrames, ( unsigned long long )S.Count, S.fMinMs, S.fMeanMs, S.fP50Ms, S.fP95Ms,
+                     S.fP99Ms, S.fMaxMs, ( i + 1 < GetNumWindows() ) ? "," : "" ) < 0 )
+            return false;
+    }
+
+    return fprintf( pFile, "]\n" ) >= 0;
+}
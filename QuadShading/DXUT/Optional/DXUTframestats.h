@@ -0,0 +1,132 @@
+//--------------------------------------------------------------------------------------
+// File: DXUTframestats.h
+//
+// Portable high-resolution clock and rolling frame-time statistics.
+//
+// This file has no Direct3D or DXUT dependencies so that headless and offline tools
+// can time their own loops with the same collector the interactive samples use.
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef DXUT_FRAMESTATS_H
+#define DXUT_FRAMESTATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <atomic>
+
+//--------------------------------------------------------------------------------------
+// High-resolution monotonic clock.  QueryPerformanceCounter on Windows,
+// clock_gettime( CLOCK_MONOTONIC ) elsewhere.
+//--------------------------------------------------------------------------------------
+uint64_t DXUTGetHighResTimeNs();
+
+
+//--------------------------------------------------------------------------------------
+// Log-linear histogram of nanosecond durations.  Values below 64ns are recorded
+// exactly; above that every power of two is split into 32 buckets, which bounds the
+// relative error of a reported percentile to about 3%.  Add/Remove are lock-free and
+// may be called from any thread.
+//--------------------------------------------------------------------------------------
+#define DXUT_FRAMESTATS_NUM_BUCKETS ( 64 + 58 * 32 )
+
+class CDXUTLatencyHistogram
+{
+public:
+                            CDXUTLatencyHistogram();
+
+    void                    Add( uint64_t ns );
+    void                    Remove( uint64_t ns );
+    void                    Reset();
+
+    uint64_t                GetCount() const;
+    uint64_t                GetPercentile( double fFraction ) const;   // fFraction in [0,1]
+
+    static int              GetBucket( uint64_t ns );
+    static uint64_t         GetBucketLowerBound( int iBucket );
+    static uint64_t         GetBucketUpperBound( int iBucket );
+
+protected:
+    std::atomic<uint32_t>   m_Buckets[DXUT_FRAMESTATS_NUM_BUCKETS];
+};
+
+
+//--------------------------------------------------------------------------------------
+// Summary of the samples seen by one window of a CDXUTFrameStats
+//--------------------------------------------------------------------------------------
+struct DXUTFrameStatsSummary
+{
+    uint32_t WindowFrames;      // 0 for the lifetime window
+    uint64_t Count;
+    double fMinMs;
+    double fMeanMs;
+    double fP50Ms;
+    double fP95Ms;
+    double fP99Ms;
+    double fMaxMs;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Rolling frame-time collector.  Every sample feeds a lifetime histogram plus up to
+// DXUT_FRAMESTATS_MAX_WINDOWS sliding windows of the most recent N frames.
+//
+// Usage, for an interactive or batch loop alike:
+//
+//     uint32_t Windows[] = { 120, 1000 };
+//     CDXUTFrameStats Stats( Windows, 2 );
+//     while( ... )
+//     {
+//         Stats.BeginFrame();
+//         ...
+//         Stats.EndFrame();
+//     }
+//     Stats.WriteJSON( pFile );
+//
+// AddSample() may be called concurrently from several threads (e.g. a batch of
+// offline workers each timing their own items); BeginFrame/EndFrame track a single
+// loop and must stay on one thread.
+//--------------------------------------------------------------------------------------
+#define DXUT_FRAMESTATS_MAX_WINDOWS 4
+
+class CDXUTFrameStats
+{
+public:
+                            CDXUTFrameStats( const uint32_t* pWindowFrames = NULL, uint32_t nNumWindows = 0 );
+                            ~CDXUTFrameStats();
+
+    void                    BeginFrame();
+    void                    EndFrame();
+    void                    AddSample( uint64_t ns );
+    void                    Reset();
+
+    uint32_t                GetNumWindows() const { return m_nNumWindows + 1; }
+    void                    GetSummary( uint32_t iWindow, DXUTFrameStatsSummary* pSummary ) const;
+
+    bool                    WriteCSV( FILE* pFile ) const;
+    bool                    WriteJSON( FILE* pFile ) const;
+
+protected:
+    struct Window
+    {
+        uint32_t Frames;
+        std::atomic<uint64_t>* pRing;       // last Frames samples, in ns
+        std::atomic<uint64_t> WriteIndex;
+        std::atomic<uint64_t> SumNs;
+        CDXUTLatencyHistogram Histogram;
+    };
+
+                            CDXUTFrameStats( const CDXUTFrameStats& );
+    CDXUTFrameStats&        operator=( const CDXUTFrameStats& );
+
+    CDXUTLatencyHistogram   m_Lifetime;
+    std::atomic<uint64_t>   m_LifetimeSumNs;
+    std::atomic<uint64_t>   m_LifetimeMinNs;
+    std::atomic<uint64_t>   m_LifetimeMaxNs;
+
+    Window                  m_Windows[DXUT_FRAMESTATS_MAX_WINDOWS];
+    uint32_t                m_nNumWindows;
+
+    uint64_t                m_FrameStartNs;
+};
+
+#endif
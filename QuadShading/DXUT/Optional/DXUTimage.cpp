@@ -0,0 +1,325 @@
+//--------------------------------------------------------------------------------------
+// File: DXUTimage.cpp
+//
+// Portable DDS decoding and a lazily decoded CPU-side image cache.
+//--------------------------------------------------------------------------------------
+#include "DXUTimage.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+//--------------------------------------------------------------------------------------
+// DDS file layout.  Declared locally so this file doesn't need ddraw.h or dds.h.
+//--------------------------------------------------------------------------------------
+#define DXUT_DDS_MAGIC              0x20534444  // "DDS "
+#define DXUT_DDS_FOURCC_DX10        0x30315844  // "DX10"
+
+#define DXUT_DDSD_MIPMAPCOUNT       0x00020000
+
+#define DXUT_DDPF_ALPHAPIXELS       0x00000001
+#define DXUT_DDPF_ALPHA             0x00000002
+#define DXUT_DDPF_FOURCC            0x00000004
+#define DXUT_DDPF_RGB               0x00000040
+#define DXUT_DDPF_LUMINANCE         0x00020000
+
+// The handful of DXGI_FORMAT values the DX10 header path accepts
+#define DXUT_DXGI_R8G8B8A8_UNORM        28
+#define DXUT_DXGI_R8G8B8A8_UNORM_SRGB   29
+#define DXUT_DXGI_B8G8R8A8_UNORM        87
+#define DXUT_DXGI_B8G8R8A8_UNORM_SRGB   91
+
+struct DXUT_DDS_PIXELFORMAT
+{
+    uint32_t Size;
+    uint32_t Flags;
+    uint32_t FourCC;
+    uint32_t RGBBitCount;
+    uint32_t RBitMask;
+    uint32_t GBitMask;
+    uint32_t BBitMask;
+    uint32_t ABitMask;
+};
+
+struct DXUT_DDS_HEADER
+{
+    uint32_t Size;
+    uint32_t Flags;
+    uint32_t Height;
+    uint32_t Width;
+    uint32_t PitchOrLinearSize;
+    uint32_t Depth;
+    uint32_t MipMapCount;
+    uint32_t Reserved1[11];
+    DXUT_DDS_PIXELFORMAT PixelFormat;
+    uint32_t Caps;
+    uint32_t Caps2;
+    uint32_t Caps3;
+    uint32_t Caps4;
+    uint32_t Reserved2;
+};
+
+struct DXUT_DDS_HEADER_DX10
+{
+    uint32_t DXGIFormat;
+    uint32_t ResourceDimension;
+    uint32_t MiscFlag;
+    uint32_t ArraySize;
+    uint32_t MiscFlags2;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Extracts one channel described by a bit mask and rescales it to 8 bits
+//--------------------------------------------------------------------------------------
+struct DXUTChannelMask
+{
+    uint32_t Mask;
+    uint32_t Shift;
+    uint32_t Max;
+};
+
+static void DXUTSetupChannelMask( uint32_t Mask, DXUTChannelMask* pChannel )
+{
+    pChannel->Mask = Mask;
+    pChannel->Shift = 0;
+    pChannel->Max = 0;
+    if( !Mask )
+        return;
+
+    while( !( Mask & 1 ) )
+    {
+        Mask >>= 1;
+        pChannel->Shift++;
+    }
+    pChannel->Max = Mask;
+}
+
+static inline uint8_t DXUTExtractChannel( uint32_t Pixel, const DXUTChannelMask& Channel, uint8_t Default )
+{
+    if( !Channel.Max )
+        return Default;
+
+    uint32_t v = ( Pixel & Channel.Mask ) >> Channel.Shift;
+    return ( uint8_t )( ( v * 255 + Channel.Max / 2 ) / Channel.Max );
+}
+
+
+//--------------------------------------------------------------------------------------
+// Validates the headers and returns where the top-level pixels start plus the layout of
+// a pixel, expressed as bit masks for both the legacy and DX10 paths
+//--------------------------------------------------------------------------------------
+static bool DXUTParseDDS( const void* pData, size_t DataBytes, const DXUT_DDS_HEADER** ppHeader,
+                          const uint8_t** ppPixels, DXUT_DDS_PIXELFORMAT* pFormat )
+{
+    if( !pData || DataBytes < sizeof( uint32_t ) + sizeof( DXUT_DDS_HEADER ) )
+        return false;
+
+    const uint8_t* pBytes = ( const uint8_t* )pData;
+    uint32_t Magic;
+    memcpy( &Magic, pBytes, sizeof( Magic ) );
+    if( Magic != DXUT_DDS_MAGIC )
+        return false;
+
+    const DXUT_DDS_HEADER* pHeader = ( const DXUT_DDS_HEADER* )( pBytes + sizeof( uint32_t ) );
+    if( pHeader->Size != sizeof( DXUT_DDS_HEADER ) || pHeader->PixelFormat.Size != sizeof( DXUT_DDS_PIXELFORMAT ) )
+        return false;
+    if( pHeader->Width == 0 || pHeader->Height == 0 )
+        return false;
+
+    size_t Offset = sizeof( uint32_t ) + sizeof( DXUT_DDS_HEADER );
+    *pFormat = pHeader->PixelFormat;
+
+    if( ( pFormat->Flags & DXUT_DDPF_FOURCC ) )
+    {
+        if( pFormat->FourCC != DXUT_DDS_FOURCC_DX10 || DataBytes < Offset + sizeof( DXUT_DDS_HEADER_DX10 ) )
+            return false;
+
+        const DXUT_DDS_HEADER_DX10* pHeader10 = ( const DXUT_DDS_HEADER_DX10* )( pBytes + Offset );
+        Offset += sizeof( DXUT_DDS_HEADER_DX10 );
+
+        pFormat->Flags = DXUT_DDPF_RGB | DXUT_DDPF_ALPHAPIXELS;
+        pFormat->RGBBitCount = 32;
+        pFormat->GBitMask = 0x0000ff00;
+        pFormat->ABitMask = 0xff000000;
+        switch( pHeader10->DXGIFormat )
+        {
+            case DXUT_DXGI_R8G8B8A8_UNORM:
+            case DXUT_DXGI_R8G8B8A8_UNORM_SRGB:
+                pFormat->RBitMask = 0x000000ff;
+                pFormat->BBitMask = 0x00ff0000;
+                break;
+            case DXUT_DXGI_B8G8R8A8_UNORM:
+            case DXUT_DXGI_B8G8R8A8_UNORM_SRGB:
+                pFormat->RBitMask = 0x00ff0000;
+                pFormat->BBitMask = 0x000000ff;
+                break;
+            default:
+                return false;
+        }
+    }
+    else if( !( pFormat->Flags & ( DXUT_DDPF_RGB | DXUT_DDPF_LUMINANCE | DXUT_DDPF_ALPHA ) ) )
+    {
+        return false;
+    }
+
+    uint32_t BitCount = pFormat->RGBBitCount;
+    if( BitCount != 8 && BitCount != 16 && BitCount != 24 && BitCount != 32 )
+        return false;
+
+    size_t TopLevelBytes = ( size_t )pHeader->Width * pHeader->Height * ( BitCount / 8 );
+    if( DataBytes - Offset < TopLevelBytes )
+        return false;
+
+    *ppHeader = pHeader;
+    *ppPixels = pBytes + Offset;
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool DXUTGetDDSInfo( const void* pData, size_t DataBytes, uint32_t* pWidth, uint32_t* pHeight,
+                     uint32_t* pMipLevels )
+{
+    const DXUT_DDS_HEADER* pHeader;
+    const uint8_t* pPixels;
+    DXUT_DDS_PIXELFORMAT Format;
+    if( !DXUTParseDDS( pData, DataBytes, &pHeader, &pPixels, &Format ) )
+        return false;
+
+    if( pWidth )
+        *pWidth = pHeader->Width;
+    if( pHeight )
+        *pHeight = pHeader->Height;
+    if( pMipLevels )
+        *pMipLevels = ( ( pHeader->Flags & DXUT_DDSD_MIPMAPCOUNT ) && pHeader->MipMapCount ) ? pHeader->MipMapCount : 1;
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool DXUTDecodeDDS( const void* pData, size_t DataBytes, DXUTImageRGBA8* pImage )
+{
+    memset( pImage, 0, sizeof( DXUTImageRGBA8 ) );
+
+    const DXUT_DDS_HEADER* pHeader;
+    const uint8_t* pSrc;
+    DXUT_DDS_PIXELFORMAT Format;
+    if( !DXUTParseDDS( pData, DataBytes, &pHeader, &pSrc, &Format ) )
+        return false;
+
+    size_t NumPixels = ( size_t )pHeader->Width * pHeader->Height;
+    uint8_t* pDest = ( uint8_t* )malloc( NumPixels * 4 );
+    if( !pDest )
+        return false;
+
+    DXUTChannelMask R, G, B, A;
+    DXUTSetupChannelMask( Format.RBitMask, &R );
+    DXUTSetupChannelMask( Format.GBitMask, &G );
+    DXUTSetupChannelMask( Format.BBitMask, &B );
+    DXUTSetupChannelMask( ( Format.Flags & ( DXUT_DDPF_ALPHAPIXELS | DXUT_DDPF_ALPHA ) ) ? Format.ABitMask : 0, &A );
+
+    bool bLuminance = ( Format.Flags & DXUT_DDPF_LUMINANCE ) != 0;
+    bool bAlphaOnly = ( Format.Flags & ( DXUT_DDPF_RGB | DXUT_DDPF_LUMINANCE ) ) == 0;
+    uint32_t BytesPerPixel = Format.RGBBitCount / 8;
+
+    for( size_t i = 0; i < NumPixels; i++ )
+    {
+        uint32_t Pixel = 0;
+        for( uint32_t b = 0; b < BytesPerPixel; b++ )
+            Pixel |= ( uint32_t )pSrc[i * BytesPerPixel + b] << ( b * 8 );
+
+        uint8_t* p = pDest + i * 4;
+        if( bAlphaOnly )
+        {
+            p[0] = p[1] = p[2] = 0;
+        }
+        else if( bLuminance )
+        {
+            p[0] = p[1] = p[2] = DXUTExtractChannel( Pixel, R, 0 );
+        }
+        else
+        {
+            p[0] = DXUTExtractChannel( Pixel, R, 0 );
+            p[1] = DXUTExtractChannel( Pixel, G, 0 );
+            p[2] = DXUTExtractChannel( Pixel, B, 0 );
+        }
+        p[3] = DXUTExtractChannel( Pixel, A, 255 );
+    }
+
+    pImage->Width = pHeader->Width;
+    pImage->Height = pHeader->Height;
+    DXUTGetDDSInfo( pData, DataBytes, NULL, NULL, &pImage->MipLevels );
+    pImage->pPixels = pDest;
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+void DXUTFreeImage( DXUTImageRGBA8* pImage )
+{
+    free( pImage->pPixels );
+    pImage->pPixels = NULL;
+}
+
+
+//--------------------------------------------------------------------------------------
+// CDXUTLazyImage
+//--------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------
+CDXUTLazyImage::CDXUTLazyImage( const void* pData, size_t DataBytes ) : m_pData( pData ),
+                                                                         m_DataBytes( DataBytes ),
+                                                                         m_pImage( NULL ),
+                                                                         m_bFailed( false )
+{
+}
+
+
+//--------------------------------------------------------------------------------------
+CDXUTLazyImage::~CDXUTLazyImage()
+{
+    Release();
+}
+
+
+//--------------------------------------------------------------------------------------
+const DXUTImageRGBA8* CDXUTLazyImage::Get()
+{
+    DXUTImageRGBA8* pImage = m_pImage.load( std::memory_order_acquire );
+    if( pImage || m_bFailed.load( std::memory_order_relaxed ) )
+        return pImage;
+
+    DXUTImageRGBA8* pDecoded = new DXUTImageRGBA8;
+    if( !DXUTDecodeDDS( m_pData, m_DataBytes, pDecoded ) )
+    {
+        delete pDecoded;
+        m_bFailed = true;
+        return NULL;
+    }
+
+    // Publish; if another thread got there first, use its copy
+    DXUTImageRGBA8* pExpected = NULL;
+    if( !m_pImage.compare_exchange_strong( pExpected, pDecoded ) )
+    {
+        DXUTFreeImage( pDecoded );
+        delete pDecoded;
+        return pExpected;
+    }
+
+    return pDecoded;
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTLazyImage::Release()
+{
+    DXUTImageRGBA8* pImage = m_pImage.exchange( NULL );
+    if( pImage )
+    {
+        DXUTFreeImage( pImage );
+        delete pImage;
+    }
+    m_bFailed = false;
+}
@@ -0,0 +1,67 @@
+//--------------------------------------------------------------------------------------
+// File: DXUTimage.h
+//
+// Portable DDS decoding and a lazily decoded CPU-side image cache.
+//
+// Nothing here depends on Direct3D or D3DX, so headless tools can read DXUT's embedded
+// media (and their own DDS files) without a device.  Only uncompressed formats are
+// handled: legacy bitmask RGB/luminance/alpha layouts, and the 8-bit RGBA/BGRA
+// formats in the DX10 extended header.  Decoded images are always top-level only and
+// 8-bit RGBA, rows tightly packed.
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef DXUT_IMAGE_H
+#define DXUT_IMAGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+struct DXUTImageRGBA8
+{
+    uint32_t Width;
+    uint32_t Height;
+    uint32_t MipLevels;     // in the source, for reporting; only the top level is decoded
+    uint8_t* pPixels;       // Width * Height * 4 bytes
+};
+
+bool DXUTGetDDSInfo( const void* pData, size_t DataBytes, uint32_t* pWidth, uint32_t* pHeight,
+                     uint32_t* pMipLevels );
+bool DXUTDecodeDDS( const void* pData, size_t DataBytes, DXUTImageRGBA8* pImage );
+void DXUTFreeImage( DXUTImageRGBA8* pImage );
+
+
+//--------------------------------------------------------------------------------------
+// Decodes an in-memory DDS the first time it is asked for and keeps the result.  Get()
+// may be called from any thread; racing first calls each decode, one result wins and
+// the others are discarded.  The source memory must outlive the object.
+//--------------------------------------------------------------------------------------
+class CDXUTLazyImage
+{
+public:
+                                    CDXUTLazyImage( const void* pData, size_t DataBytes );
+                                    ~CDXUTLazyImage();
+
+    const DXUTImageRGBA8*           Get();
+    bool                            IsDecoded() const { return m_pImage.load() != NULL; }
+
+    // Drops the decoded pixels; must not race with Get()
+    void                            Release();
+
+protected:
+                                    CDXUTLazyImage( const CDXUTLazyImage& );
+    CDXUTLazyImage&                 operator=( const CDXUTLazyImage& );
+
+    const void*                     m_pData;
+    size_t                          m_DataBytes;
+    std::atomic<DXUTImageRGBA8*>    m_pImage;
+    std::atomic<bool>               m_bFailed;
+};
+
+
+//--------------------------------------------------------------------------------------
+// The DXUT GUI texture embedded in DXUTres.cpp, decoded on first use
+//--------------------------------------------------------------------------------------
+const DXUTImageRGBA8* DXUTGetGUITextureImage();
+
+#endif
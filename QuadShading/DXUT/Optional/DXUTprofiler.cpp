@@ -0,0 +1,459 @@
+//--------------------------------------------------------------------------------------
+// File: DXUTprofiler.cpp
+//
+// Low-overhead scoped CPU profiler.
+//--------------------------------------------------------------------------------------
+#include "DXUTprofiler.h"
+#include "DXUTframestats.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+
+#ifdef _MSC_VER
+#define DXUT_THREAD_LOCAL __declspec( thread )
+#else
+#define DXUT_THREAD_LOCAL __thread
+#endif
+
+#define DXUT_PROFILER_DEFAULT_CAPACITY  65536
+#define DXUT_PROFILER_VERSION           1
+
+enum DXUT_PROFILE_EVENT_TYPE
+{
+    DXUT_PROFILE_EVENT_BEGIN = 0,
+    DXUT_PROFILE_EVENT_END,
+    DXUT_PROFILE_EVENT_MARKER,
+};
+
+struct DXUTProfileEvent
+{
+    uint64_t TimeNs;
+    const wchar_t* pName;
+    uint32_t Type;
+};
+
+//--------------------------------------------------------------------------------------
+// Single-producer ring owned by one thread.  Buffers are linked into a global list on
+// creation and live until process exit so that exports can still see events from
+// threads that have already finished.
+//--------------------------------------------------------------------------------------
+struct DXUTProfileThread
+{
+    uint32_t ThreadId;
+    uint32_t Capacity;
+    DXUTProfileEvent* pEvents;
+    std::atomic<uint64_t> WriteIndex;
+    std::atomic<uint64_t> ResetIndex;
+    DXUTProfileThread* pNext;
+};
+
+static std::atomic<DXUTProfileThread*> s_pProfileThreads( NULL );
+static std::atomic<uint32_t> s_nProfileNextThreadId( 1 );
+static std::atomic<uint32_t> s_nProfileCapacity( DXUT_PROFILER_DEFAULT_CAPACITY );
+static std::atomic<bool> s_bProfileEnabled( true );
+
+static DXUT_THREAD_LOCAL DXUTProfileThread* s_pProfileThread = NULL;
+
+
+//--------------------------------------------------------------------------------------
+static DXUTProfileThread* DXUTProfilerGetThread()
+{
+    DXUTProfileThread* pThread = s_pProfileThread;
+    if( pThread )
+        return pThread;
+
+    pThread = new DXUTProfileThread;
+    pThread->ThreadId = s_nProfileNextThreadId.fetch_add( 1 );
+    pThread->Capacity = s_nProfileCapacity.load();
+    pThread->pEvents = new DXUTProfileEvent[ pThread->Capacity ];
+    pThread->WriteIndex = 0;
+    pThread->ResetIndex = 0;
+
+    // Lock-free push onto the global list
+    pThread->pNext = s_pProfileThreads.load();
+    while( !s_pProfileThreads.compare_exchange_weak( pThread->pNext, pThread ) )
+        ;
+
+    s_pProfileThread = pThread;
+    return pThread;
+}
+
+
+//--------------------------------------------------------------------------------------
+static inline void DXUTProfilerRecord( const wchar_t* pstrName, uint32_t Type )
+{
+    if( !s_bProfileEnabled.load( std::memory_order_relaxed ) )
+        return;
+
+    DXUTProfileThread* pThread = DXUTProfilerGetThread();
+
+    uint64_t Index = pThread->WriteIndex.load( std::memory_order_relaxed );
+    DXUTProfileEvent& Event = pThread->pEvents[Index % pThread->Capacity];
+    Event.TimeNs = DXUTGetHighResTimeNs();
+    Event.pName = pstrName;
+    Event.Type = Type;
+
+    // Publish; readers only trust slots below the index they observe
+    pThread->WriteIndex.store( Index + 1, std::memory_order_release );
+}
+
+
+//--------------------------------------------------------------------------------------
+void DXUTProfilerBegin( const wchar_t* pstrName )
+{
+    DXUTProfilerRecord( pstrName, DXUT_PROFILE_EVENT_BEGIN );
+}
+
+
+//--------------------------------------------------------------------------------------
+void DXUTProfilerEnd()
+{
+    DXUTProfilerRecord( NULL, DXUT_PROFILE_EVENT_END );
+}
+
+
+//--------------------------------------------------------------------------------------
+void DXUTProfilerMarker( const wchar_t* pstrName )
+{
+    DXUTProfilerRecord( pstrName, DXUT_PROFILE_EVENT_MARKER );
+}
+
+
+//--------------------------------------------------------------------------------------
+void DXUTProfilerSetEnabled( bool bEnabled )
+{
+    s_bProfileEnabled = bEnabled;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool DXUTProfilerIsEnabled()
+{
+    return s_bProfileEnabled;
+}
+
+
+//--------------------------------------------------------------------------------------
+void DXUTProfilerSetThreadCapacity( uint32_t nEvents )
+{
+    s_nProfileCapacity = nEvents ? nEvents : 1;
+}
+
+
+//--------------------------------------------------------------------------------------
+void DXUTProfilerReset()
+{
+    for( DXUTProfileThread* pThread = s_pProfileThreads.load(); pThread; pThread = pThread->pNext )
+        pThread->ResetIndex = pThread->WriteIndex.load();
+}
+
+
+//--------------------------------------------------------------------------------------
+// Export helpers
+//--------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------
+// Copies the valid events of one ring into pEvents (Capacity entries).  Ends are given
+// the name of their matching begin so that exports don't need to track the stack.
+//--------------------------------------------------------------------------------------
+static uint32_t DXUTProfilerSnapshot( DXUTProfileThread* pThread, DXUTProfileEvent* pEvents )
+{
+    uint64_t Capacity = pThread->Capacity;
+    uint64_t End = pThread->WriteIndex.load( std::memory_order_acquire );
+    uint64_t Start = pThread->ResetIndex.load();
+    if( End > Capacity && End - Capacity > Start )
+        Start = End - Capacity;
+
+    for( uint64_t i = Start; i < End; ++i )
+        pEvents[i - Start] = pThread->pEvents[i % Capacity];
+
+    // Anything the writer lapped while we were copying is unreliable
+    std::atomic_thread_fence( std::memory_order_acquire );
+    uint64_t EndAfter = pThread->WriteIndex.load( std::memory_order_acquire );
+    uint64_t Skip = 0;
+    if( EndAfter > Capacity && EndAfter - Capacity > Start )
+    {
+        Skip = EndAfter - Capacity - Start;
+        if( Skip > End - Start )
+            Skip = End - Start;
+    }
+
+    uint32_t nNumEvents = ( uint32_t )( End - Start - Skip );
+    if( Skip )
+        memmove( pEvents, pEvents + Skip, nNumEvents * sizeof( DXUTProfileEvent ) );
+
+    // Name the ends, dropping those whose begin has already been overwritten
+    const wchar_t* Stack[256];
+    int nDepth = 0;
+    uint32_t nOut = 0;
+    for( uint32_t i = 0; i < nNumEvents; ++i )
+    {
+        DXUTProfileEvent& Event = pEvents[i];
+        if( Event.Type == DXUT_PROFILE_EVENT_BEGIN )
+        {
+            if( nDepth < 256 )
+                Stack[nDepth] = Event.pName;
+            ++nDepth;
+        }
+        else if( Event.Type == DXUT_PROFILE_EVENT_END )
+        {
+            if( nDepth == 0 )
+                continue;
+            --nDepth;
+            Event.pName = nDepth < 256 ? Stack[nDepth] : NULL;
+        }
+        pEvents[nOut++] = Event;
+    }
+
+    return nOut;
+}
+
+
+//--------------------------------------------------------------------------------------
+struct DXUTProfileStrings
+{
+    const wchar_t** ppNames;
+    uint32_t nNumNames;
+    uint32_t nMaxNames;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Names are few and exports rare, so a linear search keeps this simple
+//--------------------------------------------------------------------------------------
+static uint32_t DXUTProfilerInternString( DXUTProfileStrings* pStrings, const wchar_t* pstrName )
+{
+    for( uint32_t i = 0; i < pStrings->nNumNames; ++i )
+    {
+        if( pStrings->ppNames[i] == pstrName ||
+            ( pstrName && pStrings->ppNames[i] && wcscmp( pStrings->ppNames[i], pstrName ) == 0 ) )
+            return i;
+    }
+
+    if( pStrings->nNumNames == pStrings->nMaxNames )
+    {
+        uint32_t nMaxNames = pStrings->nMaxNames ? pStrings->nMaxNames * 2 : 64;
+        const wchar_t** ppNames = ( const wchar_t** )realloc( pStrings->ppNames, nMaxNames * sizeof( wchar_t* ) );
+        if( !ppNames )
+            return 0;
+        pStrings->ppNames = ppNames;
+        pStrings->nMaxNames = nMaxNames;
+    }
+
+    pStrings->ppNames[pStrings->nNumNames] = pstrName;
+    return pStrings->nNumNames++;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Encodes a wide string as UTF-8 into strDest (at least 4 * wcslen + 1 bytes) and returns
+// the number of bytes written.  bEscapeJSON escapes quotes, backslashes and controls.
+//--------------------------------------------------------------------------------------
+static size_t DXUTProfilerToUTF8( const wchar_t* pstrName, char* strDest, size_t nDestBytes, bool bEscapeJSON )
+{
+    size_t n = 0;
+    if( !pstrName )
+        pstrName = L"(unknown)";
+
+    for( ; *pstrName && n + 7 < nDestBytes; ++pstrName )
+    {
+        uint32_t c = ( uint32_t )*pstrName;
+        if( sizeof( wchar_t ) == 2 && c >= 0xD800 && c < 0xDC00 && pstrName[1] >= 0xDC00 && pstrName[1] < 0xE000 )
+        {
+            c = 0x10000 + ( ( c - 0xD800 ) << 10 ) + ( ( uint32_t )pstrName[1] - 0xDC00 );
+            ++pstrName;
+        }
+
+        if( bEscapeJSON && ( c == '"' || c == '\\' ) )
+        {
+            strDest[n++] = '\\';
+            strDest[n++] = ( char )c;
+        }
+        else if( bEscapeJSON && c < 0x20 )
+        {
+            static const char strHex[] = "0123456789abcdef";
+            memcpy( strDest + n, "\\u00", 4 );
+            strDest[n + 4] = strHex[c >> 4];
+            strDest[n + 5] = strHex[c & 0xF];
+            n += 6;
+        }
+        else if( c < 0x80 )
+        {
+            strDest[n++] = ( char )c;
+        }
+        else if( c < 0x800 )
+        {
+            strDest[n++] = ( char )( 0xC0 | ( c >> 6 ) );
+            strDest[n++] = ( char )( 0x80 | ( c & 0x3F ) );
+        }
+        else if( c < 0x10000 )
+        {
+            strDest[n++] = ( char )( 0xE0 | ( c >> 12 ) );
+            strDest[n++] = ( char )( 0x80 | ( ( c >> 6 ) & 0x3F ) );
+            strDest[n++] = ( char )( 0x80 | ( c & 0x3F ) );
+        }
+        else
+        {
+            strDest[n++] = ( char )( 0xF0 | ( c >> 18 ) );
+            strDest[n++] = ( char )( 0x80 | ( ( c >> 12 ) & 0x3F ) );
+            strDest[n++] = ( char )( 0x80 | ( ( c >> 6 ) & 0x3F ) );
+            strDest[n++] = ( char )( 0x80 | ( c & 0x3F ) );
+        }
+    }
+
+    strDest[n] = 0;
+    return n;
+}
+
+
+//--------------------------------------------------------------------------------------
+static void DXUTProfilerWriteVarint( FILE* pFile, uint64_t Value )
+{
+    unsigned char Bytes[10];
+    int n = 0;
+    do
+    {
+        Bytes[n] = ( unsigned char )( Value & 0x7F );
+        Value >>= 7;
+        if( Value )
+            Bytes[n] |= 0x80;
+        ++n;
+    } while( Value );
+
+    fwrite( Bytes, 1, n, pFile );
+}
+
+
+//--------------------------------------------------------------------------------------
+// Snapshot of every thread, taken once per export
+//--------------------------------------------------------------------------------------
+struct DXUTProfileCapture
+{
+    DXUTProfileThread* pThread;
+    DXUTProfileEvent* pEvents;
+    uint32_t nNumEvents;
+};
+
+static DXUTProfileCapture* DXUTProfilerCapture( uint32_t* pnNumThreads, uint64_t* pBaseNs )
+{
+    uint32_t nNumThreads = 0;
+    for( DXUTProfileThread* pThread = s_pProfileThreads.load(); pThread; pThread = pThread->pNext )
+        ++nNumThreads;
+
+    DXUTProfileCapture* pCaptures = new DXUTProfileCapture[ nNumThreads ? nNumThreads : 1 ];
+    uint64_t BaseNs = UINT64_MAX;
+
+    // Threads registered after the count are simply left out of this export
+    uint32_t i = 0;
+    for( DXUTProfileThread* pThread = s_pProfileThreads.load(); pThread && i < nNumThreads;
+         pThread = pThread->pNext, ++i )
+    {
+        pCaptures[i].pThread = pThread;
+        pCaptures[i].pEvents = new DXUTProfileEvent[ pThread->Capacity ];
+        pCaptures[i].nNumEvents = DXUTProfilerSnapshot( pThread, pCaptures[i].pEvents );
+        if( pCaptures[i].nNumEvents && pCaptures[i].pEvents[0].TimeNs < BaseNs )
+            BaseNs = pCaptures[i].pEvents[0].TimeNs;
+    }
+
+    *pnNumThreads = i;
+    *pBaseNs = ( BaseNs == UINT64_MAX ) ? 0 : BaseNs;
+    return pCaptures;
+}
+
+
+//--------------------------------------------------------------------------------------
+static void DXUTProfilerFreeCapture( DXUTProfileCapture* pCaptures, uint32_t nNumThreads )
+{
+    for( uint32_t i = 0; i < nNumThreads; ++i )
+        delete[] pCaptures[i].pEvents;
+    delete[] pCaptures;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool DXUTProfilerWriteChromeTrace( FILE* pFile )
+{
+    uint32_t nNumThreads;
+    uint64_t BaseNs;
+    DXUTProfileCapture* pCaptures = DXUTProfilerCapture( &nNumThreads, &BaseNs );
+
+    static const char* strPhases[] = { "B", "E", "i" };
+    char strName[1024];
+    bool bFirst = true;
+
+    fprintf( pFile, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n" );
+    for( uint32_t t = 0; t < nNumThreads; ++t )
+    {
+        const DXUTProfileCapture& Capture = pCaptures[t];
+        for( uint32_t i = 0; i < Capture.nNumEvents; ++i )
+        {
+            const DXUTProfileEvent& Event = Capture.pEvents[i];
+            DXUTProfilerToUTF8( Event.pName, strName, sizeof( strName ), true );
+            fprintf( pFile, "%s{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":1,\"tid\":%u%s}",
+                     bFirst ? "" : ",\n", strName, strPhases[Event.Type], ( Event.TimeNs - BaseNs ) * 1e-3,
+                     Capture.pThread->ThreadId, Event.Type == DXUT_PROFILE_EVENT_MARKER ? ",\"s\":\"t\"" : "" );
+            bFirst = false;
+        }
+    }
+    fprintf( pFile, "\n]}\n" );
+
+    DXUTProfilerFreeCapture( pCaptures, nNumThreads );
+    return ferror( pFile ) == 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool DXUTProfilerWriteBinary( FILE* pFile )
+{
+    uint32_t nNumThreads;
+    uint64_t BaseNs;
+    DXUTProfileCapture* pCaptures = DXUTProfilerCapture( &nNumThreads, &BaseNs );
+
+    DXUTProfileStrings Strings = { NULL, 0, 0 };
+    for( uint32_t t = 0; t < nNumThreads; ++t )
+    {
+        for( uint32_t i = 0; i < pCaptures[t].nNumEvents; ++i )
+            DXUTProfilerInternString( &Strings, pCaptures[t].pEvents[i].pName );
+    }
+
+    uint32_t Version = DXUT_PROFILER_VERSION;
+    unsigned char Header[16];
+    memcpy( Header, "DXPF", 4 );
+    for( int i = 0; i < 4; ++i )
+        Header[4 + i] = ( unsigned char )( Version >> ( i * 8 ) );
+    for( int i = 0; i < 8; ++i )
+        Header[8 + i] = ( unsigned char )( BaseNs >> ( i * 8 ) );
+    fwrite( Header, 1, sizeof( Header ), pFile );
+
+    char strName[1024];
+    DXUTProfilerWriteVarint( pFile, Strings.nNumNames );
+    for( uint32_t i = 0; i < Strings.nNumNames; ++i )
+    {
+        size_t nBytes = DXUTProfilerToUTF8( Strings.ppNames[i], strName, sizeof( strName ), false );
+        DXUTProfilerWriteVarint( pFile, nBytes );
+        fwrite( strName, 1, nBytes, pFile );
+    }
+
+    DXUTProfilerWriteVarint( pFile, nNumThreads );
+    for( uint32_t t = 0; t < nNumThreads; ++t )
+    {
+        const DXUTProfileCapture& Capture = pCaptures[t];
+        DXUTProfilerWriteVarint( pFile, Capture.pThread->ThreadId );
+        DXUTProfilerWriteVarint( pFile, Capture.nNumEvents );
+
+        uint64_t PrevNs = BaseNs;
+        for( uint32_t i = 0; i < Capture.nNumEvents; ++i )
+        {
+            const DXUTProfileEvent& Event = Capture.pEvents[i];
+            uint32_t iString = DXUTProfilerInternString( &Strings, Event.pName );
+            DXUTProfilerWriteVarint( pFile, Event.TimeNs - PrevNs );
+            DXUTProfilerWriteVarint( pFile, ( ( uint64_t )iString << 2 ) | Event.Type );
+            PrevNs = Event.TimeNs;
+        }
+    }
+
+    free( Strings.ppNames );
+    DXUTProfilerFreeCapture( pCaptures, nNumThreads );
+    return ferror( pFile ) == 0;
+}
@@ -0,0 +1,97 @@
+//--------------------------------------------------------------------------------------
+// File: DXUTprofiler.h
+//
+// Low-overhead scoped CPU profiler.
+//
+// Every thread that records an event gets its own fixed-size ring buffer, so recording
+// never takes a lock and never allocates after the first event on a thread.  Once the
+// ring is full the oldest events are overwritten.  Events can be exported at any time
+// as Chrome trace JSON (load in chrome://tracing or Perfetto) or as a compact binary
+// stream.
+//
+// When PROFILE is defined, DXUT_BeginPerfEvent/DXUT_EndPerfEvent (DXUTmisc.h) record
+// here as well as forwarding to D3DPERF.  Code that cannot include DXUT.h, such as the
+// offline analysis tools, uses DXUT_PROFILE_SCOPE directly.
+//
+// Event names are stored by pointer and must outlive the profiler; pass literals.
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef DXUT_PROFILER_H
+#define DXUT_PROFILER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <wchar.h>
+
+#if defined( PROFILE ) && !defined( DXUT_PROFILER )
+#define DXUT_PROFILER
+#endif
+
+//--------------------------------------------------------------------------------------
+// Recording
+//--------------------------------------------------------------------------------------
+void DXUTProfilerBegin( const wchar_t* pstrName );
+void DXUTProfilerEnd();
+void DXUTProfilerMarker( const wchar_t* pstrName );
+
+// Enabled by default; disabling makes the calls above return immediately
+void DXUTProfilerSetEnabled( bool bEnabled );
+bool DXUTProfilerIsEnabled();
+
+// Events per thread ring; only affects threads that have not recorded yet
+void DXUTProfilerSetThreadCapacity( uint32_t nEvents );
+
+// Forget everything recorded so far (buffers are kept)
+void DXUTProfilerReset();
+
+
+//--------------------------------------------------------------------------------------
+// Export.  Safe to call while other threads are still recording; events that are
+// overwritten during the export are dropped rather than reported torn.
+//
+// Binary layout (little-endian, varints are LEB128):
+//     char[4]   "DXPF"
+//     uint32    version (1)
+//     uint64    base timestamp, ns
+//     varint    string count, then per string: varint byte length, UTF-8 bytes
+//     varint    thread count, then per thread:
+//                   varint thread id, varint event count, then per event:
+//                       varint ns since the thread's previous event (or the base)
+//                       varint ( string index << 2 ) | type   (0 begin, 1 end, 2 marker)
+//--------------------------------------------------------------------------------------
+bool DXUTProfilerWriteChromeTrace( FILE* pFile );
+bool DXUTProfilerWriteBinary( FILE* pFile );
+
+
+//--------------------------------------------------------------------------------------
+// Scoped helper, records a begin on construction and an end on destruction
+//--------------------------------------------------------------------------------------
+class CDXUTProfileScope
+{
+public:
+    CDXUTProfileScope( const wchar_t* pstrName )
+    {
+        DXUTProfilerBegin( pstrName );
+    }
+    ~CDXUTProfileScope()
+    {
+        DXUTProfilerEnd();
+    }
+};
+
+#define DXUT_PROFILE_CONCAT2( a, b ) a##b
+#define DXUT_PROFILE_CONCAT( a, b ) DXUT_PROFILE_CONCAT2( a, b )
+
+#ifdef DXUT_PROFILER
+#define DXUT_PROFILE_SCOPE( pstrName )  CDXUTProfileScope DXUT_PROFILE_CONCAT( profileScope, __LINE__ )( pstrName )
+#define DXUT_PROFILE_BEGIN( pstrName )  DXUTProfilerBegin( pstrName )
+#define DXUT_PROFILE_END()              DXUTProfilerEnd()
+#define DXUT_PROFILE_MARKER( pstrName ) DXUTProfilerMarker( pstrName )
+#else
+#define DXUT_PROFILE_SCOPE( pstrName )  ( ( void )0 )
+#define DXUT_PROFILE_BEGIN( pstrName )  ( ( void )0 )
+#define DXUT_PROFILE_END()              ( ( void )0 )
+#define DXUT_PROFILE_MARKER( pstrName ) ( ( void )0 )
+#endif
+
+#endif
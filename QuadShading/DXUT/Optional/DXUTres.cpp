@@ -3,10 +3,17 @@
 //
 // Copyright (c) Microsoft Corp. All rights reserved.
 //-----------------------------------------------------------------------------
+//
+// Define DXUT_HEADLESS to build only the embedded data and its CPU-side decoding, for
+// tools that have no Direct3D device (or no D3DX).
+//-----------------------------------------------------------------------------
+#include "DXUTimage.h"
+#ifndef DXUT_HEADLESS
 #include "DXUT.h"
 #include "DXUTres.h"
+#endif
 
-static const DWORD g_DXUTGUITextureSrcData[] =
+static const uint32_t g_DXUTGUITextureSrcData[] =
 {
     0x20534444, 0x0000007c, 0x00001007, 0x00000100, 0x00000100, 0x00000000, 0x00000000, 0x00000000, 
     0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 
@@ -8206,9 +8213,9 @@ static const DWORD g_DXUTGUITextureSrcData[] =
     0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000, 0x00000000
 };
 
-static const UINT g_DXUTGUITextureSrcDataSizeInBytes = 262272;
+static const uint32_t g_DXUTGUITextureSrcDataSizeInBytes = 262272;
 
-static const DWORD g_DXUTArrowMeshSrcData[] =
+static const uint32_t g_DXUTArrowMeshSrcData[] =
 {
     0x20666f78, 0x33303330, 0x70697a62, 0x32333030, 0x000030d7, 0x087930c7, 0x59ed4b43, 0xd51c6c5d, 
     0x71dbbe15, 0xacbbc1d6, 0xe125d493, 0xc1024e27, 0x7133f9c1, 0xec1098ec, 0x1b1daef1, 0xc6d24eb7, 
@@ -8281,7 +8288,20 @@ static const DWORD g_DXUTArrowMeshSrcData[] =
     0x156e5c3f, 0xc4db201f, 0x7b8fc5c7, 0xf7e2221b, 0x0000001f
 };
 
-static const UINT g_DXUTArrowMeshSrcDataSizeInBytes = 2193;
+static const uint32_t g_DXUTArrowMeshSrcDataSizeInBytes = 2193;
+
+//-----------------------------------------------------------------------------
+// CPU-side copy of the GUI texture.  Nothing is decoded until the first caller asks,
+// and every device created afterwards reuses the same pixels.
+//-----------------------------------------------------------------------------
+static CDXUTLazyImage g_DXUTGUITextureImage( g_DXUTGUITextureSrcData, g_DXUTGUITextureSrcDataSizeInBytes );
+
+const DXUTImageRGBA8* DXUTGetGUITextureImage()
+{
+    return g_DXUTGUITextureImage.Get();
+}
+
+#ifndef DXUT_HEADLESS
 
 //-----------------------------------------------------------------------------
 HRESULT WINAPI DXUTCreateGUITextureFromInternalArray9( LPDIRECT3DDEVICE9 pd3dDevice, IDirect3DTexture9** ppTexture, D3DXIMAGE_INFO* pInfo )
@@ -8296,36 +8316,44 @@ HRESULT WINAPI DXUTCreateGUITextureFromInternalArray11(ID3D11Device* pd3dDevice,
 {
     HRESULT hr;
 
-    D3DX11_IMAGE_INFO SrcInfo;
-    if( !pInfo )
+    const DXUTImageRGBA8* pImage = DXUTGetGUITextureImage();
+    if( !pImage )
+        return E_FAIL;
+
+    // Report what D3DX11GetImageInfoFromMemory would have
+    if( pInfo )
     {
-        D3DX11GetImageInfoFromMemory( g_DXUTGUITextureSrcData, g_DXUTGUITextureSrcDataSizeInBytes, NULL, &SrcInfo, NULL );
-        pInfo = &SrcInfo;
+        ZeroMemory( pInfo, sizeof( D3DX11_IMAGE_INFO ) );
+        pInfo->Width = pImage->Width;
+        pInfo->Height = pImage->Height;
+        pInfo->Depth = 1;
+        pInfo->ArraySize = 1;
+        pInfo->MipLevels = pImage->MipLevels;
+        pInfo->Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+        pInfo->ResourceDimension = D3D11_RESOURCE_DIMENSION_TEXTURE2D;
+        pInfo->ImageFileFormat = D3DX11_IFF_DDS;
     }
 
-    ID3D11Resource *pRes;
-    D3DX11_IMAGE_LOAD_INFO loadInfo;
-    loadInfo.Width = D3DX11_DEFAULT;
-    loadInfo.Height  = D3DX11_DEFAULT;
-    loadInfo.Depth  = D3DX11_DEFAULT;
-    loadInfo.FirstMipLevel = 0;
-    loadInfo.MipLevels = 1;
-    loadInfo.Usage = D3D11_USAGE_DEFAULT;
-    loadInfo.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-    loadInfo.CpuAccessFlags = 0;
-    loadInfo.MiscFlags = 0;
-    //loadInfo.Format = MAKE_TYPELESS( pInfo->Format );
-    loadInfo.Format = MAKE_SRGB( pInfo->Format );
-    loadInfo.Filter = D3DX11_FILTER_NONE;
-    loadInfo.MipFilter = D3DX11_FILTER_NONE;
-    loadInfo.pSrcInfo = pInfo;
+    D3D11_TEXTURE2D_DESC desc;
+    desc.Width = pImage->Width;
+    desc.Height = pImage->Height;
+    desc.MipLevels = 1;
+    desc.ArraySize = 1;
+    desc.Format = MAKE_SRGB( DXGI_FORMAT_R8G8B8A8_UNORM );
+    desc.SampleDesc.Count = 1;
+    desc.SampleDesc.Quality = 0;
+    desc.Usage = D3D11_USAGE_DEFAULT;
+    desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    desc.CPUAccessFlags = 0;
+    desc.MiscFlags = 0;
+
+    D3D11_SUBRESOURCE_DATA initData;
+    initData.pSysMem = pImage->pPixels;
+    initData.SysMemPitch = pImage->Width * 4;
+    initData.SysMemSlicePitch = 0;
 
-    hr = D3DX11CreateTextureFromMemory( pd3dDevice, g_DXUTGUITextureSrcData, g_DXUTGUITextureSrcDataSizeInBytes, &loadInfo, NULL, &pRes, NULL );
-    if( FAILED( hr ) )
-        return hr;
-    DXUT_SetDebugName( pRes, "DXUT" );
-    hr = pRes->QueryInterface( __uuidof( ID3D11Texture2D ), (LPVOID*)ppTexture );
-    SAFE_RELEASE( pRes );
+    V_RETURN( pd3dDevice->CreateTexture2D( &desc, &initData, ppTexture ) );
+    DXUT_SetDebugName( *ppTexture, "DXUT" );
 
     return S_OK;
 }
@@ -8337,3 +8365,4 @@ HRESULT WINAPI DXUTCreateArrowMeshFromInternalArray( LPDIRECT3DDEVICE9 pd3dDevic
                                       D3DXMESH_MANAGED, pd3dDevice, NULL, NULL, NULL, NULL, ppMesh );
 }
 
+#endif
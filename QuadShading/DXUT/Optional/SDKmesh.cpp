@@ -12,6 +12,185 @@
 #include "SDKMesh.h"
 #include "SDKMisc.h"
 
+//--------------------------------------------------------------------------------------
+// Process-wide allocation accounting
+//--------------------------------------------------------------------------------------
+static volatile LONGLONG s_SDKMeshCurrentBytes[SDKMESH_ALLOC_NUM_CATEGORIES];
+static volatile LONGLONG s_SDKMeshPeakBytes[SDKMESH_ALLOC_NUM_CATEGORIES];
+static volatile LONGLONG s_SDKMeshNumAllocations[SDKMESH_ALLOC_NUM_CATEGORIES];
+static volatile LONGLONG s_SDKMeshArenaReservedBytes;
+static volatile LONGLONG s_SDKMeshNumArenas;
+
+static const WCHAR* s_SDKMeshAllocCategoryNames[SDKMESH_ALLOC_NUM_CATEGORIES] =
+{
+    L"Static data",
+    L"Buffer pointers",
+    L"Frame matrices",
+    L"Animation",
+};
+
+
+//--------------------------------------------------------------------------------------
+static void DXUTTrackSDKMeshAlloc( SDKMESH_ALLOC_CATEGORY Category, LONGLONG Bytes )
+{
+    LONGLONG Current = InterlockedExchangeAdd64( &s_SDKMeshCurrentBytes[Category], Bytes ) + Bytes;
+    if( Bytes <= 0 )
+        return;
+
+    InterlockedIncrement64( &s_SDKMeshNumAllocations[Category] );
+
+    LONGLONG Peak = s_SDKMeshPeakBytes[Category];
+    while( Current > Peak )
+    {
+        LONGLONG Prev = InterlockedCompareExchange64( &s_SDKMeshPeakBytes[Category], Current, Peak );
+        if( Prev == Peak )
+            break;
+        Peak = Prev;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+void WINAPI DXUTGetSDKMeshAllocStats( SDKMESH_ALLOC_STATS* pStats )
+{
+    for( int i = 0; i < SDKMESH_ALLOC_NUM_CATEGORIES; i++ )
+    {
+        pStats->CurrentBytes[i] = ( UINT64 )s_SDKMeshCurrentBytes[i];
+        pStats->PeakBytes[i] = ( UINT64 )s_SDKMeshPeakBytes[i];
+        pStats->NumAllocations[i] = ( UINT64 )s_SDKMeshNumAllocations[i];
+    }
+    pStats->ArenaReservedBytes = ( UINT64 )s_SDKMeshArenaReservedBytes;
+    pStats->NumArenas = ( UINT64 )s_SDKMeshNumArenas;
+}
+
+
+//--------------------------------------------------------------------------------------
+void WINAPI DXUTOutputSDKMeshAllocStats()
+{
+    SDKMESH_ALLOC_STATS Stats;
+    DXUTGetSDKMeshAllocStats( &Stats );
+
+    DXUTOutputDebugString( L"SDKMesh allocations: %I64u arenas, %I64u bytes reserved\n", Stats.NumArenas,
+                           Stats.ArenaReservedBytes );
+    for( int i = 0; i < SDKMESH_ALLOC_NUM_CATEGORIES; i++ )
+    {
+        DXUTOutputDebugString( L"  %-16s current %10I64u  peak %10I64u  allocations %I64u\n",
+                               s_SDKMeshAllocCategoryNames[i], Stats.CurrentBytes[i], Stats.PeakBytes[i],
+                               Stats.NumAllocations[i] );
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+static inline SIZE_T DXUTAlignArenaSize( SIZE_T Bytes )
+{
+    return ( Bytes + DXUT_MESH_ARENA_ALIGNMENT - 1 ) & ~( SIZE_T )( DXUT_MESH_ARENA_ALIGNMENT - 1 );
+}
+
+
+//--------------------------------------------------------------------------------------
+CDXUTMeshArena::CDXUTMeshArena() : m_pBlock( NULL ),
+                                   m_Capacity( 0 ),
+                                   m_Used( 0 )
+{
+    ZeroMemory( m_CategoryBytes, sizeof( m_CategoryBytes ) );
+}
+
+
+//--------------------------------------------------------------------------------------
+CDXUTMeshArena::~CDXUTMeshArena()
+{
+    Release();
+}
+
+
+//--------------------------------------------------------------------------------------
+// Worst-case arena size for a load: the static data (0 when it isn't owned by the mesh),
+// the vertex/index pointer tables and the three frame matrix arrays
+//--------------------------------------------------------------------------------------
+SIZE_T CDXUTMeshArena::GetRequiredSize( const SDKMESH_HEADER* pHeader, SIZE_T StaticBytes )
+{
+    SIZE_T Bytes = DXUTAlignArenaSize( StaticBytes );
+    Bytes += DXUTAlignArenaSize( ( SIZE_T )pHeader->NumVertexBuffers * sizeof( BYTE* ) );
+    Bytes += DXUTAlignArenaSize( ( SIZE_T )pHeader->NumIndexBuffers * sizeof( BYTE* ) );
+    Bytes += 3 * DXUTAlignArenaSize( ( SIZE_T )pHeader->NumFrames * sizeof( D3DXMATRIX ) );
+    return Bytes;
+}
+
+
+//--------------------------------------------------------------------------------------
+HRESULT CDXUTMeshArena::Reserve( SIZE_T Bytes )
+{
+    Release();
+
+    Bytes = DXUTAlignArenaSize( __max( Bytes, ( SIZE_T )1 ) );
+    m_pBlock = ( BYTE* )_aligned_malloc( Bytes, DXUT_MESH_ARENA_ALIGNMENT );
+    if( !m_pBlock )
+        return E_OUTOFMEMORY;
+
+    m_Capacity = Bytes;
+    InterlockedExchangeAdd64( &s_SDKMeshArenaReservedBytes, ( LONGLONG )m_Capacity );
+    InterlockedIncrement64( &s_SDKMeshNumArenas );
+
+    return S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Returns NULL once the reservation is exhausted; a correctly sized arena never is
+//--------------------------------------------------------------------------------------
+void* CDXUTMeshArena::Alloc( SIZE_T Bytes, SDKMESH_ALLOC_CATEGORY Category )
+{
+    SIZE_T AlignedBytes = DXUTAlignArenaSize( Bytes );
+    if( !m_pBlock || AlignedBytes > m_Capacity - m_Used )
+        return NULL;
+
+    void* p = m_pBlock + m_Used;
+    m_Used += AlignedBytes;
+    m_CategoryBytes[Category] += Bytes;
+    DXUTTrackSDKMeshAlloc( Category, ( LONGLONG )Bytes );
+
+    return p;
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTMeshArena::Release()
+{
+    if( !m_pBlock )
+        return;
+
+    for( int i = 0; i < SDKMESH_ALLOC_NUM_CATEGORIES; i++ )
+    {
+        if( m_CategoryBytes[i] )
+            DXUTTrackSDKMeshAlloc( ( SDKMESH_ALLOC_CATEGORY )i, -( LONGLONG )m_CategoryBytes[i] );
+        m_CategoryBytes[i] = 0;
+    }
+
+    InterlockedExchangeAdd64( &s_SDKMeshArenaReservedBytes, -( LONGLONG )m_Capacity );
+    InterlockedDecrement64( &s_SDKMeshNumArenas );
+
+    _aligned_free( m_pBlock );
+    m_pBlock = NULL;
+    m_Capacity = 0;
+    m_Used = 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool CDXUTMeshArena::Owns( const void* p ) const
+{
+    return m_pBlock && ( const BYTE* )p >= m_pBlock && ( const BYTE* )p < m_pBlock + m_Capacity;
+}
+
+
+//--------------------------------------------------------------------------------------
+SIZE_T CDXUTMeshArena::GetCategoryBytes( SDKMESH_ALLOC_CATEGORY Category ) const
+{
+    return m_CategoryBytes[Category];
+}
+
+
 //--------------------------------------------------------------------------------------
 void CDXUTSDKMesh::LoadMaterials( ID3D11Device* pd3dDevice, SDKMESH_MATERIAL* pMaterials, UINT numMaterials,
                                   SDKMESH_CALLBACKS11* pLoaderCallbacks )
@@ -320,6 +499,7 @@ HRESULT CDXUTSDKMesh::CreateFromFile( ID3D11Device* pDev11,
                                       SDKMESH_CALLBACKS11* pLoaderCallbacks11,
                                       SDKMESH_CALLBACKS9* pLoaderCallbacks9 )
 {
+    CDXUTPerfEventGenerator eventGenerator( DXUT_PERFEVENTCOLOR, L"SDKMesh Load" );
     HRESULT hr = S_OK;
 
     // Find the path for the file
@@ -345,17 +525,29 @@ HRESULT CDXUTSDKMesh::CreateFromFile( ID3D11Device* pDev11,
     GetFileSizeEx( m_hFile, &FileSize );
     UINT cBytes = FileSize.LowPart;
 
+    // Read the header first so the arena can be sized for the whole load
+    SDKMESH_HEADER Header;
+    DWORD dwBytesRead;
+    if( cBytes < sizeof( SDKMESH_HEADER ) ||
+        !ReadFile( m_hFile, &Header, sizeof( SDKMESH_HEADER ), &dwBytesRead, NULL ) ||
+        dwBytesRead != sizeof( SDKMESH_HEADER ) )
+    {
+        CloseHandle( m_hFile );
+        return E_FAIL;
+    }
+
     // Allocate memory
-    m_pStaticMeshData = new BYTE[ cBytes ];
-    if( !m_pStaticMeshData )
+    if( FAILED( m_Arena.Reserve( CDXUTMeshArena::GetRequiredSize( &Header, cBytes ) ) ) )
     {
         CloseHandle( m_hFile );
         return E_OUTOFMEMORY;
     }
+    m_pStaticMeshData = ( BYTE* )m_Arena.Alloc( cBytes, SDKMESH_ALLOC_STATIC_DATA );
 
-    // Read in the file
-    DWORD dwBytesRead;
-    if( !ReadFile( m_hFile, m_pStaticMeshData, cBytes, &dwBytesRead, NULL ) )
+    // Read in the rest of the file
+    CopyMemory( m_pStaticMeshData, &Header, sizeof( SDKMESH_HEADER ) );
+    if( !ReadFile( m_hFile, m_pStaticMeshData + sizeof( SDKMESH_HEADER ), cBytes - sizeof( SDKMESH_HEADER ),
+                   &dwBytesRead, NULL ) )
         hr = E_FAIL;
 
     CloseHandle( m_hFile );
@@ -370,10 +562,11 @@ HRESULT CDXUTSDKMesh::CreateFromFile( ID3D11Device* pDev11,
                                false,
                                pLoaderCallbacks11,
                                pLoaderCallbacks9 );
-        if( FAILED( hr ) )
-            delete []m_pStaticMeshData;
     }
 
+    if( FAILED( hr ) )
+        ReleaseArena();
+
     return hr;
 }
 
@@ -386,6 +579,7 @@ HRESULT CDXUTSDKMesh::CreateFromMemory( ID3D11Device* pDev11,
                                         SDKMESH_CALLBACKS11* pLoaderCallbacks11,
                                         SDKMESH_CALLBACKS9* pLoaderCallbacks9 )
 {
+    CDXUTPerfEventGenerator eventGenerator( DXUT_PERFEVENTCOLOR, L"SDKMesh Parse" );
     HRESULT hr = E_FAIL;
     D3DXVECTOR3 lower; 
     D3DXVECTOR3 upper; 
@@ -396,22 +590,30 @@ HRESULT CDXUTSDKMesh::CreateFromMemory( ID3D11Device* pDev11,
     // Set outstanding resources to zero
     m_NumOutstandingResources = 0;
 
-    if( bCopyStatic )
+    // File loads have already reserved the arena and read the file into it
+    SDKMESH_HEADER* pHeader = ( SDKMESH_HEADER* )pData;
+    SIZE_T StaticSize = ( SIZE_T )( pHeader->HeaderSize + pHeader->NonBufferDataSize );
+    bool bDataInArena = m_Arena.Owns( pData );
+    if( !bDataInArena )
     {
-        SDKMESH_HEADER* pHeader = ( SDKMESH_HEADER* )pData;
+        if( FAILED( m_Arena.Reserve( CDXUTMeshArena::GetRequiredSize( pHeader, bCopyStatic ? StaticSize : 0 ) ) ) )
+            return E_OUTOFMEMORY;
+    }
 
-        SIZE_T StaticSize = ( SIZE_T )( pHeader->HeaderSize + pHeader->NonBufferDataSize );
-        m_pHeapData = new BYTE[ StaticSize ];
-        if( !m_pHeapData )
+    if( bCopyStatic )
+    {
+        m_pStaticMeshData = ( BYTE* )m_Arena.Alloc( StaticSize, SDKMESH_ALLOC_STATIC_DATA );
+        if( !m_pStaticMeshData )
             return hr;
 
-        m_pStaticMeshData = m_pHeapData;
+        m_pHeapData = NULL;
 
         CopyMemory( m_pStaticMeshData, pData, StaticSize );
     }
     else
     {
-        m_pHeapData = pData;
+        // Caller-provided data is owned by the mesh from here on
+        m_pHeapData = bDataInArena ? NULL : pData;
         m_pStaticMeshData = pData;
     }
 
@@ -447,7 +649,10 @@ HRESULT CDXUTSDKMesh::CreateFromMemory( ID3D11Device* pDev11,
     UINT64 BufferDataStart = m_pMeshHeader->HeaderSize + m_pMeshHeader->NonBufferDataSize;
 
     // Create VBs
-    m_ppVertices = new BYTE*[m_pMeshHeader->NumVertexBuffers];
+    m_ppVertices = ( BYTE** )m_Arena.Alloc( m_pMeshHeader->NumVertexBuffers * sizeof( BYTE* ),
+                                            SDKMESH_ALLOC_BUFFER_POINTERS );
+    if( !m_ppVertices )
+        goto Error;
     for( UINT i = 0; i < m_pMeshHeader->NumVertexBuffers; i++ )
     {
         BYTE* pVertices = NULL;
@@ -462,7 +667,10 @@ HRESULT CDXUTSDKMesh::CreateFromMemory( ID3D11Device* pDev11,
     }
 
     // Create IBs
-    m_ppIndices = new BYTE*[m_pMeshHeader->NumIndexBuffers];
+    m_ppIndices = ( BYTE** )m_Arena.Alloc( m_pMeshHeader->NumIndexBuffers * sizeof( BYTE* ),
+                                           SDKMESH_ALLOC_BUFFER_POINTERS );
+    if( !m_ppIndices )
+        goto Error;
     for( UINT i = 0; i < m_pMeshHeader->NumIndexBuffers; i++ )
     {
         BYTE* pIndices = NULL;
@@ -483,15 +691,18 @@ HRESULT CDXUTSDKMesh::CreateFromMemory( ID3D11Device* pDev11,
         LoadMaterials( pDev9, m_pMaterialArray, m_pMeshHeader->NumMaterials, pLoaderCallbacks9 );
 
     // Create a place to store our bind pose frame matrices
-    m_pBindPoseFrameMatrices = new D3DXMATRIX[ m_pMeshHeader->NumFrames ];
+    m_pBindPoseFrameMatrices = ( D3DXMATRIX* )m_Arena.Alloc( m_pMeshHeader->NumFrames * sizeof( D3DXMATRIX ),
+                                                             SDKMESH_ALLOC_FRAME_MATRICES );
     if( !m_pBindPoseFrameMatrices )
         goto Error;
 
     // Create a place to store our transformed frame matrices
-    m_pTransformedFrameMatrices = new D3DXMATRIX[ m_pMeshHeader->NumFrames ];
+    m_pTransformedFrameMatrices = ( D3DXMATRIX* )m_Arena.Alloc( m_pMeshHeader->NumFrames * sizeof( D3DXMATRIX ),
+                                                                SDKMESH_ALLOC_FRAME_MATRICES );
     if( !m_pTransformedFrameMatrices )
         goto Error;
-    m_pWorldPoseFrameMatrices = new D3DXMATRIX[ m_pMeshHeader->NumFrames ];
+    m_pWorldPoseFrameMatrices = ( D3DXMATRIX* )m_Arena.Alloc( m_pMeshHeader->NumFrames * sizeof( D3DXMATRIX ),
+                                                              SDKMESH_ALLOC_FRAME_MATRICES );
     if( !m_pWorldPoseFrameMatrices )
         goto Error;
 
@@ -499,6 +710,7 @@ HRESULT CDXUTSDKMesh::CreateFromMemory( ID3D11Device* pDev11,
     D3D11_PRIMITIVE_TOPOLOGY PrimType;
 
     // update bounding volume 
+    DXUT_BeginPerfEvent( DXUT_PERFEVENTCOLOR2, L"SDKMesh Bounds" );
     SDKMESH_MESH* currentMesh = &m_pMeshArray[0];
     int tris = 0;
     for (UINT meshi=0; meshi < m_pMeshHeader->NumMeshes; ++meshi) {
@@ -582,6 +794,7 @@ HRESULT CDXUTSDKMesh::CreateFromMemory( ID3D11Device* pDev11,
         currentMesh->BoundingBoxExtents = half;
 
     }
+    DXUT_EndPerfEvent();
     // Update 
         
 
@@ -1069,6 +1282,7 @@ HRESULT CDXUTSDKMesh::LoadAnimation( WCHAR* szFileName )
 
     // pointer fixup
     m_pAnimationHeader = ( SDKANIMATION_FILE_HEADER* )m_pAnimationData;
+    DXUTTrackSDKMeshAlloc( SDKMESH_ALLOC_ANIMATION, ( LONGLONG )GetAllocatedBytes( SDKMESH_ALLOC_ANIMATION ) );
     m_pAnimationFrameData = ( SDKANIMATION_FRAME_DATA* )( m_pAnimationData + m_pAnimationHeader->AnimationDataOffset );
 
     UINT64 BaseOffset = sizeof( SDKANIMATION_FILE_HEADER );
@@ -1162,15 +1376,33 @@ void CDXUTSDKMesh::Destroy()
     SAFE_DELETE_ARRAY( m_pAdjacencyIndexBufferArray );
 
     SAFE_DELETE_ARRAY( m_pHeapData );
-    m_pStaticMeshData = NULL;
-    SAFE_DELETE_ARRAY( m_pAnimationData );
-    SAFE_DELETE_ARRAY( m_pBindPoseFrameMatrices );
-    SAFE_DELETE_ARRAY( m_pTransformedFrameMatrices );
-    SAFE_DELETE_ARRAY( m_pWorldPoseFrameMatrices );
+    if( m_pAnimationData )
+    {
+        DXUTTrackSDKMeshAlloc( SDKMESH_ALLOC_ANIMATION, -( LONGLONG )GetAllocatedBytes( SDKMESH_ALLOC_ANIMATION ) );
+        SAFE_DELETE_ARRAY( m_pAnimationData );
+    }
+    ReleaseArena();
+
+    m_pAnimationHeader = NULL;
+    m_pAnimationFrameData = NULL;
+
+}
 
-    SAFE_DELETE_ARRAY( m_ppVertices );
-    SAFE_DELETE_ARRAY( m_ppIndices );
+//--------------------------------------------------------------------------------------
+// Frees everything allocated from the arena in one go and clears the pointers into it
+//--------------------------------------------------------------------------------------
+void CDXUTSDKMesh::ReleaseArena()
+{
+    m_Arena.Release();
+
+    m_pStaticMeshData = NULL;
+    m_ppVertices = NULL;
+    m_ppIndices = NULL;
+    m_pBindPoseFrameMatrices = NULL;
+    m_pTransformedFrameMatrices = NULL;
+    m_pWorldPoseFrameMatrices = NULL;
 
+    // These point into the static data, which is either in the arena or already freed
     m_pMeshHeader = NULL;
     m_pVertexBufferArray = NULL;
     m_pIndexBufferArray = NULL;
@@ -1178,10 +1410,6 @@ void CDXUTSDKMesh::Destroy()
     m_pSubsetArray = NULL;
     m_pFrameArray = NULL;
     m_pMaterialArray = NULL;
-
-    m_pAnimationHeader = NULL;
-    m_pAnimationFrameData = NULL;
-
 }
 
 //--------------------------------------------------------------------------------------
@@ -1189,6 +1417,7 @@ void CDXUTSDKMesh::Destroy()
 //--------------------------------------------------------------------------------------
 void CDXUTSDKMesh::TransformBindPose( D3DXMATRIX* pWorld )
 {
+    CDXUTPerfEventGenerator eventGenerator( DXUT_PERFEVENTCOLOR3, L"SDKMesh Frame Transforms" );
     TransformBindPoseFrame( 0, pWorld );
 }
 
@@ -1197,6 +1426,7 @@ void CDXUTSDKMesh::TransformBindPose( D3DXMATRIX* pWorld )
 //--------------------------------------------------------------------------------------
 void CDXUTSDKMesh::TransformMesh( D3DXMATRIX* pWorld, double fTime )
 {
+    CDXUTPerfEventGenerator eventGenerator( DXUT_PERFEVENTCOLOR3, L"SDKMesh Frame Transforms" );
     if( m_pAnimationHeader == NULL || FTT_RELATIVE == m_pAnimationHeader->FrameTransformType )
     {
         TransformFrame( 0, pWorld, fTime );
@@ -1673,6 +1903,19 @@ BOOL CDXUTSDKMesh::HadLoadingError()
     return FALSE;
 }
 
+//--------------------------------------------------------------------------------------
+SIZE_T CDXUTSDKMesh::GetAllocatedBytes( SDKMESH_ALLOC_CATEGORY Category )
+{
+    if( Category == SDKMESH_ALLOC_ANIMATION )
+    {
+        if( !m_pAnimationHeader )
+            return 0;
+        return ( SIZE_T )( sizeof( SDKANIMATION_FILE_HEADER ) + m_pAnimationHeader->AnimationDataSize );
+    }
+
+    return m_Arena.GetCategoryBytes( Category );
+}
+
 //--------------------------------------------------------------------------------------
 UINT CDXUTSDKMesh::GetNumInfluences( UINT iMesh )
 {
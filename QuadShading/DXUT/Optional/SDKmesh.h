@@ -291,6 +291,66 @@ struct SDKMESH_CALLBACKS11
     void* pContext;
 };
 
+//--------------------------------------------------------------------------------------
+// Allocation accounting for sdkmesh loads.  Every byte a CDXUTSDKMesh allocates is
+// charged to one of these categories, both per mesh and process-wide.
+//--------------------------------------------------------------------------------------
+enum SDKMESH_ALLOC_CATEGORY
+{
+    SDKMESH_ALLOC_STATIC_DATA = 0,      // file image, or the copied header and non-buffer data
+    SDKMESH_ALLOC_BUFFER_POINTERS,      // raw vertex and index buffer pointer tables
+    SDKMESH_ALLOC_FRAME_MATRICES,       // bind pose, transformed and world pose matrices
+    SDKMESH_ALLOC_ANIMATION,            // animation file data
+    SDKMESH_ALLOC_NUM_CATEGORIES
+};
+
+struct SDKMESH_ALLOC_STATS
+{
+    UINT64 CurrentBytes[SDKMESH_ALLOC_NUM_CATEGORIES];
+    UINT64 PeakBytes[SDKMESH_ALLOC_NUM_CATEGORIES];
+    UINT64 NumAllocations[SDKMESH_ALLOC_NUM_CATEGORIES];
+    UINT64 ArenaReservedBytes;          // currently reserved by live arenas, used or not
+    UINT64 NumArenas;                   // live arenas
+};
+
+void WINAPI DXUTGetSDKMeshAllocStats( SDKMESH_ALLOC_STATS* pStats );
+void WINAPI DXUTOutputSDKMeshAllocStats();
+
+//--------------------------------------------------------------------------------------
+// CDXUTMeshArena.  Bump allocator backing a single CDXUTSDKMesh load.  The block is
+// sized up front from the SDKMESH_HEADER counts, so a load makes one heap allocation
+// (plus one for animation data, which comes from a separate file) and Release() frees
+// everything at once.
+//--------------------------------------------------------------------------------------
+#define DXUT_MESH_ARENA_ALIGNMENT 16
+
+class CDXUTMeshArena
+{
+public:
+                                    CDXUTMeshArena();
+                                    ~CDXUTMeshArena();
+
+    static SIZE_T                   GetRequiredSize( const SDKMESH_HEADER* pHeader, SIZE_T StaticBytes );
+
+    HRESULT                         Reserve( SIZE_T Bytes );
+    void*                           Alloc( SIZE_T Bytes, SDKMESH_ALLOC_CATEGORY Category );
+    void                            Release();
+
+    bool                            Owns( const void* p ) const;
+    SIZE_T                          GetCapacity() const { return m_Capacity; }
+    SIZE_T                          GetUsed() const { return m_Used; }
+    SIZE_T                          GetCategoryBytes( SDKMESH_ALLOC_CATEGORY Category ) const;
+
+protected:
+                                    CDXUTMeshArena( const CDXUTMeshArena& );
+    CDXUTMeshArena&                 operator=( const CDXUTMeshArena& );
+
+    BYTE* m_pBlock;
+    SIZE_T m_Capacity;
+    SIZE_T m_Used;
+    SIZE_T m_CategoryBytes[SDKMESH_ALLOC_NUM_CATEGORIES];
+};
+
 //--------------------------------------------------------------------------------------
 // CDXUTSDKMesh class.  This class reads the sdkmesh file format for use by the samples
 //--------------------------------------------------------------------------------------
@@ -309,6 +369,8 @@ private:
 
 protected:
     //These are the pointers to the two chunks of data loaded in from the mesh file
+    //m_pStaticMeshData, the buffer pointer tables and the frame matrices live in m_Arena
+    CDXUTMeshArena m_Arena;
     BYTE* m_pStaticMeshData;
     BYTE* m_pHeapData;
     BYTE* m_pAnimationData;
@@ -410,6 +472,8 @@ protected:
                                                  D3DXHANDLE htxNormal,
                                                  D3DXHANDLE htxSpecular );
 
+    void                            ReleaseArena();
+
 public:
                                     CDXUTSDKMesh();
     virtual                         ~CDXUTSDKMesh();
@@ -500,6 +564,7 @@ public:
     bool                            IsLoading();
     void                            SetLoading( bool bLoading );
     BOOL                            HadLoadingError();
+    SIZE_T                          GetAllocatedBytes( SDKMESH_ALLOC_CATEGORY Category );
 
     //Animation
     UINT                            GetNumInfluences( UINT iMesh );
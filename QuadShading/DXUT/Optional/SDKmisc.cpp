@@ -432,6 +432,117 @@ bool DXUTFindMediaSearchParentDirs( WCHAR* strSearchPath, int cchSearch, WCHAR*
 }
 
 
+//--------------------------------------------------------------------------------------
+// Cache keys.  The path hashing and comparison live in DXUTcacheindex, shared with the
+// offline tools.
+//--------------------------------------------------------------------------------------
+static DWORD DXUTHashTextureKey( const DXUTCache_Texture& Key )
+{
+    DWORD dwHash = DXUTHashPath( DXUT_HASH_BASIS, Key.wszSource );
+    dwHash = DXUTHashValue( dwHash, Key.Location );
+    dwHash = DXUTHashValue( dwHash, ( UINT64 )( UINT_PTR )Key.hSrcModule );
+    dwHash = DXUTHashValue( dwHash, Key.Width );
+    dwHash = DXUTHashValue( dwHash, Key.Height );
+    dwHash = DXUTHashValue( dwHash, Key.Depth );
+    dwHash = DXUTHashValue( dwHash, Key.MipLevels );
+    dwHash = DXUTHashValue( dwHash, Key.MiscFlags );
+    dwHash = DXUTHashValue( dwHash, Key.Usage9 );
+    dwHash = DXUTHashValue( dwHash, Key.Format );
+    dwHash = DXUTHashValue( dwHash, Key.CpuAccessFlags );
+    dwHash = DXUTHashValue( dwHash, Key.BindFlags );
+    return dwHash;
+}
+
+
+//--------------------------------------------------------------------------------------
+static bool DXUTTextureKeysEqual( const DXUTCache_Texture& A, const DXUTCache_Texture& B )
+{
+    return A.Location == B.Location &&
+           A.hSrcModule == B.hSrcModule &&
+           A.Width == B.Width &&
+           A.Height == B.Height &&
+           A.Depth == B.Depth &&
+           A.MipLevels == B.MipLevels &&
+           A.MiscFlags == B.MiscFlags &&
+           A.Usage9 == B.Usage9 &&
+           A.Format == B.Format &&
+           A.CpuAccessFlags == B.CpuAccessFlags &&
+           A.BindFlags == B.BindFlags &&
+           DXUTPathsEqual( A.wszSource, B.wszSource );
+}
+
+
+//--------------------------------------------------------------------------------------
+static DWORD DXUTHashEffectKey( DXUTCACHE_SOURCELOCATION Location, HMODULE hSrcModule, LPCWSTR pSrc,
+                                DWORD dwFlags )
+{
+    DWORD dwHash = DXUTHashPath( DXUT_HASH_BASIS, pSrc );
+    dwHash = DXUTHashValue( dwHash, Location );
+    dwHash = DXUTHashValue( dwHash, ( UINT64 )( UINT_PTR )hSrcModule );
+    dwHash = DXUTHashValue( dwHash, dwFlags );
+    return dwHash;
+}
+
+
+//--------------------------------------------------------------------------------------
+static DWORD DXUTHashFontKey( CONST D3DXFONT_DESC* pDesc )
+{
+    // Face names compare case-insensitively, which the path normalization also gives us
+    DWORD dwHash = DXUTHashPath( DXUT_HASH_BASIS, pDesc->FaceName );
+    dwHash = DXUTHashValue( dwHash, pDesc->Width );
+    dwHash = DXUTHashValue( dwHash, pDesc->Height );
+    dwHash = DXUTHashValue( dwHash, pDesc->Weight );
+    dwHash = DXUTHashValue( dwHash, pDesc->MipLevels );
+    dwHash = DXUTHashValue( dwHash, pDesc->Italic );
+    dwHash = DXUTHashValue( dwHash, pDesc->CharSet );
+    dwHash = DXUTHashValue( dwHash, pDesc->OutputPrecision );
+    dwHash = DXUTHashValue( dwHash, pDesc->Quality );
+    dwHash = DXUTHashValue( dwHash, pDesc->PitchAndFamily );
+    return dwHash;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Rough video memory footprint of a D3D11 texture, including its mip chain
+//--------------------------------------------------------------------------------------
+static UINT64 DXUTEstimateTextureBytes( const D3D11_TEXTURE2D_DESC& Desc )
+{
+    UINT BitsPerPixel;
+    if( Desc.Format >= DXGI_FORMAT_R32G32B32A32_TYPELESS && Desc.Format <= DXGI_FORMAT_R32G32B32A32_SINT )
+        BitsPerPixel = 128;
+    else if( Desc.Format >= DXGI_FORMAT_R32G32B32_TYPELESS && Desc.Format <= DXGI_FORMAT_R32G32B32_SINT )
+        BitsPerPixel = 96;
+    else if( Desc.Format >= DXGI_FORMAT_R16G16B16A16_TYPELESS && Desc.Format <= DXGI_FORMAT_X32_TYPELESS_G8X24_UINT )
+        BitsPerPixel = 64;
+    else if( Desc.Format >= DXGI_FORMAT_R8G8_TYPELESS && Desc.Format <= DXGI_FORMAT_R16_SINT )
+        BitsPerPixel = 16;
+    else if( Desc.Format >= DXGI_FORMAT_R8_TYPELESS && Desc.Format <= DXGI_FORMAT_A8_UNORM )
+        BitsPerPixel = 8;
+    else if( ( Desc.Format >= DXGI_FORMAT_BC1_TYPELESS && Desc.Format <= DXGI_FORMAT_BC1_UNORM_SRGB ) ||
+             ( Desc.Format >= DXGI_FORMAT_BC4_TYPELESS && Desc.Format <= DXGI_FORMAT_BC4_SNORM ) )
+        BitsPerPixel = 4;
+    else if( ( Desc.Format >= DXGI_FORMAT_BC2_TYPELESS && Desc.Format <= DXGI_FORMAT_BC3_UNORM_SRGB ) ||
+             ( Desc.Format >= DXGI_FORMAT_BC5_TYPELESS && Desc.Format <= DXGI_FORMAT_BC5_SNORM ) ||
+             ( Desc.Format >= DXGI_FORMAT_BC6H_TYPELESS && Desc.Format <= DXGI_FORMAT_BC7_UNORM_SRGB ) )
+        BitsPerPixel = 8;
+    else if( Desc.Format == DXGI_FORMAT_B5G6R5_UNORM || Desc.Format == DXGI_FORMAT_B5G5R5A1_UNORM )
+        BitsPerPixel = 16;
+    else
+        BitsPerPixel = 32;
+
+    UINT64 Bytes = 0;
+    UINT MipLevels = __max( Desc.MipLevels, 1 );
+    for( UINT i = 0; i < MipLevels; ++i )
+    {
+        UINT64 Width = __max( Desc.Width >> i, 1 );
+        UINT64 Height = __max( Desc.Height >> i, 1 );
+        Bytes += ( Width * Height * BitsPerPixel ) / 8;
+    }
+
+    return Bytes * __max( Desc.ArraySize, 1 );
+}
+
+
 //--------------------------------------------------------------------------------------
 // CDXUTResourceCache
 //--------------------------------------------------------------------------------------
@@ -446,6 +557,123 @@ CDXUTResourceCache::~CDXUTResourceCache()
     m_FontCache.RemoveAll();
 }
 
+
+//--------------------------------------------------------------------------------------
+// Returns the index of the texture entry matching Key, or -1
+//--------------------------------------------------------------------------------------
+int CDXUTResourceCache::FindTexture( const DXUTCache_Texture& Key )
+{
+    DWORD dwHash = DXUTHashTextureKey( Key );
+
+    int iSlot;
+    for( int i = m_TextureIndex.FirstMatch( dwHash, &iSlot ); i >= 0; i = m_TextureIndex.NextMatch( dwHash, &iSlot ) )
+    {
+        DXUTCache_Texture& Entry = m_TextureCache[i];
+        if( DXUTTextureKeysEqual( Entry, Key ) )
+        {
+            Entry.dwLastUsed = ++m_dwUseClock;
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+
+//--------------------------------------------------------------------------------------
+HRESULT CDXUTResourceCache::AddTexture( DXUTCache_Texture& NewEntry )
+{
+    NewEntry.dwHash = DXUTHashTextureKey( NewEntry );
+    NewEntry.dwLastUsed = ++m_dwUseClock;
+
+    HRESULT hr = m_TextureCache.Add( NewEntry );
+    if( FAILED( hr ) )
+        return hr;
+
+    m_TextureIndex.Insert( NewEntry.dwHash, m_TextureCache.GetSize() - 1 );
+    m_TextureBytes += NewEntry.SizeBytes;
+
+    EvictTextures();
+    return S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Releases an entry.  Removal shifts the array, so the caller must rebuild the indices.
+//--------------------------------------------------------------------------------------
+void CDXUTResourceCache::RemoveTexture( int iEntry )
+{
+    DXUTCache_Texture& Entry = m_TextureCache[iEntry];
+    m_TextureBytes -= Entry.SizeBytes;
+    SAFE_RELEASE( Entry.pTexture9 );
+    SAFE_RELEASE( Entry.pSRV11 );
+    m_TextureCache.Remove( iEntry );
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTResourceCache::SetTextureMemoryBudget( UINT64 BudgetBytes )
+{
+    m_TextureBudget = BudgetBytes;
+    EvictTextures();
+}
+
+
+//--------------------------------------------------------------------------------------
+// Evict least-recently-used D3D11 textures until we are back under budget.  Only
+// entries the cache holds the last reference to are candidates; anything still bound
+// to a material stays resident.
+//--------------------------------------------------------------------------------------
+void CDXUTResourceCache::EvictTextures()
+{
+    if( m_TextureBudget == 0 )
+        return;
+
+    bool bRemoved = false;
+    while( m_TextureBytes > m_TextureBudget )
+    {
+        int iOldest = -1;
+        for( int i = 0; i < m_TextureCache.GetSize(); ++i )
+        {
+            DXUTCache_Texture& Entry = m_TextureCache[i];
+            if( !Entry.pSRV11 || Entry.SizeBytes == 0 )
+                continue;
+            if( iOldest >= 0 && Entry.dwLastUsed >= m_TextureCache[iOldest].dwLastUsed )
+                continue;
+
+            Entry.pSRV11->AddRef();
+            if( Entry.pSRV11->Release() == 1 )
+                iOldest = i;
+        }
+
+        if( iOldest < 0 )
+            break;
+
+        RemoveTexture( iOldest );
+        bRemoved = true;
+    }
+
+    if( bRemoved )
+        RebuildIndices();
+}
+
+
+//--------------------------------------------------------------------------------------
+void CDXUTResourceCache::RebuildIndices()
+{
+    m_TextureIndex.RemoveAll();
+    for( int i = 0; i < m_TextureCache.GetSize(); ++i )
+        m_TextureIndex.Insert( m_TextureCache[i].dwHash, i );
+
+    m_EffectIndex.RemoveAll();
+    for( int i = 0; i < m_EffectCache.GetSize(); ++i )
+        m_EffectIndex.Insert( m_EffectCache[i].dwHash, i );
+
+    m_FontIndex.RemoveAll();
+    for( int i = 0; i < m_FontCache.GetSize(); ++i )
+        m_FontIndex.Insert( m_FontCache[i].dwHash, i );
+}
+
 //--------------------------------------------------------------------------------------
 HRESULT CDXUTResourceCache::CreateTextureFromFile( LPDIRECT3DDEVICE9 pDevice, LPCTSTR pSrcFile,
                                                    LPDIRECT3DTEXTURE9* ppTexture )
@@ -491,23 +719,23 @@ HRESULT CDXUTResourceCache::CreateTextureFromFileEx( LPDIRECT3DDEVICE9 pDevice,
                                                      D3DXIMAGE_INFO* pSrcInfo, PALETTEENTRY* pPalette,
                                                      LPDIRECT3DTEXTURE9* ppTexture )
 {
+    DXUTCache_Texture NewEntry;
+    NewEntry.Location = DXUTCACHE_LOCATION_FILE;
+    wcscpy_s( NewEntry.wszSource, MAX_PATH, pSrcFile );
+    NewEntry.Width = Width;
+    NewEntry.Height = Height;
+    NewEntry.MipLevels = MipLevels;
+    NewEntry.Usage9 = Usage;
+    NewEntry.Format9 = Format;
+    NewEntry.Pool9 = Pool;
+    NewEntry.Type9 = D3DRTYPE_TEXTURE;
+
     // Search the cache for a matching entry.
-    for( int i = 0; i < m_TextureCache.GetSize(); ++i )
+    int iEntry = FindTexture( NewEntry );
+    if( iEntry >= 0 )
     {
-        DXUTCache_Texture& Entry = m_TextureCache[i];
-        if( Entry.Location == DXUTCACHE_LOCATION_FILE &&
-            !lstrcmpW( Entry.wszSource, pSrcFile ) &&
-            Entry.Width == Width &&
-            Entry.Height == Height &&
-            Entry.MipLevels == MipLevels &&
-            Entry.Usage9 == Usage &&
-            Entry.Format9 == Format &&
-            Entry.Pool9 == Pool &&
-            Entry.Type9 == D3DRTYPE_TEXTURE )
-        {
-            // A match is found. Obtain the IDirect3DTexture9 interface and return that.
-            return Entry.pTexture9->QueryInterface( IID_IDirect3DTexture9, ( LPVOID* )ppTexture );
-        }
+        // A match is found. Obtain the IDirect3DTexture9 interface and return that.
+        return m_TextureCache[iEntry].pTexture9->QueryInterface( IID_IDirect3DTexture9, ( LPVOID* )ppTexture );
     }
 
 #if defined(PROFILE) || defined(DEBUG)
@@ -528,21 +756,11 @@ HRESULT CDXUTResourceCache::CreateTextureFromFileEx( LPDIRECT3DDEVICE9 pDevice,
     if( FAILED( hr ) )
         return hr;
 
-    DXUTCache_Texture NewEntry;
-    NewEntry.Location = DXUTCACHE_LOCATION_FILE;
-    wcscpy_s( NewEntry.wszSource, MAX_PATH, pSrcFile );
-    NewEntry.Width = Width;
-    NewEntry.Height = Height;
-    NewEntry.MipLevels = MipLevels;
-    NewEntry.Usage9 = Usage;
-    NewEntry.Format9 = Format;
-    NewEntry.Pool9 = Pool;
-    NewEntry.Type9 = D3DRTYPE_TEXTURE;
     ( *ppTexture )->QueryInterface( IID_IDirect3DBaseTexture9, ( LPVOID* )&NewEntry.pTexture9 );
 
     DXUT_SetDebugName( *ppTexture, pstrName );
 
-    m_TextureCache.Add( NewEntry );
+    AddTexture( NewEntry );
     return S_OK;
 }
 
@@ -573,23 +791,23 @@ HRESULT CDXUTResourceCache::CreateTextureFromFileEx( ID3D11Device* pDevice, ID3D
     }
 
     // Search the cache for a matching entry.
-    for( int i = 0; i < m_TextureCache.GetSize(); ++i )
+    DXUTCache_Texture Key;
+    Key.Location = DXUTCACHE_LOCATION_FILE;
+    wcscpy_s( Key.wszSource, MAX_PATH, pSrcFile );
+    Key.Width = pLoadInfo->Width;
+    Key.Height = pLoadInfo->Height;
+    Key.MipLevels = pLoadInfo->MipLevels;
+    Key.Usage11 = pLoadInfo->Usage;
+    Key.Format = pLoadInfo->Format;
+    Key.CpuAccessFlags = pLoadInfo->CpuAccessFlags;
+    Key.BindFlags = pLoadInfo->BindFlags;
+    Key.MiscFlags = pLoadInfo->MiscFlags;
+
+    int iEntry = FindTexture( Key );
+    if( iEntry >= 0 )
     {
-        DXUTCache_Texture& Entry = m_TextureCache[i];
-        if( Entry.Location == DXUTCACHE_LOCATION_FILE &&
-            !lstrcmpW( Entry.wszSource, pSrcFile ) &&
-            Entry.Width == pLoadInfo->Width &&
-            Entry.Height == pLoadInfo->Height &&
-            Entry.MipLevels == pLoadInfo->MipLevels &&
-            Entry.Usage11 == pLoadInfo->Usage &&
-            Entry.Format == pLoadInfo->Format &&
-            Entry.CpuAccessFlags == pLoadInfo->CpuAccessFlags &&
-            Entry.BindFlags == pLoadInfo->BindFlags &&
-            Entry.MiscFlags == pLoadInfo->MiscFlags )
-        {
-            // A match is found. Obtain the IDirect3DTexture9 interface and return that.
-            return Entry.pSRV11->QueryInterface( __uuidof( ID3D11ShaderResourceView ), ( LPVOID* )ppOutputRV );
-        }
+        // A match is found. Obtain the IDirect3DTexture9 interface and return that.
+        return m_TextureCache[iEntry].pSRV11->QueryInterface( __uuidof( ID3D11ShaderResourceView ), ( LPVOID* )ppOutputRV );
     }
 
 #if defined(PROFILE) || defined(DEBUG)
@@ -727,8 +945,9 @@ HRESULT CDXUTResourceCache::CreateTextureFromFileEx( ID3D11Device* pDevice, ID3D
     DXUT_SetDebugName( *ppOutputRV, pstrName );
 
     ( *ppOutputRV )->QueryInterface( __uuidof( ID3D11ShaderResourceView ), ( LPVOID* )&NewEntry.pSRV11 );
+    NewEntry.SizeBytes = DXUTEstimateTextureBytes( tex_dsc );
 
-    m_TextureCache.Add( NewEntry );
+    AddTexture( NewEntry );
 
     return S_OK;
 }
@@ -751,24 +970,24 @@ HRESULT CDXUTResourceCache::CreateTextureFromResourceEx( LPDIRECT3DDEVICE9 pDevi
                                                          DWORD MipFilter, D3DCOLOR ColorKey, D3DXIMAGE_INFO* pSrcInfo,
                                                          PALETTEENTRY* pPalette, LPDIRECT3DTEXTURE9* ppTexture )
 {
+    DXUTCache_Texture NewEntry;
+    NewEntry.Location = DXUTCACHE_LOCATION_RESOURCE;
+    NewEntry.hSrcModule = hSrcModule;
+    wcscpy_s( NewEntry.wszSource, MAX_PATH, pSrcResource );
+    NewEntry.Width = Width;
+    NewEntry.Height = Height;
+    NewEntry.MipLevels = MipLevels;
+    NewEntry.Usage9 = Usage;
+    NewEntry.Format9 = Format;
+    NewEntry.Pool9 = Pool;
+    NewEntry.Type9 = D3DRTYPE_TEXTURE;
+
     // Search the cache for a matching entry.
-    for( int i = 0; i < m_TextureCache.GetSize(); ++i )
+    int iEntry = FindTexture( NewEntry );
+    if( iEntry >= 0 )
     {
-        DXUTCache_Texture& Entry = m_TextureCache[i];
-        if( Entry.Location == DXUTCACHE_LOCATION_RESOURCE &&
-            Entry.hSrcModule == hSrcModule &&
-            !lstrcmpW( Entry.wszSource, pSrcResource ) &&
-            Entry.Width == Width &&
-            Entry.Height == Height &&
-            Entry.MipLevels == MipLevels &&
-            Entry.Usage9 == Usage &&
-            Entry.Format9 == Format &&
-            Entry.Pool9 == Pool &&
-            Entry.Type9 == D3DRTYPE_TEXTURE )
-        {
-            // A match is found. Obtain the IDirect3DTexture9 interface and return that.
-            return Entry.pTexture9->QueryInterface( IID_IDirect3DTexture9, ( LPVOID* )ppTexture );
-        }
+        // A match is found. Obtain the IDirect3DTexture9 interface and return that.
+        return m_TextureCache[iEntry].pTexture9->QueryInterface( IID_IDirect3DTexture9, ( LPVOID* )ppTexture );
     }
 
     HRESULT hr;
@@ -779,20 +998,9 @@ HRESULT CDXUTResourceCache::CreateTextureFromResourceEx( LPDIRECT3DDEVICE9 pDevi
     if( FAILED( hr ) )
         return hr;
 
-    DXUTCache_Texture NewEntry;
-    NewEntry.Location = DXUTCACHE_LOCATION_RESOURCE;
-    NewEntry.hSrcModule = hSrcModule;
-    wcscpy_s( NewEntry.wszSource, MAX_PATH, pSrcResource );
-    NewEntry.Width = Width;
-    NewEntry.Height = Height;
-    NewEntry.MipLevels = MipLevels;
-    NewEntry.Usage9 = Usage;
-    NewEntry.Format9 = Format;
-    NewEntry.Pool9 = Pool;
-    NewEntry.Type9 = D3DRTYPE_TEXTURE;
     ( *ppTexture )->QueryInterface( IID_IDirect3DBaseTexture9, ( LPVOID* )&NewEntry.pTexture9 );
 
-    m_TextureCache.Add( NewEntry );
+    AddTexture( NewEntry );
     return S_OK;
 }
 
@@ -814,22 +1022,22 @@ HRESULT CDXUTResourceCache::CreateCubeTextureFromFileEx( LPDIRECT3DDEVICE9 pDevi
                                                          D3DXIMAGE_INFO* pSrcInfo, PALETTEENTRY* pPalette,
                                                          LPDIRECT3DCUBETEXTURE9* ppCubeTexture )
 {
+    DXUTCache_Texture NewEntry;
+    NewEntry.Location = DXUTCACHE_LOCATION_FILE;
+    wcscpy_s( NewEntry.wszSource, MAX_PATH, pSrcFile );
+    NewEntry.Width = Size;
+    NewEntry.MipLevels = MipLevels;
+    NewEntry.Usage9 = Usage;
+    NewEntry.Format9 = Format;
+    NewEntry.Pool9 = Pool;
+    NewEntry.Type9 = D3DRTYPE_CUBETEXTURE;
+
     // Search the cache for a matching entry.
-    for( int i = 0; i < m_TextureCache.GetSize(); ++i )
+    int iEntry = FindTexture( NewEntry );
+    if( iEntry >= 0 )
     {
-        DXUTCache_Texture& Entry = m_TextureCache[i];
-        if( Entry.Location == DXUTCACHE_LOCATION_FILE &&
-            !lstrcmpW( Entry.wszSource, pSrcFile ) &&
-            Entry.Width == Size &&
-            Entry.MipLevels == MipLevels &&
-            Entry.Usage9 == Usage &&
-            Entry.Format9 == Format &&
-            Entry.Pool9 == Pool &&
-            Entry.Type9 == D3DRTYPE_CUBETEXTURE )
-        {
-            // A match is found. Obtain the IDirect3DCubeTexture9 interface and return that.
-            return Entry.pTexture9->QueryInterface( IID_IDirect3DCubeTexture9, ( LPVOID* )ppCubeTexture );
-        }
+        // A match is found. Obtain the IDirect3DCubeTexture9 interface and return that.
+        return m_TextureCache[iEntry].pTexture9->QueryInterface( IID_IDirect3DCubeTexture9, ( LPVOID* )ppCubeTexture );
     }
 
     HRESULT hr;
@@ -840,18 +1048,9 @@ HRESULT CDXUTResourceCache::CreateCubeTextureFromFileEx( LPDIRECT3DDEVICE9 pDevi
     if( FAILED( hr ) )
         return hr;
 
-    DXUTCache_Texture NewEntry;
-    NewEntry.Location = DXUTCACHE_LOCATION_FILE;
-    wcscpy_s( NewEntry.wszSource, MAX_PATH, pSrcFile );
-    NewEntry.Width = Size;
-    NewEntry.MipLevels = MipLevels;
-    NewEntry.Usage9 = Usage;
-    NewEntry.Format9 = Format;
-    NewEntry.Pool9 = Pool;
-    NewEntry.Type9 = D3DRTYPE_CUBETEXTURE;
     ( *ppCubeTexture )->QueryInterface( IID_IDirect3DBaseTexture9, ( LPVOID* )&NewEntry.pTexture9 );
 
-    m_TextureCache.Add( NewEntry );
+    AddTexture( NewEntry );
     return S_OK;
 }
 
@@ -875,23 +1074,23 @@ HRESULT CDXUTResourceCache::CreateCubeTextureFromResourceEx( LPDIRECT3DDEVICE9 p
                                                              D3DXIMAGE_INFO* pSrcInfo, PALETTEENTRY* pPalette,
                                                              LPDIRECT3DCUBETEXTURE9* ppCubeTexture )
 {
+    DXUTCache_Texture NewEntry;
+    NewEntry.Location = DXUTCACHE_LOCATION_RESOURCE;
+    NewEntry.hSrcModule = hSrcModule;
+    wcscpy_s( NewEntry.wszSource, MAX_PATH, pSrcResource );
+    NewEntry.Width = Size;
+    NewEntry.MipLevels = MipLevels;
+    NewEntry.Usage9 = Usage;
+    NewEntry.Format9 = Format;
+    NewEntry.Pool9 = Pool;
+    NewEntry.Type9 = D3DRTYPE_CUBETEXTURE;
+
     // Search the cache for a matching entry.
-    for( int i = 0; i < m_TextureCache.GetSize(); ++i )
+    int iEntry = FindTexture( NewEntry );
+    if( iEntry >= 0 )
     {
-        DXUTCache_Texture& Entry = m_TextureCache[i];
-        if( Entry.Location == DXUTCACHE_LOCATION_RESOURCE &&
-            Entry.hSrcModule == hSrcModule &&
-            !lstrcmpW( Entry.wszSource, pSrcResource ) &&
-            Entry.Width == Size &&
-            Entry.MipLevels == MipLevels &&
-            Entry.Usage9 == Usage &&
-            Entry.Format9 == Format &&
-            Entry.Pool9 == Pool &&
-            Entry.Type9 == D3DRTYPE_CUBETEXTURE )
-        {
-            // A match is found. Obtain the IDirect3DCubeTexture9 interface and return that.
-            return Entry.pTexture9->QueryInterface( IID_IDirect3DCubeTexture9, ( LPVOID* )ppCubeTexture );
-        }
+        // A match is found. Obtain the IDirect3DCubeTexture9 interface and return that.
+        return m_TextureCache[iEntry].pTexture9->QueryInterface( IID_IDirect3DCubeTexture9, ( LPVOID* )ppCubeTexture );
     }
 
     HRESULT hr;
@@ -902,19 +1101,9 @@ HRESULT CDXUTResourceCache::CreateCubeTextureFromResourceEx( LPDIRECT3DDEVICE9 p
     if( FAILED( hr ) )
         return hr;
 
-    DXUTCache_Texture NewEntry;
-    NewEntry.Location = DXUTCACHE_LOCATION_RESOURCE;
-    NewEntry.hSrcModule = hSrcModule;
-    wcscpy_s( NewEntry.wszSource, MAX_PATH, pSrcResource );
-    NewEntry.Width = Size;
-    NewEntry.MipLevels = MipLevels;
-    NewEntry.Usage9 = Usage;
-    NewEntry.Format9 = Format;
-    NewEntry.Pool9 = Pool;
-    NewEntry.Type9 = D3DRTYPE_CUBETEXTURE;
     ( *ppCubeTexture )->QueryInterface( IID_IDirect3DBaseTexture9, ( LPVOID* )&NewEntry.pTexture9 );
 
-    m_TextureCache.Add( NewEntry );
+    AddTexture( NewEntry );
     return S_OK;
 }
 
@@ -937,24 +1126,24 @@ HRESULT CDXUTResourceCache::CreateVolumeTextureFromFileEx( LPDIRECT3DDEVICE9 pDe
                                                            D3DXIMAGE_INFO* pSrcInfo, PALETTEENTRY* pPalette,
                                                            LPDIRECT3DVOLUMETEXTURE9* ppTexture )
 {
+    DXUTCache_Texture NewEntry;
+    NewEntry.Location = DXUTCACHE_LOCATION_FILE;
+    wcscpy_s( NewEntry.wszSource, MAX_PATH, pSrcFile );
+    NewEntry.Width = Width;
+    NewEntry.Height = Height;
+    NewEntry.Depth = Depth;
+    NewEntry.MipLevels = MipLevels;
+    NewEntry.Usage9 = Usage;
+    NewEntry.Format9 = Format;
+    NewEntry.Pool9 = Pool;
+    NewEntry.Type9 = D3DRTYPE_VOLUMETEXTURE;
+
     // Search the cache for a matching entry.
-    for( int i = 0; i < m_TextureCache.GetSize(); ++i )
+    int iEntry = FindTexture( NewEntry );
+    if( iEntry >= 0 )
     {
-        DXUTCache_Texture& Entry = m_TextureCache[i];
-        if( Entry.Location == DXUTCACHE_LOCATION_FILE &&
-            !lstrcmpW( Entry.wszSource, pSrcFile ) &&
-            Entry.Width == Width &&
-            Entry.Height == Height &&
-            Entry.Depth == Depth &&
-            Entry.MipLevels == MipLevels &&
-            Entry.Usage9 == Usage &&
-            Entry.Format9 == Format &&
-            Entry.Pool9 == Pool &&
-            Entry.Type9 == D3DRTYPE_VOLUMETEXTURE )
-        {
-            // A match is found. Obtain the IDirect3DVolumeTexture9 interface and return that.
-            return Entry.pTexture9->QueryInterface( IID_IDirect3DVolumeTexture9, ( LPVOID* )ppTexture );
-        }
+        // A match is found. Obtain the IDirect3DVolumeTexture9 interface and return that.
+        return m_TextureCache[iEntry].pTexture9->QueryInterface( IID_IDirect3DVolumeTexture9, ( LPVOID* )ppTexture );
     }
 
     HRESULT hr;
@@ -965,20 +1154,9 @@ HRESULT CDXUTResourceCache::CreateVolumeTextureFromFileEx( LPDIRECT3DDEVICE9 pDe
     if( FAILED( hr ) )
         return hr;
 
-    DXUTCache_Texture NewEntry;
-    NewEntry.Location = DXUTCACHE_LOCATION_FILE;
-    wcscpy_s( NewEntry.wszSource, MAX_PATH, pSrcFile );
-    NewEntry.Width = Width;
-    NewEntry.Height = Height;
-    NewEntry.Depth = Depth;
-    NewEntry.MipLevels = MipLevels;
-    NewEntry.Usage9 = Usage;
-    NewEntry.Format9 = Format;
-    NewEntry.Pool9 = Pool;
-    NewEntry.Type9 = D3DRTYPE_VOLUMETEXTURE;
     ( *ppTexture )->QueryInterface( IID_IDirect3DBaseTexture9, ( LPVOID* )&NewEntry.pTexture9 );
 
-    m_TextureCache.Add( NewEntry );
+    AddTexture( NewEntry );
     return S_OK;
 }
 
@@ -1003,25 +1181,25 @@ HRESULT CDXUTResourceCache::CreateVolumeTextureFromResourceEx( LPDIRECT3DDEVICE9
                                                                D3DXIMAGE_INFO* pSrcInfo, PALETTEENTRY* pPalette,
                                                                LPDIRECT3DVOLUMETEXTURE9* ppVolumeTexture )
 {
+    DXUTCache_Texture NewEntry;
+    NewEntry.Location = DXUTCACHE_LOCATION_RESOURCE;
+    NewEntry.hSrcModule = hSrcModule;
+    wcscpy_s( NewEntry.wszSource, MAX_PATH, pSrcResource );
+    NewEntry.Width = Width;
+    NewEntry.Height = Height;
+    NewEntry.Depth = Depth;
+    NewEntry.MipLevels = MipLevels;
+    NewEntry.Usage9 = Usage;
+    NewEntry.Format9 = Format;
+    NewEntry.Pool9 = Pool;
+    NewEntry.Type9 = D3DRTYPE_VOLUMETEXTURE;
+
     // Search the cache for a matching entry.
-    for( int i = 0; i < m_TextureCache.GetSize(); ++i )
+    int iEntry = FindTexture( NewEntry );
+    if( iEntry >= 0 )
     {
-        DXUTCache_Texture& Entry = m_TextureCache[i];
-        if( Entry.Location == DXUTCACHE_LOCATION_RESOURCE &&
-            Entry.hSrcModule == hSrcModule &&
-            !lstrcmpW( Entry.wszSource, pSrcResource ) &&
-            Entry.Width == Width &&
-            Entry.Height == Height &&
-            Entry.Depth == Depth &&
-            Entry.MipLevels == MipLevels &&
-            Entry.Usage9 == Usage &&
-            Entry.Format9 == Format &&
-            Entry.Pool9 == Pool &&
-            Entry.Type9 == D3DRTYPE_VOLUMETEXTURE )
-        {
-            // A match is found. Obtain the IDirect3DVolumeTexture9 interface and return that.
-            return Entry.pTexture9->QueryInterface( IID_IDirect3DVolumeTexture9, ( LPVOID* )ppVolumeTexture );
-        }
+        // A match is found. Obtain the IDirect3DVolumeTexture9 interface and return that.
+        return m_TextureCache[iEntry].pTexture9->QueryInterface( IID_IDirect3DVolumeTexture9, ( LPVOID* )ppVolumeTexture );
     }
 
     HRESULT hr;
@@ -1034,21 +1212,9 @@ HRESULT CDXUTResourceCache::CreateVolumeTextureFromResourceEx( LPDIRECT3DDEVICE9
     if( FAILED( hr ) )
         return hr;
 
-    DXUTCache_Texture NewEntry;
-    NewEntry.Location = DXUTCACHE_LOCATION_RESOURCE;
-    NewEntry.hSrcModule = hSrcModule;
-    wcscpy_s( NewEntry.wszSource, MAX_PATH, pSrcResource );
-    NewEntry.Width = Width;
-    NewEntry.Height = Height;
-    NewEntry.Depth = Depth;
-    NewEntry.MipLevels = MipLevels;
-    NewEntry.Usage9 = Usage;
-    NewEntry.Format9 = Format;
-    NewEntry.Pool9 = Pool;
-    NewEntry.Type9 = D3DRTYPE_VOLUMETEXTURE;
     ( *ppVolumeTexture )->QueryInterface( IID_IDirect3DBaseTexture9, ( LPVOID* )&NewEntry.pTexture9 );
 
-    m_TextureCache.Add( NewEntry );
+    AddTexture( NewEntry );
     return S_OK;
 }
 
@@ -1079,7 +1245,10 @@ HRESULT CDXUTResourceCache::CreateFont( LPDIRECT3DDEVICE9 pDevice, UINT Height,
 HRESULT CDXUTResourceCache::CreateFontIndirect( LPDIRECT3DDEVICE9 pDevice, CONST D3DXFONT_DESC *pDesc, LPD3DXFONT *ppFont )
  {
     // Search the cache for a matching entry.
-    for( int i = 0; i < m_FontCache.GetSize(); ++i )
+    DWORD dwHash = DXUTHashFontKey( pDesc );
+
+    int iSlot;
+    for( int i = m_FontIndex.FirstMatch( dwHash, &iSlot ); i >= 0; i = m_FontIndex.NextMatch( dwHash, &iSlot ) )
  {
         DXUTCache_Font &Entry = m_FontCache[i];
 
@@ -1114,8 +1283,10 @@ HRESULT CDXUTResourceCache::CreateFontIndirect( LPDIRECT3DDEVICE9 pDevice, CONST
     ( D3DXFONT_DESC & )NewEntry = *pDesc;
     NewEntry.pFont = *ppFont;
     NewEntry.pFont->AddRef();
+    NewEntry.dwHash = dwHash;
 
     m_FontCache.Add( NewEntry );
+    m_FontIndex.Insert( dwHash, m_FontCache.GetSize() - 1 );
     return S_OK;
 }
 
@@ -1127,12 +1298,15 @@ HRESULT CDXUTResourceCache::CreateEffectFromFile( LPDIRECT3DDEVICE9 pDevice, LPC
                                                   LPD3DXBUFFER* ppCompilationErrors )
 {
     // Search the cache for a matching entry.
-    for( int i = 0; i < m_EffectCache.GetSize(); ++i )
+    DWORD dwHash = DXUTHashEffectKey( DXUTCACHE_LOCATION_FILE, NULL, pSrcFile, Flags );
+
+    int iSlot;
+    for( int i = m_EffectIndex.FirstMatch( dwHash, &iSlot ); i >= 0; i = m_EffectIndex.NextMatch( dwHash, &iSlot ) )
     {
         DXUTCache_Effect& Entry = m_EffectCache[i];
 
         if( Entry.Location == DXUTCACHE_LOCATION_FILE &&
-            !lstrcmpW( Entry.wszSource, pSrcFile ) &&
+            DXUTPathsEqual( Entry.wszSource, pSrcFile ) &&
             Entry.dwFlags == Flags )
         {
             // A match is found.  Increment the ref coutn and return the ID3DXEffect object.
@@ -1156,12 +1330,15 @@ HRESULT CDXUTResourceCache::CreateEffectFromFile( LPDIRECT3DDEVICE9 pDevice, LPC
 
     DXUTCache_Effect NewEntry;
     NewEntry.Location = DXUTCACHE_LOCATION_FILE;
+    NewEntry.hSrcModule = NULL;
     wcscpy_s( NewEntry.wszSource, MAX_PATH, pSrcFile );
     NewEntry.dwFlags = Flags;
     NewEntry.pEffect = *ppEffect;
     NewEntry.pEffect->AddRef();
+    NewEntry.dwHash = DXUTHashEffectKey( NewEntry.Location, NewEntry.hSrcModule, NewEntry.wszSource, Flags );
 
     m_EffectCache.Add( NewEntry );
+    m_EffectIndex.Insert( NewEntry.dwHash, m_EffectCache.GetSize() - 1 );
     return S_OK;
 }
 
@@ -1173,13 +1350,16 @@ HRESULT CDXUTResourceCache::CreateEffectFromResource( LPDIRECT3DDEVICE9 pDevice,
                                                       LPD3DXEFFECT* ppEffect, LPD3DXBUFFER* ppCompilationErrors )
 {
     // Search the cache for a matching entry.
-    for( int i = 0; i < m_EffectCache.GetSize(); ++i )
+    DWORD dwHash = DXUTHashEffectKey( DXUTCACHE_LOCATION_RESOURCE, hSrcModule, pSrcResource, Flags );
+
+    int iSlot;
+    for( int i = m_EffectIndex.FirstMatch( dwHash, &iSlot ); i >= 0; i = m_EffectIndex.NextMatch( dwHash, &iSlot ) )
     {
         DXUTCache_Effect& Entry = m_EffectCache[i];
 
         if( Entry.Location == DXUTCACHE_LOCATION_RESOURCE &&
             Entry.hSrcModule == hSrcModule &&
-            !lstrcmpW( Entry.wszSource, pSrcResource ) &&
+            DXUTPathsEqual( Entry.wszSource, pSrcResource ) &&
             Entry.dwFlags == Flags )
         {
             // A match is found.  Increment the ref coutn and return the ID3DXEffect object.
@@ -1208,8 +1388,10 @@ HRESULT CDXUTResourceCache::CreateEffectFromResource( LPDIRECT3DDEVICE9 pDevice,
     NewEntry.dwFlags = Flags;
     NewEntry.pEffect = *ppEffect;
     NewEntry.pEffect->AddRef();
+    NewEntry.dwHash = DXUTHashEffectKey( NewEntry.Location, NewEntry.hSrcModule, NewEntry.wszSource, Flags );
 
     m_EffectCache.Add( NewEntry );
+    m_EffectIndex.Insert( NewEntry.dwHash, m_EffectCache.GetSize() - 1 );
     return S_OK;
 }
 
@@ -1252,10 +1434,9 @@ HRESULT CDXUTResourceCache::OnLostDevice()
     // Release all the default pool textures
     for( int i = m_TextureCache.GetSize() - 1; i >= 0; --i )
         if( m_TextureCache[i].Pool9 == D3DPOOL_DEFAULT )
-        {
-            SAFE_RELEASE( m_TextureCache[i].pTexture9 );
-            m_TextureCache.Remove( i );  // Remove the entry
-        }
+            RemoveTexture( i );  // Remove the entry
+
+    RebuildIndices();
 
     return S_OK;
 }
@@ -1276,11 +1457,11 @@ HRESULT CDXUTResourceCache::OnDestroyDevice()
         m_FontCache.Remove( i );
     }
     for( int i = m_TextureCache.GetSize() - 1; i >= 0; --i )
-    {
-        SAFE_RELEASE( m_TextureCache[i].pTexture9 );
-        SAFE_RELEASE( m_TextureCache[i].pSRV11 );
-        m_TextureCache.Remove( i );
-    }
+        RemoveTexture( i );
+
+    m_TextureIndex.RemoveAll();
+    m_EffectIndex.RemoveAll();
+    m_FontIndex.RemoveAll();
 
     return S_OK;
 }
@@ -9,6 +9,8 @@
 #ifndef SDKMISC_H
 #define SDKMISC_H
 
+#include "DXUTcacheindex.h"
+
 
 //-----------------------------------------------------------------------------
 // Resource cache for textures, fonts, meshs, and effects.  
@@ -54,16 +56,20 @@ struct DXUTCache_Texture
     IDirect3DBaseTexture9* pTexture9;
     ID3D11ShaderResourceView* pSRV11;
 
+    DWORD dwHash;       // Hash of the normalized source and creation parameters
+    DWORD dwLastUsed;   // Use clock value of the last lookup, for LRU eviction
+    UINT64 SizeBytes;   // Estimated video memory footprint (D3D11 textures only)
+
             DXUTCache_Texture()
             {
-                pTexture9 = NULL;
-                pSRV11 = NULL;
+                ZeroMemory( this, sizeof( DXUTCache_Texture ) );
             }
 };
 
 struct DXUTCache_Font : public D3DXFONT_DESC
 {
     ID3DXFont* pFont;
+    DWORD dwHash;
 };
 
 struct DXUTCache_Effect
@@ -73,6 +79,7 @@ struct DXUTCache_Effect
     HMODULE hSrcModule;
     DWORD dwFlags;
     ID3DXEffect* pEffect;
+    DWORD dwHash;
 };
 
 
@@ -157,6 +164,12 @@ public:
     HRESULT                 OnLostDevice();
     HRESULT                 OnDestroyDevice();
 
+    // Least-recently-used textures that are no longer referenced outside the cache are
+    // released once the estimated D3D11 texture memory exceeds the budget (0 = unlimited)
+    void                    SetTextureMemoryBudget( UINT64 BudgetBytes );
+    UINT64                  GetTextureMemoryBudget() const { return m_TextureBudget; }
+    UINT64                  GetTextureMemoryUsage() const { return m_TextureBytes; }
+
 protected:
     friend CDXUTResourceCache& WINAPI DXUTGetGlobalResourceCache();
     friend HRESULT WINAPI   DXUTInitialize3DEnvironment();
@@ -165,11 +178,28 @@ protected:
 
                             CDXUTResourceCache()
                             {
+                                m_dwUseClock = 0;
+                                m_TextureBudget = 0;
+                                m_TextureBytes = 0;
                             }
 
+    int                     FindTexture( const DXUTCache_Texture& Key );
+    HRESULT                 AddTexture( DXUTCache_Texture& NewEntry );
+    void                    RemoveTexture( int iEntry );
+    void                    EvictTextures();
+    void                    RebuildIndices();
+
     CGrowableArray <DXUTCache_Texture> m_TextureCache;
     CGrowableArray <DXUTCache_Effect> m_EffectCache;
     CGrowableArray <DXUTCache_Font> m_FontCache;
+
+    CDXUTCacheIndex m_TextureIndex;
+    CDXUTCacheIndex m_EffectIndex;
+    CDXUTCacheIndex m_FontIndex;
+
+    DWORD m_dwUseClock;
+    UINT64 m_TextureBudget;
+    UINT64 m_TextureBytes;
 };
 
 CDXUTResourceCache& WINAPI DXUTGetGlobalResourceCache();
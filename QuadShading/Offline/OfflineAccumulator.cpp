@@ -0,0 +1,169 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineAccumulator.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#include "OfflineAccumulator.h"
+#include "DXUTprofiler.h"
+
+#include <string.h>
+#include <algorithm>
+
+//--------------------------------------------------------------------------------------
+const char* OfflineGetAccumStatName(OFFLINE_ACCUM_STAT stat)
+{
+    static const char* names[OFFLINE_NB_ACCUM_STATS] =
+    {
+        "mean",
+        "ema",
+        "max"
+    };
+    return names[stat];
+}
+
+
+//--------------------------------------------------------------------------------------
+// COfflineAccumulator
+//--------------------------------------------------------------------------------------
+COfflineAccumulator::COfflineAccumulator() : m_Width(0),
+                                             m_Height(0),
+                                             m_Alpha(OFFLINE_ACCUM_DEFAULT_ALPHA)
+{
+    Clear();
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineAccumulator::Resize(uint32_t width, uint32_t height, float alpha)
+{
+    m_Width  = width;
+    m_Height = height;
+    m_Alpha  = alpha;
+    m_Sums.resize((size_t)width*height);
+    m_Averages.resize((size_t)width*height);
+    m_Maxima.resize((size_t)width*height);
+    Clear();
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineAccumulator::Clear()
+{
+    std::fill(m_Sums.begin(), m_Sums.end(), 0);
+    std::fill(m_Averages.begin(), m_Averages.end(), 0.0f);
+    std::fill(m_Maxima.begin(), m_Maxima.end(), 0);
+
+    m_Frames      = 0;
+    m_QuadSum     = 0;
+    m_QuadAverage = 0.0f;
+    m_PeakFrame   = 0;
+    memset(m_LiveStatsSums, 0, sizeof(m_LiveStatsSums));
+    memset(m_LiveStatsAverages, 0, sizeof(m_LiveStatsAverages));
+    memset(&m_PeakTotals, 0, sizeof(m_PeakTotals));
+}
+
+
+//--------------------------------------------------------------------------------------
+// The first frame seeds the averages, so they don't start out pulled towards zero
+//--------------------------------------------------------------------------------------
+OfflineLiveTotals COfflineAccumulator::Accumulate(const COfflineOverdraw& overdraw, bool bSlices)
+{
+    DXUT_PROFILE_SCOPE(L"Offline Accumulate");
+
+    const float alpha = m_Frames ? m_Alpha : 1.0f;
+    const uint32_t width  = std::min(m_Width, overdraw.GetWidth());
+    const uint32_t height = std::min(m_Height, overdraw.GetHeight());
+
+    for (uint32_t y = 0; y < height; y++)
+    {
+        size_t row = (size_t)y*m_Width;
+        for (uint32_t x = 0; x < width; x++)
+        {
+            uint32_t count = overdraw.GetQuadCount(x, y, bSlices);
+            m_Sums[row + x]     += count;
+            m_Averages[row + x] += alpha*((float)count - m_Averages[row + x]);
+            m_Maxima[row + x]    = std::max(m_Maxima[row + x], count);
+        }
+    }
+
+    OfflineLiveTotals totals = overdraw.GetLiveTotals(bSlices);
+    m_QuadSum     += totals.Quads;
+    m_QuadAverage += alpha*((float)totals.Quads - m_QuadAverage);
+    for (uint32_t i = 0; i < OFFLINE_NB_SLICES; i++)
+    {
+        m_LiveStatsSums[i]     += totals.LiveStats[i];
+        m_LiveStatsAverages[i] += alpha*((float)totals.LiveStats[i] - m_LiveStatsAverages[i]);
+    }
+
+    if (!m_Frames || totals.Quads > m_PeakTotals.Quads)
+    {
+        m_PeakTotals = totals;
+        m_PeakFrame  = m_Frames;
+    }
+
+    m_Frames++;
+    return totals;
+}
+
+
+//--------------------------------------------------------------------------------------
+OfflineLiveTotals COfflineAccumulator::GetMeanTotals() const
+{
+    OfflineLiveTotals totals;
+    const uint32_t frames = std::max(m_Frames, 1u);
+    totals.Quads = (m_QuadSum + frames/2)/frames;
+    for (uint32_t i = 0; i < OFFLINE_NB_SLICES; i++)
+        totals.LiveStats[i] = (m_LiveStatsSums[i] + frames/2)/frames;
+    return totals;
+}
+
+
+//--------------------------------------------------------------------------------------
+OfflineLiveTotals COfflineAccumulator::GetAverageTotals() const
+{
+    OfflineLiveTotals totals;
+    totals.Quads = (uint64_t)(m_QuadAverage + 0.5f);
+    for (uint32_t i = 0; i < OFFLINE_NB_SLICES; i++)
+        totals.LiveStats[i] = (uint64_t)(m_LiveStatsAverages[i] + 0.5f);
+    return totals;
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineAccumulator::Resolve(OFFLINE_ACCUM_STAT stat, COfflineOverdraw* pOverdraw) const
+{
+    pOverdraw->Resize(m_Width, m_Height);
+    pOverdraw->Clear();
+
+    const uint64_t frames = std::max(m_Frames, 1u);
+    for (uint32_t y = 0; y < m_Height; y++)
+    {
+        for (uint32_t x = 0; x < m_Width; x++)
+        {
+            uint32_t count;
+            if (stat == OFFLINE_ACCUM_MEAN)
+                count = (uint32_t)((GetSum(x, y) + frames/2)/frames);
+            else if (stat == OFFLINE_ACCUM_EMA)
+                count = (uint32_t)(GetAverage(x, y) + 0.5f);
+            else
+                count = GetMax(x, y);
+
+            if (count)
+                pOverdraw->Add(x, y, 0, count);
+        }
+    }
+
+    // The pie follows the same statistic as the heatmap
+    OfflineLiveTotals totals = stat == OFFLINE_ACCUM_MEAN ? GetMeanTotals() :
+                                stat == OFFLINE_ACCUM_EMA ? GetAverageTotals() : m_PeakTotals;
+    for (uint32_t i = 0; i < OFFLINE_NB_SLICES; i++)
+        pOverdraw->AddLiveStats(i, (uint32_t)totals.LiveStats[i]);
+}
+
+
+//--------------------------------------------------------------------------------------
+size_t COfflineAccumulator::GetMemoryUsed() const
+{
+    return m_Sums.size()*sizeof(m_Sums[0]) + m_Averages.size()*sizeof(m_Averages[0]) +
+           m_Maxima.size()*sizeof(m_Maxima[0]);
+}
@@ -0,0 +1,86 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineAccumulator.h
+//
+// Overshading over a sequence of frames for the offline overshading engine. The demo
+// clears its overdraw and liveStats buffers every frame; here each frame's counts are
+// folded into a running sum, an exponential moving average and a maximum per quad, so
+// a camera path can be judged by its average cost rather than by single-frame spikes.
+// Memory depends only on the grid size, however many frames go in; each frame's
+// totals are handed back for the caller to stream out as a time series.
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef OFFLINE_ACCUMULATOR_H
+#define OFFLINE_ACCUMULATOR_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "OfflineMethods.h"
+
+#define OFFLINE_ACCUM_DEFAULT_ALPHA     0.1f    // weight of the newest frame in the averages
+
+enum OFFLINE_ACCUM_STAT
+{
+    OFFLINE_ACCUM_MEAN,         // sum over the frames, divided by their number
+    OFFLINE_ACCUM_EMA,          // exponential moving average
+    OFFLINE_ACCUM_MAX,          // largest count seen in any frame
+    OFFLINE_NB_ACCUM_STATS
+};
+
+const char* OfflineGetAccumStatName(OFFLINE_ACCUM_STAT stat);
+
+
+//--------------------------------------------------------------------------------------
+class COfflineAccumulator
+{
+public:
+                        COfflineAccumulator();
+
+    // Sizes the grids, in quads, and clears them
+    void                Resize(uint32_t width, uint32_t height, float alpha);
+    void                Clear();
+
+    // Folds in one frame's counts, returning the frame's totals
+    OfflineLiveTotals   Accumulate(const COfflineOverdraw& overdraw, bool bSlices);
+
+    uint32_t            GetWidth() const        { return m_Width; }
+    uint32_t            GetHeight() const       { return m_Height; }
+    uint32_t            GetNumFrames() const    { return m_Frames; }
+    float               GetAlpha() const        { return m_Alpha; }
+    uint64_t            GetSum(uint32_t x, uint32_t y) const        { return m_Sums[(size_t)y*m_Width + x]; }
+    float               GetAverage(uint32_t x, uint32_t y) const    { return m_Averages[(size_t)y*m_Width + x]; }
+    uint32_t            GetMax(uint32_t x, uint32_t y) const        { return m_Maxima[(size_t)y*m_Width + x]; }
+
+    // Totals over the sequence: the mean frame, the moving average and the frame with
+    // the most quads
+    OfflineLiveTotals   GetMeanTotals() const;
+    OfflineLiveTotals   GetAverageTotals() const;
+    const OfflineLiveTotals& GetPeakTotals() const { return m_PeakTotals; }
+    uint32_t            GetPeakFrame() const    { return m_PeakFrame; }
+
+    // Writes a statistic, rounded to whole quads, into slice 0 of an overdraw buffer the
+    // compositor can draw, with the matching totals for the pie chart. MAX takes the
+    // peak frame's liveStats.
+    void                Resolve(OFFLINE_ACCUM_STAT stat, COfflineOverdraw* pOverdraw) const;
+
+    size_t              GetMemoryUsed() const;
+
+protected:
+    uint32_t                m_Width;
+    uint32_t                m_Height;
+    float                   m_Alpha;
+    uint32_t                m_Frames;
+    std::vector<uint64_t>   m_Sums;
+    std::vector<float>      m_Averages;
+    std::vector<uint32_t>   m_Maxima;
+    uint64_t                m_QuadSum;
+    uint64_t                m_LiveStatsSums[OFFLINE_NB_SLICES];
+    float                   m_QuadAverage;
+    float                   m_LiveStatsAverages[OFFLINE_NB_SLICES];
+    OfflineLiveTotals       m_PeakTotals;
+    uint32_t                m_PeakFrame;
+};
+
+#endif
@@ -0,0 +1,533 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineAnalysis.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+#include "OfflineAnalysis.h"
+#include "OfflineRun.h"
+#include "OfflineAccumulator.h"
+#include "OfflineJitter.h"
+#include "OfflineMultiView.h"
+#include "OfflinePrepass.h"
+#include "OfflineQuadMerge.h"
+#include "OfflineTiles.h"
+#include "OfflineVRS.h"
+#include "OfflineVisBuffer.h"
+#include "DXUTprofiler.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+#define OFFLINE_MAX_THREADS         256
+#define OFFLINE_MAX_RUNS            1000
+#define OFFLINE_MAX_VRS_TILE        256
+#define OFFLINE_MAX_CASCADES        16
+#define OFFLINE_MAX_MERGE_WINDOW    65536
+#define OFFLINE_MAX_JITTER_SAMPLES  1024
+#define OFFLINE_MAX_JITTER_REGION   4096
+#define OFFLINE_MAX_FRAMES          100000
+#define OFFLINE_MAX_PATH_FRAMES     100000
+#define OFFLINE_MAX_FPS             240
+#define OFFLINE_MAX_INSTANCES       65536
+
+
+//--------------------------------------------------------------------------------------
+static void PrintUsage()
+{
+    fprintf(stderr,
+        "Offline overshading analysis\n"
+        "  -mesh <file>           .sdkmesh to analyse (default Media/hebe.sdkmesh)\n"
+        "  -size <width> <height> viewport size (default 1024 1024)\n"
+        "  -out <prefix>          output file prefix (default \"offline\")\n"
+        "  -trace <file>          write a CPU profile (Chrome .json or binary), if built with DXUT_PROFILER\n"
+        "  -depth d24|d32         depth buffer format (default d24, as the demo)\n"
+        "  -stress                stress ScenePS1's quad lock instead of comparing methods\n"
+        "  -threads <n>           stress threads (default: one per core)\n"
+        "  -runs <n>              stress runs per mode, or timed -cull or -cache runs (default 3)\n"
+        "  -record <file>         save the quad stream that -stress replays\n"
+        "  -replay <file>         stress a saved quad stream instead of a mesh\n"
+        "  -prepass               compare shading with and without the depth pre-pass\n"
+        "  -quad-cost <c>         cost of shading a quad, in depth tests (default 32)\n"
+        "  -hiz                   cull subsets and clusters against a Hi-Z pyramid\n"
+        "  -cull                  report what triangle culling rejects, SIMD against scalar\n"
+        "  -cache                 time resource cache lookups of 10k texture names, indexed against a scan\n"
+        "  -visbuffer             derive quad metrics from a visibility buffer, and save it\n"
+        "  -vis-load <file>       re-analyse a saved visibility buffer instead of a mesh\n"
+        "  -fetch-cost <c>        visibility-buffer cost per covered pixel (default 4)\n"
+        "  -vrs                   estimate variable-rate shading savings\n"
+        "  -vrs-tile <n>          shading-rate image tile size, a multiple of 4 (default 16)\n"
+        "  -vrs-rates <file>      shading-rate image to use (PGM of D3D12_SHADING_RATE values)\n"
+        "  -merge                 simulate quad-fragment merging\n"
+        "  -merge-window <n>      quads waiting to merge (default 16)\n"
+        "  -jitter                shade under Halton subpixel offsets, as TAA does\n"
+        "  -jitter-count <n>      jitter offsets (default 16)\n"
+        "  -jitter-region <n>     jitter statistics region size in pixels, even (default 64)\n"
+        "  -multiview <views>     cascades|cube|stereo|all, from one traversal\n"
+        "  -cascades <n>          shadow cascades (default 4)\n"
+        "  -view-size <n>         shadow map and cube face size (default 1024)\n"
+        "  -ipd <d>               stereo eye separation, in mesh units (default 0.4)\n"
+        "  -composite             write the frame the demo shows for each method\n"
+        "  -image-format <f>      png|ppm|exr (default png)\n"
+        "  -frames <n>            also write n jittered heatmaps in the background (default 0)\n"
+        "  -video <file>          write a heatmap video of the camera orbiting the mesh\n"
+        "  -video-format <f>      y4m|rgb (default y4m)\n"
+        "  -path-frames <n>       frames in the camera path, one full turn (default 240)\n"
+        "  -fps <n>               video frame rate, and the step through -camera-path (default 30)\n"
+        "  -camera-path <file>    follow keyframed views instead of orbiting, for -video and -accumulate\n"
+        "  -tiles                 reduce overdraw into 8, 32 and 128 quad tile statistics\n"
+        "  -tile-budget <b>       mean overdraw a tile may reach (default 2)\n"
+        "  -sizes                 histogram quad liveness by triangle area and edge ratio\n"
+        "  -accumulate            average overdraw over the camera path, with a per-frame time series\n"
+        "  -ema-alpha <a>         weight of each new frame in the moving average, in (0, 1] (default 0.1)\n"
+        "  -instances <n>         shade n copies of the mesh, sweeping up from one (default 1024)\n"
+        "  -instance-layout <l>   grid|scatter (default grid)\n"
+        "  -instance-file <file>  shade the instances listed in a file, \"x y z [yaw [scale]]\" per line\n"
+        "  -scene <file>          shade a scene file of meshes, instances, material costs and cameras\n"
+        "  -regress <file>        check fixed views against golden statistics (Media/hebe_golden.txt)\n"
+        "  -regress-update <file> write the golden statistics instead\n");
+}
+
+
+//--------------------------------------------------------------------------------------
+// A decimal count from minimum to maximum; atoi would wrap a negative one
+//--------------------------------------------------------------------------------------
+static bool ParseCount(const char* option, const char* value, uint32_t minimum, uint32_t maximum, uint32_t* pCount)
+{
+    char* pEnd = NULL;
+    unsigned long count = isdigit((unsigned char)value[0]) ? strtoul(value, &pEnd, 10) : 0;
+    if (!pEnd || *pEnd || count < minimum || count > maximum)
+    {
+        fprintf(stderr, "Invalid %s \"%s\": must be from %u to %u\n", option, value, minimum, maximum);
+        return false;
+    }
+    *pCount = (uint32_t)count;
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+static bool ParseOptions(int argc, char** argv, OfflineOptions* pOptions)
+{
+    pOptions->meshFile     = NULL;
+    pOptions->outputPrefix = "offline";
+    pOptions->traceFile    = NULL;
+    pOptions->width        = 1024;
+    pOptions->height       = 1024;
+    pOptions->mode         = OFFLINE_RUN_METHODS;
+    pOptions->depthFormat  = OFFLINE_DEPTH_FORMAT_D24_UNORM;
+    pOptions->threads      = std::thread::hardware_concurrency();
+    pOptions->runs         = 3;
+    pOptions->recordFile   = NULL;
+    pOptions->replayFile   = NULL;
+    pOptions->quadCost     = OfflineGetDefaultDepthCostModel().ShadedQuadCost;
+    pOptions->visFile      = NULL;
+    pOptions->fetchCost    = OfflineGetDefaultVisCostModel().PixelFetchCost;
+    pOptions->vrsTile      = OFFLINE_VRS_DEFAULT_TILE;
+    pOptions->vrsRatesFile = NULL;
+    pOptions->mergeWindow  = OFFLINE_MERGE_DEFAULT_WINDOW;
+    pOptions->jitterCount  = OFFLINE_JITTER_DEFAULT_SAMPLES;
+    pOptions->jitterRegion = OFFLINE_JITTER_DEFAULT_REGION;
+    pOptions->viewSets     = OFFLINE_VIEWS_CASCADES | OFFLINE_VIEWS_CUBE | OFFLINE_VIEWS_STEREO;
+    pOptions->cascades     = OFFLINE_DEFAULT_CASCADES;
+    pOptions->viewSize     = OFFLINE_DEFAULT_VIEW_SIZE;
+    pOptions->ipd          = OFFLINE_DEFAULT_STEREO_IPD;
+    pOptions->imageFormat  = OFFLINE_IMAGE_PNG;
+    pOptions->frames       = 0;
+    pOptions->videoFile    = NULL;
+    pOptions->videoFormat  = OFFLINE_VIDEO_Y4M;
+    pOptions->pathFrames   = OFFLINE_DEFAULT_PATH_FRAMES;
+    pOptions->fps          = OFFLINE_VIDEO_DEFAULT_FPS;
+    pOptions->cameraPathFile = NULL;
+    pOptions->tileBudget   = OFFLINE_TILE_DEFAULT_BUDGET;
+    pOptions->emaAlpha     = OFFLINE_ACCUM_DEFAULT_ALPHA;
+    pOptions->instances    = OFFLINE_DEFAULT_INSTANCES;
+    pOptions->instanceLayout = OFFLINE_INSTANCES_GRID;
+    pOptions->instanceFile = NULL;
+    pOptions->sceneFile    = NULL;
+    pOptions->goldenFile   = NULL;
+    pOptions->bUpdateGolden = false;
+
+    for (int i = 0; i < argc; i++)
+    {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (strcmp(arg, "-offline") == 0)
+            continue;
+        else if (strcmp(arg, "-mesh") == 0 && hasValue)
+            pOptions->meshFile = argv[++i];
+        else if (strcmp(arg, "-out") == 0 && hasValue)
+            pOptions->outputPrefix = argv[++i];
+        else if (strcmp(arg, "-trace") == 0 && hasValue)
+        {
+#ifdef DXUT_PROFILER
+            pOptions->traceFile = argv[++i];
+#else
+            // The scopes compile to nothing, so the profile would be empty
+            fprintf(stderr, "-trace needs a build with DXUT_PROFILER defined\n");
+            return false;
+#endif
+        }
+        else if (strcmp(arg, "-depth") == 0 && hasValue)
+        {
+            const char* format = argv[++i];
+            if (strcmp(format, "d24") == 0)
+                pOptions->depthFormat = OFFLINE_DEPTH_FORMAT_D24_UNORM;
+            else if (strcmp(format, "d32") == 0)
+                pOptions->depthFormat = OFFLINE_DEPTH_FORMAT_D32_FLOAT;
+            else
+            {
+                fprintf(stderr, "Unknown depth format \"%s\"\n", format);
+                return false;
+            }
+        }
+        else if (strcmp(arg, "-stress") == 0)
+            pOptions->mode = OFFLINE_RUN_STRESS;
+        else if (strcmp(arg, "-prepass") == 0)
+            pOptions->mode = OFFLINE_RUN_PREPASS;
+        else if (strcmp(arg, "-hiz") == 0)
+            pOptions->mode = OFFLINE_RUN_HIZ;
+        else if (strcmp(arg, "-cull") == 0)
+            pOptions->mode = OFFLINE_RUN_CULL;
+        else if (strcmp(arg, "-cache") == 0)
+            pOptions->mode = OFFLINE_RUN_CACHE;
+        else if (strcmp(arg, "-visbuffer") == 0)
+            pOptions->mode = OFFLINE_RUN_VISBUFFER;
+        else if (strcmp(arg, "-vis-load") == 0 && hasValue)
+        {
+            pOptions->mode    = OFFLINE_RUN_VISBUFFER;
+            pOptions->visFile = argv[++i];
+        }
+        else if (strcmp(arg, "-fetch-cost") == 0 && hasValue)
+            pOptions->fetchCost = atof(argv[++i]);
+        else if (strcmp(arg, "-vrs") == 0)
+            pOptions->mode = OFFLINE_RUN_VRS;
+        else if (strcmp(arg, "-vrs-tile") == 0 && hasValue)
+        {
+            if (!ParseCount(arg, argv[++i], 4, OFFLINE_MAX_VRS_TILE, &pOptions->vrsTile))
+                return false;
+        }
+        else if (strcmp(arg, "-vrs-rates") == 0 && hasValue)
+            pOptions->vrsRatesFile = argv[++i];
+        else if (strcmp(arg, "-merge") == 0)
+            pOptions->mode = OFFLINE_RUN_MERGE;
+        else if (strcmp(arg, "-merge-window") == 0 && hasValue)
+        {
+            if (!ParseCount(arg, argv[++i], 0, OFFLINE_MAX_MERGE_WINDOW, &pOptions->mergeWindow))
+                return false;
+        }
+        else if (strcmp(arg, "-jitter") == 0)
+            pOptions->mode = OFFLINE_RUN_JITTER;
+        else if (strcmp(arg, "-jitter-count") == 0 && hasValue)
+        {
+            if (!ParseCount(arg, argv[++i], 1, OFFLINE_MAX_JITTER_SAMPLES, &pOptions->jitterCount))
+                return false;
+        }
+        else if (strcmp(arg, "-jitter-region") == 0 && hasValue)
+        {
+            if (!ParseCount(arg, argv[++i], 2, OFFLINE_MAX_JITTER_REGION, &pOptions->jitterRegion))
+                return false;
+        }
+        else if (strcmp(arg, "-multiview") == 0 && hasValue)
+        {
+            const char* views = argv[++i];
+            pOptions->mode = OFFLINE_RUN_MULTIVIEW;
+            if (strcmp(views, "cascades") == 0)
+                pOptions->viewSets = OFFLINE_VIEWS_CASCADES;
+            else if (strcmp(views, "cube") == 0)
+                pOptions->viewSets = OFFLINE_VIEWS_CUBE;
+            else if (strcmp(views, "stereo") == 0)
+                pOptions->viewSets = OFFLINE_VIEWS_STEREO;
+            else if (strcmp(views, "all") == 0)
+                pOptions->viewSets = OFFLINE_VIEWS_CASCADES | OFFLINE_VIEWS_CUBE | OFFLINE_VIEWS_STEREO;
+            else
+            {
+                fprintf(stderr, "Unknown views \"%s\"\n", views);
+                return false;
+            }
+        }
+        else if (strcmp(arg, "-cascades") == 0 && hasValue)
+        {
+            if (!ParseCount(arg, argv[++i], 1, OFFLINE_MAX_CASCADES, &pOptions->cascades))
+                return false;
+        }
+        else if (strcmp(arg, "-view-size") == 0 && hasValue)
+        {
+            if (!ParseCount(arg, argv[++i], 2, 16384, &pOptions->viewSize))
+                return false;
+        }
+        else if (strcmp(arg, "-ipd") == 0 && hasValue)
+            pOptions->ipd = (float)atof(argv[++i]);
+        else if (strcmp(arg, "-composite") == 0)
+            pOptions->mode = OFFLINE_RUN_COMPOSITE;
+        else if (strcmp(arg, "-image-format") == 0 && hasValue)
+        {
+            const char* format = argv[++i];
+            int f = 0;
+            while (f < OFFLINE_NB_IMAGE_FORMATS && strcmp(format, OfflineGetImageFormatName((OFFLINE_IMAGE_FORMAT)f)))
+                f++;
+            if (f == OFFLINE_NB_IMAGE_FORMATS)
+            {
+                fprintf(stderr, "Unknown image format \"%s\"\n", format);
+                return false;
+            }
+            pOptions->imageFormat = (OFFLINE_IMAGE_FORMAT)f;
+        }
+        else if (strcmp(arg, "-frames") == 0 && hasValue)
+        {
+            if (!ParseCount(arg, argv[++i], 0, OFFLINE_MAX_FRAMES, &pOptions->frames))
+                return false;
+        }
+        else if (strcmp(arg, "-video") == 0 && hasValue)
+        {
+            pOptions->mode      = OFFLINE_RUN_VIDEO;
+            pOptions->videoFile = argv[++i];
+        }
+        else if (strcmp(arg, "-video-format") == 0 && hasValue)
+        {
+            const char* format = argv[++i];
+            int f = 0;
+            while (f < OFFLINE_NB_VIDEO_FORMATS && strcmp(format, OfflineGetVideoFormatName((OFFLINE_VIDEO_FORMAT)f)))
+                f++;
+            if (f == OFFLINE_NB_VIDEO_FORMATS)
+            {
+                fprintf(stderr, "Unknown video format \"%s\"\n", format);
+                return false;
+            }
+            pOptions->videoFormat = (OFFLINE_VIDEO_FORMAT)f;
+        }
+        else if (strcmp(arg, "-path-frames") == 0 && hasValue)
+        {
+            if (!ParseCount(arg, argv[++i], 1, OFFLINE_MAX_PATH_FRAMES, &pOptions->pathFrames))
+                return false;
+        }
+        else if (strcmp(arg, "-fps") == 0 && hasValue)
+        {
+            if (!ParseCount(arg, argv[++i], 1, OFFLINE_MAX_FPS, &pOptions->fps))
+                return false;
+        }
+        else if (strcmp(arg, "-camera-path") == 0 && hasValue)
+            pOptions->cameraPathFile = argv[++i];
+        else if (strcmp(arg, "-tiles") == 0)
+            pOptions->mode = OFFLINE_RUN_TILES;
+        else if (strcmp(arg, "-tile-budget") == 0 && hasValue)
+            pOptions->tileBudget = atof(argv[++i]);
+        else if (strcmp(arg, "-sizes") == 0)
+            pOptions->mode = OFFLINE_RUN_SIZES;
+        else if (strcmp(arg, "-accumulate") == 0)
+            pOptions->mode = OFFLINE_RUN_ACCUMULATE;
+        else if (strcmp(arg, "-ema-alpha") == 0 && hasValue)
+        {
+            pOptions->emaAlpha = (float)atof(argv[++i]);
+            if (!(pOptions->emaAlpha > 0.0f && pOptions->emaAlpha <= 1.0f))
+            {
+                fprintf(stderr, "Invalid moving average weight %s: must be in (0, 1]\n", argv[i]);
+                return false;
+            }
+        }
+        else if (strcmp(arg, "-instances") == 0 && hasValue)
+        {
+            pOptions->mode = OFFLINE_RUN_INSTANCES;
+            if (!ParseCount(arg, argv[++i], 1, OFFLINE_MAX_INSTANCES, &pOptions->instances))
+                return false;
+        }
+        else if (strcmp(arg, "-instance-layout") == 0 && hasValue)
+        {
+            const char* layout = argv[++i];
+            if (strcmp(layout, "grid") == 0)
+                pOptions->instanceLayout = OFFLINE_INSTANCES_GRID;
+            else if (strcmp(layout, "scatter") == 0)
+                pOptions->instanceLayout = OFFLINE_INSTANCES_SCATTER;
+            else
+            {
+                fprintf(stderr, "Unknown instance layout \"%s\"\n", layout);
+                return false;
+            }
+        }
+        else if (strcmp(arg, "-instance-file") == 0 && hasValue)
+        {
+            pOptions->mode           = OFFLINE_RUN_INSTANCES;
+            pOptions->instanceLayout = OFFLINE_INSTANCES_FILE;
+            pOptions->instanceFile   = argv[++i];
+        }
+        else if (strcmp(arg, "-scene") == 0 && hasValue)
+        {
+            pOptions->mode      = OFFLINE_RUN_SCENE;
+            pOptions->sceneFile = argv[++i];
+        }
+        else if ((strcmp(arg, "-regress") == 0 || strcmp(arg, "-regress-update") == 0) && hasValue)
+        {
+            pOptions->mode          = OFFLINE_RUN_REGRESS;
+            pOptions->bUpdateGolden = strcmp(arg, "-regress-update") == 0;
+            pOptions->goldenFile    = argv[++i];
+        }
+        else if (strcmp(arg, "-quad-cost") == 0 && hasValue)
+            pOptions->quadCost = atof(argv[++i]);
+        else if (strcmp(arg, "-threads") == 0 && hasValue)
+        {
+            if (!ParseCount(arg, argv[++i], 1, OFFLINE_MAX_THREADS, &pOptions->threads))
+                return false;
+        }
+        else if (strcmp(arg, "-runs") == 0 && hasValue)
+        {
+            if (!ParseCount(arg, argv[++i], 1, OFFLINE_MAX_RUNS, &pOptions->runs))
+                return false;
+        }
+        else if (strcmp(arg, "-record") == 0 && hasValue)
+            pOptions->recordFile = argv[++i];
+        else if (strcmp(arg, "-replay") == 0 && hasValue)
+            pOptions->replayFile = argv[++i];
+        else if (strcmp(arg, "-size") == 0 && i + 2 < argc)
+        {
+            pOptions->width  = (uint32_t)atoi(argv[++i]);
+            pOptions->height = (uint32_t)atoi(argv[++i]);
+            if (pOptions->width < 2 || pOptions->height < 2 || pOptions->width > 16384 || pOptions->height > 16384)
+            {
+                fprintf(stderr, "Invalid size %ux%u\n", pOptions->width, pOptions->height);
+                return false;
+            }
+        }
+        else
+        {
+            fprintf(stderr, "Unknown or incomplete option \"%s\"\n", arg);
+            return false;
+        }
+    }
+
+    // hardware_concurrency() is 0 when it can't tell
+    if (pOptions->threads < 1)
+        pOptions->threads = 1;
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+static bool WriteTrace(const char* fileName)
+{
+    FILE* pFile = fopen(fileName, "wb");
+    if (!pFile)
+        return false;
+
+    const char* ext = strrchr(fileName, '.');
+    bool ok = ext && strcmp(ext, ".json") == 0 ? DXUTProfilerWriteChromeTrace(pFile) : DXUTProfilerWriteBinary(pFile);
+
+    fclose(pFile);
+    return ok;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Same media as the interactive demo, run from the project or the media folder
+//--------------------------------------------------------------------------------------
+static bool LoadMesh(OfflineOptions* pOptions, COfflineMesh* pMesh)
+{
+    if (pOptions->meshFile)
+        return pMesh->Load(pOptions->meshFile) && pMesh->GetNumTriangles();
+
+    const char* defaultMeshes[] = { "Media/hebe.sdkmesh", "hebe.sdkmesh" };
+    for (int i = 0; i < 2 && !pMesh->GetNumTriangles(); i++)
+    {
+        pOptions->meshFile = defaultMeshes[i];
+        pMesh->Load(pOptions->meshFile);
+    }
+    return pMesh->GetNumTriangles() != 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+int OfflineMain(int argc, char** argv)
+{
+    OfflineOptions options;
+    if (!ParseOptions(argc, argv, &options))
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    // A saved quad stream or visibility buffer needs no geometry, nor does the cache lookup,
+    // and a scene brings its own
+    COfflineMesh mesh;
+    bool needMesh = !(options.mode == OFFLINE_RUN_STRESS && options.replayFile) &&
+                    !(options.mode == OFFLINE_RUN_VISBUFFER && options.visFile) &&
+                    options.mode != OFFLINE_RUN_CACHE && options.mode != OFFLINE_RUN_SCENE;
+    if (needMesh && !LoadMesh(&options, &mesh))
+    {
+        fprintf(stderr, "Failed to load %s\n", options.meshFile);
+        return 1;
+    }
+
+    int result;
+    switch (options.mode)
+    {
+    case OFFLINE_RUN_STRESS:
+        result = OfflineRunStress(options, mesh);
+        break;
+    case OFFLINE_RUN_PREPASS:
+        result = OfflineRunPrepass(options, mesh);
+        break;
+    case OFFLINE_RUN_HIZ:
+        result = OfflineRunHiZ(options, mesh);
+        break;
+    case OFFLINE_RUN_CULL:
+        result = OfflineRunCull(options, mesh);
+        break;
+    case OFFLINE_RUN_CACHE:
+        result = OfflineRunCache(options);
+        break;
+    case OFFLINE_RUN_VISBUFFER:
+        result = OfflineRunVisBuffer(options, mesh);
+        break;
+    case OFFLINE_RUN_VRS:
+        result = OfflineRunVRS(options, mesh);
+        break;
+    case OFFLINE_RUN_MERGE:
+        result = OfflineRunMerge(options, mesh);
+        break;
+    case OFFLINE_RUN_JITTER:
+        result = OfflineRunJitter(options, mesh);
+        break;
+    case OFFLINE_RUN_MULTIVIEW:
+        result = OfflineRunMultiView(options, mesh);
+        break;
+    case OFFLINE_RUN_COMPOSITE:
+        result = OfflineRunComposite(options, mesh);
+        break;
+    case OFFLINE_RUN_VIDEO:
+        result = OfflineRunVideo(options, mesh);
+        break;
+    case OFFLINE_RUN_TILES:
+        result = OfflineRunTiles(options, mesh);
+        break;
+    case OFFLINE_RUN_SIZES:
+        result = OfflineRunSizes(options, mesh);
+        break;
+    case OFFLINE_RUN_ACCUMULATE:
+        result = OfflineRunAccumulate(options, mesh);
+        break;
+    case OFFLINE_RUN_INSTANCES:
+        result = OfflineRunInstances(options, mesh);
+        break;
+    case OFFLINE_RUN_SCENE:
+        result = OfflineRunScene(options);
+        break;
+    case OFFLINE_RUN_REGRESS:
+        result = OfflineRunRegress(options, mesh);
+        break;
+    default:
+        result = OfflineRunMethods(options, mesh);
+        break;
+    }
+
+    if (options.traceFile && !WriteTrace(options.traceFile))
+    {
+        fprintf(stderr, "Failed to write %s\n", options.traceFile);
+        return 1;
+    }
+
+    return result;
+}
@@ -0,0 +1,17 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineAnalysis.h
+//
+// Command-line driver for the offline overshading engine. QuadShading.exe runs it
+// instead of opening a window when given "-offline"; on other platforms OfflineMain.cpp
+// provides a main() that calls it directly.
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef OFFLINE_ANALYSIS_H
+#define OFFLINE_ANALYSIS_H
+
+// Arguments are UTF-8; returns the process exit code
+int OfflineMain(int argc, char** argv);
+
+#endif
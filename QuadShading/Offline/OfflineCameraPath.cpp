@@ -0,0 +1,240 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineCameraPath.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+#include "OfflineCameraPath.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#define OFFLINE_KEY_VALUES      10
+
+//--------------------------------------------------------------------------------------
+void OfflineFrameBounds(const Vec3& boundsMin, const Vec3& boundsMax, OfflineCamera* pCamera)
+{
+    const Vec3  diagonal = Subtract(boundsMax, boundsMin);
+    const float radius   = std::max(0.5f*sqrtf(Dot(diagonal, diagonal)), 0.001f);
+    const float distance = radius/sinf(0.5f*pCamera->fovY);
+
+    pCamera->at    = Scale(Add(boundsMin, boundsMax), 0.5f);
+    pCamera->eye   = Add(pCamera->at, Scale(Normalize(MakeVec3(0, 0.5f, -1.0f)), distance));
+    pCamera->zNear = std::max(0.5f*(distance - radius), 0.01f);
+    pCamera->zFar  = distance + radius;
+}
+
+
+//--------------------------------------------------------------------------------------
+// COfflineOrbitPath
+//--------------------------------------------------------------------------------------
+COfflineOrbitPath::COfflineOrbitPath() : m_Frames(0),
+                                         m_TurnFrames(1)
+{
+    memset(&m_Start, 0, sizeof(m_Start));
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineOrbitPath::Setup(const OfflineCamera& start, uint32_t frames, uint32_t turnFrames)
+{
+    m_Start      = start;
+    m_Frames     = frames;
+    m_TurnFrames = turnFrames ? turnFrames : 1;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Rodrigues' rotation of the target-to-eye vector about the up axis. The angle is taken
+// from the frame's place in its turn, so that long paths don't drift.
+//--------------------------------------------------------------------------------------
+void COfflineOrbitPath::GetCamera(uint32_t frame, OfflineCamera* pCamera) const
+{
+    float angle = 2.0f*3.141592654f*(float)(frame%m_TurnFrames)/(float)m_TurnFrames;
+    float c = cosf(angle);
+    float s = sinf(angle);
+
+    Vec3 axis   = Normalize(m_Start.up);
+    Vec3 offset = Subtract(m_Start.eye, m_Start.at);
+    Vec3 turned = Add(Add(Scale(offset, c), Scale(Cross(axis, offset), s)), Scale(axis, Dot(axis, offset)*(1.0f - c)));
+
+    *pCamera     = m_Start;
+    pCamera->eye = Add(m_Start.at, turned);
+}
+
+
+//--------------------------------------------------------------------------------------
+// COfflineKeyframePath
+//--------------------------------------------------------------------------------------
+COfflineKeyframePath::COfflineKeyframePath() : m_Fps(OFFLINE_DEFAULT_PATH_FPS)
+{
+    memset(&m_Base, 0, sizeof(m_Base));
+    m_Base.up = MakeVec3(0, 1, 0);
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineKeyframePath::Setup(const OfflineCamera& base, uint32_t fps)
+{
+    m_Base = base;
+    m_Fps  = fps ? fps : 1;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool COfflineKeyframePath::AddKey(const OfflineCameraKey& key)
+{
+    if (!m_Keys.empty() && !(key.Time > m_Keys.back().Time))
+        return false;
+
+    m_Keys.push_back(key);
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool COfflineKeyframePath::Load(const char* fileName)
+{
+    m_Keys.clear();
+
+    FILE* pFile = fopen(fileName, "rt");
+    if (!pFile)
+        return false;
+
+    char line[256];
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), pFile))
+    {
+        char keyword[16];
+        int  length = 0;
+        if (sscanf(line, " %15s%n", keyword, &length) < 1 || keyword[0] == '#')
+            continue;
+
+        OfflineCameraKey key;
+        float fov;
+        key.Up = MakeVec3(0, 1, 0);
+        int values = strcmp(keyword, "key") == 0 ?
+                     sscanf(line + length, "%f %f %f %f %f %f %f %f %f %f %f", &key.Time, &key.Eye.x, &key.Eye.y,
+                            &key.Eye.z, &key.At.x, &key.At.y, &key.At.z, &fov, &key.Up.x, &key.Up.y, &key.Up.z) : 0;
+        ok = values == 8 || values == 11;
+        if (ok)
+        {
+            key.FovY = fov*3.141592654f/180.0f;
+            ok = AddKey(key);
+        }
+    }
+    fclose(pFile);
+
+    return ok && !m_Keys.empty();
+}
+
+
+//--------------------------------------------------------------------------------------
+bool COfflineKeyframePath::Save(const char* fileName) const
+{
+    FILE* pFile = fopen(fileName, "wt");
+    if (!pFile)
+        return false;
+
+    fprintf(pFile, "# time  eye x y z  at x y z  fov  up x y z\n");
+    for (size_t i = 0; i < m_Keys.size(); i++)
+    {
+        const OfflineCameraKey& key = m_Keys[i];
+        fprintf(pFile, "key %.9g  %.9g %.9g %.9g  %.9g %.9g %.9g  %.9g  %.9g %.9g %.9g\n", key.Time, key.Eye.x,
+                key.Eye.y, key.Eye.z, key.At.x, key.At.y, key.At.z, key.FovY*180.0f/3.141592654f, key.Up.x, key.Up.y,
+                key.Up.z);
+    }
+
+    return fclose(pFile) == 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+uint32_t COfflineKeyframePath::GetNumFrames() const
+{
+    if (m_Keys.empty())
+        return 0;
+
+    // A little slack, so that a last key on a step isn't lost to rounding
+    return (uint32_t)((double)GetDuration()*m_Fps + 1e-3) + 1;
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineKeyframePath::GetCamera(uint32_t frame, OfflineCamera* pCamera) const
+{
+    Evaluate(m_Keys.empty() ? 0.0f : (float)(m_Keys[0].Time + (double)frame/m_Fps), pCamera);
+}
+
+
+//--------------------------------------------------------------------------------------
+static void GetKeyValues(const OfflineCameraKey& key, float values[OFFLINE_KEY_VALUES])
+{
+    values[0] = key.Eye.x;
+    values[1] = key.Eye.y;
+    values[2] = key.Eye.z;
+    values[3] = key.At.x;
+    values[4] = key.At.y;
+    values[5] = key.At.z;
+    values[6] = key.Up.x;
+    values[7] = key.Up.y;
+    values[8] = key.Up.z;
+    values[9] = key.FovY;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Cubic Hermite segments, with the tangent at each key the slope between its
+// neighbours, or to its one neighbour at the ends. Times are the keys' own, so
+// unevenly spaced keys don't speed up or slow down the camera between them.
+//--------------------------------------------------------------------------------------
+void COfflineKeyframePath::Evaluate(float time, OfflineCamera* pCamera) const
+{
+    *pCamera = m_Base;
+    if (m_Keys.empty())
+        return;
+
+    const uint32_t last = (uint32_t)m_Keys.size() - 1;
+    uint32_t k = 0;
+    while (k < last && m_Keys[k + 1].Time <= time)
+        k++;
+
+    float values[OFFLINE_KEY_VALUES];
+    if (k == last || time <= m_Keys[0].Time)
+        GetKeyValues(m_Keys[time <= m_Keys[0].Time ? 0 : last], values);
+    else
+    {
+        const uint32_t k0 = k > 0 ? k - 1 : k;
+        const uint32_t k3 = k + 1 < last ? k + 2 : last;
+
+        float p0[OFFLINE_KEY_VALUES], p1[OFFLINE_KEY_VALUES], p2[OFFLINE_KEY_VALUES], p3[OFFLINE_KEY_VALUES];
+        GetKeyValues(m_Keys[k0], p0);
+        GetKeyValues(m_Keys[k], p1);
+        GetKeyValues(m_Keys[k + 1], p2);
+        GetKeyValues(m_Keys[k3], p3);
+
+        const float t0 = m_Keys[k0].Time, t1 = m_Keys[k].Time, t2 = m_Keys[k + 1].Time, t3 = m_Keys[k3].Time;
+        const float dt = t2 - t1;
+        const float u  = (time - t1)/dt;
+        const float u2 = u*u, u3 = u2*u;
+
+        const float h00 = 2.0f*u3 - 3.0f*u2 + 1.0f;
+        const float h10 = u3 - 2.0f*u2 + u;
+        const float h01 = -2.0f*u3 + 3.0f*u2;
+        const float h11 = u3 - u2;
+
+        for (uint32_t i = 0; i < OFFLINE_KEY_VALUES; i++)
+        {
+            float m1 = (p2[i] - p0[i])/(t2 - t0);
+            float m2 = (p3[i] - p1[i])/(t3 - t1);
+            values[i] = h00*p1[i] + h10*dt*m1 + h01*p2[i] + h11*dt*m2;
+        }
+    }
+
+    pCamera->eye  = MakeVec3(values[0], values[1], values[2]);
+    pCamera->at   = MakeVec3(values[3], values[4], values[5]);
+    pCamera->up   = MakeVec3(values[6], values[7], values[8]);
+    pCamera->fovY = values[9];
+}
@@ -0,0 +1,117 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineCameraPath.h
+//
+// Camera paths for the offline overshading engine: a camera for every frame of a
+// sequence, evaluated on demand so that a path costs the same however many frames it
+// runs to. The orbit path turns the demo's start-up view about its target, as dragging
+// CModelViewerCamera round the model does. The keyframe path splines between views
+// saved to a file, which the demo can record from CModelViewerCamera and play back at
+// a fixed step, so that a view found by hand is benchmarked the same way every run:
+//
+//   key <time> <eye x y z> <at x y z> <fov> [<up x y z>]   seconds and degrees
+//
+// with # for comments. The up axis is y unless given; CModelViewerCamera rolls it as
+// the view turns, so recorded keys carry it.
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef OFFLINE_CAMERA_PATH_H
+#define OFFLINE_CAMERA_PATH_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "OfflineMath.h"
+
+#define OFFLINE_DEFAULT_PATH_FRAMES     240
+#define OFFLINE_DEFAULT_PATH_FPS        30
+
+// Points the camera, from above and in front, at a world-space box and backs it off
+// until the whole box is in view, with the clip planes pulled in around the box for
+// depth precision. The field of view and up axis are kept.
+void OfflineFrameBounds(const Vec3& boundsMin, const Vec3& boundsMax, OfflineCamera* pCamera);
+
+
+//--------------------------------------------------------------------------------------
+class IOfflineCameraPath
+{
+public:
+    virtual             ~IOfflineCameraPath() {}
+
+    virtual uint32_t    GetNumFrames() const = 0;
+
+    // Safe to call from several threads at once
+    virtual void        GetCamera(uint32_t frame, OfflineCamera* pCamera) const = 0;
+};
+
+
+//--------------------------------------------------------------------------------------
+// The start camera's eye turned about the up axis through its target, a full turn
+// every turnFrames frames
+//--------------------------------------------------------------------------------------
+class COfflineOrbitPath : public IOfflineCameraPath
+{
+public:
+                        COfflineOrbitPath();
+
+    void                Setup(const OfflineCamera& start, uint32_t frames, uint32_t turnFrames);
+
+    virtual uint32_t    GetNumFrames() const    { return m_Frames; }
+    virtual void        GetCamera(uint32_t frame, OfflineCamera* pCamera) const;
+
+protected:
+    OfflineCamera       m_Start;
+    uint32_t            m_Frames;
+    uint32_t            m_TurnFrames;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Keyframed views, interpolated by a Catmull-Rom spline through the eye, target, up
+// axis and field of view with the keys' own spacing in time, and stepped at a fixed
+// frame rate. The clip planes are the base camera's.
+//--------------------------------------------------------------------------------------
+struct OfflineCameraKey
+{
+    float               Time;
+    Vec3                Eye;
+    Vec3                At;
+    Vec3                Up;
+    float               FovY;
+};
+
+class COfflineKeyframePath : public IOfflineCameraPath
+{
+public:
+                        COfflineKeyframePath();
+
+    void                Setup(const OfflineCamera& base, uint32_t fps);
+
+    // Keys must come later than the last; one that doesn't is refused, returning false
+    bool                AddKey(const OfflineCameraKey& key);
+    void                Clear()                 { m_Keys.clear(); }
+    uint32_t            GetNumKeys() const      { return (uint32_t)m_Keys.size(); }
+    const OfflineCameraKey& GetKey(uint32_t i) const { return m_Keys[i]; }
+    float               GetDuration() const     { return m_Keys.empty() ? 0.0f : m_Keys.back().Time - m_Keys[0].Time; }
+
+    // Written to nine digits, so that times, eyes and targets read back bit for bit
+    // Fails on the first malformed or out-of-order key, so a benchmark never runs a
+    // path other than the one in the file
+    bool                Load(const char* fileName);
+    bool                Save(const char* fileName) const;
+
+    // A frame at every step from the first key up to and including the last
+    virtual uint32_t    GetNumFrames() const;
+    virtual void        GetCamera(uint32_t frame, OfflineCamera* pCamera) const;
+
+    // The view at a time after the first key, held at the ends
+    void                Evaluate(float time, OfflineCamera* pCamera) const;
+
+protected:
+    std::vector<OfflineCameraKey> m_Keys;
+    OfflineCamera       m_Base;
+    uint32_t            m_Fps;
+};
+
+#endif
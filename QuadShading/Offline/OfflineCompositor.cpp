@@ -0,0 +1,183 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineCompositor.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#include "OfflineCompositor.h"
+#include "DXUTprofiler.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#if (defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)) && !defined(OFFLINE_NO_SIMD)
+#define OFFLINE_COMPOSITOR_SSE2
+#include <emmintrin.h>
+#endif
+
+#define OFFLINE_RGBA(r, g, b)   ((uint32_t)(r) | ((uint32_t)(g) << 8) | ((uint32_t)(b) << 16) | 0xff000000)
+
+// PieChart's centre and radius, in pixels
+#define OFFLINE_PIE_CENTRE      144
+#define OFFLINE_PIE_RADIUS      128
+
+static const uint32_t s_Palette[OFFLINE_NB_COLOURS] =
+{
+    OFFLINE_RGBA(  0,   0,   0),
+    OFFLINE_RGBA(  2,  25, 147),
+    OFFLINE_RGBA(  0, 149, 255),
+    OFFLINE_RGBA(  0, 253, 255),
+    OFFLINE_RGBA(142, 250,   0),
+    OFFLINE_RGBA(255, 251,   0),
+    OFFLINE_RGBA(255, 147,   0),
+    OFFLINE_RGBA(255,  38,   0),
+    OFFLINE_RGBA(148,  17,   0),
+    OFFLINE_RGBA(255,   0, 255)
+};
+
+//--------------------------------------------------------------------------------------
+uint32_t OfflineGetColour(uint32_t value)
+{
+    return s_Palette[std::min(value, (uint32_t)OFFLINE_NB_COLOURS - 1)];
+}
+
+
+//--------------------------------------------------------------------------------------
+// Colours n quads, a multiple of four, into 2n pixels
+//--------------------------------------------------------------------------------------
+#ifdef OFFLINE_COMPOSITOR_SSE2
+
+static void MapQuadRow(const uint32_t* pCounts, uint32_t n, uint32_t* pPixels)
+{
+    __m128i palette[OFFLINE_NB_COLOURS];
+    __m128i values[OFFLINE_NB_COLOURS];
+    for (uint32_t c = 0; c < OFFLINE_NB_COLOURS; c++)
+    {
+        palette[c] = _mm_set1_epi32((int)s_Palette[c]);
+        values[c]  = _mm_set1_epi32((int)c);
+    }
+
+    // Anything that matches no earlier entry, however large, keeps the last colour
+    for (uint32_t i = 0; i < n; i += 4)
+    {
+        __m128i counts  = _mm_loadu_si128((const __m128i*)(pCounts + i));
+        __m128i colours = palette[OFFLINE_NB_COLOURS - 1];
+        for (uint32_t c = 0; c < OFFLINE_NB_COLOURS - 1; c++)
+        {
+            __m128i mask = _mm_cmpeq_epi32(counts, values[c]);
+            colours = _mm_or_si128(_mm_and_si128(mask, palette[c]), _mm_andnot_si128(mask, colours));
+        }
+
+        _mm_storeu_si128((__m128i*)(pPixels + 2*i), _mm_unpacklo_epi32(colours, colours));
+        _mm_storeu_si128((__m128i*)(pPixels + 2*i + 4), _mm_unpackhi_epi32(colours, colours));
+    }
+}
+
+#else
+
+static void MapQuadRow(const uint32_t* pCounts, uint32_t n, uint32_t* pPixels)
+{
+    for (uint32_t i = 0; i < n; i++)
+    {
+        uint32_t colour = OfflineGetColour(pCounts[i]);
+        pPixels[2*i]     = colour;
+        pPixels[2*i + 1] = colour;
+    }
+}
+
+#endif
+
+
+//--------------------------------------------------------------------------------------
+void OfflineComposeHeatmap(const COfflineOverdraw& overdraw, bool bSlices, uint32_t width, uint32_t height,
+                           OfflineImage* pImage)
+{
+    DXUT_PROFILE_SCOPE(L"Offline Compose");
+
+    pImage->Resize(width, height);
+
+    const uint32_t quadsX = ((width + 1)/2 + 3) & ~3;
+    const uint32_t gridX  = std::min(overdraw.GetWidth(), (width + 1)/2);
+    std::vector<uint32_t> counts(quadsX, 0);
+    std::vector<uint32_t> pixels(2*quadsX);
+
+    for (uint32_t qy = 0; 2*qy < height; qy++)
+    {
+        if (qy < overdraw.GetHeight())
+        {
+            for (uint32_t qx = 0; qx < gridX; qx++)
+                counts[qx] = overdraw.GetQuadCount(qx, qy, bSlices);
+        }
+        else
+            std::fill(counts.begin(), counts.end(), 0);
+
+        MapQuadRow(&counts[0], quadsX, &pixels[0]);
+        memcpy(pImage->GetRow(2*qy), &pixels[0], (size_t)width*4);
+        if (2*qy + 1 < height)
+            memcpy(pImage->GetRow(2*qy + 1), &pixels[0], (size_t)width*4);
+    }
+
+    OfflineDrawPieChart(overdraw.GetLiveTotals(bSlices), pImage);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Each sample inside the pie adds a quarter of its colour over the heatmap, and the sum
+// saturates as the UNORM target does
+//--------------------------------------------------------------------------------------
+void OfflineDrawPieChart(const OfflineLiveTotals& totals, OfflineImage* pImage)
+{
+    const float t4 = (float)totals.LiveStats[3];
+    const float t3 = (float)totals.LiveStats[2] + t4;
+    const float t2 = (float)totals.LiveStats[1] + t3;
+    const float t1 = (float)totals.LiveStats[0] + t2;
+
+    const uint32_t first = OFFLINE_PIE_CENTRE - OFFLINE_PIE_RADIUS - 1;
+    const uint32_t endX  = std::min(pImage->Width, (uint32_t)(OFFLINE_PIE_CENTRE + OFFLINE_PIE_RADIUS));
+    const uint32_t endY  = std::min(pImage->Height, (uint32_t)(OFFLINE_PIE_CENTRE + OFFLINE_PIE_RADIUS));
+    const float    radius = 0.5f*OFFLINE_PIE_RADIUS;
+    const float    centre = 0.5f*OFFLINE_PIE_CENTRE;
+
+    for (uint32_t y = first; y < endY; y++)
+    {
+        uint8_t* pRow = pImage->GetRow(y);
+        for (uint32_t x = first; x < endX; x++)
+        {
+            uint32_t sum[3] = { 0, 0, 0 };
+            bool     inside = false;
+            for (uint32_t s = 0; s < 4; s++)
+            {
+                float px = ((float)x + 0.5f + 0.5f*(s & 1))*0.5f - centre;
+                float py = ((float)y + 0.5f + 0.5f*(s >> 1))*0.5f - centre;
+                if (px*px + py*py >= radius*radius)
+                    continue;
+
+                float a = t1*(atan2f(py, px + 0.0001f)/(2.0f*3.14159265f) + 0.5f);
+
+                uint32_t colour;
+                if (a <= t4)
+                    colour = s_Palette[5];
+                else if (a <= t3)
+                    colour = s_Palette[6];
+                else if (a <= t2)
+                    colour = s_Palette[7];
+                else if (a <= t1)
+                    colour = s_Palette[8];
+                else
+                    continue;
+
+                for (uint32_t c = 0; c < 3; c++)
+                    sum[c] += (colour >> (8*c)) & 0xff;
+                inside = true;
+            }
+
+            if (!inside)
+                continue;
+
+            uint8_t* pPixel = pRow + x*4;
+            for (uint32_t c = 0; c < 3; c++)
+                pPixel[c] = (uint8_t)std::min((4*pPixel[c] + sum[c] + 2)/4, 255u);
+        }
+    }
+}
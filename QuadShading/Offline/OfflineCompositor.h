@@ -0,0 +1,34 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineCompositor.h
+//
+// CPU copy of the visualisation pass. VisPS1, or VisPS2 for the slices method, colours
+// each quad's overdraw count through ToColour's palette and blends PieChart's liveStats
+// pie on top, sampled four times a pixel. Quad rows are coloured four quads at a time
+// against the whole palette held in SIMD registers, and each is written out as the two
+// pixel rows the quad covers.
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef OFFLINE_COMPOSITOR_H
+#define OFFLINE_COMPOSITOR_H
+
+#include <stdint.h>
+
+#include "OfflineImage.h"
+#include "OfflineMethods.h"
+
+#define OFFLINE_NB_COLOURS      10
+
+// ToColour as packed RGBA8, counts past the end of the palette taking the last colour
+uint32_t OfflineGetColour(uint32_t value);
+
+// The frame the demo shows for an overdraw buffer, as VisPS2 with bSlices or VisPS1
+// otherwise. Pixels beyond the quad grid, on odd sizes, read zero as the SRV loads do.
+void OfflineComposeHeatmap(const COfflineOverdraw& overdraw, bool bSlices, uint32_t width, uint32_t height,
+                           OfflineImage* pImage);
+
+// PieChart over an image, liveStats as the shader receives them
+void OfflineDrawPieChart(const OfflineLiveTotals& totals, OfflineImage* pImage);
+
+#endif
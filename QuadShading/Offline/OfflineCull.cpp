@@ -0,0 +1,386 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineCull.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#include "OfflineCull.h"
+
+#include <string.h>
+
+#if (defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)) && !defined(OFFLINE_NO_SIMD)
+#define OFFLINE_CULL_SSE2
+#include <emmintrin.h>
+#endif
+
+// Front-facing triangles whose bounds hold at most this many pixel centres have them
+// tested one by one, which catches most of the slivers between samples
+#define OFFLINE_CULL_MAX_SAMPLE_TESTS   4
+
+//--------------------------------------------------------------------------------------
+const char* OfflineGetCullResultName(OFFLINE_CULL_RESULT result)
+{
+    static const char* names[OFFLINE_NB_CULL_RESULTS] =
+    {
+        "accepted",
+        "clipped",
+        "outside",
+        "backFacing",
+        "zeroArea",
+        "noSamples"
+    };
+    return names[result];
+}
+
+
+//--------------------------------------------------------------------------------------
+// The sums run in TransformPoint's order, x then y then z then the translation
+//--------------------------------------------------------------------------------------
+#ifdef OFFLINE_CULL_SSE2
+
+void OfflineTransformVertices(const Vec3* pPositions, uint32_t nbVertices, const Mat4& m, Vec4* pClip)
+{
+    const __m128 row0 = _mm_loadu_ps(m.m[0]);
+    const __m128 row1 = _mm_loadu_ps(m.m[1]);
+    const __m128 row2 = _mm_loadu_ps(m.m[2]);
+    const __m128 row3 = _mm_loadu_ps(m.m[3]);
+
+    for (uint32_t i = 0; i < nbVertices; i++)
+    {
+        const Vec3& p = pPositions[i];
+        __m128 r = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.x), row0), _mm_mul_ps(_mm_set1_ps(p.y), row1));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(p.z), row2));
+        r = _mm_add_ps(r, row3);
+        _mm_storeu_ps(&pClip[i].x, r);
+    }
+}
+
+#else
+
+void OfflineTransformVertices(const Vec3* pPositions, uint32_t nbVertices, const Mat4& m, Vec4* pClip)
+{
+    for (uint32_t i = 0; i < nbVertices; i++)
+        pClip[i] = TransformPoint(pPositions[i], m);
+}
+
+#endif
+
+
+//--------------------------------------------------------------------------------------
+void OfflineSnapVertices(const Vec4* pClip, uint32_t nbVertices, uint32_t width, uint32_t height,
+                         OfflineSnappedVertex* pSnapped)
+{
+    for (uint32_t i = 0; i < nbVertices; i++)
+    {
+        OfflineSnappedVertex& vertex = pSnapped[i];
+        vertex.OutCode = OfflineOutCode(pClip[i], 1.0f) |
+                         (OfflineOutCode(pClip[i], OFFLINE_GUARD_BAND) << OFFLINE_OUTCODE_GUARD_SHIFT);
+
+        // Positions outside the guard band could overflow, and go through the clipper
+        if (vertex.OutCode >> OFFLINE_OUTCODE_GUARD_SHIFT)
+        {
+            vertex.X = 0;
+            vertex.Y = 0;
+            vertex.Z = 0.0f;
+        }
+        else
+        {
+            OfflineSnapVertex(pClip[i], width, height, &vertex.X, &vertex.Y, &vertex.Z);
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// The rasterizer's coverage test, through the same OfflineEvaluateEdge, for the pixels
+// in a small rectangle. The vertices are in clockwise order.
+//--------------------------------------------------------------------------------------
+static bool CoversSample(const OfflineSnappedVertex* const* ppV, int32_t x0, int32_t y0, int32_t x1, int32_t y1)
+{
+    for (int32_t py = y0; py <= y1; py++)
+    {
+        for (int32_t px = x0; px <= x1; px++)
+        {
+            const int64_t sx = (int64_t)px*OFFLINE_SUBPIXEL_ONE + OFFLINE_SUBPIXEL_ONE/2;
+            const int64_t sy = (int64_t)py*OFFLINE_SUBPIXEL_ONE + OFFLINE_SUBPIXEL_ONE/2;
+
+            bool covered = true;
+            for (int i = 0; i < 3 && covered; i++)
+            {
+                const OfflineSnappedVertex& a = *ppV[i];
+                const OfflineSnappedVertex& b = *ppV[(i + 1)%3];
+                int64_t bias;
+                covered = OfflineEvaluateEdge(a.X, a.Y, b.X, b.Y, sx, sy, &bias) + bias >= 0;
+            }
+            if (covered)
+                return true;
+        }
+    }
+    return false;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Last stage for a front-facing triangle, given its pixel-centre rectangle before
+// clamping to the viewport
+//--------------------------------------------------------------------------------------
+static OFFLINE_CULL_RESULT CullSamples(const OfflineSnappedVertex* const* ppV, int32_t x0, int32_t y0,
+                                       int32_t x1, int32_t y1, uint32_t width, uint32_t height)
+{
+    x0 = x0 < 0 ? 0 : x0;
+    y0 = y0 < 0 ? 0 : y0;
+    x1 = x1 > (int32_t)width  - 1 ? (int32_t)width  - 1 : x1;
+    y1 = y1 > (int32_t)height - 1 ? (int32_t)height - 1 : y1;
+    if (x0 > x1 || y0 > y1)
+        return OFFLINE_CULL_NO_SAMPLES;
+
+    if ((int64_t)(x1 - x0 + 1)*(y1 - y0 + 1) > OFFLINE_CULL_MAX_SAMPLE_TESTS)
+        return OFFLINE_CULL_ACCEPT;
+
+    return CoversSample(ppV, x0, y0, x1, y1) ? OFFLINE_CULL_ACCEPT : OFFLINE_CULL_NO_SAMPLES;
+}
+
+
+//--------------------------------------------------------------------------------------
+static OFFLINE_CULL_RESULT CullTriangle(const OfflineSnappedVertex* const* ppV, uint32_t width, uint32_t height)
+{
+    const OfflineSnappedVertex& a = *ppV[0];
+    const OfflineSnappedVertex& b = *ppV[1];
+    const OfflineSnappedVertex& c = *ppV[2];
+
+    if (a.OutCode & b.OutCode & c.OutCode & OFFLINE_OUTCODE_VIEW_MASK)
+        return OFFLINE_CULL_OUTSIDE;
+    if ((a.OutCode | b.OutCode | c.OutCode) >> OFFLINE_OUTCODE_GUARD_SHIFT)
+        return OFFLINE_CULL_CLIP;
+
+    // Positive area is clockwise on screen, which is front-facing here
+    int64_t area = (int64_t)(b.X - a.X)*(c.Y - a.Y) - (int64_t)(c.X - a.X)*(b.Y - a.Y);
+    if (area < 0)
+        return OFFLINE_CULL_BACK_FACING;
+    if (area == 0)
+        return OFFLINE_CULL_ZERO_AREA;
+
+    int32_t minX = a.X < b.X ? a.X : b.X;
+    int32_t maxX = a.X > b.X ? a.X : b.X;
+    int32_t minY = a.Y < b.Y ? a.Y : b.Y;
+    int32_t maxY = a.Y > b.Y ? a.Y : b.Y;
+    minX = c.X < minX ? c.X : minX;
+    maxX = c.X > maxX ? c.X : maxX;
+    minY = c.Y < minY ? c.Y : minY;
+    maxY = c.Y > maxY ? c.Y : maxY;
+
+    // Within the view volume's planes, but not touching the viewport
+    if (maxX < 0 || maxY < 0 || minX > (int32_t)width*OFFLINE_SUBPIXEL_ONE || minY > (int32_t)height*OFFLINE_SUBPIXEL_ONE)
+        return OFFLINE_CULL_OUTSIDE;
+
+    const int32_t half = OFFLINE_SUBPIXEL_ONE/2;
+    return CullSamples(ppV, OfflineCeilDiv(minX - half, OFFLINE_SUBPIXEL_ONE),
+                       OfflineCeilDiv(minY - half, OFFLINE_SUBPIXEL_ONE),
+                       OfflineFloorDiv(maxX - half, OFFLINE_SUBPIXEL_ONE),
+                       OfflineFloorDiv(maxY - half, OFFLINE_SUBPIXEL_ONE), width, height);
+}
+
+
+//--------------------------------------------------------------------------------------
+void OfflineCullTrianglesScalar(const OfflineSnappedVertex* pVertices, const uint32_t* pIndices, uint32_t nbTriangles,
+                                uint32_t width, uint32_t height, uint8_t* pResults)
+{
+    for (uint32_t t = 0; t < nbTriangles; t++)
+    {
+        const OfflineSnappedVertex* v[3] =
+        {
+            &pVertices[pIndices[t*3 + 0]],
+            &pVertices[pIndices[t*3 + 1]],
+            &pVertices[pIndices[t*3 + 2]]
+        };
+        pResults[t] = (uint8_t)CullTriangle(v, width, height);
+    }
+}
+
+
+#ifdef OFFLINE_CULL_SSE2
+
+//--------------------------------------------------------------------------------------
+// SSE2 has no 32-bit min, max, blend or 4-lane 64-bit multiply
+//--------------------------------------------------------------------------------------
+static inline __m128i Select(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+static inline __m128i Min32(__m128i a, __m128i b)
+{
+    return Select(_mm_cmplt_epi32(a, b), a, b);
+}
+
+static inline __m128i Max32(__m128i a, __m128i b)
+{
+    return Select(_mm_cmpgt_epi32(a, b), a, b);
+}
+
+// Packs two 2-lane double masks into one 4-lane integer mask
+static inline __m128i PackMask(__m128d lo, __m128d hi)
+{
+    return _mm_castps_si128(_mm_shuffle_ps(_mm_castpd_ps(lo), _mm_castpd_ps(hi), _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+// a*b - c*d in doubles, for the low and high pairs of lanes. Differences of snapped
+// coordinates inside the guard band need at most 26 bits, so this is exact.
+static inline void CrossDiff(__m128i a, __m128i b, __m128i c, __m128i d, __m128d* pLo, __m128d* pHi)
+{
+    *pLo = _mm_sub_pd(_mm_mul_pd(_mm_cvtepi32_pd(a), _mm_cvtepi32_pd(b)),
+                      _mm_mul_pd(_mm_cvtepi32_pd(c), _mm_cvtepi32_pd(d)));
+    a = _mm_shuffle_epi32(a, _MM_SHUFFLE(3, 2, 3, 2));
+    b = _mm_shuffle_epi32(b, _MM_SHUFFLE(3, 2, 3, 2));
+    c = _mm_shuffle_epi32(c, _MM_SHUFFLE(3, 2, 3, 2));
+    d = _mm_shuffle_epi32(d, _MM_SHUFFLE(3, 2, 3, 2));
+    *pHi = _mm_sub_pd(_mm_mul_pd(_mm_cvtepi32_pd(a), _mm_cvtepi32_pd(b)),
+                      _mm_mul_pd(_mm_cvtepi32_pd(c), _mm_cvtepi32_pd(d)));
+}
+
+
+//--------------------------------------------------------------------------------------
+// Four triangles at a time, with every test done on all of them and the results picked
+// in the same order of precedence as CullTriangle
+//--------------------------------------------------------------------------------------
+void OfflineCullTriangles(const OfflineSnappedVertex* pVertices, const uint32_t* pIndices, uint32_t nbTriangles,
+                          uint32_t width, uint32_t height, uint8_t* pResults)
+{
+    const __m128i zero     = _mm_setzero_si128();
+    const __m128i ones     = _mm_cmpeq_epi32(zero, zero);
+    const __m128i one      = _mm_set1_epi32(1);
+    const __m128i three    = _mm_set1_epi32(3);
+    const __m128i viewMask = _mm_set1_epi32(OFFLINE_OUTCODE_VIEW_MASK);
+    const __m128i half     = _mm_set1_epi32(OFFLINE_SUBPIXEL_ONE/2);
+    const __m128i ceilBias = _mm_set1_epi32(OFFLINE_SUBPIXEL_ONE/2 - (OFFLINE_SUBPIXEL_ONE - 1));
+    const __m128i right    = _mm_set1_epi32((int32_t)width*OFFLINE_SUBPIXEL_ONE);
+    const __m128i bottom   = _mm_set1_epi32((int32_t)height*OFFLINE_SUBPIXEL_ONE);
+    const __m128i lastX    = _mm_set1_epi32((int32_t)width - 1);
+    const __m128i lastY    = _mm_set1_epi32((int32_t)height - 1);
+    const __m128d zeroPD   = _mm_setzero_pd();
+
+    uint32_t t = 0;
+    for (; t + 4 <= nbTriangles; t += 4)
+    {
+        // Gather the four triangles' vertices into one register per attribute
+        const OfflineSnappedVertex* v[4][3];
+        for (int lane = 0; lane < 4; lane++)
+        {
+            v[lane][0] = &pVertices[pIndices[(t + lane)*3 + 0]];
+            v[lane][1] = &pVertices[pIndices[(t + lane)*3 + 1]];
+            v[lane][2] = &pVertices[pIndices[(t + lane)*3 + 2]];
+        }
+
+#define OFFLINE_GATHER(i, field) _mm_set_epi32((int32_t)v[3][i]->field, (int32_t)v[2][i]->field, \
+                                               (int32_t)v[1][i]->field, (int32_t)v[0][i]->field)
+        __m128i x[3] = { OFFLINE_GATHER(0, X), OFFLINE_GATHER(1, X), OFFLINE_GATHER(2, X) };
+        __m128i y[3] = { OFFLINE_GATHER(0, Y), OFFLINE_GATHER(1, Y), OFFLINE_GATHER(2, Y) };
+        __m128i c0 = OFFLINE_GATHER(0, OutCode);
+        __m128i c1 = OFFLINE_GATHER(1, OutCode);
+        __m128i c2 = OFFLINE_GATHER(2, OutCode);
+#undef OFFLINE_GATHER
+
+        // Frustum and guard band
+        __m128i allOut  = _mm_and_si128(_mm_and_si128(_mm_and_si128(c0, c1), c2), viewMask);
+        __m128i anyOut  = _mm_srli_epi32(_mm_or_si128(_mm_or_si128(c0, c1), c2), OFFLINE_OUTCODE_GUARD_SHIFT);
+        __m128i outside = _mm_xor_si128(_mm_cmpeq_epi32(allOut, zero), ones);
+        __m128i clip    = _mm_xor_si128(_mm_cmpeq_epi32(anyOut, zero), ones);
+
+        // Facing and degenerate triangles
+        __m128d areaLo, areaHi;
+        CrossDiff(_mm_sub_epi32(x[1], x[0]), _mm_sub_epi32(y[2], y[0]),
+                  _mm_sub_epi32(x[2], x[0]), _mm_sub_epi32(y[1], y[0]), &areaLo, &areaHi);
+        __m128i backFacing = PackMask(_mm_cmplt_pd(areaLo, zeroPD), _mm_cmplt_pd(areaHi, zeroPD));
+        __m128i zeroArea   = PackMask(_mm_cmpeq_pd(areaLo, zeroPD), _mm_cmpeq_pd(areaHi, zeroPD));
+
+        // Bounds against the viewport
+        __m128i minX = Min32(Min32(x[0], x[1]), x[2]);
+        __m128i maxX = Max32(Max32(x[0], x[1]), x[2]);
+        __m128i minY = Min32(Min32(y[0], y[1]), y[2]);
+        __m128i maxY = Max32(Max32(y[0], y[1]), y[2]);
+        __m128i offViewport = _mm_or_si128(_mm_or_si128(_mm_cmplt_epi32(maxX, zero), _mm_cmplt_epi32(maxY, zero)),
+                                           _mm_or_si128(_mm_cmpgt_epi32(minX, right), _mm_cmpgt_epi32(minY, bottom)));
+
+        // Pixel centres inside the bounds; floor division by a power of two is a shift
+        __m128i rectX0 = Max32(_mm_srai_epi32(_mm_sub_epi32(minX, ceilBias), OFFLINE_SUBPIXEL_BITS), zero);
+        __m128i rectY0 = Max32(_mm_srai_epi32(_mm_sub_epi32(minY, ceilBias), OFFLINE_SUBPIXEL_BITS), zero);
+        __m128i rectX1 = Min32(_mm_srai_epi32(_mm_sub_epi32(maxX, half), OFFLINE_SUBPIXEL_BITS), lastX);
+        __m128i rectY1 = Min32(_mm_srai_epi32(_mm_sub_epi32(maxY, half), OFFLINE_SUBPIXEL_BITS), lastY);
+        __m128i spanX  = _mm_sub_epi32(rectX1, rectX0);
+        __m128i spanY  = _mm_sub_epi32(rectY1, rectY0);
+        __m128i empty  = _mm_or_si128(_mm_cmplt_epi32(spanX, zero), _mm_cmplt_epi32(spanY, zero));
+
+        // Up to OFFLINE_CULL_MAX_SAMPLE_TESTS centres: a column, a row, or 2x2
+        __m128i column = _mm_and_si128(_mm_cmpeq_epi32(spanX, zero), _mm_cmplt_epi32(spanY, _mm_set1_epi32(4)));
+        __m128i row    = _mm_and_si128(_mm_cmpeq_epi32(spanY, zero), _mm_cmplt_epi32(spanX, _mm_set1_epi32(4)));
+        __m128i square = _mm_and_si128(_mm_cmpeq_epi32(spanX, one), _mm_cmpeq_epi32(spanY, one));
+        __m128i last   = Select(column, spanY, Select(row, spanX, three));
+
+        __m128i decided = _mm_or_si128(_mm_or_si128(_mm_or_si128(outside, clip), _mm_or_si128(backFacing, zeroArea)),
+                                       _mm_or_si128(offViewport, empty));
+        __m128i test    = _mm_andnot_si128(decided, _mm_or_si128(_mm_or_si128(column, row), square));
+
+        __m128i covered = zero;
+        if (_mm_movemask_epi8(test))
+        {
+            // OfflineEvaluateEdge four triangles at a time; -cull counts any triangle on
+            // which it and the scalar path disagree
+            __m128i dx[3], dy[3], topLeft[3];
+            for (int i = 0; i < 3; i++)
+            {
+                dx[i] = _mm_sub_epi32(x[(i + 1)%3], x[i]);
+                dy[i] = _mm_sub_epi32(y[(i + 1)%3], y[i]);
+                topLeft[i] = _mm_or_si128(_mm_and_si128(_mm_cmpeq_epi32(dy[i], zero), _mm_cmpgt_epi32(dx[i], zero)),
+                                          _mm_cmplt_epi32(dy[i], zero));
+            }
+
+            for (int k = 0; k < OFFLINE_CULL_MAX_SAMPLE_TESTS; k++)
+            {
+                __m128i pending = _mm_andnot_si128(covered, _mm_and_si128(test, _mm_cmpgt_epi32(last, _mm_set1_epi32(k - 1))));
+                if (!_mm_movemask_epi8(pending))
+                    break;
+
+                __m128i kx = Select(column, zero, Select(row, _mm_set1_epi32(k), _mm_set1_epi32(k & 1)));
+                __m128i ky = Select(column, _mm_set1_epi32(k), Select(row, zero, _mm_set1_epi32(k >> 1)));
+                __m128i sx = _mm_add_epi32(_mm_slli_epi32(_mm_add_epi32(rectX0, kx), OFFLINE_SUBPIXEL_BITS), half);
+                __m128i sy = _mm_add_epi32(_mm_slli_epi32(_mm_add_epi32(rectY0, ky), OFFLINE_SUBPIXEL_BITS), half);
+
+                __m128i inside = pending;
+                for (int i = 0; i < 3; i++)
+                {
+                    __m128d edgeLo, edgeHi;
+                    CrossDiff(dx[i], _mm_sub_epi32(sy, y[i]), dy[i], _mm_sub_epi32(sx, x[i]), &edgeLo, &edgeHi);
+                    __m128i positive = PackMask(_mm_cmpgt_pd(edgeLo, zeroPD), _mm_cmpgt_pd(edgeHi, zeroPD));
+                    __m128i onEdge   = PackMask(_mm_cmpeq_pd(edgeLo, zeroPD), _mm_cmpeq_pd(edgeHi, zeroPD));
+                    inside = _mm_and_si128(inside, _mm_or_si128(positive, _mm_and_si128(onEdge, topLeft[i])));
+                }
+                covered = _mm_or_si128(covered, inside);
+            }
+        }
+
+        __m128i result = Select(test, Select(covered, _mm_set1_epi32(OFFLINE_CULL_ACCEPT), _mm_set1_epi32(OFFLINE_CULL_NO_SAMPLES)),
+                                _mm_set1_epi32(OFFLINE_CULL_ACCEPT));
+        result = Select(empty,       _mm_set1_epi32(OFFLINE_CULL_NO_SAMPLES),  result);
+        result = Select(offViewport, _mm_set1_epi32(OFFLINE_CULL_OUTSIDE),     result);
+        result = Select(zeroArea,    _mm_set1_epi32(OFFLINE_CULL_ZERO_AREA),   result);
+        result = Select(backFacing,  _mm_set1_epi32(OFFLINE_CULL_BACK_FACING), result);
+        result = Select(clip,        _mm_set1_epi32(OFFLINE_CULL_CLIP),        result);
+        result = Select(outside,     _mm_set1_epi32(OFFLINE_CULL_OUTSIDE),     result);
+
+        result = _mm_packs_epi32(result, result);
+        int32_t packed = _mm_cvtsi128_si32(_mm_packus_epi16(result, result));
+        memcpy(pResults + t, &packed, sizeof(packed));
+    }
+
+    OfflineCullTrianglesScalar(pVertices, pIndices + t*3, nbTriangles - t, width, height, pResults + t);
+}
+
+#else
+
+//--------------------------------------------------------------------------------------
+void OfflineCullTriangles(const OfflineSnappedVertex* pVertices, const uint32_t* pIndices, uint32_t nbTriangles,
+                          uint32_t width, uint32_t height, uint8_t* pResults)
+{
+    OfflineCullTrianglesScalar(pVertices, pIndices, nbTriangles, width, height, pResults);
+}
+
+#endif
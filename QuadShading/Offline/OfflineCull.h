@@ -0,0 +1,146 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineCull.h
+//
+// Triangle culling ahead of setup for the offline rasterizer. Vertices are projected
+// and snapped once per mesh, then triangles are classified four at a time with SSE2
+// (one at a time where it isn't available) as outside the view volume, needing to be
+// clipped, back-facing (CULL_BACK), zero area once snapped, or covering no pixel centre
+// at all. Only the triangles that are accepted or need clipping go on to setup.
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef OFFLINE_CULL_H
+#define OFFLINE_CULL_H
+
+#include <math.h>
+#include <stdint.h>
+
+#include "OfflineMath.h"
+
+#define OFFLINE_SUBPIXEL_BITS   8
+#define OFFLINE_SUBPIXEL_ONE    (1 << OFFLINE_SUBPIXEL_BITS)
+
+// Guard band, as a multiple of the clip-space w. Keeps snapped coordinates well inside
+// 16.8 fixed-point range for viewports up to 8K.
+#define OFFLINE_GUARD_BAND      3.0f
+
+// Clip planes, in the order they are tested
+enum OFFLINE_CLIP_PLANE
+{
+    OFFLINE_CLIP_NEAR,
+    OFFLINE_CLIP_FAR,
+    OFFLINE_CLIP_LEFT,
+    OFFLINE_CLIP_RIGHT,
+    OFFLINE_CLIP_BOTTOM,
+    OFFLINE_CLIP_TOP,
+    OFFLINE_NB_CLIP_PLANES
+};
+
+// OfflineSnappedVertex::OutCode has a bit per plane for the view volume itself in the
+// low bits, and for the guard band (with the same near and far planes) above them
+#define OFFLINE_OUTCODE_VIEW_MASK       ((1 << OFFLINE_NB_CLIP_PLANES) - 1)
+#define OFFLINE_OUTCODE_GUARD_SHIFT     8
+
+enum OFFLINE_CULL_RESULT
+{
+    OFFLINE_CULL_ACCEPT,        // inside the guard band, front-facing, may cover samples
+    OFFLINE_CULL_CLIP,          // crosses the near or far plane or the guard band
+    OFFLINE_CULL_OUTSIDE,       // nothing inside the viewport
+    OFFLINE_CULL_BACK_FACING,
+    OFFLINE_CULL_ZERO_AREA,     // degenerate once snapped
+    OFFLINE_CULL_NO_SAMPLES,    // front-facing, but no pixel centre is covered
+    OFFLINE_NB_CULL_RESULTS
+};
+
+const char* OfflineGetCullResultName(OFFLINE_CULL_RESULT result);
+
+struct OfflineSnappedVertex
+{
+    int32_t  X, Y;              // window position, 16.8 fixed point, if inside the guard band
+    float    Z;
+    uint32_t OutCode;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Signed distance to a clip plane; x and y planes are pushed out by the given band
+//--------------------------------------------------------------------------------------
+inline float OfflinePlaneDistance(const Vec4& v, int plane, float band)
+{
+    switch (plane)
+    {
+    case OFFLINE_CLIP_NEAR:   return v.z;
+    case OFFLINE_CLIP_FAR:    return v.w - v.z;
+    case OFFLINE_CLIP_LEFT:   return v.x + band*v.w;
+    case OFFLINE_CLIP_RIGHT:  return band*v.w - v.x;
+    case OFFLINE_CLIP_BOTTOM: return v.y + band*v.w;
+    default:                  return band*v.w - v.y;
+    }
+}
+
+inline uint32_t OfflineOutCode(const Vec4& v, float band)
+{
+    uint32_t code = 0;
+    for (int plane = 0; plane < OFFLINE_NB_CLIP_PLANES; plane++)
+    {
+        if (OfflinePlaneDistance(v, plane, band) < 0.0f)
+            code |= 1 << plane;
+    }
+    return code;
+}
+
+// Projection to the viewport and snapping to 16.8 fixed point, shared by every path
+// through setup so that they agree to the bit
+inline void OfflineSnapVertex(const Vec4& clip, uint32_t width, uint32_t height, int32_t* pX, int32_t* pY, float* pZ)
+{
+    float invW = 1.0f/clip.w;
+    float wx = (clip.x*invW*0.5f + 0.5f)*(float)width;
+    float wy = (0.5f - clip.y*invW*0.5f)*(float)height;
+    *pX = (int32_t)floor(wx*OFFLINE_SUBPIXEL_ONE + 0.5);
+    *pY = (int32_t)floor(wy*OFFLINE_SUBPIXEL_ONE + 0.5);
+    *pZ = clip.z*invW;
+}
+
+// Floor and ceiling of a/b for b > 0, correct for negative a
+inline int32_t OfflineFloorDiv(int32_t a, int32_t b)
+{
+    return a >= 0 ? a/b : -((-a + b - 1)/b);
+}
+
+inline int32_t OfflineCeilDiv(int32_t a, int32_t b)
+{
+    return -OfflineFloorDiv(-a, b);
+}
+
+// The fill rule, shared by the rasterizer and the no-samples cull so that they can't
+// disagree: the edge function from (x0, y0) to (x1, y1) at the sample (sx, sy), all
+// in 16.8 fixed point, positive inside for clockwise vertices with y pointing down.
+// *pBias is the top-left rule's bias; a sample is covered when the edge plus its bias
+// is non-negative on all three edges. "Top" edges run exactly left to right and "left"
+// edges run upwards.
+inline int64_t OfflineEvaluateEdge(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int64_t sx, int64_t sy,
+                                   int64_t* pBias)
+{
+    int64_t dx = (int64_t)x1 - x0;
+    int64_t dy = (int64_t)y1 - y0;
+    *pBias = (dy == 0 && dx > 0) || dy < 0 ? 0 : -1;
+    return dx*(sy - y0) - dy*(sx - x0);
+}
+
+// TransformPoint over a batch of positions, a vertex per SSE2 register; the results
+// match TransformPoint's to the bit
+void OfflineTransformVertices(const Vec3* pPositions, uint32_t nbVertices, const Mat4& m, Vec4* pClip);
+
+void OfflineSnapVertices(const Vec4* pClip, uint32_t nbVertices, uint32_t width, uint32_t height,
+                         OfflineSnappedVertex* pSnapped);
+
+// Classifies nbTriangles triangles, given as index triples, into pResults
+void OfflineCullTriangles(const OfflineSnappedVertex* pVertices, const uint32_t* pIndices, uint32_t nbTriangles,
+                          uint32_t width, uint32_t height, uint8_t* pResults);
+
+// One triangle at a time; the reference the SIMD path has to match
+void OfflineCullTrianglesScalar(const OfflineSnappedVertex* pVertices, const uint32_t* pIndices, uint32_t nbTriangles,
+                                uint32_t width, uint32_t height, uint8_t* pResults);
+
+#endif
@@ -0,0 +1,193 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineHiZ.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#include "OfflineHiZ.h"
+#include "DXUTprofiler.h"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+// Allowance for the difference between transforming a box corner and a vertex inside
+// it, far below anything that decides a real occlusion test
+#define OFFLINE_HIZ_DEPTH_EPSILON   1e-5
+
+//--------------------------------------------------------------------------------------
+COfflineHiZ::COfflineHiZ() : m_Width(0),
+                             m_Height(0),
+                             m_Format(OFFLINE_DEPTH_FORMAT_D24_UNORM)
+{
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineHiZ::Build(const COfflineDepthBuffer& depth)
+{
+    DXUT_PROFILE_SCOPE(L"Offline Hi-Z Build");
+
+    m_Width  = depth.GetWidth();
+    m_Height = depth.GetHeight();
+    m_Format = depth.GetFormat();
+    m_Levels.clear();
+    if (!m_Width || !m_Height)
+        return;
+
+    m_Levels.push_back(std::vector<uint32_t>((size_t)m_Width*m_Height));
+    for (uint32_t y = 0; y < m_Height; y++)
+        memcpy(&m_Levels[0][(size_t)y*m_Width], depth.GetRow(y), m_Width*sizeof(uint32_t));
+
+    // Each level keeps the farthest of the (up to) four texels below
+    for (uint32_t level = 1; GetLevelWidth(level - 1) > 1 || GetLevelHeight(level - 1) > 1; level++)
+    {
+        const uint32_t srcWidth  = GetLevelWidth(level - 1);
+        const uint32_t srcHeight = GetLevelHeight(level - 1);
+        const uint32_t width     = GetLevelWidth(level);
+        const uint32_t height    = GetLevelHeight(level);
+
+        m_Levels.push_back(std::vector<uint32_t>((size_t)width*height));
+        const std::vector<uint32_t>& src = m_Levels[level - 1];
+        std::vector<uint32_t>& dest = m_Levels[level];
+
+        for (uint32_t y = 0; y < height; y++)
+        {
+            uint32_t y0 = 2*y;
+            uint32_t y1 = std::min(2*y + 1, srcHeight - 1);
+            for (uint32_t x = 0; x < width; x++)
+            {
+                uint32_t x0 = 2*x;
+                uint32_t x1 = std::min(2*x + 1, srcWidth - 1);
+                dest[(size_t)y*width + x] = std::max(std::max(src[(size_t)y0*srcWidth + x0], src[(size_t)y0*srcWidth + x1]),
+                                                     std::max(src[(size_t)y1*srcWidth + x0], src[(size_t)y1*srcWidth + x1]));
+            }
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+OFFLINE_BOUNDS_VISIBILITY COfflineHiZ::TestBounds(const Vec3& boundsMin, const Vec3& boundsMax,
+                                                  const Mat4& viewProj) const
+{
+    if (m_Levels.empty())
+        return OFFLINE_BOUNDS_VISIBLE;
+
+    float  minX = FLT_MAX, maxX = -FLT_MAX;
+    float  minY = FLT_MAX, maxY = -FLT_MAX;
+    double minZ = 1.0;
+    uint32_t outside = 0x1f;
+    for (int i = 0; i < 8; i++)
+    {
+        Vec3 corner = MakeVec3(i & 1 ? boundsMax.x : boundsMin.x,
+                               i & 2 ? boundsMax.y : boundsMin.y,
+                               i & 4 ? boundsMax.z : boundsMin.z);
+        Vec4 clip = TransformPoint(corner, viewProj);
+
+        // Anything reaching in front of the near plane is left to the clipper
+        if (clip.w <= 0.0f || clip.z < 0.0f)
+            return OFFLINE_BOUNDS_VISIBLE;
+
+        uint32_t code = (clip.x < -clip.w ? 1 : 0) | (clip.x > clip.w ? 2 : 0) |
+                        (clip.y < -clip.w ? 4 : 0) | (clip.y > clip.w ? 8 : 0) | (clip.z > clip.w ? 16 : 0);
+        outside &= code;
+
+        float invW = 1.0f/clip.w;
+        float wx = (clip.x*invW*0.5f + 0.5f)*(float)m_Width;
+        float wy = (0.5f - clip.y*invW*0.5f)*(float)m_Height;
+        minX = std::min(minX, wx);
+        maxX = std::max(maxX, wx);
+        minY = std::min(minY, wy);
+        maxY = std::max(maxY, wy);
+        minZ = std::min(minZ, (double)clip.z*invW);
+    }
+
+    if (outside)
+        return OFFLINE_BOUNDS_OUTSIDE;
+
+    // Pixels whose centres the box may cover, widened by one for vertex snapping
+    minX = std::max(minX, -2.0f);
+    minY = std::max(minY, -2.0f);
+    maxX = std::min(maxX, (float)m_Width + 2.0f);
+    maxY = std::min(maxY, (float)m_Height + 2.0f);
+    int32_t x0 = std::max((int32_t)ceil(minX - 0.5f) - 1, 0);
+    int32_t y0 = std::max((int32_t)ceil(minY - 0.5f) - 1, 0);
+    int32_t x1 = std::min((int32_t)floor(maxX - 0.5f) + 1, (int32_t)m_Width - 1);
+    int32_t y1 = std::min((int32_t)floor(maxY - 0.5f) + 1, (int32_t)m_Height - 1);
+    if (x0 > x1 || y0 > y1)
+        return OFFLINE_BOUNDS_OUTSIDE;
+
+    // The finest level at which the rectangle spans at most 4x4 texels
+    uint32_t level = 0;
+    while (level + 1 < GetNumLevels() && ((x1 >> level) - (x0 >> level) > 3 || (y1 >> level) - (y0 >> level) > 3))
+        level++;
+
+    uint32_t farthest = 0;
+    for (int32_t y = y0 >> level; y <= y1 >> level; y++)
+    {
+        for (int32_t x = x0 >> level; x <= x1 >> level; x++)
+            farthest = std::max(farthest, GetTexel(level, x, y));
+    }
+
+    // LESS_EQUAL passes on equal depths, so only strictly farther boxes are hidden
+    double nearest = std::max(minZ - OFFLINE_HIZ_DEPTH_EPSILON, 0.0);
+    return OfflineEncodeDepth((float)nearest, m_Format) > farthest ? OFFLINE_BOUNDS_OCCLUDED : OFFLINE_BOUNDS_VISIBLE;
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineHiZ::CullMesh(const COfflineMesh& mesh, const Mat4& viewProj, std::vector<uint8_t>* pClusterVisible,
+                           OfflineCullStats* pStats) const
+{
+    DXUT_PROFILE_SCOPE(L"Offline Hi-Z Cull");
+
+    memset(pStats, 0, sizeof(*pStats));
+    pClusterVisible->assign(mesh.GetNumClusters(), 0);
+
+    for (uint32_t d = 0; d < mesh.GetNumDraws(); d++)
+    {
+        const OfflineDraw& draw = mesh.GetDraw(d);
+        if (!draw.NbClusters)
+            continue;
+
+        pStats->DrawsTested++;
+        pStats->TrianglesIn += draw.IndexCount/3;
+
+        OFFLINE_BOUNDS_VISIBILITY visibility = TestBounds(draw.BoundsMin, draw.BoundsMax, viewProj);
+        if (visibility != OFFLINE_BOUNDS_VISIBLE)
+        {
+            if (visibility == OFFLINE_BOUNDS_OUTSIDE)
+            {
+                pStats->DrawsOutside++;
+                pStats->ClustersOutside += draw.NbClusters;
+            }
+            else
+            {
+                pStats->DrawsOccluded++;
+                pStats->ClustersOccluded += draw.NbClusters;
+            }
+            pStats->TrianglesCulled += draw.IndexCount/3;
+            continue;
+        }
+
+        for (uint32_t c = draw.FirstCluster; c < draw.FirstCluster + draw.NbClusters; c++)
+        {
+            const OfflineCluster& cluster = mesh.GetCluster(c);
+
+            pStats->ClustersTested++;
+            visibility = TestBounds(cluster.BoundsMin, cluster.BoundsMax, viewProj);
+            if (visibility == OFFLINE_BOUNDS_VISIBLE)
+            {
+                (*pClusterVisible)[c] = 1;
+                continue;
+            }
+
+            if (visibility == OFFLINE_BOUNDS_OUTSIDE)
+                pStats->ClustersOutside++;
+            else
+                pStats->ClustersOccluded++;
+            pStats->TrianglesCulled += cluster.NbTriangles;
+        }
+    }
+}
@@ -0,0 +1,74 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineHiZ.h
+//
+// Hierarchical-Z pyramid for the offline overshading engine. Built from the depth
+// pre-pass, the CPU counterpart of g_pDepthStencil, with each level holding the
+// farthest depth of the four texels below it. Bounding boxes of subsets and clusters
+// can then be tested against it and the occluded ones skipped before setup.
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef OFFLINE_HIZ_H
+#define OFFLINE_HIZ_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "OfflineMath.h"
+#include "OfflineMesh.h"
+#include "OfflineRaster.h"
+
+enum OFFLINE_BOUNDS_VISIBILITY
+{
+    OFFLINE_BOUNDS_VISIBLE,
+    OFFLINE_BOUNDS_OUTSIDE,     // no pixel centres inside the viewport
+    OFFLINE_BOUNDS_OCCLUDED     // behind the pyramid everywhere it covers
+};
+
+struct OfflineCullStats
+{
+    uint32_t DrawsTested;
+    uint32_t DrawsOutside;
+    uint32_t DrawsOccluded;
+    uint32_t ClustersTested;    // from draws that passed
+    uint32_t ClustersOutside;   // including those of culled draws
+    uint32_t ClustersOccluded;
+    uint64_t TrianglesIn;
+    uint64_t TrianglesCulled;
+};
+
+
+//--------------------------------------------------------------------------------------
+class COfflineHiZ
+{
+public:
+                        COfflineHiZ();
+
+    void                Build(const COfflineDepthBuffer& depth);
+
+    // Conservative: boxes that cross the near plane, or that could touch a pixel whose
+    // depth test might pass, are visible
+    OFFLINE_BOUNDS_VISIBILITY TestBounds(const Vec3& boundsMin, const Vec3& boundsMax, const Mat4& viewProj) const;
+
+    // Tests every draw, then the clusters of the draws that pass. pClusterVisible gets
+    // an entry per cluster, ready for COfflineRasterizer::SetupMesh.
+    void                CullMesh(const COfflineMesh& mesh, const Mat4& viewProj, std::vector<uint8_t>* pClusterVisible,
+                                 OfflineCullStats* pStats) const;
+
+    uint32_t            GetNumLevels() const                { return (uint32_t)m_Levels.size(); }
+    uint32_t            GetLevelWidth(uint32_t level) const  { return (m_Width + (1 << level) - 1) >> level; }
+    uint32_t            GetLevelHeight(uint32_t level) const { return (m_Height + (1 << level) - 1) >> level; }
+    uint32_t            GetTexel(uint32_t level, uint32_t x, uint32_t y) const
+    {
+        return m_Levels[level][(size_t)y*GetLevelWidth(level) + x];
+    }
+
+protected:
+    uint32_t                            m_Width;
+    uint32_t                            m_Height;
+    OFFLINE_DEPTH_FORMAT                m_Format;
+    std::vector<std::vector<uint32_t> > m_Levels;   // encoded as in the depth buffer
+};
+
+#endif
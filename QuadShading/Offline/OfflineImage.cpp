@@ -0,0 +1,546 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineImage.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+#include "OfflineImage.h"
+#include "DXUTprofiler.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#define OFFLINE_DEFLATE_WINDOW      32768
+#define OFFLINE_DEFLATE_MAX_MATCH   258
+
+//--------------------------------------------------------------------------------------
+const char* OfflineGetImageFormatName(OFFLINE_IMAGE_FORMAT format)
+{
+    static const char* names[OFFLINE_NB_IMAGE_FORMATS] =
+    {
+        "png",
+        "ppm",
+        "exr"
+    };
+    return names[format];
+}
+
+
+//--------------------------------------------------------------------------------------
+void OfflineImage::Resize(uint32_t width, uint32_t height)
+{
+    Width  = width;
+    Height = height;
+    Pixels.resize((size_t)width*height*4);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Byte helpers
+//--------------------------------------------------------------------------------------
+static void PutBytes(std::vector<uint8_t>* pFile, const void* pData, size_t size)
+{
+    const uint8_t* pBytes = (const uint8_t*)pData;
+    pFile->insert(pFile->end(), pBytes, pBytes + size);
+}
+
+static void PutU32BE(std::vector<uint8_t>* pFile, uint32_t value)
+{
+    uint8_t bytes[4] = { (uint8_t)(value >> 24), (uint8_t)(value >> 16), (uint8_t)(value >> 8), (uint8_t)value };
+    PutBytes(pFile, bytes, 4);
+}
+
+static void PutU32LE(std::vector<uint8_t>* pFile, uint32_t value)
+{
+    uint8_t bytes[4] = { (uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24) };
+    PutBytes(pFile, bytes, 4);
+}
+
+static void PutString(std::vector<uint8_t>* pFile, const char* str)
+{
+    PutBytes(pFile, str, strlen(str) + 1);
+}
+
+
+//--------------------------------------------------------------------------------------
+// PPM
+//--------------------------------------------------------------------------------------
+static void EncodePPM(const OfflineImage& image, std::vector<uint8_t>* pFile)
+{
+    char header[64];
+    int length = sprintf(header, "P6\n%u %u\n255\n", image.Width, image.Height);
+    PutBytes(pFile, header, length);
+
+    size_t start = pFile->size();
+    pFile->resize(start + (size_t)image.Width*image.Height*3);
+    uint8_t* pDest = &(*pFile)[start];
+    for (size_t i = 0; i < (size_t)image.Width*image.Height; i++, pDest += 3)
+        memcpy(pDest, &image.Pixels[i*4], 3);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Deflate, as one block of fixed Huffman codes (RFC 1951, 3.2.6)
+//--------------------------------------------------------------------------------------
+class CDeflateWriter
+{
+public:
+    CDeflateWriter(std::vector<uint8_t>* pOut) : m_pOut(pOut), m_Bits(0), m_Count(0) {}
+
+    void Put(uint32_t value, uint32_t count)
+    {
+        m_Bits  |= (uint64_t)value << m_Count;
+        m_Count += count;
+        while (m_Count >= 8)
+        {
+            m_pOut->push_back((uint8_t)m_Bits);
+            m_Bits  >>= 8;
+            m_Count  -= 8;
+        }
+    }
+
+    // Huffman codes go most significant bit first
+    void PutCode(uint32_t code, uint32_t count)
+    {
+        uint32_t reversed = 0;
+        for (uint32_t i = 0; i < count; i++)
+            reversed |= ((code >> i) & 1) << (count - 1 - i);
+        Put(reversed, count);
+    }
+
+    void PutLiteral(uint32_t symbol)
+    {
+        if (symbol < 144)
+            PutCode(0x30 + symbol, 8);
+        else if (symbol < 256)
+            PutCode(0x190 + symbol - 144, 9);
+        else if (symbol < 280)
+            PutCode(symbol - 256, 7);
+        else
+            PutCode(0xc0 + symbol - 280, 8);
+    }
+
+    void PutMatch(uint32_t length, uint32_t distance)
+    {
+        static const uint16_t lengthBase[29] =
+        {
+            3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195,
+            227, 258
+        };
+        static const uint8_t lengthExtra[29] =
+        {
+            0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+        };
+        static const uint16_t distanceBase[30] =
+        {
+            1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+            4097, 6145, 8193, 12289, 16385, 24577
+        };
+        static const uint8_t distanceExtra[30] =
+        {
+            0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+        };
+
+        uint32_t l = 28;
+        while (lengthBase[l] > length)
+            l--;
+        PutLiteral(257 + l);
+        Put(length - lengthBase[l], lengthExtra[l]);
+
+        uint32_t d = 29;
+        while (distanceBase[d] > distance)
+            d--;
+        PutCode(d, 5);
+        Put(distance - distanceBase[d], distanceExtra[d]);
+    }
+
+    void Flush()
+    {
+        if (m_Count)
+            m_pOut->push_back((uint8_t)m_Bits);
+        m_Bits  = 0;
+        m_Count = 0;
+    }
+
+protected:
+    std::vector<uint8_t>*   m_pOut;
+    uint64_t                m_Bits;
+    uint32_t                m_Count;
+};
+
+
+//--------------------------------------------------------------------------------------
+// zlib stream of the data. Matches are only looked for one pixel back and one row back,
+// which between them find the runs and the repeated rows of a heatmap.
+//--------------------------------------------------------------------------------------
+static void Deflate(const std::vector<uint8_t>& data, uint32_t pixelBytes, uint32_t rowBytes,
+                    std::vector<uint8_t>* pOut)
+{
+    pOut->push_back(0x78);
+    pOut->push_back(0x01);
+
+    CDeflateWriter writer(pOut);
+    writer.Put(1, 1);   // BFINAL
+    writer.Put(1, 2);   // BTYPE = fixed Huffman codes
+
+    const uint32_t distances[2] = { pixelBytes, rowBytes };
+    const size_t   size = data.size();
+    for (size_t i = 0; i < size; )
+    {
+        uint32_t bestLength = 0, bestDistance = 0;
+        for (int c = 0; c < 2; c++)
+        {
+            uint32_t distance = distances[c];
+            if (distance > i || distance > OFFLINE_DEFLATE_WINDOW)
+                continue;
+
+            size_t maxLength = std::min((size_t)OFFLINE_DEFLATE_MAX_MATCH, size - i);
+            uint32_t length = 0;
+            while (length < maxLength && data[i + length] == data[i + length - distance])
+                length++;
+            if (length > bestLength)
+            {
+                bestLength   = length;
+                bestDistance = distance;
+            }
+        }
+
+        if (bestLength >= 3)
+        {
+            writer.PutMatch(bestLength, bestDistance);
+            i += bestLength;
+        }
+        else
+            writer.PutLiteral(data[i++]);
+    }
+    writer.PutLiteral(256);
+    writer.Flush();
+
+    uint32_t a = 1, b = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        a = (a + data[i])%65521;
+        b = (b + a)%65521;
+    }
+    PutU32BE(pOut, (b << 16) | a);
+}
+
+
+//--------------------------------------------------------------------------------------
+// PNG
+//--------------------------------------------------------------------------------------
+// Built during static initialisation, before any thread can write an image; VS2012
+// doesn't guard function-local statics
+struct OfflineCRCTable
+{
+    uint32_t Entries[256];
+
+    OfflineCRCTable()
+    {
+        for (uint32_t n = 0; n < 256; n++)
+        {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++)
+                c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+            Entries[n] = c;
+        }
+    }
+};
+
+static const OfflineCRCTable s_CRCTable;
+
+static uint32_t UpdateCRC(uint32_t crc, const uint8_t* pData, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+        crc = s_CRCTable.Entries[(crc ^ pData[i]) & 0xff] ^ (crc >> 8);
+    return crc;
+}
+
+static void PutChunk(std::vector<uint8_t>* pFile, const char* type, const std::vector<uint8_t>& data)
+{
+    PutU32BE(pFile, (uint32_t)data.size());
+    size_t start = pFile->size();
+    PutBytes(pFile, type, 4);
+    if (!data.empty())
+        PutBytes(pFile, &data[0], data.size());
+    PutU32BE(pFile, UpdateCRC(0xffffffff, &(*pFile)[start], pFile->size() - start) ^ 0xffffffff);
+}
+
+static void EncodePNG(const OfflineImage& image, std::vector<uint8_t>* pFile)
+{
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    PutBytes(pFile, signature, 8);
+
+    std::vector<uint8_t> header;
+    PutU32BE(&header, image.Width);
+    PutU32BE(&header, image.Height);
+    header.push_back(8);    // bit depth
+    header.push_back(2);    // RGB
+    header.push_back(0);    // deflate
+    header.push_back(0);    // adaptive filtering
+    header.push_back(0);    // no interlace
+    PutChunk(pFile, "IHDR", header);
+
+    // Every row unfiltered
+    const uint32_t rowBytes = 1 + image.Width*3;
+    std::vector<uint8_t> rows((size_t)rowBytes*image.Height);
+    for (uint32_t y = 0; y < image.Height; y++)
+    {
+        uint8_t* pDest = &rows[(size_t)y*rowBytes];
+        const uint8_t* pSource = image.GetRow(y);
+        *pDest++ = 0;
+        for (uint32_t x = 0; x < image.Width; x++, pDest += 3, pSource += 4)
+            memcpy(pDest, pSource, 3);
+    }
+
+    std::vector<uint8_t> data;
+    Deflate(rows, 3, rowBytes, &data);
+    PutChunk(pFile, "IDAT", data);
+    PutChunk(pFile, "IEND", std::vector<uint8_t>());
+}
+
+
+//--------------------------------------------------------------------------------------
+// OpenEXR: scan lines of B, G and R halves, uncompressed
+//--------------------------------------------------------------------------------------
+static uint16_t FloatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, 4);
+
+    uint32_t sign     = (bits >> 16) & 0x8000;
+    int32_t  exponent = (int32_t)((bits >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = bits & 0x7fffff;
+    if (exponent <= 0)
+        return (uint16_t)sign;      // too small for a normal half; 8-bit values never are
+    if (exponent >= 31)
+        return (uint16_t)(sign | 0x7c00);
+
+    uint32_t half = sign | (exponent << 10) | (mantissa >> 13);
+    if (mantissa & 0x1000)
+        half++;                     // round to nearest, carrying into the exponent
+    return (uint16_t)half;
+}
+
+static void PutAttribute(std::vector<uint8_t>* pFile, const char* name, const char* type, const void* pValue,
+                         uint32_t size)
+{
+    PutString(pFile, name);
+    PutString(pFile, type);
+    PutU32LE(pFile, size);
+    PutBytes(pFile, pValue, size);
+}
+
+static void EncodeEXR(const OfflineImage& image, std::vector<uint8_t>* pFile)
+{
+    uint16_t halves[256];
+    for (int i = 0; i < 256; i++)
+        halves[i] = FloatToHalf((float)i/255.0f);
+
+    PutU32LE(pFile, 20000630);      // magic
+    PutU32LE(pFile, 2);             // version 2, single part scan lines
+
+    std::vector<uint8_t> channels;
+    const char* names[3] = { "B", "G", "R" };
+    for (int c = 0; c < 3; c++)
+    {
+        PutString(&channels, names[c]);
+        PutU32LE(&channels, 1);     // HALF
+        PutU32LE(&channels, 0);     // pLinear and reserved
+        PutU32LE(&channels, 1);     // x and y sampling
+        PutU32LE(&channels, 1);
+    }
+    channels.push_back(0);
+
+    int32_t window[4] = { 0, 0, (int32_t)image.Width - 1, (int32_t)image.Height - 1 };
+    uint8_t zero = 0;
+    float   one = 1.0f;
+    float   centre[2] = { 0.0f, 0.0f };
+    PutAttribute(pFile, "channels", "chlist", &channels[0], (uint32_t)channels.size());
+    PutAttribute(pFile, "compression", "compression", &zero, 1);
+    PutAttribute(pFile, "dataWindow", "box2i", window, sizeof(window));
+    PutAttribute(pFile, "displayWindow", "box2i", window, sizeof(window));
+    PutAttribute(pFile, "lineOrder", "lineOrder", &zero, 1);
+    PutAttribute(pFile, "pixelAspectRatio", "float", &one, 4);
+    PutAttribute(pFile, "screenWindowCenter", "v2f", centre, sizeof(centre));
+    PutAttribute(pFile, "screenWindowWidth", "float", &one, 4);
+    pFile->push_back(0);
+
+    // The offset table, then each line with its y and size
+    const uint32_t lineBytes = image.Width*3*2;
+    uint64_t offset = pFile->size() + (uint64_t)image.Height*8;
+    for (uint32_t y = 0; y < image.Height; y++, offset += 8 + lineBytes)
+    {
+        PutU32LE(pFile, (uint32_t)offset);
+        PutU32LE(pFile, (uint32_t)(offset >> 32));
+    }
+
+    std::vector<uint16_t> line((size_t)image.Width*3);
+    for (uint32_t y = 0; y < image.Height; y++)
+    {
+        const uint8_t* pSource = image.GetRow(y);
+        for (uint32_t x = 0; x < image.Width; x++)
+        {
+            line[x]                   = halves[pSource[x*4 + 2]];
+            line[image.Width + x]     = halves[pSource[x*4 + 1]];
+            line[2*image.Width + x]   = halves[pSource[x*4 + 0]];
+        }
+
+        PutU32LE(pFile, y);
+        PutU32LE(pFile, lineBytes);
+        for (size_t i = 0; i < line.size(); i++)
+        {
+            pFile->push_back((uint8_t)line[i]);
+            pFile->push_back((uint8_t)(line[i] >> 8));
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+void OfflineEncodeImage(const OfflineImage& image, OFFLINE_IMAGE_FORMAT format, std::vector<uint8_t>* pFile)
+{
+    DXUT_PROFILE_SCOPE(L"Offline Image Encode");
+
+    pFile->clear();
+    switch (format)
+    {
+    case OFFLINE_IMAGE_PNG: EncodePNG(image, pFile); break;
+    case OFFLINE_IMAGE_PPM: EncodePPM(image, pFile); break;
+    default:                EncodeEXR(image, pFile); break;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+bool OfflineWriteImage(const char* fileName, const OfflineImage& image, OFFLINE_IMAGE_FORMAT format)
+{
+    std::vector<uint8_t> file;
+    OfflineEncodeImage(image, format, &file);
+
+    FILE* pFile = fopen(fileName, "wb");
+    if (!pFile)
+        return false;
+
+    bool ok = file.empty() || fwrite(&file[0], 1, file.size(), pFile) == file.size();
+    ok = fclose(pFile) == 0 && ok;
+    return ok;
+}
+
+
+//--------------------------------------------------------------------------------------
+// COfflineImageWriter
+//--------------------------------------------------------------------------------------
+COfflineImageWriter::COfflineImageWriter() : m_MaxQueued(1),
+                                             m_Stopping(false),
+                                             m_ImagesWritten(0),
+                                             m_Failures(0),
+                                             m_BytesWritten(0)
+{
+}
+
+
+//--------------------------------------------------------------------------------------
+COfflineImageWriter::~COfflineImageWriter()
+{
+    Finish();
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineImageWriter::Start(uint32_t threads, uint32_t maxQueued)
+{
+    Finish();
+
+    m_MaxQueued     = std::max(maxQueued, 1u);
+    m_Stopping      = false;
+    m_ImagesWritten = 0;
+    m_Failures      = 0;
+    m_BytesWritten  = 0;
+    for (uint32_t i = 0; i < std::max(threads, 1u); i++)
+        m_Threads.push_back(std::thread(&COfflineImageWriter::WorkerThread, this));
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineImageWriter::Submit(const std::string& fileName, OFFLINE_IMAGE_FORMAT format, OfflineImage* pImage)
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (m_Queue.size() >= m_MaxQueued)
+        m_SpaceFree.wait(lock);
+
+    m_Queue.push_back(Job());
+    Job& job = m_Queue.back();
+    job.FileName     = fileName;
+    job.Format       = format;
+    job.Image.Width  = pImage->Width;
+    job.Image.Height = pImage->Height;
+    job.Image.Pixels.swap(pImage->Pixels);
+    pImage->Pixels.clear();
+
+    m_JobReady.notify_one();
+}
+
+
+//--------------------------------------------------------------------------------------
+uint32_t COfflineImageWriter::Finish()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stopping = true;
+    }
+    m_JobReady.notify_all();
+
+    for (size_t i = 0; i < m_Threads.size(); i++)
+        m_Threads[i].join();
+    m_Threads.clear();
+
+    return m_Failures;
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineImageWriter::WorkerThread()
+{
+    std::vector<uint8_t> file;
+    for (;;)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            while (m_Queue.empty() && !m_Stopping)
+                m_JobReady.wait(lock);
+            if (m_Queue.empty())
+                return;
+
+            Job& next = m_Queue.front();
+            job.FileName.swap(next.FileName);
+            job.Format       = next.Format;
+            job.Image.Width  = next.Image.Width;
+            job.Image.Height = next.Image.Height;
+            job.Image.Pixels.swap(next.Image.Pixels);
+            m_Queue.pop_front();
+        }
+        m_SpaceFree.notify_one();
+
+        OfflineEncodeImage(job.Image, job.Format, &file);
+
+        bool ok = false;
+        FILE* pFile = fopen(job.FileName.c_str(), "wb");
+        if (pFile)
+        {
+            ok = file.empty() || fwrite(&file[0], 1, file.size(), pFile) == file.size();
+            ok = fclose(pFile) == 0 && ok;
+        }
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (ok)
+        {
+            m_ImagesWritten++;
+            m_BytesWritten += file.size();
+        }
+        else
+            m_Failures++;
+    }
+}
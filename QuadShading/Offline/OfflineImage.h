@@ -0,0 +1,97 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineImage.h
+//
+// RGBA8 images for the offline overshading engine, and encoders for the formats batch
+// runs write: binary PPM, PNG (deflated with fixed Huffman codes and matches against
+// the previous pixel and row, which is all a heatmap of 2x2 blocks needs) and
+// uncompressed half-float OpenEXR. A pool of writer threads encodes and saves images
+// behind a bounded queue, so that producers can hand off thousands of images without
+// waiting on the disk or holding more than a few in memory.
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef OFFLINE_IMAGE_H
+#define OFFLINE_IMAGE_H
+
+#include <stdint.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define OFFLINE_IMAGE_DEFAULT_QUEUE     16      // images waiting per writer thread
+
+enum OFFLINE_IMAGE_FORMAT
+{
+    OFFLINE_IMAGE_PNG,
+    OFFLINE_IMAGE_PPM,
+    OFFLINE_IMAGE_EXR,
+    OFFLINE_NB_IMAGE_FORMATS
+};
+
+// File extension, without the dot
+const char* OfflineGetImageFormatName(OFFLINE_IMAGE_FORMAT format);
+
+struct OfflineImage
+{
+    uint32_t Width;
+    uint32_t Height;
+    std::vector<uint8_t> Pixels;    // RGBA, rows top to bottom
+
+    void                Resize(uint32_t width, uint32_t height);
+    uint8_t*            GetRow(uint32_t y)          { return &Pixels[(size_t)y*Width*4]; }
+    const uint8_t*      GetRow(uint32_t y) const    { return &Pixels[(size_t)y*Width*4]; }
+};
+
+// The whole file in memory; alpha is dropped, and EXR gets the 8-bit values as halves
+void OfflineEncodeImage(const OfflineImage& image, OFFLINE_IMAGE_FORMAT format, std::vector<uint8_t>* pFile);
+bool OfflineWriteImage(const char* fileName, const OfflineImage& image, OFFLINE_IMAGE_FORMAT format);
+
+
+//--------------------------------------------------------------------------------------
+// Threads that encode and write submitted images in the background
+//--------------------------------------------------------------------------------------
+class COfflineImageWriter
+{
+public:
+                        COfflineImageWriter();
+                        ~COfflineImageWriter();
+
+    void                Start(uint32_t threads, uint32_t maxQueued);
+
+    // Takes the image's pixels, leaving it empty. Blocks while the queue is full.
+    void                Submit(const std::string& fileName, OFFLINE_IMAGE_FORMAT format, OfflineImage* pImage);
+
+    // Waits for the queue to drain and the threads to exit, and returns the number of
+    // images that failed to write
+    uint32_t            Finish();
+
+    uint32_t            GetImagesWritten() const    { return m_ImagesWritten; }
+    uint64_t            GetBytesWritten() const     { return m_BytesWritten; }
+
+protected:
+    struct Job
+    {
+        std::string             FileName;
+        OFFLINE_IMAGE_FORMAT    Format;
+        OfflineImage            Image;
+    };
+
+    void                WorkerThread();
+
+    std::vector<std::thread>    m_Threads;
+    std::mutex                  m_Mutex;
+    std::condition_variable     m_JobReady;     // or stopping
+    std::condition_variable     m_SpaceFree;
+    std::deque<Job>             m_Queue;
+    uint32_t                    m_MaxQueued;
+    bool                        m_Stopping;
+    uint32_t                    m_ImagesWritten;
+    uint32_t                    m_Failures;
+    uint64_t                    m_BytesWritten;
+};
+
+#endif
@@ -0,0 +1,365 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineInstances.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+#include "OfflineInstances.h"
+#include "OfflineJitter.h"
+#include "DXUTprofiler.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <thread>
+
+//--------------------------------------------------------------------------------------
+const char* OfflineGetInstanceLayoutName(OFFLINE_INSTANCE_LAYOUT layout)
+{
+    static const char* names[OFFLINE_NB_INSTANCE_LAYOUTS] =
+    {
+        "grid",
+        "scatter",
+        "file"
+    };
+    return names[layout];
+}
+
+
+//--------------------------------------------------------------------------------------
+static void GetMeshBounds(const COfflineMesh& mesh, Vec3* pMin, Vec3* pMax)
+{
+    *pMin = MakeVec3(FLT_MAX, FLT_MAX, FLT_MAX);
+    *pMax = MakeVec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for (uint32_t c = 0; c < mesh.GetNumClusters(); c++)
+    {
+        *pMin = Minimize(*pMin, mesh.GetCluster(c).BoundsMin);
+        *pMax = Maximize(*pMax, mesh.GetCluster(c).BoundsMax);
+    }
+    if (!mesh.GetNumClusters())
+    {
+        *pMin = MakeVec3(0, 0, 0);
+        *pMax = MakeVec3(0, 0, 0);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+Mat4 OfflineMakeInstanceWorld(const Vec3& pivot, const Vec3& offset, float yaw, float scale)
+{
+    const float c = cosf(yaw)*scale;
+    const float s = sinf(yaw)*scale;
+
+    Mat4 rotation = MatrixIdentity();
+    rotation.m[0][0] = c;
+    rotation.m[0][2] = -s;
+    rotation.m[1][1] = scale;
+    rotation.m[2][0] = s;
+    rotation.m[2][2] = c;
+
+    Vec3 to = Add(pivot, offset);
+    return MatrixMultiply(MatrixMultiply(MatrixTranslation(-pivot.x, -pivot.y, -pivot.z), rotation),
+                          MatrixTranslation(to.x, to.y, to.z));
+}
+
+
+//--------------------------------------------------------------------------------------
+// Rows across x, going away from the camera in z
+//--------------------------------------------------------------------------------------
+static void GetGridLayout(const COfflineMesh& mesh, uint32_t count, uint32_t* pColumns, uint32_t* pRows,
+                          Vec3* pSpacing, Vec3* pCentre)
+{
+    Vec3 boundsMin, boundsMax;
+    GetMeshBounds(mesh, &boundsMin, &boundsMax);
+
+    *pColumns = std::max((uint32_t)ceil(sqrt((double)count)), 1u);
+    *pRows    = (count + *pColumns - 1)/(*pColumns);
+    *pSpacing = Scale(Subtract(boundsMax, boundsMin), OFFLINE_INSTANCE_SPACING);
+    *pCentre  = Scale(Add(boundsMin, boundsMax), 0.5f);
+}
+
+void OfflineMakeInstanceGrid(const COfflineMesh& mesh, uint32_t count, std::vector<Mat4>* pWorlds)
+{
+    uint32_t columns, rows;
+    Vec3 spacing, centre;
+    GetGridLayout(mesh, count, &columns, &rows, &spacing, &centre);
+
+    pWorlds->resize(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        Vec3 offset = MakeVec3((i%columns - 0.5f*(columns - 1))*spacing.x, 0,
+                               (i/columns - 0.5f*(rows - 1))*spacing.z);
+        (*pWorlds)[i] = OfflineMakeInstanceWorld(centre, offset, 0.0f, 1.0f);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Halton(2, 3) positions, so that the scatter is even and the same from run to run
+//--------------------------------------------------------------------------------------
+void OfflineMakeInstanceScatter(const COfflineMesh& mesh, uint32_t count, std::vector<Mat4>* pWorlds)
+{
+    uint32_t columns, rows;
+    Vec3 spacing, centre;
+    GetGridLayout(mesh, count, &columns, &rows, &spacing, &centre);
+
+    pWorlds->resize(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        Vec3 offset = MakeVec3((OfflineHalton(i + 1, 2) - 0.5f)*columns*spacing.x, 0,
+                               (OfflineHalton(i + 1, 3) - 0.5f)*rows*spacing.z);
+        float yaw   = 2.0f*3.14159265f*OfflineHalton(i + 1, 5);
+        float scale = 0.75f + 0.5f*OfflineHalton(i + 1, 7);
+        (*pWorlds)[i] = OfflineMakeInstanceWorld(centre, offset, yaw, scale);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// The mesh is turned about its own origin here, as a level editor would place it
+//--------------------------------------------------------------------------------------
+bool OfflineLoadInstances(const char* fileName, std::vector<Mat4>* pWorlds)
+{
+    FILE* pFile = fopen(fileName, "rt");
+    if (!pFile)
+        return false;
+
+    pWorlds->clear();
+    bool ok = true;
+    char line[256];
+    while (ok && fgets(line, sizeof(line), pFile))
+    {
+        const char* p = line + strspn(line, " \t");
+        if (*p == '#' || *p == '\n' || *p == '\r' || *p == 0)
+            continue;
+
+        float x, y, z, yaw = 0.0f, scale = 1.0f;
+        ok = sscanf(p, "%f %f %f %f %f", &x, &y, &z, &yaw, &scale) >= 3;
+        if (ok)
+        {
+            pWorlds->push_back(OfflineMakeInstanceWorld(MakeVec3(0, 0, 0), MakeVec3(x, y, z), yaw*3.14159265f/180.0f,
+                                                        scale));
+        }
+    }
+
+    fclose(pFile);
+    return ok;
+}
+
+
+//--------------------------------------------------------------------------------------
+// COfflineInstanceAttribution
+//--------------------------------------------------------------------------------------
+void COfflineInstanceAttribution::Resize(uint32_t nbInstances)
+{
+    OfflineLiveTotals empty;
+    memset(&empty, 0, sizeof(empty));
+    m_Instances.assign(nbInstances, empty);
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineInstanceAttribution::OnQuad(const OfflineTriangle& tri, const OfflineQuad& quad)
+{
+    if (tri.Instance >= m_Instances.size())
+        return;
+
+    OfflineAddQuad(&m_Instances[tri.Instance], quad.Live);
+}
+
+
+//--------------------------------------------------------------------------------------
+// COfflineInstancedScene
+//--------------------------------------------------------------------------------------
+COfflineInstancedScene::COfflineInstancedScene() : m_InstancesCulled(0)
+{
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineInstancedScene::SetInstances(const COfflineMesh& mesh, const std::vector<Mat4>& worlds)
+{
+    Vec3 boundsMin, boundsMax;
+    GetMeshBounds(mesh, &boundsMin, &boundsMax);
+
+    m_Instances.resize(worlds.size());
+    for (size_t i = 0; i < worlds.size(); i++)
+    {
+        m_Instances[i].Instance.pMesh = &mesh;
+        m_Instances[i].Instance.World = worlds[i];
+        m_Instances[i].BoundsMin      = boundsMin;
+        m_Instances[i].BoundsMax      = boundsMax;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Bounds are worked out once for each run of instances of the same mesh
+//--------------------------------------------------------------------------------------
+void COfflineInstancedScene::SetInstances(const std::vector<OfflineInstance>& instances)
+{
+    m_Instances.resize(instances.size());
+    for (size_t i = 0; i < instances.size(); i++)
+    {
+        InstanceState& state = m_Instances[i];
+        state.Instance = instances[i];
+        if (i && instances[i].pMesh == instances[i - 1].pMesh)
+        {
+            state.BoundsMin = m_Instances[i - 1].BoundsMin;
+            state.BoundsMax = m_Instances[i - 1].BoundsMax;
+        }
+        else
+            GetMeshBounds(*instances[i].pMesh, &state.BoundsMin, &state.BoundsMax);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineInstancedScene::GetBounds(Vec3* pMin, Vec3* pMax) const
+{
+    *pMin = MakeVec3(FLT_MAX, FLT_MAX, FLT_MAX);
+    *pMax = MakeVec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for (size_t i = 0; i < m_Instances.size(); i++)
+    {
+        const InstanceState& state = m_Instances[i];
+        for (int c = 0; c < 8; c++)
+        {
+            Vec4 p = TransformPoint(MakeVec3(c & 1 ? state.BoundsMax.x : state.BoundsMin.x,
+                                             c & 2 ? state.BoundsMax.y : state.BoundsMin.y,
+                                             c & 4 ? state.BoundsMax.z : state.BoundsMin.z), state.Instance.World);
+            *pMin = Minimize(*pMin, MakeVec3(p.x, p.y, p.z));
+            *pMax = Maximize(*pMax, MakeVec3(p.x, p.y, p.z));
+        }
+    }
+    if (m_Instances.empty())
+    {
+        *pMin = MakeVec3(0, 0, 0);
+        *pMax = MakeVec3(0, 0, 0);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Chunks are contiguous runs of instances, so each rasterizer's triangles are already
+// in draw order
+//--------------------------------------------------------------------------------------
+void COfflineInstancedScene::Setup(const Mat4& viewProj, uint32_t width, uint32_t height, uint32_t threads)
+{
+    DXUT_PROFILE_SCOPE(L"Offline Instanced Setup");
+
+    const uint32_t instances = GetNumInstances();
+    const uint32_t chunks    = std::max(std::min(threads, instances), 1u);
+    m_Chunks.resize(chunks);
+    for (uint32_t c = 0; c < chunks; c++)
+    {
+        Chunk& chunk = m_Chunks[c];
+        chunk.FirstInstance   = (uint32_t)((uint64_t)instances*c/chunks);
+        chunk.EndInstance     = (uint32_t)((uint64_t)instances*(c + 1)/chunks);
+        chunk.InstancesCulled = 0;
+        chunk.Rasterizer.Reset();
+        chunk.Rasterizer.SetViewport(width, height);
+    }
+
+    std::vector<std::thread> workers;
+    for (uint32_t c = 1; c < chunks; c++)
+        workers.push_back(std::thread(&COfflineInstancedScene::SetupChunk, this, &viewProj, c));
+    SetupChunk(&viewProj, 0);
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+
+    m_InstancesCulled = 0;
+    for (uint32_t c = 0; c < chunks; c++)
+        m_InstancesCulled += m_Chunks[c].InstancesCulled;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Every instance numbers its triangles from zero, as a draw of the mesh does, and the
+// instance ID tells them apart
+//--------------------------------------------------------------------------------------
+void COfflineInstancedScene::SetupChunk(const Mat4* pViewProj, uint32_t c)
+{
+    Chunk& chunk = m_Chunks[c];
+    COfflineRasterizer& rasterizer = chunk.Rasterizer;
+
+    for (uint32_t i = chunk.FirstInstance; i < chunk.EndInstance; i++)
+    {
+        const InstanceState& state = m_Instances[i];
+        const COfflineMesh* pMesh = state.Instance.pMesh;
+
+        Mat4 worldViewProj = MatrixMultiply(state.Instance.World, *pViewProj);
+        if (!IsVisible(state, worldViewProj))
+        {
+            for (uint32_t cluster = 0; cluster < pMesh->GetNumClusters(); cluster++)
+                rasterizer.SkipCluster(*pMesh, cluster);
+            chunk.InstancesCulled++;
+            continue;
+        }
+
+        rasterizer.TransformVertices(pMesh->GetPositions(), pMesh->GetNumVertices(), worldViewProj);
+        for (uint32_t cluster = 0; cluster < pMesh->GetNumClusters(); cluster++)
+            rasterizer.SetupCluster(*pMesh, cluster, 0, i);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Visible unless every corner of the bounds is outside the same plane
+//--------------------------------------------------------------------------------------
+bool COfflineInstancedScene::IsVisible(const InstanceState& instance, const Mat4& worldViewProj)
+{
+    uint32_t outside = OFFLINE_OUTCODE_VIEW_MASK;
+    for (int i = 0; i < 8 && outside; i++)
+    {
+        Vec3 corner = MakeVec3(i & 1 ? instance.BoundsMax.x : instance.BoundsMin.x,
+                               i & 2 ? instance.BoundsMax.y : instance.BoundsMin.y,
+                               i & 4 ? instance.BoundsMax.z : instance.BoundsMin.z);
+        outside &= OfflineOutCode(TransformPoint(corner, worldViewProj), 1.0f);
+    }
+    return outside == 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineInstancedScene::Rasterize(COfflineDepthBuffer* pDepth, OFFLINE_DEPTH_MODE mode, IOfflineQuadSink* pSink)
+{
+    for (size_t c = 0; c < m_Chunks.size(); c++)
+        m_Chunks[c].Rasterizer.Rasterize(pDepth, mode, pSink);
+}
+
+
+//--------------------------------------------------------------------------------------
+uint32_t COfflineInstancedScene::GetNumTriangles() const
+{
+    uint32_t count = 0;
+    for (size_t c = 0; c < m_Chunks.size(); c++)
+        count += m_Chunks[c].Rasterizer.GetNumTriangles();
+    return count;
+}
+
+
+//--------------------------------------------------------------------------------------
+OfflineRasterStats COfflineInstancedScene::GetStats() const
+{
+    OfflineRasterStats stats;
+    memset(&stats, 0, sizeof(stats));
+    for (size_t c = 0; c < m_Chunks.size(); c++)
+    {
+        const OfflineRasterStats& chunk = m_Chunks[c].Rasterizer.GetStats();
+        stats.TrianglesIn         += chunk.TrianglesIn;
+        stats.TrianglesSkipped    += chunk.TrianglesSkipped;
+        stats.TrianglesOutside    += chunk.TrianglesOutside;
+        stats.TrianglesClipped    += chunk.TrianglesClipped;
+        stats.TrianglesBackFacing += chunk.TrianglesBackFacing;
+        stats.TrianglesZeroArea   += chunk.TrianglesZeroArea;
+        stats.TrianglesNoSamples  += chunk.TrianglesNoSamples;
+        stats.TrianglesSetUp      += chunk.TrianglesSetUp;
+        stats.QuadsCovered        += chunk.QuadsCovered;
+        stats.QuadsLive           += chunk.QuadsLive;
+        stats.PixelsLive          += chunk.PixelsLive;
+        stats.DepthTests          += chunk.DepthTests;
+    }
+    return stats;
+}
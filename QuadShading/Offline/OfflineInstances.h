@@ -0,0 +1,127 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineInstances.h
+//
+// Instanced scenes for the offline overshading engine. The demo draws hebe.sdkmesh
+// once; here meshes are drawn any number of times, each instance with its own world
+// transform, laid out on a grid, scattered, or read from a file. Instances wholly
+// outside the view are culled on their bounds, and the rest are transformed and set up
+// in chunks on separate threads, one rasterizer per chunk. The chunks are then
+// rasterized in instance order, as a draw per instance would be, and every triangle
+// keeps its instance ID so that sinks can attribute quads to instances.
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef OFFLINE_INSTANCES_H
+#define OFFLINE_INSTANCES_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "OfflineMath.h"
+#include "OfflineMesh.h"
+#include "OfflineMethods.h"
+#include "OfflineRaster.h"
+
+#define OFFLINE_DEFAULT_INSTANCES       1024
+#define OFFLINE_INSTANCE_SPACING        1.25f   // bounds apart, on the grid
+
+enum OFFLINE_INSTANCE_LAYOUT
+{
+    OFFLINE_INSTANCES_GRID,     // rows on the xz plane, facing the camera
+    OFFLINE_INSTANCES_SCATTER,  // Halton positions, headings and scales over the same area
+    OFFLINE_INSTANCES_FILE,     // "x y z [yaw [scale]]" per line
+    OFFLINE_NB_INSTANCE_LAYOUTS
+};
+
+const char* OfflineGetInstanceLayoutName(OFFLINE_INSTANCE_LAYOUT layout);
+
+// Turned by yaw radians about y and scaled, both about pivot, then moved by offset
+Mat4 OfflineMakeInstanceWorld(const Vec3& pivot, const Vec3& offset, float yaw, float scale);
+
+// Layouts centred on the origin, in rows spaced by the mesh's bounds
+void OfflineMakeInstanceGrid(const COfflineMesh& mesh, uint32_t count, std::vector<Mat4>* pWorlds);
+void OfflineMakeInstanceScatter(const COfflineMesh& mesh, uint32_t count, std::vector<Mat4>* pWorlds);
+
+// Yaw is in degrees about y; blank lines and lines starting with # are skipped
+bool OfflineLoadInstances(const char* fileName, std::vector<Mat4>* pWorlds);
+
+
+// A mesh and where it goes; the mesh is shared, not copied
+struct OfflineInstance
+{
+    const COfflineMesh* pMesh;
+    Mat4                World;
+};
+
+
+//--------------------------------------------------------------------------------------
+// The quads each instance launched
+//--------------------------------------------------------------------------------------
+class COfflineInstanceAttribution : public IOfflineQuadSink
+{
+public:
+    void                Resize(uint32_t nbInstances);
+
+    virtual void        OnQuad(const OfflineTriangle& tri, const OfflineQuad& quad);
+
+    const OfflineLiveTotals& GetInstance(uint32_t instance) const { return m_Instances[instance]; }
+
+protected:
+    std::vector<OfflineLiveTotals> m_Instances;
+};
+
+
+//--------------------------------------------------------------------------------------
+class COfflineInstancedScene
+{
+public:
+                        COfflineInstancedScene();
+
+    // Copies of one mesh, or instances of any number of meshes
+    void                SetInstances(const COfflineMesh& mesh, const std::vector<Mat4>& worlds);
+    void                SetInstances(const std::vector<OfflineInstance>& instances);
+
+    // Culls the instances against the view, then sets up the rest, with a chunk of
+    // instances per thread
+    void                Setup(const Mat4& viewProj, uint32_t width, uint32_t height, uint32_t threads);
+
+    // The chunks one after another, so that depth and quads come out in instance order
+    void                Rasterize(COfflineDepthBuffer* pDepth, OFFLINE_DEPTH_MODE mode, IOfflineQuadSink* pSink);
+
+    uint32_t            GetNumInstances() const     { return (uint32_t)m_Instances.size(); }
+    const OfflineInstance& GetInstance(uint32_t i) const { return m_Instances[i].Instance; }
+    uint32_t            GetInstancesCulled() const  { return m_InstancesCulled; }
+    uint32_t            GetNumTriangles() const;
+
+    // World-space box around every instance's bounds
+    void                GetBounds(Vec3* pMin, Vec3* pMax) const;
+
+    // Summed over the chunks
+    OfflineRasterStats  GetStats() const;
+
+protected:
+    struct InstanceState
+    {
+        OfflineInstance     Instance;
+        Vec3                BoundsMin;      // of the mesh, in object space
+        Vec3                BoundsMax;
+    };
+
+    void                SetupChunk(const Mat4* pViewProj, uint32_t chunk);
+    static bool         IsVisible(const InstanceState& instance, const Mat4& worldViewProj);
+
+    struct Chunk
+    {
+        COfflineRasterizer  Rasterizer;
+        uint32_t            FirstInstance;
+        uint32_t            EndInstance;
+        uint32_t            InstancesCulled;
+    };
+
+    std::vector<InstanceState>  m_Instances;
+    std::vector<Chunk>          m_Chunks;
+    uint32_t                    m_InstancesCulled;
+};
+
+#endif
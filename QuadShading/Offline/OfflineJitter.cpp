@@ -0,0 +1,172 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineJitter.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#include "OfflineJitter.h"
+#include "OfflineMethods.h"
+
+#include <string.h>
+#include <algorithm>
+
+//--------------------------------------------------------------------------------------
+float OfflineHalton(uint32_t index, uint32_t base)
+{
+    float result   = 0.0f;
+    float fraction = 1.0f;
+    while (index > 0)
+    {
+        fraction /= (float)base;
+        result   += fraction*(float)(index%base);
+        index    /= base;
+    }
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------
+void OfflineGetJitterOffset(uint32_t sample, float* pX, float* pY)
+{
+    *pX = OfflineHalton(sample + 1, 2) - 0.5f;
+    *pY = OfflineHalton(sample + 1, 3) - 0.5f;
+}
+
+
+//--------------------------------------------------------------------------------------
+// The offset is added in clip space scaled by w, so that it comes out as a constant
+// shift in NDC, and NDC y points up
+//--------------------------------------------------------------------------------------
+Mat4 OfflineJitterViewProjection(const Mat4& viewProj, float x, float y, uint32_t width, uint32_t height)
+{
+    Mat4 jitter = MatrixTranslation(2.0f*x/(float)width, -2.0f*y/(float)height, 0.0f);
+    return MatrixMultiply(viewProj, jitter);
+}
+
+
+//--------------------------------------------------------------------------------------
+// COfflineJitterSample
+//--------------------------------------------------------------------------------------
+COfflineJitterSample::COfflineJitterSample() : m_GridWidth(0),
+                                               m_GridHeight(0),
+                                               m_RegionQuads(1),
+                                               m_RegionsX(0),
+                                               m_RegionsY(0)
+{
+    memset(&m_Totals, 0, sizeof(m_Totals));
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineJitterSample::Resize(uint32_t gridWidth, uint32_t gridHeight, uint32_t regionSize)
+{
+    m_GridWidth   = gridWidth;
+    m_GridHeight  = gridHeight;
+    m_RegionQuads = std::max(1u, regionSize >> 1);
+    m_RegionsX    = (gridWidth + m_RegionQuads - 1)/m_RegionQuads;
+    m_RegionsY    = (gridHeight + m_RegionQuads - 1)/m_RegionQuads;
+    m_Quads.assign((size_t)m_RegionsX*m_RegionsY, 0);
+    m_Live.assign((size_t)m_RegionsX*m_RegionsY, 0);
+    memset(&m_Totals, 0, sizeof(m_Totals));
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineJitterSample::OnQuad(const OfflineTriangle&, const OfflineQuad& quad)
+{
+    if (quad.X >= m_GridWidth || quad.Y >= m_GridHeight)
+        return;
+
+    uint32_t live   = OfflineCountLanes(quad.Live);
+    size_t   region = (size_t)(quad.Y/m_RegionQuads)*m_RegionsX + quad.X/m_RegionQuads;
+    m_Quads[region]++;
+    m_Live[region] += live;
+    OfflineAddQuad(&m_Totals, quad.Live);
+}
+
+
+//--------------------------------------------------------------------------------------
+// COfflineJitterStats
+//--------------------------------------------------------------------------------------
+COfflineJitterStats::COfflineJitterStats() : m_NbSamples(0),
+                                             m_RegionsX(0),
+                                             m_RegionsY(0)
+{
+    memset(&m_Total, 0, sizeof(m_Total));
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineJitterStats::Resize(uint32_t regionsX, uint32_t regionsY)
+{
+    Sums empty;
+    memset(&empty, 0, sizeof(empty));
+
+    m_NbSamples = 0;
+    m_RegionsX  = regionsX;
+    m_RegionsY  = regionsY;
+    m_Regions.assign((size_t)regionsX*regionsY, empty);
+    m_Total = empty;
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineJitterStats::AddSample(const COfflineJitterSample& sample)
+{
+    m_NbSamples++;
+    for (size_t i = 0; i < m_Regions.size(); i++)
+        Accumulate(&m_Regions[i], sample.GetRegionQuads((uint32_t)i), sample.GetRegionLive((uint32_t)i));
+    Accumulate(&m_Total, sample.GetTotals().Quads, OfflineGetLivePixels(sample.GetTotals()));
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineJitterStats::Accumulate(Sums* pSums, uint64_t quads, uint64_t live)
+{
+    pSums->Quads   += (double)quads;
+    pSums->QuadsSq += (double)quads*(double)quads;
+    if (!quads)
+        return;
+
+    double efficiency = OfflineGetEfficiency(live, quads);
+    pSums->Samples++;
+    pSums->Efficiency   += efficiency;
+    pSums->EfficiencySq += efficiency*efficiency;
+}
+
+
+//--------------------------------------------------------------------------------------
+OfflineJitterRegionStats COfflineJitterStats::GetRegionStats(uint32_t region) const
+{
+    return GetStats(m_Regions[region]);
+}
+
+
+//--------------------------------------------------------------------------------------
+OfflineJitterRegionStats COfflineJitterStats::GetTotalStats() const
+{
+    return GetStats(m_Total);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Population variances, over the samples taken rather than estimated for the sequence
+//--------------------------------------------------------------------------------------
+OfflineJitterRegionStats COfflineJitterStats::GetStats(const Sums& sums) const
+{
+    OfflineJitterRegionStats stats;
+    memset(&stats, 0, sizeof(stats));
+    stats.Samples = sums.Samples;
+
+    if (m_NbSamples)
+    {
+        stats.MeanQuads     = sums.Quads/m_NbSamples;
+        stats.QuadsVariance = std::max(0.0, sums.QuadsSq/m_NbSamples - stats.MeanQuads*stats.MeanQuads);
+    }
+    if (sums.Samples)
+    {
+        stats.MeanEfficiency     = sums.Efficiency/sums.Samples;
+        stats.EfficiencyVariance = std::max(0.0, sums.EfficiencySq/sums.Samples -
+                                                 stats.MeanEfficiency*stats.MeanEfficiency);
+    }
+    return stats;
+}
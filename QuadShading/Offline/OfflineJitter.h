@@ -0,0 +1,117 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineJitter.h
+//
+// Subpixel jitter sweeps for the offline overshading engine. With TAA, g_Projection is
+// offset by a different subpixel amount every frame, which moves triangle edges against
+// the fixed 2x2 quad grid and so changes how well each quad is used. A view is shaded
+// under a Halton(2, 3) sequence of offsets, and quad efficiency (live pixels over four
+// lanes per quad) is gathered per screen region so that its mean and variance across
+// the sequence can be set against the single un-jittered sample.
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef OFFLINE_JITTER_H
+#define OFFLINE_JITTER_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "OfflineMath.h"
+#include "OfflineMethods.h"
+#include "OfflineRaster.h"
+
+#define OFFLINE_JITTER_DEFAULT_SAMPLES  16
+#define OFFLINE_JITTER_DEFAULT_REGION   64      // pixels, even
+
+// Radical inverse of index in the given base
+float OfflineHalton(uint32_t index, uint32_t base);
+
+// Offset of a sample in pixels, in [-0.5, 0.5), from Halton(2, 3) starting at index 1
+// as TAA implementations usually do
+void OfflineGetJitterOffset(uint32_t sample, float* pX, float* pY);
+
+// viewProj followed by a translation of x pixels right and y pixels down
+Mat4 OfflineJitterViewProjection(const Mat4& viewProj, float x, float y, uint32_t width, uint32_t height);
+
+
+//--------------------------------------------------------------------------------------
+// The quads one jittered shading pass launches in each region
+//--------------------------------------------------------------------------------------
+class COfflineJitterSample : public IOfflineQuadSink
+{
+public:
+                        COfflineJitterSample();
+
+    // Grid size in quads, as the UAVs'; region size in pixels
+    void                Resize(uint32_t gridWidth, uint32_t gridHeight, uint32_t regionSize);
+
+    virtual void        OnQuad(const OfflineTriangle& tri, const OfflineQuad& quad);
+
+    uint32_t            GetRegionsX() const             { return m_RegionsX; }
+    uint32_t            GetRegionsY() const             { return m_RegionsY; }
+    uint32_t            GetRegionQuads(uint32_t region) const   { return m_Quads[region]; }
+    uint32_t            GetRegionLive(uint32_t region) const    { return m_Live[region]; }
+
+    const OfflineLiveTotals& GetTotals() const          { return m_Totals; }
+
+protected:
+    uint32_t                m_GridWidth;
+    uint32_t                m_GridHeight;
+    uint32_t                m_RegionQuads;  // region size in quads
+    uint32_t                m_RegionsX;
+    uint32_t                m_RegionsY;
+    std::vector<uint32_t>   m_Quads;        // per region
+    std::vector<uint32_t>   m_Live;         // live pixels per region
+    OfflineLiveTotals       m_Totals;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Per-region statistics across samples. Regions a sample leaves empty don't count
+// towards that region's efficiency, but do count as zero quads.
+//--------------------------------------------------------------------------------------
+struct OfflineJitterRegionStats
+{
+    uint32_t Samples;           // samples with at least one quad here
+    double   MeanQuads;
+    double   QuadsVariance;
+    double   MeanEfficiency;
+    double   EfficiencyVariance;
+};
+
+class COfflineJitterStats
+{
+public:
+                        COfflineJitterStats();
+
+    void                Resize(uint32_t regionsX, uint32_t regionsY);
+    void                AddSample(const COfflineJitterSample& sample);
+
+    uint32_t            GetNumSamples() const           { return m_NbSamples; }
+    uint32_t            GetRegionsX() const             { return m_RegionsX; }
+    uint32_t            GetRegionsY() const             { return m_RegionsY; }
+    OfflineJitterRegionStats GetRegionStats(uint32_t region) const;
+
+    // Whole-view efficiency and quads, one value per sample
+    OfflineJitterRegionStats GetTotalStats() const;
+
+protected:
+    struct Sums
+    {
+        uint32_t Samples;
+        double   Quads, QuadsSq;
+        double   Efficiency, EfficiencySq;
+    };
+
+    static void         Accumulate(Sums* pSums, uint64_t quads, uint64_t live);
+    OfflineJitterRegionStats GetStats(const Sums& sums) const;
+
+    uint32_t            m_NbSamples;
+    uint32_t            m_RegionsX;
+    uint32_t            m_RegionsY;
+    std::vector<Sums>   m_Regions;
+    Sums                m_Total;
+};
+
+#endif
@@ -0,0 +1,510 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineLockStress.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+#include "OfflineLockStress.h"
+#include "OfflineMethods.h"
+#include "DXUTframestats.h"
+#include "DXUTprofiler.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <thread>
+
+#define OFFLINE_FRAGMENT_FILE_VERSION   1
+
+//--------------------------------------------------------------------------------------
+// Structures
+//--------------------------------------------------------------------------------------
+struct OfflineFragmentFileHeader
+{
+    char     Magic[4];              // "QSFQ"
+    uint32_t Version;
+    uint32_t GridWidth;
+    uint32_t GridHeight;
+    uint32_t NumFragments;
+};
+
+
+//--------------------------------------------------------------------------------------
+// COfflineFragmentRecorder
+//--------------------------------------------------------------------------------------
+COfflineFragmentRecorder::COfflineFragmentRecorder() : m_GridWidth(0),
+                                                       m_GridHeight(0)
+{
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineFragmentRecorder::SetGrid(uint32_t width, uint32_t height)
+{
+    m_GridWidth  = width;
+    m_GridHeight = height;
+    Clear();
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineFragmentRecorder::Clear()
+{
+    m_Fragments.clear();
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineFragmentRecorder::OnQuad(const OfflineTriangle& tri, const OfflineQuad& quad)
+{
+    if (quad.X >= m_GridWidth || quad.Y >= m_GridHeight)
+        return;
+
+    OfflineFragmentQuad fragment;
+    fragment.X           = quad.X;
+    fragment.Y           = quad.Y;
+    fragment.PrimitiveID = tri.PrimitiveID;
+    fragment.Triangle    = tri.Triangle;
+    fragment.Instance    = tri.Instance;
+    fragment.Live        = quad.Live;
+    m_Fragments.push_back(fragment);
+}
+
+
+//--------------------------------------------------------------------------------------
+bool COfflineFragmentRecorder::Save(const char* fileName) const
+{
+    FILE* pFile = fopen(fileName, "wb");
+    if (!pFile)
+        return false;
+
+    OfflineFragmentFileHeader header;
+    memcpy(header.Magic, "QSFQ", 4);
+    header.Version      = OFFLINE_FRAGMENT_FILE_VERSION;
+    header.GridWidth    = m_GridWidth;
+    header.GridHeight   = m_GridHeight;
+    header.NumFragments = GetNumFragments();
+
+    bool ok = fwrite(&header, sizeof(header), 1, pFile) == 1;
+    if (ok && !m_Fragments.empty())
+        ok = fwrite(&m_Fragments[0], sizeof(m_Fragments[0]), m_Fragments.size(), pFile) == m_Fragments.size();
+    fclose(pFile);
+    return ok;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool COfflineFragmentRecorder::Load(const char* fileName)
+{
+    SetGrid(0, 0);
+
+    FILE* pFile = fopen(fileName, "rb");
+    if (!pFile)
+        return false;
+
+    OfflineFragmentFileHeader header;
+    bool ok = fread(&header, sizeof(header), 1, pFile) == 1 &&
+              memcmp(header.Magic, "QSFQ", 4) == 0 && header.Version == OFFLINE_FRAGMENT_FILE_VERSION &&
+              header.GridWidth > 0 && header.GridHeight > 0 && header.GridWidth <= 8192 && header.GridHeight <= 8192;
+    if (ok && header.NumFragments)
+    {
+        m_Fragments.resize(header.NumFragments);
+        ok = fread(&m_Fragments[0], sizeof(m_Fragments[0]), m_Fragments.size(), pFile) == m_Fragments.size();
+    }
+    fclose(pFile);
+
+    for (size_t i = 0; ok && i < m_Fragments.size(); i++)
+    {
+        const OfflineFragmentQuad& fragment = m_Fragments[i];
+        ok = fragment.X < header.GridWidth && fragment.Y < header.GridHeight &&
+             fragment.Live != 0 && fragment.Live < 16;
+    }
+
+    if (!ok)
+    {
+        m_Fragments.clear();
+        return false;
+    }
+
+    m_GridWidth  = header.GridWidth;
+    m_GridHeight = header.GridHeight;
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+uint32_t COfflineFragmentRecorder::CountAliasedIDs() const
+{
+    std::vector<uint32_t> last((size_t)m_GridWidth*m_GridHeight, OFFLINE_UNLOCKED_ID);
+
+    uint32_t count = 0;
+    for (size_t i = 0; i < m_Fragments.size(); i++)
+    {
+        const OfflineFragmentQuad& fragment = m_Fragments[i];
+
+        uint32_t& prev = last[(size_t)fragment.Y*m_GridWidth + fragment.X];
+        if (prev != OFFLINE_UNLOCKED_ID)
+        {
+            const OfflineFragmentQuad& other = m_Fragments[prev];
+            if (other.PrimitiveID == fragment.PrimitiveID &&
+                (other.Triangle != fragment.Triangle || other.Instance != fragment.Instance))
+                count++;
+        }
+        prev = (uint32_t)i;
+    }
+    return count;
+}
+
+
+//--------------------------------------------------------------------------------------
+const char* OfflineGetStressModeName(OFFLINE_STRESS_MODE mode)
+{
+    static const char* names[OFFLINE_NB_STRESS_MODES] =
+    {
+        "lockstep",
+        "independent",
+        "lock-free"
+    };
+    return names[mode];
+}
+
+
+//--------------------------------------------------------------------------------------
+// COfflineLockStress
+//--------------------------------------------------------------------------------------
+COfflineLockStress::COfflineLockStress() : m_Width(0),
+                                           m_Height(0),
+                                           m_pLock(NULL),
+                                           m_pLiveCount(NULL),
+                                           m_pOverdraw(NULL),
+                                           m_pContention(NULL),
+                                           m_pFragments(NULL),
+                                           m_NbFragments(0),
+                                           m_Mode(OFFLINE_STRESS_LOCKSTEP)
+{
+    for (int i = 0; i < 4; i++)
+        m_LiveStats[i] = 0;
+    m_NextWave = 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+COfflineLockStress::~COfflineLockStress()
+{
+    delete[] m_pLock;
+    delete[] m_pLiveCount;
+    delete[] m_pOverdraw;
+    delete[] m_pContention;
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineLockStress::Resize(uint32_t width, uint32_t height)
+{
+    if (width == m_Width && height == m_Height)
+        return;
+
+    delete[] m_pLock;
+    delete[] m_pLiveCount;
+    delete[] m_pOverdraw;
+    delete[] m_pContention;
+
+    m_Width       = width;
+    m_Height      = height;
+    m_pLock       = new std::atomic<uint32_t>[(size_t)width*height];
+    m_pLiveCount  = new std::atomic<uint32_t>[(size_t)width*height];
+    m_pOverdraw   = new std::atomic<uint32_t>[(size_t)width*height];
+    m_pContention = new std::atomic<uint32_t>[(size_t)width*height];
+
+    ResetGrids();
+    ClearContention();
+}
+
+
+//--------------------------------------------------------------------------------------
+// As the clears at the top of Render()
+//--------------------------------------------------------------------------------------
+void COfflineLockStress::ResetGrids()
+{
+    for (size_t i = 0; i < (size_t)m_Width*m_Height; i++)
+    {
+        m_pLock[i].store(OFFLINE_UNLOCKED_ID, std::memory_order_relaxed);
+        m_pLiveCount[i].store(0, std::memory_order_relaxed);
+        m_pOverdraw[i].store(0, std::memory_order_relaxed);
+    }
+    for (int i = 0; i < 4; i++)
+        m_LiveStats[i].store(0, std::memory_order_relaxed);
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineLockStress::ClearContention()
+{
+    for (size_t i = 0; i < (size_t)m_Width*m_Height; i++)
+        m_pContention[i].store(0, std::memory_order_relaxed);
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineLockStress::GetHotSpots(uint32_t count, std::vector<OfflineStressHotSpot>* pHotSpots) const
+{
+    pHotSpots->clear();
+    for (uint32_t y = 0; y < m_Height; y++)
+    {
+        for (uint32_t x = 0; x < m_Width; x++)
+        {
+            uint32_t failures = GetContention(x, y);
+            if (!failures)
+                continue;
+
+            OfflineStressHotSpot hotSpot = { x, y, failures };
+            pHotSpots->push_back(hotSpot);
+        }
+    }
+
+    struct MoreFailures
+    {
+        bool operator()(const OfflineStressHotSpot& a, const OfflineStressHotSpot& b) const
+        {
+            if (a.CASFailures != b.CASFailures)
+                return a.CASFailures > b.CASFailures;
+            return a.Y != b.Y ? a.Y < b.Y : a.X < b.X;
+        }
+    };
+
+    size_t kept = std::min((size_t)count, pHotSpots->size());
+    std::partial_sort(pHotSpots->begin(), pHotSpots->begin() + kept, pHotSpots->end(), MoreFailures());
+    pHotSpots->resize(kept);
+}
+
+
+//--------------------------------------------------------------------------------------
+OfflineStressResult COfflineLockStress::Run(const COfflineFragmentRecorder& fragments, OFFLINE_STRESS_MODE mode,
+                                            uint32_t threads)
+{
+    DXUT_PROFILE_SCOPE(L"Offline Lock Stress");
+
+    Resize(fragments.GetGridWidth(), fragments.GetGridHeight());
+    ResetGrids();
+
+    m_pFragments  = fragments.GetFragments();
+    m_NbFragments = fragments.GetNumFragments();
+    m_Mode        = mode;
+    m_NextWave    = 0;
+
+    if (threads < 1)
+        threads = 1;
+
+    std::vector<WorkerStats> stats(threads);
+    uint64_t start = DXUTGetHighResTimeNs();
+    {
+        std::vector<std::thread> workers;
+        for (uint32_t i = 1; i < threads; i++)
+            workers.push_back(std::thread(&COfflineLockStress::WorkerThread, this, &stats[i]));
+        WorkerThread(&stats[0]);
+        for (size_t i = 0; i < workers.size(); i++)
+            workers[i].join();
+    }
+
+    OfflineStressResult result;
+    memset(&result, 0, sizeof(result));
+    result.Mode      = mode;
+    result.Threads   = threads;
+    result.ElapsedNs = DXUTGetHighResTimeNs() - start;
+
+    for (uint32_t i = 0; i < threads; i++)
+    {
+        result.Invocations     += stats[i].Invocations;
+        result.BudgetExhausted += stats[i].BudgetExhausted;
+        result.CASFailures     += stats[i].CASFailures;
+        result.StatsOutOfRange += stats[i].StatsOutOfRange;
+        result.MaxIterations    = std::max(result.MaxIterations, stats[i].MaxIterations);
+    }
+
+    // What every method should have counted: one per quad in the stream
+    std::vector<uint32_t> expected((size_t)m_Width*m_Height, 0);
+    for (uint32_t i = 0; i < m_NbFragments; i++)
+    {
+        const OfflineFragmentQuad& fragment = m_pFragments[i];
+        expected[(size_t)fragment.Y*m_Width + fragment.X]++;
+        result.ExpectedLiveStats[OfflineCountLanes(fragment.Live) - 1]++;
+    }
+    result.ExpectedQuads = m_NbFragments;
+
+    for (size_t i = 0; i < expected.size(); i++)
+    {
+        uint32_t counted = m_pOverdraw[i].load();
+        result.CountedQuads += counted;
+        if (counted < expected[i])
+            result.LostQuads += expected[i] - counted;
+        else
+            result.ExtraQuads += counted - expected[i];
+
+        if (m_pLock[i].load() != OFFLINE_UNLOCKED_ID)
+            result.LeakedLocks++;
+        if (m_pLiveCount[i].load() != 0)
+            result.ResidualCounts++;
+    }
+    for (int i = 0; i < 4; i++)
+        result.LiveStats[i] = m_LiveStats[i].load();
+
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineLockStress::WorkerThread(WorkerStats* pStats)
+{
+    memset(pStats, 0, sizeof(*pStats));
+
+    const uint32_t nbWaves = (m_NbFragments + OFFLINE_STRESS_WAVE_QUADS - 1)/OFFLINE_STRESS_WAVE_QUADS;
+    for (;;)
+    {
+        uint32_t wave = m_NextWave.fetch_add(1);
+        if (wave >= nbWaves)
+            break;
+
+        uint32_t first = wave*OFFLINE_STRESS_WAVE_QUADS;
+        uint32_t last  = std::min(first + OFFLINE_STRESS_WAVE_QUADS, m_NbFragments);
+
+        if (m_Mode == OFFLINE_STRESS_LOCK_FREE)
+        {
+            for (uint32_t i = first; i < last; i++)
+            {
+                LockFreeQuad(m_pFragments[i]);
+                pStats->Invocations += OfflineCountLanes(m_pFragments[i].Live);
+            }
+            continue;
+        }
+
+        // Only live lanes touch memory; helper lanes' atomics are discarded
+        const OfflineFragmentQuad* lanes[OFFLINE_STRESS_WAVE_QUADS*4];
+        uint32_t nbLanes = 0;
+        for (uint32_t i = first; i < last; i++)
+        {
+            for (int lane = 0; lane < 4; lane++)
+            {
+                if (m_pFragments[i].Live & (1 << lane))
+                    lanes[nbLanes++] = &m_pFragments[i];
+            }
+        }
+        pStats->Invocations += nbLanes;
+
+        if (m_Mode == OFFLINE_STRESS_LOCKSTEP)
+        {
+            LockWave(lanes, nbLanes, pStats);
+        }
+        else
+        {
+            for (uint32_t i = 0; i < nbLanes; i++)
+                LockWave(&lanes[i], 1, pStats);
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// ScenePS1 for a wave of lanes. Every instruction runs for all of the lanes before the
+// next one starts, and the lanes' atomics are applied in lane order.
+//--------------------------------------------------------------------------------------
+void COfflineLockStress::LockWave(const OfflineFragmentQuad* const* ppQuads, uint32_t nbLanes, WorkerStats* pStats)
+{
+    const uint32_t unlockedID = OFFLINE_UNLOCKED_ID;
+
+    size_t   quad[OFFLINE_STRESS_WAVE_QUADS*4];
+    uint32_t prevID[OFFLINE_STRESS_WAVE_QUADS*4];
+    bool     processed[OFFLINE_STRESS_WAVE_QUADS*4];
+    int      lockCount[OFFLINE_STRESS_WAVE_QUADS*4];
+    uint32_t pixelCount[OFFLINE_STRESS_WAVE_QUADS*4];
+
+    for (uint32_t lane = 0; lane < nbLanes; lane++)
+    {
+        quad[lane]       = (size_t)ppQuads[lane]->Y*m_Width + ppQuads[lane]->X;
+        prevID[lane]     = 0;
+        processed[lane]  = false;
+        lockCount[lane]  = 0;
+        pixelCount[lane] = 0;
+    }
+
+    uint32_t iterations = 0;
+    for (int i = 0; i < OFFLINE_LOCK_ITERATIONS; i++)
+    {
+        for (uint32_t lane = 0; lane < nbLanes; lane++)
+        {
+            if (processed[lane])
+                continue;
+
+            // InterlockedCompareExchange(lockUAV[quad], unlockedID, id, prevID)
+            const uint32_t id = ppQuads[lane]->PrimitiveID;
+            prevID[lane] = unlockedID;
+            m_pLock[quad[lane]].compare_exchange_strong(prevID[lane], id);
+
+            if (prevID[lane] != unlockedID && prevID[lane] != id)
+            {
+                pStats->CASFailures++;
+                m_pContention[quad[lane]].fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        for (uint32_t lane = 0; lane < nbLanes; lane++)
+        {
+            if (prevID[lane] != unlockedID)
+                continue;
+
+            if (++lockCount[lane] == 4)
+            {
+                // InterlockedAnd(liveCountUAV[quad], 0, pixelCount)
+                pixelCount[lane] = m_pLiveCount[quad[lane]].fetch_and(0);
+
+                // InterlockedExchange(lockUAV[quad], unlockedID, prevID)
+                prevID[lane] = m_pLock[quad[lane]].exchange(unlockedID);
+            }
+            processed[lane] = true;
+        }
+
+        bool done = true;
+        for (uint32_t lane = 0; lane < nbLanes; lane++)
+        {
+            if (prevID[lane] == ppQuads[lane]->PrimitiveID && !processed[lane])
+            {
+                m_pLiveCount[quad[lane]].fetch_add(1);
+                processed[lane] = true;
+            }
+
+            // A lock holder has to keep looping until it has released the lock
+            done = done && processed[lane] && (lockCount[lane] == 0 || lockCount[lane] >= 4);
+        }
+
+        iterations = i + 1;
+        if (done)
+            break;
+    }
+
+    pStats->MaxIterations = std::max(pStats->MaxIterations, iterations);
+
+    for (uint32_t lane = 0; lane < nbLanes; lane++)
+    {
+        if (!processed[lane])
+            pStats->BudgetExhausted++;
+
+        if (lockCount[lane])
+        {
+            m_pOverdraw[quad[lane]].fetch_add(1);
+            if (pixelCount[lane] < 4)
+                m_LiveStats[pixelCount[lane]].fetch_add(1);
+            else
+                pStats->StatsOutOfRange++;
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// The lock-free alternative: with the quad's live mask to hand (SV_Coverage, or wave
+// intrinsics), one lane counts the quad and its liveness with two plain atomic adds
+//--------------------------------------------------------------------------------------
+void COfflineLockStress::LockFreeQuad(const OfflineFragmentQuad& quad)
+{
+    m_pOverdraw[(size_t)quad.Y*m_Width + quad.X].fetch_add(1);
+    m_LiveStats[OfflineCountLanes(quad.Live) - 1].fetch_add(1);
+}
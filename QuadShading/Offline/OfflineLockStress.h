@@ -0,0 +1,172 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineLockStress.h
+//
+// Multi-threaded stress test for ScenePS1's quad lock. The shader's atomics on lockUAV
+// and liveCountUAV become std::atomic operations on a CPU grid, and worker threads
+// replay a recorded stream of quad fragments through them a wave at a time, so that
+// neighbouring quads race for the same locks just as they do on the GPU. Each run is
+// checked against the exact counts implied by the stream.
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef OFFLINE_LOCK_STRESS_H
+#define OFFLINE_LOCK_STRESS_H
+
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+
+#include "OfflineRaster.h"
+
+#define OFFLINE_LOCK_ITERATIONS     64      // ScenePS1's loop count
+#define OFFLINE_STRESS_WAVE_QUADS   16      // quads per 64-lane wave
+
+//--------------------------------------------------------------------------------------
+// One quad of the shading pass, as the pixel shader invocations see it
+//--------------------------------------------------------------------------------------
+struct OfflineFragmentQuad
+{
+    uint32_t X, Y;              // quad position
+    uint32_t PrimitiveID;       // SV_PrimitiveID, the lock owner's ID
+    uint32_t Triangle;          // source triangle and instance, to spot aliased IDs
+    uint32_t Instance;
+    uint32_t Live;              // lanes that run the shader
+};
+
+
+//--------------------------------------------------------------------------------------
+// Records the shading pass's quad stream, in order, for replay
+//--------------------------------------------------------------------------------------
+class COfflineFragmentRecorder : public IOfflineQuadSink
+{
+public:
+                        COfflineFragmentRecorder();
+
+    // Quad grid size; quads outside it are dropped, as by the UAVs
+    void                SetGrid(uint32_t width, uint32_t height);
+    void                Clear();
+
+    virtual void        OnQuad(const OfflineTriangle& tri, const OfflineQuad& quad);
+
+    bool                Save(const char* fileName) const;
+    bool                Load(const char* fileName);
+
+    uint32_t            GetGridWidth() const    { return m_GridWidth; }
+    uint32_t            GetGridHeight() const   { return m_GridHeight; }
+    uint32_t            GetNumFragments() const { return (uint32_t)m_Fragments.size(); }
+    const OfflineFragmentQuad* GetFragments() const { return m_Fragments.empty() ? NULL : &m_Fragments[0]; }
+
+    // Quads whose lock ID matches the quad drawn before them at the same position even
+    // though they come from a different triangle or instance. ScenePS1 can't tell these
+    // apart if they're in flight together.
+    uint32_t            CountAliasedIDs() const;
+
+protected:
+    uint32_t                            m_GridWidth;
+    uint32_t                            m_GridHeight;
+    std::vector<OfflineFragmentQuad>    m_Fragments;
+};
+
+
+enum OFFLINE_STRESS_MODE
+{
+    OFFLINE_STRESS_LOCKSTEP,        // ScenePS1, with each wave's lanes stepping together
+    OFFLINE_STRESS_INDEPENDENT,     // ScenePS1, with every lane running on its own
+    OFFLINE_STRESS_LOCK_FREE,       // one atomic add per quad, from the live mask
+    OFFLINE_NB_STRESS_MODES
+};
+
+const char* OfflineGetStressModeName(OFFLINE_STRESS_MODE mode);
+
+struct OfflineStressResult
+{
+    OFFLINE_STRESS_MODE Mode;
+    uint32_t Threads;
+    uint64_t ElapsedNs;
+    uint64_t Invocations;           // live lanes run
+    uint64_t ExpectedQuads;
+    uint64_t CountedQuads;
+    uint64_t LostQuads;             // summed over positions that were under-counted
+    uint64_t ExtraQuads;            // summed over positions that were over-counted
+    uint64_t ExpectedLiveStats[4];
+    uint64_t LiveStats[4];
+    uint64_t StatsOutOfRange;       // live counts past liveStatsUAV's end, dropped
+    uint64_t BudgetExhausted;       // lanes that ran out of iterations unprocessed
+    uint64_t CASFailures;           // compare-exchanges that found another ID's lock
+    uint32_t LeakedLocks;           // positions still locked afterwards
+    uint32_t ResidualCounts;        // positions with live counts nobody collected
+    uint32_t MaxIterations;         // most loop iterations any wave needed
+
+    bool                IsExact() const
+    {
+        return LostQuads == 0 && ExtraQuads == 0 && StatsOutOfRange == 0 && BudgetExhausted == 0 &&
+               LeakedLocks == 0 && ResidualCounts == 0 &&
+               LiveStats[0] == ExpectedLiveStats[0] && LiveStats[1] == ExpectedLiveStats[1] &&
+               LiveStats[2] == ExpectedLiveStats[2] && LiveStats[3] == ExpectedLiveStats[3];
+    }
+};
+
+struct OfflineStressHotSpot
+{
+    uint32_t X, Y;
+    uint32_t CASFailures;
+};
+
+
+//--------------------------------------------------------------------------------------
+class COfflineLockStress
+{
+public:
+                        COfflineLockStress();
+                        ~COfflineLockStress();
+
+    // Replays the whole stream once. Waves are handed out to the threads in stream
+    // order, so the threads work on neighbouring parts of the screen at the same time.
+    OfflineStressResult Run(const COfflineFragmentRecorder& fragments, OFFLINE_STRESS_MODE mode, uint32_t threads);
+
+    // CAS failures per quad, summed over runs since the last ClearContention()
+    void                ClearContention();
+    uint32_t            GetContention(uint32_t x, uint32_t y) const
+    {
+        return m_pContention[(size_t)y*m_Width + x].load(std::memory_order_relaxed);
+    }
+    void                GetHotSpots(uint32_t count, std::vector<OfflineStressHotSpot>* pHotSpots) const;
+
+    uint32_t            GetWidth() const    { return m_Width; }
+    uint32_t            GetHeight() const   { return m_Height; }
+
+protected:
+    // Counters that each thread keeps to itself
+    struct WorkerStats
+    {
+        uint64_t Invocations;
+        uint64_t BudgetExhausted;
+        uint64_t CASFailures;
+        uint64_t StatsOutOfRange;
+        uint32_t MaxIterations;
+    };
+
+    void                Resize(uint32_t width, uint32_t height);
+    void                ResetGrids();
+
+    void                WorkerThread(WorkerStats* pStats);
+    void                LockWave(const OfflineFragmentQuad* const* ppQuads, uint32_t nbLanes, WorkerStats* pStats);
+    void                LockFreeQuad(const OfflineFragmentQuad& quad);
+
+    uint32_t                    m_Width;
+    uint32_t                    m_Height;
+    std::atomic<uint32_t>*      m_pLock;        // lockUAV
+    std::atomic<uint32_t>*      m_pLiveCount;   // liveCountUAV
+    std::atomic<uint32_t>*      m_pOverdraw;    // overdrawUAV, slice 0
+    std::atomic<uint32_t>*      m_pContention;
+    std::atomic<uint32_t>       m_LiveStats[4]; // liveStatsUAV
+
+    // State of the current run
+    const OfflineFragmentQuad*  m_pFragments;
+    uint32_t                    m_NbFragments;
+    OFFLINE_STRESS_MODE         m_Mode;
+    std::atomic<uint32_t>       m_NextWave;
+};
+
+#endif
@@ -0,0 +1,26 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineMain.cpp
+//
+// Entry point for running the offline overshading engine away from Windows, where
+// QuadShading.exe's "-offline" switch isn't available. Not part of the Visual Studio
+// project. Build from the QuadShading directory with, for example:
+//
+//   g++ -O2 -std=c++11 -pthread -IDXUT/Optional -o quadshading-offline Offline/*.cpp
+//       DXUT/Optional/DXUTprofiler.cpp DXUT/Optional/DXUTframestats.cpp
+//       DXUT/Optional/DXUTcacheindex.cpp
+//
+// adding -DDXUT_PROFILER to record the profile that "-trace" writes out; without it
+// "-trace" is refused.
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#ifndef _WIN32
+
+#include "OfflineAnalysis.h"
+
+int main(int argc, char** argv)
+{
+    return OfflineMain(argc - 1, argv + 1);
+}
+
+#endif
@@ -0,0 +1,171 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineMath.h
+//
+// Minimal vector and matrix helpers for the offline overshading engine. Matrices use
+// the same row-vector convention as D3DX and XNA Math (v' = v*M), and the camera and
+// projection builders produce the same values as their D3DX/XNA namesakes so that
+// offline results line up with what QuadShading.fx sees.
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef OFFLINE_MATH_H
+#define OFFLINE_MATH_H
+
+#include <math.h>
+
+struct Vec3
+{
+    float x, y, z;
+};
+
+struct Vec4
+{
+    float x, y, z, w;
+};
+
+struct Mat4
+{
+    float m[4][4];
+};
+
+
+//--------------------------------------------------------------------------------------
+inline Vec3 MakeVec3(float x, float y, float z)
+{
+    Vec3 v = { x, y, z };
+    return v;
+}
+
+inline Vec3 Add(const Vec3& a, const Vec3& b)       { return MakeVec3(a.x + b.x, a.y + b.y, a.z + b.z); }
+inline Vec3 Subtract(const Vec3& a, const Vec3& b)  { return MakeVec3(a.x - b.x, a.y - b.y, a.z - b.z); }
+inline Vec3 Scale(const Vec3& a, float s)           { return MakeVec3(a.x*s, a.y*s, a.z*s); }
+inline float Dot(const Vec3& a, const Vec3& b)      { return a.x*b.x + a.y*b.y + a.z*b.z; }
+
+inline Vec3 Cross(const Vec3& a, const Vec3& b)
+{
+    return MakeVec3(a.y*b.z - a.z*b.y, a.z*b.x - a.x*b.z, a.x*b.y - a.y*b.x);
+}
+
+inline Vec3 Minimize(const Vec3& a, const Vec3& b)
+{
+    return MakeVec3(a.x < b.x ? a.x : b.x, a.y < b.y ? a.y : b.y, a.z < b.z ? a.z : b.z);
+}
+
+inline Vec3 Maximize(const Vec3& a, const Vec3& b)
+{
+    return MakeVec3(a.x > b.x ? a.x : b.x, a.y > b.y ? a.y : b.y, a.z > b.z ? a.z : b.z);
+}
+
+inline Vec3 Normalize(const Vec3& a)
+{
+    float len = sqrtf(Dot(a, a));
+    return len > 0.0f ? Scale(a, 1.0f/len) : a;
+}
+
+
+//--------------------------------------------------------------------------------------
+inline Mat4 MatrixIdentity()
+{
+    Mat4 r = {{
+        { 1, 0, 0, 0 },
+        { 0, 1, 0, 0 },
+        { 0, 0, 1, 0 },
+        { 0, 0, 0, 1 }
+    }};
+    return r;
+}
+
+inline Mat4 MatrixMultiply(const Mat4& a, const Mat4& b)
+{
+    Mat4 r;
+    for (int i = 0; i < 4; i++)
+    {
+        for (int j = 0; j < 4; j++)
+        {
+            r.m[i][j] = a.m[i][0]*b.m[0][j] + a.m[i][1]*b.m[1][j] +
+                        a.m[i][2]*b.m[2][j] + a.m[i][3]*b.m[3][j];
+        }
+    }
+    return r;
+}
+
+inline Mat4 MatrixTranslation(float x, float y, float z)
+{
+    Mat4 r = MatrixIdentity();
+    r.m[3][0] = x;
+    r.m[3][1] = y;
+    r.m[3][2] = z;
+    return r;
+}
+
+// Same as D3DXMatrixLookAtLH
+inline Mat4 MatrixLookAtLH(const Vec3& eye, const Vec3& at, const Vec3& up)
+{
+    Vec3 zAxis = Normalize(Subtract(at, eye));
+    Vec3 xAxis = Normalize(Cross(up, zAxis));
+    Vec3 yAxis = Cross(zAxis, xAxis);
+
+    Mat4 r = {{
+        { xAxis.x, yAxis.x, zAxis.x, 0 },
+        { xAxis.y, yAxis.y, zAxis.y, 0 },
+        { xAxis.z, yAxis.z, zAxis.z, 0 },
+        { -Dot(xAxis, eye), -Dot(yAxis, eye), -Dot(zAxis, eye), 1 }
+    }};
+    return r;
+}
+
+// Same as XMMatrixPerspectiveFovLH
+inline Mat4 MatrixPerspectiveFovLH(float fovY, float aspect, float zn, float zf)
+{
+    float yScale = 1.0f/tanf(fovY*0.5f);
+    float xScale = yScale/aspect;
+    float range  = zf/(zf - zn);
+
+    Mat4 r = {{
+        { xScale, 0,      0,          0 },
+        { 0,      yScale, 0,          0 },
+        { 0,      0,      range,      1 },
+        { 0,      0,      -range*zn,  0 }
+    }};
+    return r;
+}
+
+// Same as XMMatrixOrthographicOffCenterLH
+inline Mat4 MatrixOrthographicOffCenterLH(float l, float r, float b, float t, float zn, float zf)
+{
+    Mat4 m = {{
+        { 2.0f/(r - l),      0,                 0,              0 },
+        { 0,                 2.0f/(t - b),      0,              0 },
+        { 0,                 0,                 1.0f/(zf - zn), 0 },
+        { (l + r)/(l - r),   (t + b)/(b - t),   zn/(zn - zf),   1 }
+    }};
+    return m;
+}
+
+// Position (w = 1) times matrix
+inline Vec4 TransformPoint(const Vec3& p, const Mat4& m)
+{
+    Vec4 r;
+    r.x = p.x*m.m[0][0] + p.y*m.m[1][0] + p.z*m.m[2][0] + m.m[3][0];
+    r.y = p.x*m.m[0][1] + p.y*m.m[1][1] + p.z*m.m[2][1] + m.m[3][1];
+    r.z = p.x*m.m[0][2] + p.y*m.m[1][2] + p.z*m.m[2][2] + m.m[3][2];
+    r.w = p.x*m.m[0][3] + p.y*m.m[1][3] + p.z*m.m[2][3] + m.m[3][3];
+    return r;
+}
+
+
+//--------------------------------------------------------------------------------------
+// A perspective view, as InitDevice sets one up from an eye, target and g_Projection
+//--------------------------------------------------------------------------------------
+struct OfflineCamera
+{
+    Vec3  eye;
+    Vec3  at;
+    Vec3  up;
+    float fovY;
+    float zNear;
+    float zFar;
+};
+
+#endif
@@ -0,0 +1,343 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineMesh.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+#include "OfflineMesh.h"
+#include "DXUTprofiler.h"
+
+#include <float.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+//--------------------------------------------------------------------------------------
+// The parts of the .sdkmesh layout we need (see SDKmesh.h), spelled with fixed-size
+// types so this file doesn't need the Direct3D headers. The D3D pointer unions in the
+// originals are always 64 bits wide on disk.
+//--------------------------------------------------------------------------------------
+#define OFFLINE_SDKMESH_FILE_VERSION    101
+#define OFFLINE_MAX_VERTEX_ELEMENTS     32
+#define OFFLINE_MAX_VERTEX_STREAMS      16
+#define OFFLINE_MAX_NAME                100
+#define OFFLINE_PT_TRIANGLE_LIST        0
+#define OFFLINE_IT_16BIT                0
+
+struct OfflineSDKMeshHeader
+{
+    uint32_t Version;
+    uint8_t  IsBigEndian;
+    uint64_t HeaderSize;
+    uint64_t NonBufferDataSize;
+    uint64_t BufferDataSize;
+
+    uint32_t NumVertexBuffers;
+    uint32_t NumIndexBuffers;
+    uint32_t NumMeshes;
+    uint32_t NumTotalSubsets;
+    uint32_t NumFrames;
+    uint32_t NumMaterials;
+
+    uint64_t VertexStreamHeadersOffset;
+    uint64_t IndexStreamHeadersOffset;
+    uint64_t MeshDataOffset;
+    uint64_t SubsetDataOffset;
+    uint64_t FrameDataOffset;
+    uint64_t MaterialDataOffset;
+};
+
+struct OfflineSDKMeshVertexElement
+{
+    uint16_t Stream;
+    uint16_t Offset;
+    uint8_t  Type;
+    uint8_t  Method;
+    uint8_t  Usage;
+    uint8_t  UsageIndex;
+};
+
+struct OfflineSDKMeshVertexBuffer
+{
+    uint64_t NumVertices;
+    uint64_t SizeBytes;
+    uint64_t StrideBytes;
+    OfflineSDKMeshVertexElement Decl[OFFLINE_MAX_VERTEX_ELEMENTS];
+    uint64_t DataOffset;
+};
+
+struct OfflineSDKMeshIndexBuffer
+{
+    uint64_t NumIndices;
+    uint64_t SizeBytes;
+    uint32_t IndexType;
+    uint64_t DataOffset;
+};
+
+struct OfflineSDKMeshMesh
+{
+    char     Name[OFFLINE_MAX_NAME];
+    uint8_t  NumVertexBuffers;
+    uint32_t VertexBuffers[OFFLINE_MAX_VERTEX_STREAMS];
+    uint32_t IndexBuffer;
+    uint32_t NumSubsets;
+    uint32_t NumFrameInfluences;
+    float    BoundingBoxCenter[3];
+    float    BoundingBoxExtents[3];
+    uint64_t SubsetOffset;
+    uint64_t FrameInfluenceOffset;
+};
+
+struct OfflineSDKMeshSubset
+{
+    char     Name[OFFLINE_MAX_NAME];
+    uint32_t MaterialID;
+    uint32_t PrimitiveType;
+    uint64_t IndexStart;
+    uint64_t IndexCount;
+    uint64_t VertexStart;
+    uint64_t VertexCount;
+};
+
+
+//--------------------------------------------------------------------------------------
+static bool InRange(uint64_t offset, uint64_t bytes, size_t dataBytes)
+{
+    return offset <= dataBytes && bytes <= dataBytes - offset;
+}
+
+static uint32_t ReadIndex(const OfflineSDKMeshIndexBuffer& ib, const uint8_t* pIndices, uint64_t i)
+{
+    if (ib.IndexType == OFFLINE_IT_16BIT)
+    {
+        uint16_t index;
+        memcpy(&index, pIndices + i*2, 2);
+        return index;
+    }
+
+    uint32_t index;
+    memcpy(&index, pIndices + i*4, 4);
+    return index;
+}
+
+
+//--------------------------------------------------------------------------------------
+COfflineMesh::COfflineMesh()
+{
+}
+
+
+//--------------------------------------------------------------------------------------
+bool COfflineMesh::Load(const char* fileName)
+{
+    DXUT_PROFILE_SCOPE(L"Offline Mesh Load");
+
+    FILE* pFile = fopen(fileName, "rb");
+    if (!pFile)
+        return false;
+
+    std::vector<uint8_t> data;
+    fseek(pFile, 0, SEEK_END);
+    long fileBytes = ftell(pFile);
+    fseek(pFile, 0, SEEK_SET);
+    if (fileBytes > 0)
+    {
+        data.resize((size_t)fileBytes);
+        if (fread(&data[0], 1, data.size(), pFile) != data.size())
+            data.clear();
+    }
+    fclose(pFile);
+
+    if (data.empty())
+        return false;
+
+    return LoadFromMemory(&data[0], data.size());
+}
+
+
+//--------------------------------------------------------------------------------------
+bool COfflineMesh::LoadFromMemory(const uint8_t* pData, size_t dataBytes)
+{
+    Release();
+
+    OfflineSDKMeshHeader header;
+    if (dataBytes < sizeof(header))
+        return false;
+    memcpy(&header, pData, sizeof(header));
+
+    if (header.Version != OFFLINE_SDKMESH_FILE_VERSION || header.IsBigEndian)
+        return false;
+    if (!InRange(header.VertexStreamHeadersOffset, header.NumVertexBuffers*sizeof(OfflineSDKMeshVertexBuffer), dataBytes) ||
+        !InRange(header.IndexStreamHeadersOffset, header.NumIndexBuffers*sizeof(OfflineSDKMeshIndexBuffer), dataBytes) ||
+        !InRange(header.MeshDataOffset, header.NumMeshes*sizeof(OfflineSDKMeshMesh), dataBytes) ||
+        !InRange(header.SubsetDataOffset, header.NumTotalSubsets*sizeof(OfflineSDKMeshSubset), dataBytes))
+        return false;
+
+    std::vector<OfflineSDKMeshVertexBuffer> vbs(header.NumVertexBuffers);
+    std::vector<OfflineSDKMeshIndexBuffer>  ibs(header.NumIndexBuffers);
+    if (!vbs.empty())
+        memcpy(&vbs[0], pData + header.VertexStreamHeadersOffset, vbs.size()*sizeof(vbs[0]));
+    if (!ibs.empty())
+        memcpy(&ibs[0], pData + header.IndexStreamHeadersOffset, ibs.size()*sizeof(ibs[0]));
+
+    // Positions from every vertex buffer, back to back. Like the scene input layout,
+    // the position is the float3 at the start of each vertex.
+    std::vector<uint32_t> vbBase(vbs.size());
+    for (size_t i = 0; i < vbs.size(); i++)
+    {
+        const OfflineSDKMeshVertexBuffer& vb = vbs[i];
+        if (vb.StrideBytes < sizeof(Vec3) || !InRange(vb.DataOffset, vb.NumVertices*vb.StrideBytes, dataBytes))
+        {
+            Release();
+            return false;
+        }
+
+        vbBase[i] = (uint32_t)m_Positions.size();
+        const uint8_t* pVertex = pData + vb.DataOffset;
+        for (uint64_t v = 0; v < vb.NumVertices; v++, pVertex += vb.StrideBytes)
+        {
+            Vec3 p;
+            memcpy(&p, pVertex, sizeof(p));
+            m_Positions.push_back(p);
+        }
+    }
+
+    for (size_t i = 0; i < ibs.size(); i++)
+    {
+        uint64_t indexBytes = ibs[i].IndexType == OFFLINE_IT_16BIT ? 2 : 4;
+        if (!InRange(ibs[i].DataOffset, ibs[i].NumIndices*indexBytes, dataBytes))
+        {
+            Release();
+            return false;
+        }
+    }
+
+    for (uint32_t meshi = 0; meshi < header.NumMeshes; meshi++)
+    {
+        OfflineSDKMeshMesh mesh;
+        memcpy(&mesh, pData + header.MeshDataOffset + meshi*sizeof(mesh), sizeof(mesh));
+
+        if (mesh.NumVertexBuffers == 0 || mesh.VertexBuffers[0] >= vbs.size() || mesh.IndexBuffer >= ibs.size() ||
+            !InRange(mesh.SubsetOffset, mesh.NumSubsets*sizeof(uint32_t), dataBytes))
+        {
+            Release();
+            return false;
+        }
+
+        const OfflineSDKMeshVertexBuffer& vb = vbs[mesh.VertexBuffers[0]];
+        const OfflineSDKMeshIndexBuffer&  ib = ibs[mesh.IndexBuffer];
+        const uint8_t* pIndices = pData + ib.DataOffset;
+        const Vec3* pMeshPositions = &m_Positions[vbBase[mesh.VertexBuffers[0]]];
+
+        Vec3 lower = MakeVec3( FLT_MAX,  FLT_MAX,  FLT_MAX);
+        Vec3 upper = MakeVec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+        for (uint32_t s = 0; s < mesh.NumSubsets; s++)
+        {
+            uint32_t subsetIndex;
+            memcpy(&subsetIndex, pData + mesh.SubsetOffset + s*sizeof(uint32_t), sizeof(subsetIndex));
+            if (subsetIndex >= header.NumTotalSubsets)
+            {
+                Release();
+                return false;
+            }
+
+            OfflineSDKMeshSubset subset;
+            memcpy(&subset, pData + header.SubsetDataOffset + subsetIndex*sizeof(subset), sizeof(subset));
+
+            // RenderMesh assumes triangle lists too
+            if (subset.PrimitiveType != OFFLINE_PT_TRIANGLE_LIST)
+                continue;
+            if (subset.IndexStart + subset.IndexCount > ib.NumIndices)
+            {
+                Release();
+                return false;
+            }
+
+            OfflineDraw draw;
+            draw.Mesh       = meshi;
+            draw.MaterialID = subset.MaterialID;
+            draw.IndexStart = (uint32_t)m_Indices.size();
+            draw.IndexCount = (uint32_t)(subset.IndexCount - subset.IndexCount%3);
+            draw.BoundsMin  = MakeVec3( FLT_MAX,  FLT_MAX,  FLT_MAX);
+            draw.BoundsMax  = MakeVec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+            for (uint64_t i = 0; i < subset.IndexCount; i++)
+            {
+                // The loader's bounding box ignores VertexStart, so we do as well
+                uint32_t index = ReadIndex(ib, pIndices, subset.IndexStart + i);
+                if (index < vb.NumVertices)
+                {
+                    const Vec3& p = pMeshPositions[index];
+                    lower = Minimize(lower, p);
+                    upper = Maximize(upper, p);
+                }
+
+                if (i >= draw.IndexCount)
+                    continue;
+
+                uint64_t vertex = index + subset.VertexStart;
+                if (vertex >= vb.NumVertices)
+                {
+                    Release();
+                    return false;
+                }
+
+                const Vec3& p = pMeshPositions[vertex];
+                draw.BoundsMin = Minimize(draw.BoundsMin, p);
+                draw.BoundsMax = Maximize(draw.BoundsMax, p);
+                m_Indices.push_back(vbBase[mesh.VertexBuffers[0]] + (uint32_t)vertex);
+            }
+
+            m_Draws.push_back(draw);
+            AddClusters((uint32_t)m_Draws.size() - 1);
+        }
+
+        Vec3 half = Scale(Subtract(upper, lower), 0.5f);
+        m_MeshCenters.push_back(Add(lower, half));
+        m_MeshExtents.push_back(half);
+    }
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineMesh::AddClusters(uint32_t drawIndex)
+{
+    OfflineDraw& draw = m_Draws[drawIndex];
+    draw.FirstCluster = (uint32_t)m_Clusters.size();
+    draw.NbClusters   = 0;
+
+    for (uint32_t first = 0; first < draw.IndexCount/3; first += OFFLINE_CLUSTER_TRIANGLES)
+    {
+        OfflineCluster cluster;
+        cluster.Draw        = drawIndex;
+        cluster.IndexStart  = draw.IndexStart + first*3;
+        cluster.NbTriangles = std::min<uint32_t>(OFFLINE_CLUSTER_TRIANGLES, draw.IndexCount/3 - first);
+        cluster.BoundsMin   = MakeVec3( FLT_MAX,  FLT_MAX,  FLT_MAX);
+        cluster.BoundsMax   = MakeVec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+        for (uint32_t i = 0; i < cluster.NbTriangles*3; i++)
+        {
+            const Vec3& p = m_Positions[m_Indices[cluster.IndexStart + i]];
+            cluster.BoundsMin = Minimize(cluster.BoundsMin, p);
+            cluster.BoundsMax = Maximize(cluster.BoundsMax, p);
+        }
+
+        m_Clusters.push_back(cluster);
+        draw.NbClusters++;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineMesh::Release()
+{
+    m_Positions.clear();
+    m_Indices.clear();
+    m_Draws.clear();
+    m_Clusters.clear();
+    m_MeshCenters.clear();
+    m_MeshExtents.clear();
+}
@@ -0,0 +1,90 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineMesh.h
+//
+// Geometry-only view of an .sdkmesh file for the offline overshading engine. Reads the
+// same layout as CDXUTSDKMesh without needing Direct3D, keeping just the positions and
+// the indices, flattened into submission order: every subset of every mesh becomes one
+// "draw", matching the DrawIndexed calls that RenderMesh makes.
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef OFFLINE_MESH_H
+#define OFFLINE_MESH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "OfflineMath.h"
+
+#define OFFLINE_CLUSTER_TRIANGLES   64
+
+//--------------------------------------------------------------------------------------
+// One DrawIndexed call. Indices are already rebased by the subset's VertexStart, so
+// they address COfflineMesh's position array directly.
+//--------------------------------------------------------------------------------------
+struct OfflineDraw
+{
+    uint32_t Mesh;          // SDKMESH_MESH this subset belongs to
+    uint32_t MaterialID;
+    uint32_t IndexStart;    // into COfflineMesh::GetIndices()
+    uint32_t IndexCount;
+    Vec3     BoundsMin;     // of the vertices the draw references
+    Vec3     BoundsMax;
+    uint32_t FirstCluster;
+    uint32_t NbClusters;
+};
+
+//--------------------------------------------------------------------------------------
+// A run of up to OFFLINE_CLUSTER_TRIANGLES consecutive triangles of one draw, with its
+// bounds, for culling at a finer grain than whole subsets
+//--------------------------------------------------------------------------------------
+struct OfflineCluster
+{
+    uint32_t Draw;
+    uint32_t IndexStart;    // into COfflineMesh::GetIndices()
+    uint32_t NbTriangles;
+    Vec3     BoundsMin;
+    Vec3     BoundsMax;
+};
+
+class COfflineMesh
+{
+public:
+                        COfflineMesh();
+
+    bool                Load(const char* fileName);
+    bool                LoadFromMemory(const uint8_t* pData, size_t dataBytes);
+    void                Release();
+
+    uint32_t            GetNumVertices() const  { return (uint32_t)m_Positions.size(); }
+    const Vec3*         GetPositions() const    { return m_Positions.empty() ? NULL : &m_Positions[0]; }
+    uint32_t            GetNumIndices() const   { return (uint32_t)m_Indices.size(); }
+    const uint32_t*     GetIndices() const      { return m_Indices.empty() ? NULL : &m_Indices[0]; }
+    uint32_t            GetNumTriangles() const { return (uint32_t)m_Indices.size()/3; }
+
+    uint32_t            GetNumDraws() const     { return (uint32_t)m_Draws.size(); }
+    const OfflineDraw&  GetDraw(uint32_t i) const { return m_Draws[i]; }
+
+    uint32_t            GetNumClusters() const  { return (uint32_t)m_Clusters.size(); }
+    const OfflineCluster& GetCluster(uint32_t i) const { return m_Clusters[i]; }
+
+    // Same values as CDXUTSDKMesh::GetMeshBBoxCenter/Extents, including the way the
+    // loader computes them
+    uint32_t            GetNumMeshes() const    { return (uint32_t)m_MeshCenters.size(); }
+    Vec3                GetMeshBBoxCenter(uint32_t mesh) const  { return m_MeshCenters[mesh]; }
+    Vec3                GetMeshBBoxExtents(uint32_t mesh) const { return m_MeshExtents[mesh]; }
+
+protected:
+    void                AddClusters(uint32_t drawIndex);
+
+    std::vector<Vec3>           m_Positions;
+    std::vector<uint32_t>       m_Indices;
+    std::vector<OfflineDraw>    m_Draws;
+    std::vector<OfflineCluster> m_Clusters;
+    std::vector<Vec3>           m_MeshCenters;
+    std::vector<Vec3>           m_MeshExtents;
+};
+
+#endif
@@ -0,0 +1,395 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineMethods.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#include "OfflineMethods.h"
+#include "DXUTprofiler.h"
+
+#include <string.h>
+
+//--------------------------------------------------------------------------------------
+const char* OfflineGetMethodName(OFFLINE_METHOD method)
+{
+    static const char* names[OFFLINE_NB_METHODS] =
+    {
+        "ScenePS1",
+        "ScenePS2",
+        "ScenePS3",
+        "ScenePS4"
+    };
+    return names[method];
+}
+
+// Lowest set bit of a non-zero lane mask, as firstbitlow
+static inline uint32_t FirstLane(uint32_t mask)
+{
+    uint32_t lane = 0;
+    while (!(mask & (1 << lane)))
+        lane++;
+    return lane;
+}
+
+
+//--------------------------------------------------------------------------------------
+void OfflineAddLiveTotals(OfflineLiveTotals* pTotals, const OfflineLiveTotals& other)
+{
+    pTotals->Quads += other.Quads;
+    for (uint32_t i = 0; i < OFFLINE_NB_SLICES; i++)
+        pTotals->LiveStats[i] += other.LiveStats[i];
+}
+
+
+//--------------------------------------------------------------------------------------
+uint64_t OfflineGetLivePixels(const OfflineLiveTotals& totals)
+{
+    uint64_t live = 0;
+    for (uint32_t i = 0; i < OFFLINE_NB_SLICES; i++)
+        live += (i + 1)*totals.LiveStats[i];
+    return live;
+}
+
+
+//--------------------------------------------------------------------------------------
+double OfflineGetEfficiency(uint64_t livePixels, uint64_t quads)
+{
+    return quads ? (double)livePixels/(4.0*(double)quads) : 0.0;
+}
+
+
+//--------------------------------------------------------------------------------------
+double OfflineGetEfficiency(const OfflineLiveTotals& totals)
+{
+    return OfflineGetEfficiency(OfflineGetLivePixels(totals), totals.Quads);
+}
+
+
+//--------------------------------------------------------------------------------------
+// COfflineOverdraw
+//--------------------------------------------------------------------------------------
+COfflineOverdraw::COfflineOverdraw() : m_Width(0),
+                                       m_Height(0),
+                                       m_TilesX(0),
+                                       m_TilesY(0)
+{
+    memset(m_LiveStats, 0, sizeof(m_LiveStats));
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineOverdraw::Resize(uint32_t width, uint32_t height)
+{
+    m_Width  = width;
+    m_Height = height;
+    m_TilesX = (width + OFFLINE_COUNTER_TILE_MASK) >> OFFLINE_COUNTER_TILE_SHIFT;
+    m_TilesY = (height + OFFLINE_COUNTER_TILE_MASK) >> OFFLINE_COUNTER_TILE_SHIFT;
+
+    size_t tiles = (size_t)m_TilesX*m_TilesY*OFFLINE_NB_SLICES;
+    m_Counts.resize(tiles*OFFLINE_COUNTER_TILE_QUADS);
+    m_WideTiles.resize(tiles);
+    Clear();
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineOverdraw::Clear()
+{
+    if (!m_Counts.empty())
+    {
+        memset(&m_Counts[0], 0, m_Counts.size()*sizeof(m_Counts[0]));
+        memset(&m_WideTiles[0], 0, m_WideTiles.size()*sizeof(m_WideTiles[0]));
+    }
+    m_WideCounts.clear();
+    memset(m_LiveStats, 0, sizeof(m_LiveStats));
+}
+
+
+//--------------------------------------------------------------------------------------
+// The first overflow in a tile copies the tile out to 32 bits; the counter being added
+// to still holds its value from before the add
+//--------------------------------------------------------------------------------------
+void COfflineOverdraw::AddWide(size_t i, uint32_t n)
+{
+    size_t tile = i >> 2*OFFLINE_COUNTER_TILE_SHIFT;
+    if (!m_WideTiles[tile])
+    {
+        uint16_t* pCounts = &m_Counts[tile*OFFLINE_COUNTER_TILE_QUADS];
+        m_WideCounts.insert(m_WideCounts.end(), pCounts, pCounts + OFFLINE_COUNTER_TILE_QUADS);
+        m_WideTiles[tile] = GetNumWideTiles();
+        for (uint32_t q = 0; q < OFFLINE_COUNTER_TILE_QUADS; q++)
+            pCounts[q] = OFFLINE_COUNTER_WIDE;
+    }
+
+    uint32_t& count = m_WideCounts[GetWideIndex(i)];
+    count = count + n >= count ? count + n : 0xffffffff;
+}
+
+
+//--------------------------------------------------------------------------------------
+size_t COfflineOverdraw::GetMemoryUsed() const
+{
+    return m_Counts.size()*sizeof(m_Counts[0]) + m_WideTiles.size()*sizeof(m_WideTiles[0]) +
+           m_WideCounts.size()*sizeof(m_WideCounts[0]);
+}
+
+
+//--------------------------------------------------------------------------------------
+uint32_t COfflineOverdraw::GetQuadCount(uint32_t x, uint32_t y, bool bSlices) const
+{
+    if (!bSlices)
+        return Get(x, y, 0);
+
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < OFFLINE_NB_SLICES; i++)
+        count += Get(x, y, i)/(i + 1);
+    return count;
+}
+
+
+//--------------------------------------------------------------------------------------
+uint64_t COfflineOverdraw::GetSliceTotal(uint32_t slice) const
+{
+    const size_t tiles = (size_t)m_TilesX*m_TilesY;
+
+    uint64_t total = 0;
+    for (size_t tile = slice*tiles; tile < (slice + 1)*tiles; tile++)
+    {
+        const uint32_t wide = m_WideTiles[tile];
+        if (wide)
+        {
+            const uint32_t* pCounts = &m_WideCounts[(size_t)(wide - 1)*OFFLINE_COUNTER_TILE_QUADS];
+            for (uint32_t q = 0; q < OFFLINE_COUNTER_TILE_QUADS; q++)
+                total += pCounts[q];
+        }
+        else
+        {
+            const uint16_t* pCounts = &m_Counts[tile*OFFLINE_COUNTER_TILE_QUADS];
+            for (uint32_t q = 0; q < OFFLINE_COUNTER_TILE_QUADS; q++)
+                total += pCounts[q];
+        }
+    }
+    return total;
+}
+
+
+//--------------------------------------------------------------------------------------
+uint64_t COfflineOverdraw::GetTotalQuads(bool bSlices) const
+{
+    if (!bSlices)
+        return GetSliceTotal(0);
+
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < OFFLINE_NB_SLICES; i++)
+        total += GetSliceTotal(i)/(i + 1);
+    return total;
+}
+
+
+//--------------------------------------------------------------------------------------
+OfflineLiveTotals COfflineOverdraw::GetLiveTotals(bool bSlices) const
+{
+    OfflineLiveTotals totals;
+    totals.Quads = GetTotalQuads(bSlices);
+    for (uint32_t i = 0; i < OFFLINE_NB_SLICES; i++)
+        totals.LiveStats[i] = m_LiveStats[i]/(bSlices ? i + 1 : 1);
+    return totals;
+}
+
+
+//--------------------------------------------------------------------------------------
+// COfflineMethods
+//--------------------------------------------------------------------------------------
+COfflineMethods::COfflineMethods() : m_Width(0),
+                                     m_Height(0)
+{
+    memset(m_DisagreementCount, 0, sizeof(m_DisagreementCount));
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineMethods::Resize(uint32_t width, uint32_t height)
+{
+    m_Width  = width;
+    m_Height = height;
+    for (int i = 0; i < OFFLINE_NB_METHODS; i++)
+        m_Overdraw[i].Resize(width, height);
+    m_Lock.resize((size_t)width*height);
+    m_LiveCount.resize((size_t)width*height);
+    m_Disagreement.resize((size_t)width*height);
+    Clear();
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineMethods::Clear()
+{
+    for (int i = 0; i < OFFLINE_NB_METHODS; i++)
+        m_Overdraw[i].Clear();
+    for (size_t i = 0; i < m_Lock.size(); i++)
+        m_Lock[i] = OFFLINE_UNLOCKED_ID;
+    if (!m_LiveCount.empty())
+        memset(&m_LiveCount[0], 0, m_LiveCount.size()*sizeof(m_LiveCount[0]));
+    if (!m_Disagreement.empty())
+        memset(&m_Disagreement[0], 0, m_Disagreement.size());
+    memset(m_DisagreementCount, 0, sizeof(m_DisagreementCount));
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineMethods::OnQuad(const OfflineTriangle& tri, const OfflineQuad& quad)
+{
+    // Out-of-range UAV writes are dropped. The grids round up, so this only guards
+    // against a sink sized smaller than the viewport.
+    if (quad.X >= m_Width || quad.Y >= m_Height)
+        return;
+
+    LockMethod(tri, quad);
+    BarycentricMethod(quad);
+    CoverageMethod(quad);
+    SlicesMethod(quad);
+}
+
+
+//--------------------------------------------------------------------------------------
+// ScenePS1, with the quad's live lanes stepping through the loop together and their
+// atomics applied in lane order. Helper lanes' atomics are discarded, so only live
+// lanes take part.
+//--------------------------------------------------------------------------------------
+void COfflineMethods::LockMethod(const OfflineTriangle& tri, const OfflineQuad& quad)
+{
+    uint32_t& lock      = m_Lock[(size_t)quad.Y*m_Width + quad.X];
+    uint32_t& liveCount = m_LiveCount[(size_t)quad.Y*m_Width + quad.X];
+    const uint32_t id   = tri.PrimitiveID;
+
+    uint32_t prevID[4]     = { 0, 0, 0, 0 };
+    bool     processed[4]  = { false, false, false, false };
+    int      lockCount[4]  = { 0, 0, 0, 0 };
+    uint32_t pixelCount[4] = { 0, 0, 0, 0 };
+
+    for (int i = 0; i < 64; i++)
+    {
+        // InterlockedCompareExchange(lockUAV[quad], unlockedID, id, prevID)
+        for (int lane = 0; lane < 4; lane++)
+        {
+            if ((quad.Live & (1 << lane)) && !processed[lane])
+            {
+                prevID[lane] = lock;
+                if (lock == OFFLINE_UNLOCKED_ID)
+                    lock = id;
+            }
+        }
+
+        bool done = true;
+        for (int lane = 0; lane < 4; lane++)
+        {
+            if (!(quad.Live & (1 << lane)) || prevID[lane] != OFFLINE_UNLOCKED_ID)
+                continue;
+
+            if (++lockCount[lane] == 4)
+            {
+                pixelCount[lane] = liveCount;
+                liveCount = 0;
+                lock = OFFLINE_UNLOCKED_ID;
+            }
+            processed[lane] = true;
+            done = done && lockCount[lane] >= 4;
+        }
+
+        for (int lane = 0; lane < 4; lane++)
+        {
+            if (!(quad.Live & (1 << lane)))
+                continue;
+
+            if (prevID[lane] == id && !processed[lane])
+            {
+                liveCount++;
+                processed[lane] = true;
+            }
+            done = done && processed[lane];
+        }
+
+        // Nothing left that can touch memory
+        if (done)
+            break;
+    }
+
+    COfflineOverdraw& overdraw = m_Overdraw[OFFLINE_METHOD_LOCK];
+    for (int lane = 0; lane < 4; lane++)
+    {
+        if (lockCount[lane])
+        {
+            overdraw.Add(quad.X, quad.Y, 0, 1);
+            if (pixelCount[lane] < OFFLINE_NB_SLICES)
+                overdraw.AddLiveStats(pixelCount[lane], 1);
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// ScenePS2: the first lane inside the triangle does the counting, which is lost if
+// that lane is only a helper
+//--------------------------------------------------------------------------------------
+void COfflineMethods::BarycentricMethod(const OfflineQuad& quad)
+{
+    uint32_t firstAlive = FirstLane(quad.Inside);
+    if (!(quad.Live & (1 << firstAlive)))
+        return;
+
+    COfflineOverdraw& overdraw = m_Overdraw[OFFLINE_METHOD_BARYCENTRIC];
+    overdraw.Add(quad.X, quad.Y, 0, 1);
+    overdraw.AddLiveStats(OfflineCountLanes(quad.Inside) - 1, 1);
+}
+
+
+//--------------------------------------------------------------------------------------
+// ScenePS3
+//--------------------------------------------------------------------------------------
+void COfflineMethods::CoverageMethod(const OfflineQuad& quad)
+{
+    COfflineOverdraw& overdraw = m_Overdraw[OFFLINE_METHOD_COVERAGE];
+    overdraw.Add(quad.X, quad.Y, 0, 1);
+    overdraw.AddLiveStats(OfflineCountLanes(quad.Live) - 1, 1);
+}
+
+
+//--------------------------------------------------------------------------------------
+// ScenePS4: every live lane adds one to its quad's slice and to the stats
+//--------------------------------------------------------------------------------------
+void COfflineMethods::SlicesMethod(const OfflineQuad& quad)
+{
+    uint32_t live = OfflineCountLanes(quad.Live);
+
+    COfflineOverdraw& overdraw = m_Overdraw[OFFLINE_METHOD_SLICES];
+    overdraw.Add(quad.X, quad.Y, live - 1, live);
+    overdraw.AddLiveStats(live - 1, live);
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineMethods::BuildDisagreementMap()
+{
+    DXUT_PROFILE_SCOPE(L"Offline Disagreement Map");
+
+    memset(m_DisagreementCount, 0, sizeof(m_DisagreementCount));
+
+    const COfflineOverdraw& reference = m_Overdraw[OFFLINE_REFERENCE_METHOD];
+    for (uint32_t y = 0; y < m_Height; y++)
+    {
+        for (uint32_t x = 0; x < m_Width; x++)
+        {
+            uint32_t expected = reference.GetQuadCount(x, y, OFFLINE_REFERENCE_METHOD == OFFLINE_METHOD_SLICES);
+
+            uint32_t mask = 0;
+            for (int m = 0; m < OFFLINE_NB_METHODS; m++)
+            {
+                if (m_Overdraw[m].GetQuadCount(x, y, m == OFFLINE_METHOD_SLICES) != expected)
+                {
+                    mask |= 1 << m;
+                    m_DisagreementCount[m]++;
+                }
+            }
+            m_Disagreement[(size_t)y*m_Width + x] = (uint8_t)mask;
+        }
+    }
+}
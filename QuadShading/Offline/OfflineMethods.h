@@ -0,0 +1,191 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineMethods.h
+//
+// CPU versions of the four overshading methods in QuadShading.fx. All four are fed
+// from the same quad stream, so one traversal of the scene fills in every method's
+// overdraw and liveness counters, and the results can be compared quad by quad.
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef OFFLINE_METHODS_H
+#define OFFLINE_METHODS_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "OfflineRaster.h"
+
+enum OFFLINE_METHOD
+{
+    OFFLINE_METHOD_LOCK,            // ScenePS1: per-quad spin lock and live count
+    OFFLINE_METHOD_BARYCENTRIC,     // ScenePS2: barycentric inclusion across the quad
+    OFFLINE_METHOD_COVERAGE,        // ScenePS3: SV_Coverage across the quad
+    OFFLINE_METHOD_SLICES,          // ScenePS4: one overdraw slice per liveness
+    OFFLINE_NB_METHODS
+};
+
+#define OFFLINE_NB_SLICES       4
+#define OFFLINE_UNLOCKED_ID     0xffffffff
+
+// The method the others are compared against: SV_Coverage sees exactly the pixels the
+// hardware launched
+#define OFFLINE_REFERENCE_METHOD    OFFLINE_METHOD_COVERAGE
+
+const char* OfflineGetMethodName(OFFLINE_METHOD method);
+
+// Number of set bits in a quad lane mask
+inline uint32_t OfflineCountLanes(uint32_t mask)
+{
+    return (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Quads shaded and how many of them had 1-4 live pixels, as the visualisation's pie
+// shows them; every tally of liveness, per frame, instance, asset or size bucket, is one
+//--------------------------------------------------------------------------------------
+struct OfflineLiveTotals
+{
+    uint64_t Quads;
+    uint64_t LiveStats[OFFLINE_NB_SLICES];
+};
+
+inline void OfflineAddQuad(OfflineLiveTotals* pTotals, uint32_t liveMask)
+{
+    pTotals->Quads++;
+    pTotals->LiveStats[OfflineCountLanes(liveMask) - 1]++;
+}
+
+void OfflineAddLiveTotals(OfflineLiveTotals* pTotals, const OfflineLiveTotals& other);
+uint64_t OfflineGetLivePixels(const OfflineLiveTotals& totals);
+
+// Live pixels over the lanes of the quads shaded
+double OfflineGetEfficiency(uint64_t livePixels, uint64_t quads);
+double OfflineGetEfficiency(const OfflineLiveTotals& totals);
+
+
+//--------------------------------------------------------------------------------------
+// CPU copy of g_pOverdrawBuffer (one counter per quad in each of four slices) and
+// g_pLiveStatsBuffer.
+//
+// Counters live in 8x8 quad tiles, row by row within each tile, so that the quads of a
+// triangle share a few cache lines rather than a line per row. They are 16-bit to
+// start with: a counter that would reach 0xffff moves its whole tile to 32-bit storage
+// and leaves 0xffff behind in the tile as a marker, so reads and adds only leave the
+// 16-bit path for the rare tiles that have overflowed.
+//--------------------------------------------------------------------------------------
+#define OFFLINE_COUNTER_TILE_SHIFT  3
+#define OFFLINE_COUNTER_TILE_MASK   ((1 << OFFLINE_COUNTER_TILE_SHIFT) - 1)
+#define OFFLINE_COUNTER_TILE_QUADS  (1 << 2*OFFLINE_COUNTER_TILE_SHIFT)
+#define OFFLINE_COUNTER_WIDE        0xffff
+
+class COfflineOverdraw
+{
+public:
+                        COfflineOverdraw();
+
+    void                Resize(uint32_t width, uint32_t height);
+    void                Clear();
+
+    uint32_t            GetWidth() const    { return m_Width; }
+    uint32_t            GetHeight() const   { return m_Height; }
+
+    void                Add(uint32_t x, uint32_t y, uint32_t slice, uint32_t n)
+    {
+        size_t i = GetIndex(x, y, slice);
+        if (n < (uint32_t)(OFFLINE_COUNTER_WIDE - m_Counts[i]))
+            m_Counts[i] = (uint16_t)(m_Counts[i] + n);
+        else
+            AddWide(i, n);
+    }
+    uint32_t            Get(uint32_t x, uint32_t y, uint32_t slice) const
+    {
+        size_t   i     = GetIndex(x, y, slice);
+        uint32_t count = m_Counts[i];
+        return count < OFFLINE_COUNTER_WIDE ? count : m_WideCounts[GetWideIndex(i)];
+    }
+
+    // What the visualisation shows for a quad: slice 0 for VisPS1, or VisPS2's sum of
+    // each slice divided by its liveness
+    uint32_t            GetQuadCount(uint32_t x, uint32_t y, bool bSlices) const;
+
+    uint64_t            GetSliceTotal(uint32_t slice) const;
+    uint64_t            GetTotalQuads(bool bSlices) const;
+
+    // What the pie shows with the heatmap: VisPS2 scales liveStats down as it does the
+    // slices
+    OfflineLiveTotals   GetLiveTotals(bool bSlices) const;
+
+    // liveStatsUAV: quads with 1-4 live pixels, as counted by the method
+    void                AddLiveStats(uint32_t pixelCount, uint32_t n) { m_LiveStats[pixelCount] += n; }
+    uint32_t            GetLiveStats(uint32_t pixelCount) const { return m_LiveStats[pixelCount]; }
+
+    uint32_t            GetNumWideTiles() const { return (uint32_t)(m_WideCounts.size()/OFFLINE_COUNTER_TILE_QUADS); }
+    size_t              GetMemoryUsed() const;
+
+protected:
+    size_t              GetIndex(uint32_t x, uint32_t y, uint32_t slice) const
+    {
+        size_t tile = ((size_t)slice*m_TilesY + (y >> OFFLINE_COUNTER_TILE_SHIFT))*m_TilesX +
+                      (x >> OFFLINE_COUNTER_TILE_SHIFT);
+        return (tile << 2*OFFLINE_COUNTER_TILE_SHIFT) | ((y & OFFLINE_COUNTER_TILE_MASK) << OFFLINE_COUNTER_TILE_SHIFT) |
+               (x & OFFLINE_COUNTER_TILE_MASK);
+    }
+    size_t              GetWideIndex(size_t i) const
+    {
+        return (size_t)(m_WideTiles[i >> 2*OFFLINE_COUNTER_TILE_SHIFT] - 1)*OFFLINE_COUNTER_TILE_QUADS +
+               (i & (OFFLINE_COUNTER_TILE_QUADS - 1));
+    }
+
+    void                AddWide(size_t i, uint32_t n);
+
+    uint32_t                m_Width;
+    uint32_t                m_Height;
+    uint32_t                m_TilesX;
+    uint32_t                m_TilesY;
+    std::vector<uint16_t>   m_Counts;       // every slice, padded out to whole tiles
+    std::vector<uint32_t>   m_WideTiles;    // per tile, 1 + its index in m_WideCounts, or 0
+    std::vector<uint32_t>   m_WideCounts;
+    uint32_t                m_LiveStats[OFFLINE_NB_SLICES];
+};
+
+
+//--------------------------------------------------------------------------------------
+class COfflineMethods : public IOfflineQuadSink
+{
+public:
+                        COfflineMethods();
+
+    // Quad grid size, as InitDevice's uavWidth and uavHeight
+    void                Resize(uint32_t width, uint32_t height);
+
+    // As the clears at the top of Render()
+    void                Clear();
+
+    virtual void        OnQuad(const OfflineTriangle& tri, const OfflineQuad& quad);
+
+    const COfflineOverdraw& GetOverdraw(OFFLINE_METHOD method) const { return m_Overdraw[method]; }
+
+    // Compares every method's per-quad count with the reference method. Each map entry
+    // has bit m set if method m disagrees there.
+    void                BuildDisagreementMap();
+    const uint8_t*      GetDisagreementMap() const { return m_Disagreement.empty() ? NULL : &m_Disagreement[0]; }
+    uint32_t            GetDisagreementCount(OFFLINE_METHOD method) const { return m_DisagreementCount[method]; }
+
+protected:
+    void                LockMethod(const OfflineTriangle& tri, const OfflineQuad& quad);
+    void                BarycentricMethod(const OfflineQuad& quad);
+    void                CoverageMethod(const OfflineQuad& quad);
+    void                SlicesMethod(const OfflineQuad& quad);
+
+    uint32_t                m_Width;
+    uint32_t                m_Height;
+    COfflineOverdraw        m_Overdraw[OFFLINE_NB_METHODS];
+    std::vector<uint32_t>   m_Lock;         // lockUAV
+    std::vector<uint32_t>   m_LiveCount;    // liveCountUAV
+    std::vector<uint8_t>    m_Disagreement;
+    uint32_t                m_DisagreementCount[OFFLINE_NB_METHODS];
+};
+
+#endif
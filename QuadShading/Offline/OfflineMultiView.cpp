@@ -0,0 +1,278 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineMultiView.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+#include "OfflineMultiView.h"
+#include "DXUTprofiler.h"
+
+#include <float.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <thread>
+
+//--------------------------------------------------------------------------------------
+static OfflineView MakeView(const char* name, const Mat4& view, const Mat4& proj, uint32_t width, uint32_t height)
+{
+    OfflineView result;
+    memset(result.Name, 0, sizeof(result.Name));
+    strncpy(result.Name, name, sizeof(result.Name) - 1);
+    result.ViewProj = MatrixMultiply(view, proj);
+    result.Width    = width;
+    result.Height   = height;
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------
+// True if every corner of the box is outside the same clip plane. The planes are tested
+// in homogeneous space, so corners behind the eye need no special case.
+//--------------------------------------------------------------------------------------
+static bool BoundsOutside(const Vec3& boundsMin, const Vec3& boundsMax, const Mat4& viewProj)
+{
+    uint32_t outside = 0x3f;
+    for (int i = 0; i < 8 && outside; i++)
+    {
+        Vec3 corner = MakeVec3(i & 1 ? boundsMax.x : boundsMin.x,
+                               i & 2 ? boundsMax.y : boundsMin.y,
+                               i & 4 ? boundsMax.z : boundsMin.z);
+        Vec4 clip = TransformPoint(corner, viewProj);
+        outside &= (clip.x < -clip.w ? 1 : 0) | (clip.x > clip.w ? 2 : 0) | (clip.y < -clip.w ? 4 : 0) |
+                   (clip.y > clip.w ? 8 : 0) | (clip.z < 0.0f ? 16 : 0) | (clip.z > clip.w ? 32 : 0);
+    }
+    return outside != 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+void OfflineAddCascadeViews(const OfflineCamera& camera, float aspect, const Vec3& sceneMin, const Vec3& sceneMax,
+                            const Vec3& lightDir, uint32_t cascades, uint32_t size, std::vector<OfflineView>* pViews)
+{
+    Vec3 forward = Normalize(Subtract(camera.at, camera.eye));
+    Vec3 right   = Normalize(Cross(camera.up, forward));
+    Vec3 up      = Cross(forward, right);
+
+    // The part of the frustum the scene can be in
+    Vec3  centre   = Scale(Add(sceneMin, sceneMax), 0.5f);
+    float radius   = sqrtf(Dot(Subtract(sceneMax, centre), Subtract(sceneMax, centre)));
+    float distance = Dot(Subtract(centre, camera.eye), forward);
+    float zNear    = std::max(camera.zNear, distance - radius);
+    float zFar     = std::max(zNear*1.001f, std::min(camera.zFar, distance + radius));
+
+    Vec3 light    = Normalize(lightDir);
+    Vec3 lightUp  = fabsf(light.y) > 0.99f ? MakeVec3(0, 0, 1) : MakeVec3(0, 1, 0);
+    Mat4 lightView = MatrixLookAtLH(Subtract(centre, Scale(light, 2.0f*radius)), centre, lightUp);
+
+    // Casters anywhere in the scene can shade any cascade
+    float minZ = FLT_MAX, maxZ = -FLT_MAX;
+    for (int i = 0; i < 8; i++)
+    {
+        Vec3 corner = MakeVec3(i & 1 ? sceneMax.x : sceneMin.x,
+                               i & 2 ? sceneMax.y : sceneMin.y,
+                               i & 4 ? sceneMax.z : sceneMin.z);
+        float z = TransformPoint(corner, lightView).z;
+        minZ = std::min(minZ, z);
+        maxZ = std::max(maxZ, z);
+    }
+
+    const float tanY = tanf(camera.fovY*0.5f);
+    const float tanX = tanY*aspect;
+    for (uint32_t c = 0; c < cascades; c++)
+    {
+        float bounds[2];
+        for (uint32_t i = 0; i < 2; i++)
+        {
+            float t = (float)(c + i)/(float)cascades;
+            float uniform = zNear + (zFar - zNear)*t;
+            float log     = zNear*powf(zFar/zNear, t);
+            bounds[i] = OFFLINE_CASCADE_SPLIT_LAMBDA*log + (1.0f - OFFLINE_CASCADE_SPLIT_LAMBDA)*uniform;
+        }
+
+        float minX = FLT_MAX, maxX = -FLT_MAX;
+        float minY = FLT_MAX, maxY = -FLT_MAX;
+        for (int i = 0; i < 8; i++)
+        {
+            float d = bounds[i >> 2];
+            Vec3 corner = Add(Add(camera.eye, Scale(forward, d)),
+                              Add(Scale(right, (i & 1 ? d : -d)*tanX), Scale(up, (i & 2 ? d : -d)*tanY)));
+            Vec4 p = TransformPoint(corner, lightView);
+            minX = std::min(minX, p.x);
+            maxX = std::max(maxX, p.x);
+            minY = std::min(minY, p.y);
+            maxY = std::max(maxY, p.y);
+        }
+
+        char name[32];
+        sprintf(name, "cascade%u", c);
+        Mat4 proj = MatrixOrthographicOffCenterLH(minX, maxX, minY, maxY, minZ, std::max(maxZ, minZ + 1e-3f));
+        pViews->push_back(MakeView(name, lightView, proj, size, size));
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+void OfflineAddCubeViews(const OfflineCamera& camera, uint32_t size, std::vector<OfflineView>* pViews)
+{
+    static const char* names[6] = { "cube+x", "cube-x", "cube+y", "cube-y", "cube+z", "cube-z" };
+    static const float directions[6][3] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+    static const float ups[6][3]        = { { 0, 1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 }, { 0, 1, 0 }, { 0, 1, 0 } };
+
+    Mat4 proj = MatrixPerspectiveFovLH(3.141592654f/2, 1.0f, camera.zNear, camera.zFar);
+    for (int face = 0; face < 6; face++)
+    {
+        Vec3 at = Add(camera.eye, MakeVec3(directions[face][0], directions[face][1], directions[face][2]));
+        Vec3 up = MakeVec3(ups[face][0], ups[face][1], ups[face][2]);
+        pViews->push_back(MakeView(names[face], MatrixLookAtLH(camera.eye, at, up), proj, size, size));
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+void OfflineAddStereoViews(const OfflineCamera& camera, uint32_t width, uint32_t height, float ipd,
+                           std::vector<OfflineView>* pViews)
+{
+    Vec3 forward = Normalize(Subtract(camera.at, camera.eye));
+    Vec3 offset  = Scale(Normalize(Cross(camera.up, forward)), 0.5f*ipd);
+    Mat4 proj    = MatrixPerspectiveFovLH(camera.fovY, (float)width/(float)height, camera.zNear, camera.zFar);
+
+    Mat4 left  = MatrixLookAtLH(Subtract(camera.eye, offset), Subtract(camera.at, offset), camera.up);
+    Mat4 right = MatrixLookAtLH(Add(camera.eye, offset), Add(camera.at, offset), camera.up);
+    pViews->push_back(MakeView("left", left, proj, width, height));
+    pViews->push_back(MakeView("right", right, proj, width, height));
+}
+
+
+//--------------------------------------------------------------------------------------
+// COfflineViewOverdraw
+//--------------------------------------------------------------------------------------
+COfflineViewOverdraw::COfflineViewOverdraw()
+{
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineViewOverdraw::Resize(uint32_t width, uint32_t height)
+{
+    m_Overdraw.Resize(width, height);
+    m_Overdraw.Clear();
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineViewOverdraw::OnQuad(const OfflineTriangle&, const OfflineQuad& quad)
+{
+    if (quad.X >= m_Overdraw.GetWidth() || quad.Y >= m_Overdraw.GetHeight())
+        return;
+
+    m_Overdraw.Add(quad.X, quad.Y, 0, 1);
+    m_Overdraw.AddLiveStats(OfflineCountLanes(quad.Live) - 1, 1);
+}
+
+
+//--------------------------------------------------------------------------------------
+// COfflineMultiView
+//--------------------------------------------------------------------------------------
+void COfflineMultiView::SetViews(const std::vector<OfflineView>& views)
+{
+    m_Views.resize(views.size());
+    for (size_t i = 0; i < views.size(); i++)
+        m_Views[i].View = views[i];
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineMultiView::Setup(const COfflineMesh& mesh, const Mat4& world)
+{
+    DXUT_PROFILE_SCOPE(L"Offline Multi-view Setup");
+
+    const Vec3* pPositions = mesh.GetPositions();
+    m_WorldPositions.resize(mesh.GetNumVertices());
+    for (uint32_t i = 0; i < mesh.GetNumVertices(); i++)
+    {
+        Vec4 p = TransformPoint(pPositions[i], world);
+        m_WorldPositions[i] = MakeVec3(p.x, p.y, p.z);
+    }
+    const Vec3* pWorld = m_WorldPositions.empty() ? NULL : &m_WorldPositions[0];
+
+    std::vector<uint32_t> firstTriangles(m_Views.size());
+    for (size_t v = 0; v < m_Views.size(); v++)
+    {
+        ViewState& state = m_Views[v];
+        state.Rasterizer.Reset();
+        state.Rasterizer.SetViewport(state.View.Width, state.View.Height);
+        state.Rasterizer.TransformVertices(pWorld, mesh.GetNumVertices(), state.View.ViewProj);
+        state.ClustersBinned = 0;
+        firstTriangles[v] = state.Rasterizer.GetNextTriangle();
+    }
+
+    for (uint32_t c = 0; c < mesh.GetNumClusters(); c++)
+    {
+        // The cluster's box in world space, once for all views
+        const OfflineCluster& cluster = mesh.GetCluster(c);
+        Vec3 boundsMin = MakeVec3(FLT_MAX, FLT_MAX, FLT_MAX);
+        Vec3 boundsMax = MakeVec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+        for (int i = 0; i < 8; i++)
+        {
+            Vec4 p = TransformPoint(MakeVec3(i & 1 ? cluster.BoundsMax.x : cluster.BoundsMin.x,
+                                             i & 2 ? cluster.BoundsMax.y : cluster.BoundsMin.y,
+                                             i & 4 ? cluster.BoundsMax.z : cluster.BoundsMin.z), world);
+            boundsMin = Minimize(boundsMin, MakeVec3(p.x, p.y, p.z));
+            boundsMax = Maximize(boundsMax, MakeVec3(p.x, p.y, p.z));
+        }
+
+        for (size_t v = 0; v < m_Views.size(); v++)
+        {
+            ViewState& state = m_Views[v];
+            if (BoundsOutside(boundsMin, boundsMax, state.View.ViewProj))
+                state.Rasterizer.SkipCluster(mesh, c);
+            else
+            {
+                state.Rasterizer.SetupCluster(mesh, c, firstTriangles[v], 0);
+                state.ClustersBinned++;
+            }
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineMultiView::Rasterize(OFFLINE_DEPTH_FORMAT format, uint32_t threads)
+{
+    const uint32_t nbViews = (uint32_t)m_Views.size();
+    threads = std::max(1u, std::min(threads, nbViews));
+    m_Depth.resize(threads);
+    std::vector<std::thread> workers;
+    for (uint32_t i = 0; i < threads; i++)
+    {
+        uint32_t firstView = nbViews*i/threads;
+        uint32_t endView   = nbViews*(i + 1)/threads;
+        if (i + 1 < threads)
+        {
+            workers.push_back(std::thread(&COfflineMultiView::RasterizeViews, this, firstView, endView, format,
+                                          &m_Depth[i]));
+        }
+        else
+            RasterizeViews(firstView, endView, format, &m_Depth[i]);
+    }
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineMultiView::RasterizeViews(uint32_t firstView, uint32_t endView, OFFLINE_DEPTH_FORMAT format,
+                                       COfflineDepthBuffer* pDepth)
+{
+    for (uint32_t v = firstView; v < endView; v++)
+    {
+        ViewState& state = m_Views[v];
+        pDepth->Resize(state.View.Width, state.View.Height, format);
+        pDepth->Clear(1.0f);
+        state.Overdraw.Resize(OfflineGetQuadGridSize(state.View.Width),
+                              OfflineGetQuadGridSize(state.View.Height));
+        state.Rasterizer.Rasterize(pDepth, OFFLINE_DEPTH_PREPASS, NULL);
+        state.Rasterizer.Rasterize(pDepth, OFFLINE_DEPTH_EARLY_TEST, &state.Overdraw);
+    }
+}
@@ -0,0 +1,111 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineMultiView.h
+//
+// Several views of one mesh from a single traversal, as a frame renders shadow
+// cascades, cube-map faces or two stereo eyes. Positions are taken to world space once
+// and shared by every view; each cluster is then binned against every view's frustum
+// and set up only for the views it reaches, and each view is rasterized, pre-pass then
+// shading pass, into its own depth buffer, overdraw grid and liveStats.
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef OFFLINE_MULTI_VIEW_H
+#define OFFLINE_MULTI_VIEW_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "OfflineMath.h"
+#include "OfflineMesh.h"
+#include "OfflineMethods.h"
+#include "OfflineRaster.h"
+
+#define OFFLINE_DEFAULT_CASCADES        4
+#define OFFLINE_DEFAULT_VIEW_SIZE       1024    // shadow maps and cube faces
+#define OFFLINE_DEFAULT_STEREO_IPD      0.4f    // hebe is a life-size figure about 11 units tall
+#define OFFLINE_CASCADE_SPLIT_LAMBDA    0.5f    // practical split scheme, between uniform and log
+
+// View sets, combined as flags
+#define OFFLINE_VIEWS_CASCADES          0x1
+#define OFFLINE_VIEWS_CUBE              0x2
+#define OFFLINE_VIEWS_STEREO            0x4
+
+struct OfflineView
+{
+    char     Name[16];
+    Mat4     ViewProj;          // from world space
+    uint32_t Width;
+    uint32_t Height;
+};
+
+// Orthographic light views, each fitted around a slice of the camera's frustum from
+// the scene's near side to its far side, and deep enough for every caster in the scene
+void OfflineAddCascadeViews(const OfflineCamera& camera, float aspect, const Vec3& sceneMin, const Vec3& sceneMax,
+                            const Vec3& lightDir, uint32_t cascades, uint32_t size, std::vector<OfflineView>* pViews);
+
+// 90 degree faces at the camera's eye, in D3D11_TEXTURECUBE_FACE order
+void OfflineAddCubeViews(const OfflineCamera& camera, uint32_t size, std::vector<OfflineView>* pViews);
+
+// The camera's view from two eyes ipd apart, with parallel axes
+void OfflineAddStereoViews(const OfflineCamera& camera, uint32_t width, uint32_t height, float ipd,
+                           std::vector<OfflineView>* pViews);
+
+
+//--------------------------------------------------------------------------------------
+// g_pOverdrawBuffer and g_pLiveStatsBuffer for one view, as the reference method counts
+//--------------------------------------------------------------------------------------
+class COfflineViewOverdraw : public IOfflineQuadSink
+{
+public:
+                        COfflineViewOverdraw();
+
+    void                Resize(uint32_t width, uint32_t height);
+
+    virtual void        OnQuad(const OfflineTriangle& tri, const OfflineQuad& quad);
+
+    const COfflineOverdraw& GetOverdraw() const { return m_Overdraw; }
+
+protected:
+    COfflineOverdraw    m_Overdraw;
+};
+
+
+//--------------------------------------------------------------------------------------
+class COfflineMultiView
+{
+public:
+    void                SetViews(const std::vector<OfflineView>& views);
+
+    // Walks the mesh once for all views
+    void                Setup(const COfflineMesh& mesh, const Mat4& world);
+
+    // Clears each view's buffers, then runs its pre-pass and shading pass, with the views
+    // split across threads. Each thread keeps one depth buffer for all its views.
+    void                Rasterize(OFFLINE_DEPTH_FORMAT format, uint32_t threads);
+
+    uint32_t            GetNumViews() const                             { return (uint32_t)m_Views.size(); }
+    const OfflineView&  GetView(uint32_t view) const                    { return m_Views[view].View; }
+    const COfflineRasterizer& GetRasterizer(uint32_t view) const        { return m_Views[view].Rasterizer; }
+    const COfflineViewOverdraw& GetOverdraw(uint32_t view) const        { return m_Views[view].Overdraw; }
+    uint32_t            GetClustersBinned(uint32_t view) const          { return m_Views[view].ClustersBinned; }
+    uint32_t            GetNumWorldVertices() const                     { return (uint32_t)m_WorldPositions.size(); }
+
+protected:
+    struct ViewState
+    {
+        OfflineView             View;
+        COfflineRasterizer      Rasterizer;
+        COfflineViewOverdraw    Overdraw;
+        uint32_t                ClustersBinned; // set up for this view
+    };
+
+    void                RasterizeViews(uint32_t firstView, uint32_t endView, OFFLINE_DEPTH_FORMAT format,
+                                       COfflineDepthBuffer* pDepth);
+
+    std::vector<ViewState>              m_Views;
+    std::vector<Vec3>                   m_WorldPositions;
+    std::vector<COfflineDepthBuffer>    m_Depth;            // per thread
+};
+
+#endif
@@ -0,0 +1,90 @@
+//--------------------------------------------------------------------------------------
+// File: OfflinePrepass.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#include "OfflinePrepass.h"
+#include "DXUTprofiler.h"
+
+#include <string.h>
+
+//--------------------------------------------------------------------------------------
+OfflineDepthCostModel OfflineGetDefaultDepthCostModel()
+{
+    OfflineDepthCostModel model;
+    model.TriangleCost   = 4.0;
+    model.DepthTestCost  = 1.0;
+    model.DepthQuadCost  = 0.0;
+    model.ShadedQuadCost = 32.0;
+    return model;
+}
+
+
+//--------------------------------------------------------------------------------------
+COfflinePrepassComparison::COfflinePrepassComparison()
+{
+    m_Model = OfflineGetDefaultDepthCostModel();
+    memset(&m_WithPrepass, 0, sizeof(m_WithPrepass));
+    memset(&m_WithoutPrepass, 0, sizeof(m_WithoutPrepass));
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflinePrepassComparison::Run(COfflineRasterizer* pRasterizer, OFFLINE_DEPTH_FORMAT format,
+                                    const OfflineDepthCostModel& model)
+{
+    DXUT_PROFILE_SCOPE(L"Offline Pre-pass Comparison");
+
+    m_Model = model;
+    memset(&m_WithPrepass, 0, sizeof(m_WithPrepass));
+    memset(&m_WithoutPrepass, 0, sizeof(m_WithoutPrepass));
+
+    COfflineDepthBuffer depth;
+    depth.Resize(pRasterizer->GetWidth(), pRasterizer->GetHeight(), format);
+
+    // As Render(): g_sceneDepthDS, then g_sceneDS
+    depth.Clear(1.0f);
+    RunPass(pRasterizer, &depth, OFFLINE_DEPTH_PREPASS, &m_WithPrepass.DepthPass);
+    RunPass(pRasterizer, &depth, OFFLINE_DEPTH_EARLY_TEST, &m_WithPrepass.ShadingPass);
+    m_WithPrepass.Cost = m_WithPrepass.DepthPass.Cost + m_WithPrepass.ShadingPass.Cost;
+
+    // One pass that writes depth as it goes
+    depth.Clear(1.0f);
+    RunPass(pRasterizer, &depth, OFFLINE_DEPTH_EARLY_WRITE, &m_WithoutPrepass.ShadingPass);
+    m_WithoutPrepass.Cost = m_WithoutPrepass.ShadingPass.Cost;
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflinePrepassComparison::RunPass(COfflineRasterizer* pRasterizer, COfflineDepthBuffer* pDepth,
+                                        OFFLINE_DEPTH_MODE mode, OfflineDepthPassStats* pStats)
+{
+    OfflineRasterStats before = pRasterizer->GetStats();
+    pRasterizer->Rasterize(pDepth, mode, NULL);
+    const OfflineRasterStats& after = pRasterizer->GetStats();
+
+    pStats->Triangles    = pRasterizer->GetNumTriangles();
+    pStats->DepthTests   = after.DepthTests - before.DepthTests;
+    pStats->QuadsCovered = after.QuadsCovered - before.QuadsCovered;
+    pStats->QuadsLive    = after.QuadsLive - before.QuadsLive;
+    pStats->PixelsLive   = after.PixelsLive - before.PixelsLive;
+
+    double quadCost = mode == OFFLINE_DEPTH_PREPASS ? m_Model.DepthQuadCost : m_Model.ShadedQuadCost;
+    pStats->Cost = (double)pStats->Triangles*m_Model.TriangleCost + (double)pStats->DepthTests*m_Model.DepthTestCost +
+                   (double)pStats->QuadsLive*quadCost;
+}
+
+
+//--------------------------------------------------------------------------------------
+double COfflinePrepassComparison::GetBreakEvenQuadCost() const
+{
+    uint64_t shadedWith    = m_WithPrepass.ShadingPass.QuadsLive;
+    uint64_t shadedWithout = m_WithoutPrepass.ShadingPass.QuadsLive;
+    if (shadedWithout <= shadedWith)
+        return 0.0;
+
+    // Everything but the shading of the scene's quads
+    double fixedWith    = m_WithPrepass.Cost - (double)shadedWith*m_Model.ShadedQuadCost;
+    double fixedWithout = m_WithoutPrepass.Cost - (double)shadedWithout*m_Model.ShadedQuadCost;
+    return (fixedWith - fixedWithout)/(double)(shadedWithout - shadedWith);
+}
@@ -0,0 +1,78 @@
+//--------------------------------------------------------------------------------------
+// File: OfflinePrepass.h
+//
+// Compares Render()'s two-pass strategy, a depth-only pass with SceneDepthPS followed by
+// a LESS_EQUAL shading pass under [earlydepthstencil], against a single shading pass
+// that tests and writes depth in submission order, where early-Z can only reject what
+// has already been drawn.
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef OFFLINE_PREPASS_H
+#define OFFLINE_PREPASS_H
+
+#include <stdint.h>
+
+#include "OfflineRaster.h"
+
+//--------------------------------------------------------------------------------------
+// Relative costs, in units of one depth test
+//--------------------------------------------------------------------------------------
+struct OfflineDepthCostModel
+{
+    double TriangleCost;        // setting up a triangle, every pass
+    double DepthTestCost;
+    double DepthQuadCost;       // a quad through SceneDepthPS, which is empty
+    double ShadedQuadCost;      // a quad through the scene pixel shader, helpers included
+};
+
+OfflineDepthCostModel OfflineGetDefaultDepthCostModel();
+
+struct OfflineDepthPassStats
+{
+    uint64_t Triangles;
+    uint64_t DepthTests;
+    uint64_t QuadsCovered;
+    uint64_t QuadsLive;         // quads launched
+    uint64_t PixelsLive;        // live lanes among them
+    double   Cost;
+};
+
+struct OfflinePrepassStrategy
+{
+    OfflineDepthPassStats DepthPass;    // all zero without a pre-pass
+    OfflineDepthPassStats ShadingPass;
+    double                Cost;
+};
+
+
+//--------------------------------------------------------------------------------------
+class COfflinePrepassComparison
+{
+public:
+                        COfflinePrepassComparison();
+
+    // Runs both strategies over the triangles already set up in the rasterizer
+    void                Run(COfflineRasterizer* pRasterizer, OFFLINE_DEPTH_FORMAT format,
+                            const OfflineDepthCostModel& model);
+
+    const OfflinePrepassStrategy& GetWithPrepass() const    { return m_WithPrepass; }
+    const OfflinePrepassStrategy& GetWithoutPrepass() const { return m_WithoutPrepass; }
+
+    bool                PrepassPaysOff() const { return m_WithPrepass.Cost < m_WithoutPrepass.Cost; }
+
+    // The shaded quad cost at which both strategies cost the same, or 0 if the pre-pass
+    // saves no quads
+    double              GetBreakEvenQuadCost() const;
+
+protected:
+    void                RunPass(COfflineRasterizer* pRasterizer, COfflineDepthBuffer* pDepth,
+                                OFFLINE_DEPTH_MODE mode, OfflineDepthPassStats* pStats);
+
+    OfflineDepthCostModel   m_Model;
+    OfflinePrepassStrategy  m_WithPrepass;
+    OfflinePrepassStrategy  m_WithoutPrepass;
+};
+
+#endif
@@ -0,0 +1,140 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineQuadMerge.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#include "OfflineQuadMerge.h"
+#include "OfflineMethods.h"
+#include "DXUTprofiler.h"
+
+#include <string.h>
+#include <deque>
+
+//--------------------------------------------------------------------------------------
+const char* OfflineGetMergeRuleName(OFFLINE_MERGE_RULE rule)
+{
+    static const char* names[OFFLINE_NB_MERGE_RULES] =
+    {
+        "adjacent",
+        "sameDraw"
+    };
+    return names[rule];
+}
+
+
+//--------------------------------------------------------------------------------------
+// COfflineQuadMerger
+//--------------------------------------------------------------------------------------
+void COfflineQuadMerger::SetMesh(const COfflineMesh& mesh)
+{
+    m_Indices.assign(mesh.GetIndices(), mesh.GetIndices() + mesh.GetNumIndices());
+
+    // Unreferenced triangles keep an impossible draw, and so never merge
+    m_TriangleDraws.assign(mesh.GetNumTriangles(), 0xffffffff);
+    for (uint32_t d = 0; d < mesh.GetNumDraws(); d++)
+    {
+        const OfflineDraw& draw = mesh.GetDraw(d);
+        for (uint32_t t = draw.IndexStart/3; t < (draw.IndexStart + draw.IndexCount)/3; t++)
+            m_TriangleDraws[t] = d;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+OfflineMergeStats COfflineQuadMerger::Run(const COfflineFragmentRecorder& fragments, uint32_t window,
+                                          OFFLINE_MERGE_RULE rule) const
+{
+    DXUT_PROFILE_SCOPE(L"Offline Quad Merge");
+
+    OfflineMergeStats stats;
+    memset(&stats, 0, sizeof(stats));
+    stats.Rule    = rule;
+    stats.Window  = window;
+    stats.QuadsIn = fragments.GetNumFragments();
+
+    std::deque<PendingQuad> pending;
+    const OfflineFragmentQuad* pFragments = fragments.GetFragments();
+    for (uint32_t i = 0; i <= fragments.GetNumFragments(); i++)
+    {
+        bool last = i == fragments.GetNumFragments();
+
+        if (!last)
+        {
+            const OfflineFragmentQuad& fragment = pFragments[i];
+            uint32_t draw = fragment.Triangle < m_TriangleDraws.size() ? m_TriangleDraws[fragment.Triangle] : 0xffffffff;
+
+            // Newest first: the triangles drawn just before are the likeliest neighbours
+            bool merged = false;
+            for (size_t j = pending.size(); j-- > 0 && !merged; )
+            {
+                PendingQuad& quad = pending[j];
+                if (!CanMerge(quad, fragment, draw, rule))
+                    continue;
+
+                quad.Live |= fragment.Live;
+                quad.Triangles[quad.NbTriangles++] = fragment.Triangle;
+                stats.Merges++;
+                merged = true;
+            }
+            if (merged)
+                continue;
+
+            PendingQuad quad;
+            quad.X           = fragment.X;
+            quad.Y           = fragment.Y;
+            quad.Instance    = fragment.Instance;
+            quad.Draw        = draw;
+            quad.Live        = fragment.Live;
+            quad.NbTriangles = 1;
+            quad.Triangles[0] = fragment.Triangle;
+            pending.push_back(quad);
+        }
+
+        // Shade whatever falls out of the window, and everything at the end
+        while (pending.size() > window || (last && !pending.empty()))
+        {
+            uint32_t live = OfflineCountLanes(pending.front().Live);
+            stats.QuadsOut++;
+            stats.LivePixels += live;
+            stats.LiveStats[live - 1]++;
+            pending.pop_front();
+        }
+    }
+
+    stats.Invocations = 4*stats.QuadsOut;
+    stats.HelperLanes = stats.Invocations - stats.LivePixels;
+    return stats;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool COfflineQuadMerger::CanMerge(const PendingQuad& quad, const OfflineFragmentQuad& fragment, uint32_t draw,
+                                  OFFLINE_MERGE_RULE rule) const
+{
+    if (quad.X != fragment.X || quad.Y != fragment.Y || quad.Instance != fragment.Instance ||
+        quad.Draw != draw || draw == 0xffffffff || (quad.Live & fragment.Live))
+        return false;
+
+    if (rule == OFFLINE_MERGE_SAME_DRAW)
+        return true;
+
+    for (uint32_t i = 0; i < quad.NbTriangles; i++)
+    {
+        if (SharesEdge(quad.Triangles[i], fragment.Triangle))
+            return true;
+    }
+    return false;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool COfflineQuadMerger::SharesEdge(uint32_t a, uint32_t b) const
+{
+    const uint32_t* pA = &m_Indices[(size_t)a*3];
+    const uint32_t* pB = &m_Indices[(size_t)b*3];
+
+    uint32_t shared = 0;
+    for (int i = 0; i < 3; i++)
+        shared += (pA[i] == pB[0] || pA[i] == pB[1] || pA[i] == pB[2]) ? 1 : 0;
+    return shared >= 2;
+}
@@ -0,0 +1,78 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineQuadMerge.h
+//
+// Quad-fragment merging (Fatahalian et al. 2010) over the shading pass's quad stream.
+// Quads wait in a small FIFO window before being shaded, and a new quad at the same
+// position merges into a waiting one when their live pixels don't overlap and their
+// triangles can be shaded together, so partial quads along shared edges fill up instead
+// of each paying for their own helper lanes.
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef OFFLINE_QUAD_MERGE_H
+#define OFFLINE_QUAD_MERGE_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "OfflineLockStress.h"
+#include "OfflineMesh.h"
+
+#define OFFLINE_MERGE_DEFAULT_WINDOW    16
+
+enum OFFLINE_MERGE_RULE
+{
+    OFFLINE_MERGE_ADJACENT,     // triangles of one draw sharing an edge (both indices), so
+                                // attributes interpolate continuously across the quad
+    OFFLINE_MERGE_SAME_DRAW,    // any triangles of one draw, as a software rasterizer
+                                // shading from a visibility buffer could
+    OFFLINE_NB_MERGE_RULES
+};
+
+const char* OfflineGetMergeRuleName(OFFLINE_MERGE_RULE rule);
+
+struct OfflineMergeStats
+{
+    OFFLINE_MERGE_RULE Rule;
+    uint32_t Window;
+    uint64_t QuadsIn;
+    uint64_t QuadsOut;          // shaded after merging
+    uint64_t Merges;
+    uint64_t LivePixels;
+    uint64_t Invocations;       // four per shaded quad
+    uint64_t HelperLanes;
+    uint32_t LiveStats[4];      // shaded quads with 1-4 live pixels
+};
+
+
+//--------------------------------------------------------------------------------------
+class COfflineQuadMerger
+{
+public:
+    // The mesh whose triangles the stream's Triangle numbers refer to
+    void                SetMesh(const COfflineMesh& mesh);
+
+    OfflineMergeStats   Run(const COfflineFragmentRecorder& fragments, uint32_t window, OFFLINE_MERGE_RULE rule) const;
+
+protected:
+    // A quad waiting to be shaded, with the triangles merged into it
+    struct PendingQuad
+    {
+        uint32_t X, Y;
+        uint32_t Instance;
+        uint32_t Draw;
+        uint32_t Live;
+        uint32_t NbTriangles;
+        uint32_t Triangles[4];  // each adds at least one live pixel
+    };
+
+    bool                CanMerge(const PendingQuad& quad, const OfflineFragmentQuad& fragment, uint32_t draw,
+                                 OFFLINE_MERGE_RULE rule) const;
+    bool                SharesEdge(uint32_t a, uint32_t b) const;
+
+    std::vector<uint32_t>   m_Indices;          // three per triangle
+    std::vector<uint32_t>   m_TriangleDraws;
+};
+
+#endif
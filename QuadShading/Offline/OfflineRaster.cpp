@@ -0,0 +1,406 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineRaster.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#include "OfflineRaster.h"
+#include "DXUTprofiler.h"
+
+#include <math.h>
+#include <string.h>
+
+// Enough for a triangle clipped by every plane
+#define MAX_CLIP_VERTICES   (3 + OFFLINE_NB_CLIP_PLANES)
+
+
+//--------------------------------------------------------------------------------------
+static uint32_t ClipPolygon(const Vec4* pIn, uint32_t nbIn, Vec4* pOut, int plane)
+{
+    uint32_t nbOut = 0;
+    for (uint32_t i = 0; i < nbIn; i++)
+    {
+        const Vec4& a = pIn[i];
+        const Vec4& b = pIn[(i + 1)%nbIn];
+        float da = OfflinePlaneDistance(a, plane, OFFLINE_GUARD_BAND);
+        float db = OfflinePlaneDistance(b, plane, OFFLINE_GUARD_BAND);
+
+        if (da >= 0.0f)
+            pOut[nbOut++] = a;
+
+        if ((da >= 0.0f) != (db >= 0.0f))
+        {
+            float t = da/(da - db);
+            Vec4 v;
+            v.x = a.x + (b.x - a.x)*t;
+            v.y = a.y + (b.y - a.y)*t;
+            v.z = a.z + (b.z - a.z)*t;
+            v.w = a.w + (b.w - a.w)*t;
+            pOut[nbOut++] = v;
+        }
+    }
+    return nbOut;
+}
+
+
+
+//--------------------------------------------------------------------------------------
+// COfflineDepthBuffer
+//--------------------------------------------------------------------------------------
+void COfflineDepthBuffer::Resize(uint32_t width, uint32_t height, OFFLINE_DEPTH_FORMAT format)
+{
+    m_Width  = width;
+    m_Height = height;
+    m_Format = format;
+    m_Depth.resize((size_t)width*height);
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineDepthBuffer::Clear(float depth)
+{
+    uint32_t encoded = Encode(depth);
+    for (size_t i = 0; i < m_Depth.size(); i++)
+        m_Depth[i] = encoded;
+}
+
+
+//--------------------------------------------------------------------------------------
+// COfflineRasterizer
+//--------------------------------------------------------------------------------------
+COfflineRasterizer::COfflineRasterizer() : m_Width(0),
+                                           m_Height(0)
+{
+    memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineRasterizer::SetViewport(uint32_t width, uint32_t height)
+{
+    m_Width  = width;
+    m_Height = height;
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineRasterizer::Reset()
+{
+    m_Triangles.clear();
+    memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineRasterizer::SetupMesh(const COfflineMesh& mesh, const Mat4& viewProj, uint32_t instance,
+                                   const uint8_t* pClusterVisible)
+{
+    DXUT_PROFILE_SCOPE(L"Offline Setup");
+
+    TransformVertices(mesh.GetPositions(), mesh.GetNumVertices(), viewProj);
+
+    // Triangles are numbered the same whether or not clusters are skipped
+    const uint32_t firstTriangle = GetNextTriangle();
+    for (uint32_t c = 0; c < mesh.GetNumClusters(); c++)
+    {
+        if (pClusterVisible && !pClusterVisible[c])
+            SkipCluster(mesh, c);
+        else
+            SetupCluster(mesh, c, firstTriangle, instance);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Shared vertex work: every position is transformed and snapped once, whichever draws
+// use it
+//--------------------------------------------------------------------------------------
+void COfflineRasterizer::TransformVertices(const Vec3* pPositions, uint32_t nbVertices, const Mat4& viewProj)
+{
+    m_ClipPositions.resize(nbVertices);
+    m_Snapped.resize(nbVertices);
+    if (!m_ClipPositions.empty())
+    {
+        OfflineTransformVertices(pPositions, nbVertices, viewProj, &m_ClipPositions[0]);
+        OfflineSnapVertices(&m_ClipPositions[0], nbVertices, m_Width, m_Height, &m_Snapped[0]);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineRasterizer::SkipCluster(const COfflineMesh& mesh, uint32_t c)
+{
+    m_Stats.TrianglesSkipped += mesh.GetCluster(c).NbTriangles;
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineRasterizer::SetupCluster(const COfflineMesh& mesh, uint32_t c, uint32_t firstTriangle, uint32_t instance)
+{
+    const OfflineCluster& cluster = mesh.GetCluster(c);
+    const uint32_t* pIndices = mesh.GetIndices();
+
+    m_CullResults.resize(cluster.NbTriangles);
+    OfflineCullTriangles(&m_Snapped[0], pIndices + cluster.IndexStart, cluster.NbTriangles, m_Width, m_Height,
+                         &m_CullResults[0]);
+
+    const OfflineDraw& draw = mesh.GetDraw(cluster.Draw);
+    for (uint32_t t = 0; t < cluster.NbTriangles; t++)
+    {
+        const uint32_t* pTri = pIndices + cluster.IndexStart + t*3;
+        const uint32_t triangle    = firstTriangle + cluster.IndexStart/3 + t;
+        const uint32_t primitiveID = (cluster.IndexStart - draw.IndexStart)/3 + t;
+
+        m_Stats.TrianglesIn++;
+
+        OFFLINE_CULL_RESULT result = (OFFLINE_CULL_RESULT)m_CullResults[t];
+        if (result == OFFLINE_CULL_ACCEPT)
+        {
+            int32_t x[3], y[3];
+            float   z[3];
+            for (int i = 0; i < 3; i++)
+            {
+                const OfflineSnappedVertex& vertex = m_Snapped[pTri[i]];
+                x[i] = vertex.X;
+                y[i] = vertex.Y;
+                z[i] = vertex.Z;
+            }
+            result = SetupPolygon(x, y, z, 3, triangle, primitiveID, cluster.Draw, instance);
+        }
+        else if (result == OFFLINE_CULL_CLIP)
+        {
+            Vec4 clip[3] =
+            {
+                m_ClipPositions[pTri[0]],
+                m_ClipPositions[pTri[1]],
+                m_ClipPositions[pTri[2]]
+            };
+            m_Stats.TrianglesClipped++;
+            result = ClipTriangle(clip, triangle, primitiveID, cluster.Draw, instance);
+        }
+
+        switch (result)
+        {
+        case OFFLINE_CULL_OUTSIDE:     m_Stats.TrianglesOutside++;    break;
+        case OFFLINE_CULL_BACK_FACING: m_Stats.TrianglesBackFacing++; break;
+        case OFFLINE_CULL_ZERO_AREA:   m_Stats.TrianglesZeroArea++;   break;
+        case OFFLINE_CULL_NO_SAMPLES:  m_Stats.TrianglesNoSamples++;  break;
+        default:                                                      break;
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Triangles that cross the near/far planes or the guard band
+//--------------------------------------------------------------------------------------
+OFFLINE_CULL_RESULT COfflineRasterizer::ClipTriangle(const Vec4* pClip, uint32_t triangle, uint32_t primitiveID,
+                                                     uint32_t draw, uint32_t instance)
+{
+    Vec4 polygon[2][MAX_CLIP_VERTICES];
+    uint32_t nbVertices = 3;
+    polygon[0][0] = pClip[0];
+    polygon[0][1] = pClip[1];
+    polygon[0][2] = pClip[2];
+
+    int src = 0;
+    for (int plane = 0; plane < OFFLINE_NB_CLIP_PLANES && nbVertices >= 3; plane++)
+    {
+        nbVertices = ClipPolygon(polygon[src], nbVertices, polygon[src ^ 1], plane);
+        src ^= 1;
+    }
+
+    if (nbVertices < 3)
+        return OFFLINE_CULL_OUTSIDE;
+
+    int32_t x[MAX_CLIP_VERTICES];
+    int32_t y[MAX_CLIP_VERTICES];
+    float   z[MAX_CLIP_VERTICES];
+    for (uint32_t i = 0; i < nbVertices; i++)
+        OfflineSnapVertex(polygon[src][i], m_Width, m_Height, &x[i], &y[i], &z[i]);
+
+    return SetupPolygon(x, y, z, nbVertices, triangle, primitiveID, draw, instance);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Fans a snapped convex polygon (usually just the triangle) into triangles that all keep
+// the source triangle's IDs. Returns OFFLINE_CULL_ACCEPT if any of them was kept, and
+// otherwise the reason for the most telling of them: no samples, then back-facing.
+//--------------------------------------------------------------------------------------
+OFFLINE_CULL_RESULT COfflineRasterizer::SetupPolygon(const int32_t* pX, const int32_t* pY, const float* pZ,
+                                                     uint32_t nbVertices, uint32_t triangle, uint32_t primitiveID,
+                                                     uint32_t draw, uint32_t instance)
+{
+    OFFLINE_CULL_RESULT result = OFFLINE_CULL_ZERO_AREA;
+    for (uint32_t i = 1; i + 1 < nbVertices; i++)
+    {
+        const uint32_t v[3] = { 0, i, i + 1 };
+
+        // Positive area is clockwise on screen, which is front-facing here
+        int64_t area = (int64_t)(pX[v[1]] - pX[v[0]])*(pY[v[2]] - pY[v[0]]) -
+                       (int64_t)(pX[v[2]] - pX[v[0]])*(pY[v[1]] - pY[v[0]]);
+        if (area <= 0)
+        {
+            if (area < 0 && result == OFFLINE_CULL_ZERO_AREA)
+                result = OFFLINE_CULL_BACK_FACING;
+            continue;
+        }
+
+        OfflineTriangle tri;
+        for (int j = 0; j < 3; j++)
+        {
+            tri.X[j] = pX[v[j]];
+            tri.Y[j] = pY[v[j]];
+        }
+
+        // Pixels whose centres can be inside
+        int32_t minX = tri.X[0], maxX = tri.X[0];
+        int32_t minY = tri.Y[0], maxY = tri.Y[0];
+        for (int j = 1; j < 3; j++)
+        {
+            minX = tri.X[j] < minX ? tri.X[j] : minX;
+            maxX = tri.X[j] > maxX ? tri.X[j] : maxX;
+            minY = tri.Y[j] < minY ? tri.Y[j] : minY;
+            maxY = tri.Y[j] > maxY ? tri.Y[j] : maxY;
+        }
+        const int32_t half = OFFLINE_SUBPIXEL_ONE/2;
+        tri.MinX = OfflineCeilDiv(minX - half, OFFLINE_SUBPIXEL_ONE);
+        tri.MinY = OfflineCeilDiv(minY - half, OFFLINE_SUBPIXEL_ONE);
+        tri.MaxX = OfflineFloorDiv(maxX - half, OFFLINE_SUBPIXEL_ONE);
+        tri.MaxY = OfflineFloorDiv(maxY - half, OFFLINE_SUBPIXEL_ONE);
+        tri.MinX = tri.MinX < 0 ? 0 : tri.MinX;
+        tri.MinY = tri.MinY < 0 ? 0 : tri.MinY;
+        tri.MaxX = tri.MaxX > (int32_t)m_Width  - 1 ? (int32_t)m_Width  - 1 : tri.MaxX;
+        tri.MaxY = tri.MaxY > (int32_t)m_Height - 1 ? (int32_t)m_Height - 1 : tri.MaxY;
+        if (tri.MinX > tri.MaxX || tri.MinY > tri.MaxY)
+        {
+            if (result != OFFLINE_CULL_ACCEPT)
+                result = OFFLINE_CULL_NO_SAMPLES;
+            continue;
+        }
+
+        // Depth plane through the snapped vertices, in pixel units
+        const double scale = 1.0/OFFLINE_SUBPIXEL_ONE;
+        double x0  = tri.X[0]*scale;
+        double y0  = tri.Y[0]*scale;
+        double e1x = (tri.X[1] - tri.X[0])*scale, e1y = (tri.Y[1] - tri.Y[0])*scale;
+        double e2x = (tri.X[2] - tri.X[0])*scale, e2y = (tri.Y[2] - tri.Y[0])*scale;
+        double dz1 = (double)pZ[v[1]] - pZ[v[0]];
+        double dz2 = (double)pZ[v[2]] - pZ[v[0]];
+        double det = e1x*e2y - e2x*e1y;
+        tri.ZPlane[1] = (dz1*e2y - dz2*e1y)/det;
+        tri.ZPlane[2] = (dz2*e1x - dz1*e2x)/det;
+        tri.ZPlane[0] = pZ[v[0]] - tri.ZPlane[1]*x0 - tri.ZPlane[2]*y0;
+
+        tri.Triangle    = triangle;
+        tri.PrimitiveID = primitiveID;
+        tri.Draw        = draw;
+        tri.Instance    = instance;
+
+        m_Stats.TrianglesSetUp++;
+        m_Triangles.push_back(tri);
+        result = OFFLINE_CULL_ACCEPT;
+    }
+    return result;
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineRasterizer::Rasterize(COfflineDepthBuffer* pDepth, OFFLINE_DEPTH_MODE mode, IOfflineQuadSink* pSink)
+{
+    DXUT_PROFILE_SCOPE(mode == OFFLINE_DEPTH_PREPASS ? L"Offline Depth Pass" : L"Offline Quad Pass");
+
+    for (size_t i = 0; i < m_Triangles.size(); i++)
+        RasterizeTriangle(m_Triangles[i], pDepth, mode, pSink);
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineRasterizer::RasterizeTriangle(const OfflineTriangle& tri, COfflineDepthBuffer* pDepth,
+                                           OFFLINE_DEPTH_MODE mode, IOfflineQuadSink* pSink)
+{
+    // Edge functions at the first quad's top-left pixel centre, stepped a pixel at a time
+    int64_t edge[3], stepX[3], stepY[3], bias[3];
+    const int32_t firstX = (tri.MinX & ~1)*OFFLINE_SUBPIXEL_ONE + OFFLINE_SUBPIXEL_ONE/2;
+    const int32_t firstY = (tri.MinY & ~1)*OFFLINE_SUBPIXEL_ONE + OFFLINE_SUBPIXEL_ONE/2;
+    for (int i = 0; i < 3; i++)
+    {
+        int j = (i + 1)%3;
+        edge[i]  = OfflineEvaluateEdge(tri.X[i], tri.Y[i], tri.X[j], tri.Y[j], firstX, firstY, &bias[i]);
+        stepX[i] = -((int64_t)tri.Y[j] - tri.Y[i])*OFFLINE_SUBPIXEL_ONE;
+        stepY[i] =  ((int64_t)tri.X[j] - tri.X[i])*OFFLINE_SUBPIXEL_ONE;
+    }
+
+    for (int32_t py = tri.MinY & ~1; py <= tri.MaxY; py += 2)
+    {
+        int64_t row[3] = { edge[0], edge[1], edge[2] };
+
+        for (int32_t px = tri.MinX & ~1; px <= tri.MaxX; px += 2)
+        {
+            OfflineQuad quad;
+            quad.X = px >> 1;
+            quad.Y = py >> 1;
+            quad.Coverage = 0;
+            quad.Inside   = 0;
+            quad.Live     = 0;
+
+            for (int lane = 0; lane < 4; lane++)
+            {
+                int64_t e0 = row[0] + (lane & 1)*stepX[0] + (lane >> 1)*stepY[0];
+                int64_t e1 = row[1] + (lane & 1)*stepX[1] + (lane >> 1)*stepY[1];
+                int64_t e2 = row[2] + (lane & 1)*stepX[2] + (lane >> 1)*stepY[2];
+
+                if ((e0 | e1 | e2) >= 0)
+                    quad.Inside |= 1 << lane;
+
+                uint32_t x = px + (lane & 1);
+                uint32_t y = py + (lane >> 1);
+                if (e0 + bias[0] >= 0 && e1 + bias[1] >= 0 && e2 + bias[2] >= 0 && x < m_Width && y < m_Height)
+                    quad.Coverage |= 1 << lane;
+            }
+
+            for (int i = 0; i < 3; i++)
+                row[i] += 2*stepX[i];
+
+            if (!quad.Coverage)
+                continue;
+
+            m_Stats.QuadsCovered++;
+
+            for (int lane = 0; lane < 4; lane++)
+            {
+                quad.Depth[lane] = 0.0f;
+                if (!(quad.Coverage & (1 << lane)))
+                    continue;
+
+                uint32_t x = px + (lane & 1);
+                uint32_t y = py + (lane >> 1);
+                double z = tri.ZPlane[0] + tri.ZPlane[1]*(x + 0.5) + tri.ZPlane[2]*(y + 0.5);
+                float depth = (float)(z < 0.0 ? 0.0 : (z > 1.0 ? 1.0 : z));
+                quad.Depth[lane] = depth;
+
+                // LESS_EQUAL
+                uint32_t encoded = pDepth->Encode(depth);
+                uint32_t* pDest  = pDepth->GetRow(y) + x;
+                m_Stats.DepthTests++;
+                if (encoded <= *pDest)
+                {
+                    quad.Live |= 1 << lane;
+                    if (mode != OFFLINE_DEPTH_EARLY_TEST)
+                        *pDest = encoded;
+                }
+            }
+
+            if (!quad.Live)
+                continue;
+
+            m_Stats.QuadsLive++;
+            m_Stats.PixelsLive += (quad.Live & 1) + ((quad.Live >> 1) & 1) + ((quad.Live >> 2) & 1) + (quad.Live >> 3);
+            if (pSink && mode != OFFLINE_DEPTH_PREPASS)
+                pSink->OnQuad(tri, quad);
+        }
+
+        for (int i = 0; i < 3; i++)
+            edge[i] += 2*stepY[i];
+    }
+}
@@ -0,0 +1,208 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineRaster.h
+//
+// CPU rasterizer for the offline overshading engine. Follows the D3D11 rules the demo
+// relies on, for the state that QuadShading.cpp sets up:
+//
+//   - clipping against the near and far planes (DepthClipEnable = TRUE), plus a guard
+//     band in x and y so that large triangles keep their exact edges
+//   - 16.8 fixed-point vertex snapping and the top-left fill rule, sampling at pixel
+//     centres, no MSAA
+//   - CULL_BACK with FrontCounterClockwise = FALSE
+//   - depth interpolated linearly in screen space, tested LESS_EQUAL against a
+//     D24_UNORM buffer like g_pDepthStencil, or optionally a 32-bit float one
+//
+// Pixels are visited a 2x2 quad at a time, and every quad with live pixels is handed
+// to an IOfflineQuadSink, which stands in for the pixel shader.
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef OFFLINE_RASTER_H
+#define OFFLINE_RASTER_H
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "OfflineCull.h"
+#include "OfflineMath.h"
+#include "OfflineMesh.h"
+
+//--------------------------------------------------------------------------------------
+// A triangle after clipping, projection, snapping and culling. Vertices are always in
+// clockwise (front-facing) order.
+//--------------------------------------------------------------------------------------
+struct OfflineTriangle
+{
+    int32_t  X[3];              // window position, 16.8 fixed point
+    int32_t  Y[3];
+    double   ZPlane[3];         // depth = ZPlane[0] + ZPlane[1]*x + ZPlane[2]*y, in pixels
+    int32_t  MinX, MinY;        // pixels whose centres may be covered, inclusive and
+    int32_t  MaxX, MaxY;        // clamped to the viewport
+    uint32_t Triangle;          // source triangle, counted across all draws in order
+    uint32_t PrimitiveID;       // SV_PrimitiveID, which restarts with every draw
+    uint32_t Draw;
+    uint32_t Instance;
+};
+
+//--------------------------------------------------------------------------------------
+// One 2x2 quad of a triangle. Lane masks use the shaders' pixel index, x + 2*y within
+// the quad.
+//--------------------------------------------------------------------------------------
+struct OfflineQuad
+{
+    uint32_t X, Y;              // as uint2 quad = vpos.xy*0.5
+    uint32_t Coverage;          // pixel centres inside under the fill rule
+    uint32_t Inside;            // all barycentrics >= 0, helper lanes included (ScenePS2)
+    uint32_t Live;              // covered and passed the early depth test (SV_Coverage)
+    float    Depth[4];
+};
+
+// Quads across a side of the viewport, including the half-covered quads of odd sizes
+inline uint32_t OfflineGetQuadGridSize(uint32_t pixels)
+{
+    return (pixels + 1) >> 1;
+}
+
+struct OfflineRasterStats
+{
+    uint64_t TrianglesIn;
+    uint64_t TrianglesSkipped;  // in clusters culled before setup, not counted in TrianglesIn
+    uint64_t TrianglesOutside;  // entirely outside the view volume or the viewport
+    uint64_t TrianglesClipped;  // crossed the near/far plane or the guard band
+    uint64_t TrianglesBackFacing;
+    uint64_t TrianglesZeroArea; // after snapping
+    uint64_t TrianglesNoSamples;// front-facing, but covering no pixel centre
+    uint64_t TrianglesSetUp;    // handed to the rasterizer; clipping can split triangles
+    uint64_t QuadsCovered;      // with at least one covered pixel
+    uint64_t QuadsLive;         // with at least one pixel that passed the depth test
+    uint64_t PixelsLive;
+    uint64_t DepthTests;
+};
+
+enum OFFLINE_DEPTH_MODE
+{
+    OFFLINE_DEPTH_PREPASS,      // g_sceneDepthDS: test and write, no quads emitted
+    OFFLINE_DEPTH_EARLY_TEST,   // g_sceneDS under [earlydepthstencil]: test only
+    OFFLINE_DEPTH_EARLY_WRITE   // shading without a pre-pass: test and write
+};
+
+enum OFFLINE_DEPTH_FORMAT
+{
+    OFFLINE_DEPTH_FORMAT_D24_UNORM, // DXGI_FORMAT_D24_UNORM_S8_UINT, as the demo uses
+    OFFLINE_DEPTH_FORMAT_D32_FLOAT
+};
+
+
+//--------------------------------------------------------------------------------------
+// Depth in [0, 1] as stored, so that LESS_EQUAL is an integer compare at the precision
+// of the format. D24_UNORM rounds to the nearest of 2^24 - 1 steps, as the FLOAT to UNORM
+// conversion does; the bits of a non-negative float order the same way as its value.
+//--------------------------------------------------------------------------------------
+inline uint32_t OfflineEncodeDepth(float depth, OFFLINE_DEPTH_FORMAT format)
+{
+    if (format == OFFLINE_DEPTH_FORMAT_D24_UNORM)
+        return (uint32_t)(depth*16777215.0 + 0.5);
+
+    uint32_t bits;
+    memcpy(&bits, &depth, sizeof(bits));
+    return bits;
+}
+
+
+//--------------------------------------------------------------------------------------
+class COfflineDepthBuffer
+{
+public:
+                        COfflineDepthBuffer() : m_Width(0), m_Height(0), m_Format(OFFLINE_DEPTH_FORMAT_D24_UNORM) {}
+
+    void                Resize(uint32_t width, uint32_t height, OFFLINE_DEPTH_FORMAT format);
+    void                Clear(float depth);
+
+    uint32_t            GetWidth() const    { return m_Width; }
+    uint32_t            GetHeight() const   { return m_Height; }
+    OFFLINE_DEPTH_FORMAT GetFormat() const  { return m_Format; }
+    uint32_t*           GetRow(uint32_t y)  { return &m_Depth[(size_t)y*m_Width]; }
+    const uint32_t*     GetRow(uint32_t y) const { return &m_Depth[(size_t)y*m_Width]; }
+
+    uint32_t            Encode(float depth) const { return OfflineEncodeDepth(depth, m_Format); }
+
+protected:
+    uint32_t                m_Width;
+    uint32_t                m_Height;
+    OFFLINE_DEPTH_FORMAT    m_Format;
+    std::vector<uint32_t>   m_Depth;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Receives quads in rasterization order, standing in for the pixel shader
+//--------------------------------------------------------------------------------------
+class IOfflineQuadSink
+{
+public:
+    virtual             ~IOfflineQuadSink() {}
+    virtual void        OnQuad(const OfflineTriangle& tri, const OfflineQuad& quad) = 0;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Triangles are set up once per view and can then be rasterized any number of times,
+// so the depth pre-pass and the shading pass share all of the vertex and setup work.
+//--------------------------------------------------------------------------------------
+class COfflineRasterizer
+{
+public:
+                        COfflineRasterizer();
+
+    void                SetViewport(uint32_t width, uint32_t height);
+    uint32_t            GetWidth() const    { return m_Width; }
+    uint32_t            GetHeight() const   { return m_Height; }
+
+    // Forget the set-up triangles and the statistics
+    void                Reset();
+
+    // Transforms the mesh by viewProj and sets up every triangle of every draw that
+    // OfflineCullTriangles lets through, skipping the clusters whose entry in
+    // pClusterVisible is zero, if given
+    void                SetupMesh(const COfflineMesh& mesh, const Mat4& viewProj, uint32_t instance,
+                                  const uint8_t* pClusterVisible = NULL);
+
+    // SetupMesh in steps, for callers walking the clusters themselves: the positions,
+    // which may already be in world space, are transformed by viewProj, then clusters
+    // are set up or skipped one at a time. firstTriangle numbers the mesh's first
+    // triangle, from GetNextTriangle() before the first cluster.
+    void                TransformVertices(const Vec3* pPositions, uint32_t nbVertices, const Mat4& viewProj);
+    void                SetupCluster(const COfflineMesh& mesh, uint32_t cluster, uint32_t firstTriangle,
+                                     uint32_t instance);
+    void                SkipCluster(const COfflineMesh& mesh, uint32_t cluster);
+    uint32_t            GetNextTriangle() const
+    {
+        return (uint32_t)(m_Stats.TrianglesIn + m_Stats.TrianglesSkipped);
+    }
+
+    void                Rasterize(COfflineDepthBuffer* pDepth, OFFLINE_DEPTH_MODE mode, IOfflineQuadSink* pSink);
+
+    uint32_t            GetNumTriangles() const { return (uint32_t)m_Triangles.size(); }
+    const OfflineTriangle& GetTriangle(uint32_t i) const { return m_Triangles[i]; }
+    const OfflineRasterStats& GetStats() const { return m_Stats; }
+
+protected:
+    OFFLINE_CULL_RESULT ClipTriangle(const Vec4* pClip, uint32_t triangle, uint32_t primitiveID,
+                                     uint32_t draw, uint32_t instance);
+    OFFLINE_CULL_RESULT SetupPolygon(const int32_t* pX, const int32_t* pY, const float* pZ, uint32_t nbVertices,
+                                     uint32_t triangle, uint32_t primitiveID, uint32_t draw, uint32_t instance);
+    void                RasterizeTriangle(const OfflineTriangle& tri, COfflineDepthBuffer* pDepth,
+                                          OFFLINE_DEPTH_MODE mode, IOfflineQuadSink* pSink);
+
+    uint32_t                        m_Width;
+    uint32_t                        m_Height;
+    std::vector<Vec4>               m_ClipPositions;
+    std::vector<OfflineSnappedVertex> m_Snapped;
+    std::vector<uint8_t>            m_CullResults;      // OFFLINE_CULL_RESULT, per triangle of a cluster
+    std::vector<OfflineTriangle>    m_Triangles;
+    OfflineRasterStats              m_Stats;
+};
+
+#endif
@@ -0,0 +1,394 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineRegression.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+#include "OfflineRegression.h"
+#include "OfflineTiles.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+//--------------------------------------------------------------------------------------
+const char* OfflineGetRegressStatName(OFFLINE_REGRESS_STAT stat)
+{
+    static const char* names[OFFLINE_NB_REGRESS_STATS] =
+    {
+        "quads",
+        "slices",
+        "live",
+        "tiles"
+    };
+    return names[stat];
+}
+
+
+//--------------------------------------------------------------------------------------
+bool OfflineIsWithinTolerance(const OfflineTolerance& tolerance, double golden, double value)
+{
+    double delta = fabs(value - golden);
+    return delta <= tolerance.Absolute || delta <= tolerance.Relative*fabs(golden);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Front and back, the sides, from above and below, and close enough to fill the view
+// with large triangles and far enough to shrink them to a pixel or two
+//--------------------------------------------------------------------------------------
+static const OfflineRegressPose g_RegressPoses[] =
+{
+    { "front",      0.0f,   0.0f, 1.0f  },
+    { "quarter",    45.0f,  0.0f, 1.0f  },
+    { "side",       90.0f,  0.0f, 1.0f  },
+    { "back",       180.0f, 0.0f, 1.0f  },
+    { "above",      0.0f,   60.0f, 1.0f },
+    { "below",      30.0f, -30.0f, 1.0f },
+    { "close",      0.0f,   0.0f, 0.4f  },
+    { "far",        0.0f,   0.0f, 4.0f  }
+};
+
+uint32_t OfflineGetNumRegressPoses()
+{
+    return sizeof(g_RegressPoses)/sizeof(g_RegressPoses[0]);
+}
+
+const OfflineRegressPose& OfflineGetRegressPose(uint32_t pose)
+{
+    return g_RegressPoses[pose];
+}
+
+
+//--------------------------------------------------------------------------------------
+// The start-up view looks down +z at its target
+//--------------------------------------------------------------------------------------
+void OfflineGetRegressCamera(uint32_t pose, const OfflineCamera& start, OfflineCamera* pCamera)
+{
+    const OfflineRegressPose& p = g_RegressPoses[pose];
+    const Vec3  offset = Subtract(start.eye, start.at);
+    const float radius = sqrtf(Dot(offset, offset))*p.Distance;
+    const float yaw    = p.Yaw*3.141592654f/180.0f;
+    const float pitch  = p.Pitch*3.141592654f/180.0f;
+
+    *pCamera     = start;
+    pCamera->eye = Add(start.at, Scale(MakeVec3(sinf(yaw)*cosf(pitch), sinf(pitch), -cosf(yaw)*cosf(pitch)), radius));
+}
+
+
+//--------------------------------------------------------------------------------------
+void OfflineCaptureRegressResult(const COfflineMethods& methods, OfflineRegressResult* pResult)
+{
+    for (uint32_t m = 0; m < OFFLINE_NB_METHODS; m++)
+    {
+        const COfflineOverdraw& overdraw = methods.GetOverdraw((OFFLINE_METHOD)m);
+        pResult->Quads[m] = overdraw.GetTotalQuads(m == OFFLINE_METHOD_SLICES);
+        for (uint32_t s = 0; s < OFFLINE_NB_SLICES; s++)
+        {
+            pResult->Slices[m][s]    = overdraw.GetSliceTotal(s);
+            pResult->LiveStats[m][s] = overdraw.GetLiveStats(s);
+        }
+    }
+
+    COfflineTilePyramid pyramid;
+    pyramid.Build(methods.GetOverdraw(OFFLINE_REFERENCE_METHOD), false, 1);
+
+    pResult->TilesX = pyramid.GetTilesX(OFFLINE_REGRESS_TILE_LEVEL);
+    pResult->TilesY = pyramid.GetTilesY(OFFLINE_REGRESS_TILE_LEVEL);
+    pResult->Tiles.resize((size_t)pResult->TilesX*pResult->TilesY);
+    for (uint32_t y = 0; y < pResult->TilesY; y++)
+    {
+        for (uint32_t x = 0; x < pResult->TilesX; x++)
+            pResult->Tiles[(size_t)y*pResult->TilesX + x] = pyramid.GetTile(OFFLINE_REGRESS_TILE_LEVEL, x, y).Sum;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+static bool CompareValue(const char* method, const char* name, const OfflineTolerance& tolerance, double golden,
+                         double value, std::vector<std::string>* pFailures)
+{
+    if (OfflineIsWithinTolerance(tolerance, golden, value))
+        return true;
+
+    char line[256];
+    sprintf(line, "%s %s: %.0f golden, %.0f now (%+.3f%%)", method, name, golden, value,
+            golden != 0.0 ? 100.0*(value - golden)/golden : 100.0);
+    pFailures->push_back(line);
+    return false;
+}
+
+
+//--------------------------------------------------------------------------------------
+uint32_t OfflineCompareRegressResults(const OfflineRegressResult& golden, const OfflineRegressResult& result,
+                                      const OfflineTolerance tolerances[OFFLINE_NB_REGRESS_STATS],
+                                      std::vector<std::string>* pFailures, std::vector<uint8_t>* pTileFailed)
+{
+    static const char* liveNames[OFFLINE_NB_SLICES]  = { "1 live", "2 live", "3 live", "4 live" };
+    static const char* sliceNames[OFFLINE_NB_SLICES] = { "slice 0", "slice 1", "slice 2", "slice 3" };
+
+    uint32_t failures = 0;
+    for (uint32_t m = 0; m < OFFLINE_NB_METHODS; m++)
+    {
+        const char* method = OfflineGetMethodName((OFFLINE_METHOD)m);
+        failures += !CompareValue(method, "quads", tolerances[OFFLINE_REGRESS_QUADS], (double)golden.Quads[m],
+                                  (double)result.Quads[m], pFailures);
+        for (uint32_t s = 0; s < OFFLINE_NB_SLICES; s++)
+        {
+            failures += !CompareValue(method, sliceNames[s], tolerances[OFFLINE_REGRESS_SLICES],
+                                      (double)golden.Slices[m][s], (double)result.Slices[m][s], pFailures);
+            failures += !CompareValue(method, liveNames[s], tolerances[OFFLINE_REGRESS_LIVE],
+                                      (double)golden.LiveStats[m][s], (double)result.LiveStats[m][s], pFailures);
+        }
+    }
+
+    pTileFailed->assign(result.Tiles.size(), 0);
+    if (golden.TilesX != result.TilesX || golden.TilesY != result.TilesY)
+    {
+        pFailures->push_back("tiles: the grid is a different size");
+        pTileFailed->assign(result.Tiles.size(), 1);
+        return failures + 1;
+    }
+
+    uint32_t tileFailures = 0, worst = 0;
+    double   worstDelta = 0.0;
+    for (uint32_t i = 0; i < (uint32_t)result.Tiles.size(); i++)
+    {
+        double delta = fabs((double)result.Tiles[i] - (double)golden.Tiles[i]);
+        if (!OfflineIsWithinTolerance(tolerances[OFFLINE_REGRESS_TILES], (double)golden.Tiles[i],
+                                      (double)result.Tiles[i]))
+        {
+            (*pTileFailed)[i] = 1;
+            tileFailures++;
+            if (delta > worstDelta)
+            {
+                worst      = i;
+                worstDelta = delta;
+            }
+        }
+    }
+
+    if (tileFailures)
+    {
+        char line[256];
+        sprintf(line, "tiles: %u of %u out, worst at (%u, %u): %llu golden, %llu now", tileFailures,
+                (uint32_t)result.Tiles.size(), worst%result.TilesX, worst/result.TilesX,
+                (unsigned long long)golden.Tiles[worst], (unsigned long long)result.Tiles[worst]);
+        pFailures->push_back(line);
+    }
+
+    return failures + tileFailures;
+}
+
+
+//--------------------------------------------------------------------------------------
+void OfflineDrawRegressDelta(const OfflineRegressResult& golden, const OfflineRegressResult& result,
+                             const std::vector<uint8_t>& tileFailed, OfflineImage* pHeatmap)
+{
+    const bool     bSameGrid = golden.TilesX == result.TilesX && golden.TilesY == result.TilesY;
+    const uint32_t tilePixels = 2*COfflineTilePyramid::GetTileSize(OFFLINE_REGRESS_TILE_LEVEL);
+
+    double maxDelta = 1.0;
+    for (size_t i = 0; bSameGrid && i < result.Tiles.size(); i++)
+    {
+        if (tileFailed[i])
+            maxDelta = std::max(maxDelta, fabs((double)result.Tiles[i] - (double)golden.Tiles[i]));
+    }
+
+    for (uint32_t y = 0; y < pHeatmap->Height; y++)
+    {
+        uint8_t* pRow = pHeatmap->GetRow(y);
+        for (uint32_t x = 0; x < pHeatmap->Width; x++, pRow += 4)
+        {
+            uint32_t tile  = std::min(y/tilePixels, result.TilesY - 1)*result.TilesX +
+                             std::min(x/tilePixels, result.TilesX - 1);
+            uint8_t  grey  = (uint8_t)((pRow[0] + pRow[1] + pRow[2])/9);
+            pRow[0] = pRow[1] = pRow[2] = grey;
+            if (!tileFailed[tile])
+                continue;
+
+            double delta = bSameGrid ? (double)result.Tiles[tile] - (double)golden.Tiles[tile] : maxDelta;
+            uint8_t tint = (uint8_t)(96.0 + 159.0*fabs(delta)/maxDelta);
+            pRow[delta > 0.0 ? 0 : 2] = tint;
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+void OfflineSetDefaultTolerances(OfflineGolden* pGolden)
+{
+    // Totals barely move between correct ports, where tiles feel every rounding change
+    // along an edge
+    static const OfflineTolerance defaults[OFFLINE_NB_REGRESS_STATS] =
+    {
+        { 0.001, 0.0  },
+        { 0.001, 0.0  },
+        { 0.002, 4.0  },
+        { 0.02,  16.0 }
+    };
+    memcpy(pGolden->Tolerances, defaults, sizeof(defaults));
+}
+
+
+//--------------------------------------------------------------------------------------
+bool OfflineLoadGolden(const char* fileName, OfflineGolden* pGolden)
+{
+    pGolden->Width       = 0;
+    pGolden->Height      = 0;
+    pGolden->DepthFormat = OFFLINE_DEPTH_FORMAT_D24_UNORM;
+    pGolden->Triangles   = 0;
+    pGolden->Vertices    = 0;
+    pGolden->Results.clear();
+    OfflineSetDefaultTolerances(pGolden);
+
+    FILE* pFile = fopen(fileName, "rt");
+    if (!pFile)
+        return false;
+
+    OfflineRegressResult* pResult = NULL;
+    char keyword[64], name[64];
+    bool ok = true;
+    while (ok && fscanf(pFile, " %63s", keyword) == 1)
+    {
+        if (keyword[0] == '#')
+        {
+            char line[256];
+            if (!fgets(line, sizeof(line), pFile))
+                break;
+        }
+        else if (strcmp(keyword, "size") == 0)
+            ok = fscanf(pFile, "%u %u", &pGolden->Width, &pGolden->Height) == 2;
+        else if (strcmp(keyword, "depth") == 0)
+        {
+            ok = fscanf(pFile, " %63s", name) == 1 && (strcmp(name, "d24") == 0 || strcmp(name, "d32") == 0);
+            pGolden->DepthFormat = strcmp(name, "d32") == 0 ? OFFLINE_DEPTH_FORMAT_D32_FLOAT :
+                                                               OFFLINE_DEPTH_FORMAT_D24_UNORM;
+        }
+        else if (strcmp(keyword, "mesh") == 0)
+            ok = fscanf(pFile, "%u %u", &pGolden->Triangles, &pGolden->Vertices) == 2;
+        else if (strcmp(keyword, "tolerance") == 0)
+        {
+            OfflineTolerance tolerance;
+            ok = fscanf(pFile, " %63s %lf %lf", name, &tolerance.Relative, &tolerance.Absolute) == 3;
+
+            int stat = 0;
+            while (stat < OFFLINE_NB_REGRESS_STATS && strcmp(name, OfflineGetRegressStatName((OFFLINE_REGRESS_STAT)stat)))
+                stat++;
+            ok = ok && stat < OFFLINE_NB_REGRESS_STATS;
+            if (ok)
+                pGolden->Tolerances[stat] = tolerance;
+        }
+        else if (strcmp(keyword, "pose") == 0)
+        {
+            ok = fscanf(pFile, " %63s", name) == 1;
+
+            OfflineRegressResult result;
+            memset(result.Quads, 0, sizeof(result.Quads));
+            memset(result.Slices, 0, sizeof(result.Slices));
+            memset(result.LiveStats, 0, sizeof(result.LiveStats));
+            result.Pose   = name;
+            result.TilesX = 0;
+            result.TilesY = 0;
+            pGolden->Results.push_back(result);
+            pResult = &pGolden->Results.back();
+        }
+        else if (strcmp(keyword, "method") == 0 && pResult)
+        {
+            ok = fscanf(pFile, " %63s", name) == 1;
+
+            int m = 0;
+            while (m < OFFLINE_NB_METHODS && strcmp(name, OfflineGetMethodName((OFFLINE_METHOD)m)))
+                m++;
+            ok = ok && m < OFFLINE_NB_METHODS;
+
+            unsigned long long values[1 + OFFLINE_NB_SLICES];
+            uint32_t live[OFFLINE_NB_SLICES];
+            ok = ok && fscanf(pFile, "%llu %llu %llu %llu %llu %u %u %u %u", &values[0], &values[1], &values[2],
+                              &values[3], &values[4], &live[0], &live[1], &live[2], &live[3]) == 9;
+            if (ok)
+            {
+                pResult->Quads[m] = values[0];
+                for (uint32_t s = 0; s < OFFLINE_NB_SLICES; s++)
+                {
+                    pResult->Slices[m][s]    = values[1 + s];
+                    pResult->LiveStats[m][s] = live[s];
+                }
+            }
+        }
+        else if (strcmp(keyword, "tiles") == 0 && pResult)
+        {
+            ok = fscanf(pFile, "%u %u", &pResult->TilesX, &pResult->TilesY) == 2 &&
+                 pResult->TilesX*pResult->TilesY <= (1u << 20);
+            if (ok)
+                pResult->Tiles.resize((size_t)pResult->TilesX*pResult->TilesY);
+            for (size_t i = 0; ok && i < pResult->Tiles.size(); i++)
+            {
+                unsigned long long sum;
+                ok = fscanf(pFile, "%llu", &sum) == 1;
+                pResult->Tiles[i] = sum;
+            }
+        }
+        else
+            ok = false;
+    }
+    fclose(pFile);
+
+    return ok && pGolden->Width && pGolden->Height && !pGolden->Results.empty();
+}
+
+
+//--------------------------------------------------------------------------------------
+bool OfflineSaveGolden(const char* fileName, const OfflineGolden& golden)
+{
+    FILE* pFile = fopen(fileName, "wt");
+    if (!pFile)
+        return false;
+
+    fprintf(pFile, "# Golden overshading statistics, checked by -offline -regress and written by -regress-update\n");
+    fprintf(pFile, "size %u %u\n", golden.Width, golden.Height);
+    fprintf(pFile, "depth %s\n", golden.DepthFormat == OFFLINE_DEPTH_FORMAT_D32_FLOAT ? "d32" : "d24");
+    fprintf(pFile, "mesh %u %u\n", golden.Triangles, golden.Vertices);
+    for (int stat = 0; stat < OFFLINE_NB_REGRESS_STATS; stat++)
+    {
+        fprintf(pFile, "tolerance %-6s %g %g\n", OfflineGetRegressStatName((OFFLINE_REGRESS_STAT)stat),
+                golden.Tolerances[stat].Relative, golden.Tolerances[stat].Absolute);
+    }
+
+    for (size_t r = 0; r < golden.Results.size(); r++)
+    {
+        const OfflineRegressResult& result = golden.Results[r];
+        fprintf(pFile, "\npose %s\n", result.Pose.c_str());
+        for (uint32_t m = 0; m < OFFLINE_NB_METHODS; m++)
+        {
+            fprintf(pFile, "method %s %llu  %llu %llu %llu %llu  %u %u %u %u\n", OfflineGetMethodName((OFFLINE_METHOD)m),
+                    (unsigned long long)result.Quads[m], (unsigned long long)result.Slices[m][0],
+                    (unsigned long long)result.Slices[m][1], (unsigned long long)result.Slices[m][2],
+                    (unsigned long long)result.Slices[m][3], result.LiveStats[m][0], result.LiveStats[m][1],
+                    result.LiveStats[m][2], result.LiveStats[m][3]);
+        }
+
+        fprintf(pFile, "tiles %u %u\n", result.TilesX, result.TilesY);
+        for (uint32_t y = 0; y < result.TilesY; y++)
+        {
+            for (uint32_t x = 0; x < result.TilesX; x++)
+                fprintf(pFile, x ? " %llu" : "%llu", (unsigned long long)result.Tiles[(size_t)y*result.TilesX + x]);
+            fprintf(pFile, "\n");
+        }
+    }
+
+    return fclose(pFile) == 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+const OfflineRegressResult* OfflineFindRegressResult(const OfflineGolden& golden, const char* pose)
+{
+    for (size_t r = 0; r < golden.Results.size(); r++)
+    {
+        if (golden.Results[r].Pose == pose)
+            return &golden.Results[r];
+    }
+    return NULL;
+}
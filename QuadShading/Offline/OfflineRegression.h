@@ -0,0 +1,119 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineRegression.h
+//
+// Golden statistics for the offline overshading engine. A fixed set of poses around
+// the mesh is shaded through all four methods, and each pose's quad totals, slice
+// totals and liveStats, with the reference method's overdraw summed over 32x32 quad
+// tiles, are checked against values kept in a text file. The file also holds the
+// tolerances, so loosening one is a reviewed change like any other:
+//
+//   size <width> <height>
+//   depth d24|d32
+//   mesh <triangles> <vertices>
+//   tolerance <quads|slices|live|tiles> <relative> <absolute>
+//   pose <name>
+//   method <name> <quads> <slice totals x4> <liveStats x4>     once per method
+//   tiles <x> <y> <sum>...                                     x by y, row by row
+//
+// A value passes if it is within either tolerance of its golden value. Tiles that fail
+// are drawn over the pose's heatmap, so a regression shows where it happened.
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef OFFLINE_REGRESSION_H
+#define OFFLINE_REGRESSION_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "OfflineImage.h"
+#include "OfflineMath.h"
+#include "OfflineMethods.h"
+
+#define OFFLINE_REGRESS_TILE_LEVEL  1       // 32x32 quad tiles
+
+enum OFFLINE_REGRESS_STAT
+{
+    OFFLINE_REGRESS_QUADS,
+    OFFLINE_REGRESS_SLICES,
+    OFFLINE_REGRESS_LIVE,
+    OFFLINE_REGRESS_TILES,
+    OFFLINE_NB_REGRESS_STATS
+};
+
+const char* OfflineGetRegressStatName(OFFLINE_REGRESS_STAT stat);
+
+struct OfflineTolerance
+{
+    double Relative;
+    double Absolute;
+};
+
+bool OfflineIsWithinTolerance(const OfflineTolerance& tolerance, double golden, double value);
+
+
+//--------------------------------------------------------------------------------------
+// The poses, as turns and distances from the demo's start-up view
+//--------------------------------------------------------------------------------------
+struct OfflineRegressPose
+{
+    const char*         Name;
+    float               Yaw;            // degrees about the target, from the front
+    float               Pitch;          // degrees above the target
+    float               Distance;       // times the start-up view's
+};
+
+uint32_t OfflineGetNumRegressPoses();
+const OfflineRegressPose& OfflineGetRegressPose(uint32_t pose);
+void OfflineGetRegressCamera(uint32_t pose, const OfflineCamera& start, OfflineCamera* pCamera);
+
+
+//--------------------------------------------------------------------------------------
+// What is checked for one pose
+//--------------------------------------------------------------------------------------
+struct OfflineRegressResult
+{
+    std::string             Pose;
+    uint64_t                Quads[OFFLINE_NB_METHODS];
+    uint64_t                Slices[OFFLINE_NB_METHODS][OFFLINE_NB_SLICES];
+    uint32_t                LiveStats[OFFLINE_NB_METHODS][OFFLINE_NB_SLICES];
+    uint32_t                TilesX;
+    uint32_t                TilesY;
+    std::vector<uint64_t>   Tiles;      // the reference method's
+};
+
+void OfflineCaptureRegressResult(const COfflineMethods& methods, OfflineRegressResult* pResult);
+
+// One line per value out of tolerance; the failed tiles are flagged in pTileFailed
+uint32_t OfflineCompareRegressResults(const OfflineRegressResult& golden, const OfflineRegressResult& result,
+                                      const OfflineTolerance tolerances[OFFLINE_NB_REGRESS_STATS],
+                                      std::vector<std::string>* pFailures, std::vector<uint8_t>* pTileFailed);
+
+// The heatmap, greyed out, with each failed tile tinted red where the count went up and
+// blue where it went down, the stronger the further out
+void OfflineDrawRegressDelta(const OfflineRegressResult& golden, const OfflineRegressResult& result,
+                             const std::vector<uint8_t>& tileFailed, OfflineImage* pHeatmap);
+
+
+//--------------------------------------------------------------------------------------
+// The golden file
+//--------------------------------------------------------------------------------------
+struct OfflineGolden
+{
+    uint32_t            Width;
+    uint32_t            Height;
+    OFFLINE_DEPTH_FORMAT DepthFormat;
+    uint32_t            Triangles;
+    uint32_t            Vertices;
+    OfflineTolerance    Tolerances[OFFLINE_NB_REGRESS_STATS];
+    std::vector<OfflineRegressResult> Results;
+};
+
+void OfflineSetDefaultTolerances(OfflineGolden* pGolden);
+bool OfflineLoadGolden(const char* fileName, OfflineGolden* pGolden);
+bool OfflineSaveGolden(const char* fileName, const OfflineGolden& golden);
+const OfflineRegressResult* OfflineFindRegressResult(const OfflineGolden& golden, const char* pose);
+
+#endif
@@ -0,0 +1,152 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineRun.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+#include "OfflineRun.h"
+
+#include <stdio.h>
+#include <string>
+
+
+//--------------------------------------------------------------------------------------
+// As InitDevice: look at the centre of the first mesh's bounds from 16 units in front,
+// with g_Projection's field of view and clip planes
+//--------------------------------------------------------------------------------------
+OfflineCamera OfflineGetDefaultCamera(const COfflineMesh& mesh)
+{
+    OfflineCamera camera;
+    camera.at    = mesh.GetNumMeshes() ? mesh.GetMeshBBoxCenter(0) : MakeVec3(0, 0, 0);
+    camera.eye   = Subtract(camera.at, MakeVec3(0, 0, 16.0f));
+    camera.up    = MakeVec3(0, 1, 0);
+    camera.fovY  = 3.141592654f/4;
+    camera.zNear = 0.01f;
+    camera.zFar  = 5000.0f;
+    return camera;
+}
+
+Mat4 OfflineGetViewProjection(const OfflineCamera& camera, uint32_t width, uint32_t height)
+{
+    Mat4 view = MatrixLookAtLH(camera.eye, camera.at, camera.up);
+    Mat4 proj = MatrixPerspectiveFovLH(camera.fovY, (float)width/(float)height, camera.zNear, camera.zFar);
+    return MatrixMultiply(view, proj);
+}
+
+
+//--------------------------------------------------------------------------------------
+// The -camera-path keys stepped at -fps, or the default view orbiting the mesh once
+// over -path-frames. NULL if the keys can't be read.
+//--------------------------------------------------------------------------------------
+const IOfflineCameraPath* OfflineGetCameraPath(const OfflineOptions& options, const COfflineMesh& mesh,
+                                               COfflineOrbitPath* pOrbit, COfflineKeyframePath* pKeyframes)
+{
+    if (!options.cameraPathFile)
+    {
+        pOrbit->Setup(OfflineGetDefaultCamera(mesh), options.pathFrames, options.pathFrames);
+        return pOrbit;
+    }
+
+    pKeyframes->Setup(OfflineGetDefaultCamera(mesh), options.fps);
+    if (!pKeyframes->Load(options.cameraPathFile))
+    {
+        fprintf(stderr, "Failed to read camera keys from %s\n", options.cameraPathFile);
+        return NULL;
+    }
+    return pKeyframes;
+}
+
+
+//--------------------------------------------------------------------------------------
+const char* OfflineGetDepthFormatName(OFFLINE_DEPTH_FORMAT format)
+{
+    return format == OFFLINE_DEPTH_FORMAT_D24_UNORM ? "D24_UNORM" : "D32_FLOAT";
+}
+
+
+//--------------------------------------------------------------------------------------
+void OfflineWriteJSONString(FILE* pFile, const char* str)
+{
+    fputc('"', pFile);
+    for (; *str; str++)
+    {
+        unsigned char c = (unsigned char)*str;
+        if (c == '"' || c == '\\')
+            fprintf(pFile, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(pFile, "\\u%04x", c);
+        else
+            fputc(c, pFile);
+    }
+    fputc('"', pFile);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Binary greyscale image, one byte per quad
+//--------------------------------------------------------------------------------------
+bool OfflineWritePGM(const std::string& fileName, const uint8_t* pPixels, uint32_t width, uint32_t height,
+                     uint32_t maxValue)
+{
+    FILE* pFile = fopen(fileName.c_str(), "wb");
+    if (!pFile)
+        return false;
+
+    fprintf(pFile, "P5\n%u %u\n%u\n", width, height, maxValue);
+    bool ok = fwrite(pPixels, 1, (size_t)width*height, pFile) == (size_t)width*height;
+    fclose(pFile);
+    return ok;
+}
+
+
+//--------------------------------------------------------------------------------------
+void OfflinePrintFrameStats(const char* label, const CDXUTFrameStats& stats)
+{
+    DXUTFrameStatsSummary summary;
+    stats.GetSummary(0, &summary);
+    printf("%s: min %.2f, p50 %.2f, p95 %.2f, p99 %.2f, max %.2f ms over %llu frames\n", label, summary.fMinMs,
+           summary.fP50Ms, summary.fP95Ms, summary.fP99Ms, summary.fMaxMs, (unsigned long long)summary.Count);
+}
+
+
+//--------------------------------------------------------------------------------------
+bool OfflineWriteFrameStats(const std::string& baseName, const CDXUTFrameStats& stats)
+{
+    FILE* pFile = fopen((baseName + "_frametimes.csv").c_str(), "wt");
+    if (!pFile)
+        return false;
+    bool ok = stats.WriteCSV(pFile);
+    ok = fclose(pFile) == 0 && ok;
+
+    pFile = fopen((baseName + "_frametimes.json").c_str(), "wt");
+    if (!pFile)
+        return false;
+    ok = stats.WriteJSON(pFile) && ok;
+    return fclose(pFile) == 0 && ok;
+}
+
+
+//--------------------------------------------------------------------------------------
+// The triangles are set up once, the depth pre-pass fills the depth buffer, and the
+// shading pass hands every quad to the sink
+//--------------------------------------------------------------------------------------
+void OfflineRunShadingPass(const OfflineOptions& options, const COfflineMesh& mesh, const Mat4& viewProj,
+                           COfflineRasterizer* pRasterizer, IOfflineQuadSink* pSink)
+{
+    pRasterizer->SetViewport(options.width, options.height);
+    pRasterizer->SetupMesh(mesh, viewProj, 0);
+
+    COfflineDepthBuffer depth;
+    depth.Resize(options.width, options.height, options.depthFormat);
+    depth.Clear(1.0f);
+    pRasterizer->Rasterize(&depth, OFFLINE_DEPTH_PREPASS, NULL);
+    pRasterizer->Rasterize(&depth, OFFLINE_DEPTH_EARLY_TEST, pSink);
+}
+
+void OfflineRunShadingPass(const OfflineOptions& options, const COfflineMesh& mesh, COfflineRasterizer* pRasterizer,
+                           IOfflineQuadSink* pSink)
+{
+    OfflineCamera camera = OfflineGetDefaultCamera(mesh);
+    OfflineRunShadingPass(options, mesh, OfflineGetViewProjection(camera, options.width, options.height), pRasterizer,
+                          pSink);
+}
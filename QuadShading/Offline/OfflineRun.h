@@ -0,0 +1,183 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineRun.h
+//
+// What the modes of the command-line driver share. OfflineAnalysis.cpp parses the
+// options and picks a mode; each mode and the files it writes live in their own
+// OfflineRun<Mode>.cpp.
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef OFFLINE_RUN_H
+#define OFFLINE_RUN_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+
+#include "OfflineCameraPath.h"
+#include "OfflineImage.h"
+#include "OfflineInstances.h"
+#include "OfflineMath.h"
+#include "OfflineMesh.h"
+#include "OfflineRaster.h"
+#include "OfflineVideo.h"
+#include "DXUTframestats.h"
+
+
+//--------------------------------------------------------------------------------------
+// Options
+//--------------------------------------------------------------------------------------
+enum OFFLINE_RUN_MODE
+{
+    OFFLINE_RUN_METHODS,        // compare the four methods
+    OFFLINE_RUN_STRESS,         // replay the shading pass through ScenePS1's lock on many threads
+    OFFLINE_RUN_PREPASS,        // depth pre-pass on and off
+    OFFLINE_RUN_HIZ,            // Hi-Z culling of subsets and clusters
+    OFFLINE_RUN_CULL,           // the triangle culling stage ahead of setup
+    OFFLINE_RUN_CACHE,          // the resource cache's key lookup
+    OFFLINE_RUN_VISBUFFER,      // quad metrics from a visibility buffer
+    OFFLINE_RUN_VRS,            // variable-rate shading savings
+    OFFLINE_RUN_MERGE,          // quad-fragment merging
+    OFFLINE_RUN_JITTER,         // TAA subpixel jitter sweep
+    OFFLINE_RUN_MULTIVIEW,      // several views from one traversal
+    OFFLINE_RUN_COMPOSITE,      // the visualisation pass, as images
+    OFFLINE_RUN_VIDEO,          // heatmap video of a camera path
+    OFFLINE_RUN_TILES,          // tile statistics pyramid
+    OFFLINE_RUN_SIZES,          // liveness by triangle area and shape
+    OFFLINE_RUN_ACCUMULATE,     // overdraw averaged over a camera path
+    OFFLINE_RUN_INSTANCES,      // many copies of the mesh
+    OFFLINE_RUN_SCENE,          // a scene file of several meshes
+    OFFLINE_RUN_REGRESS         // golden statistics
+};
+
+struct OfflineOptions
+{
+    OFFLINE_RUN_MODE mode;
+    const char* meshFile;
+    const char* outputPrefix;
+    const char* traceFile;
+    uint32_t    width;
+    uint32_t    height;
+    OFFLINE_DEPTH_FORMAT depthFormat;
+
+    // -stress
+    uint32_t    threads;
+    uint32_t    runs;
+    const char* recordFile;
+    const char* replayFile;
+
+    // -prepass and -visbuffer
+    double      quadCost;
+
+    // -visbuffer
+    const char* visFile;
+    double      fetchCost;
+
+    // -vrs
+    uint32_t    vrsTile;
+    const char* vrsRatesFile;
+
+    // -merge
+    uint32_t    mergeWindow;
+
+    // -jitter
+    uint32_t    jitterCount;
+    uint32_t    jitterRegion;
+
+    // -multiview
+    uint32_t    viewSets;       // OFFLINE_VIEWS_*
+    uint32_t    cascades;
+    uint32_t    viewSize;
+    float       ipd;
+
+    // -composite
+    OFFLINE_IMAGE_FORMAT imageFormat;
+    uint32_t    frames;
+
+    // -video
+    const char* videoFile;
+    OFFLINE_VIDEO_FORMAT videoFormat;
+    uint32_t    pathFrames;
+    uint32_t    fps;
+    const char* cameraPathFile;
+
+    // -tiles
+    double      tileBudget;
+
+    // -accumulate
+    float       emaAlpha;
+
+    // -instances
+    uint32_t    instances;
+    OFFLINE_INSTANCE_LAYOUT instanceLayout;
+    const char* instanceFile;
+
+    // -scene
+    const char* sceneFile;
+
+    // -regress
+    const char* goldenFile;
+    bool        bUpdateGolden;
+};
+
+
+
+//--------------------------------------------------------------------------------------
+// Helpers
+//--------------------------------------------------------------------------------------
+
+// As InitDevice: look at the centre of the first mesh's bounds from 16 units in front,
+// with g_Projection's field of view and clip planes
+OfflineCamera OfflineGetDefaultCamera(const COfflineMesh& mesh);
+Mat4 OfflineGetViewProjection(const OfflineCamera& camera, uint32_t width, uint32_t height);
+
+// The -camera-path keys stepped at -fps, or the default view orbiting the mesh once
+// over -path-frames. NULL if the keys can't be read.
+const IOfflineCameraPath* OfflineGetCameraPath(const OfflineOptions& options, const COfflineMesh& mesh,
+                                               COfflineOrbitPath* pOrbit, COfflineKeyframePath* pKeyframes);
+
+const char* OfflineGetDepthFormatName(OFFLINE_DEPTH_FORMAT format);
+void OfflineWriteJSONString(FILE* pFile, const char* str);
+
+// Binary greyscale image, one byte per quad
+bool OfflineWritePGM(const std::string& fileName, const uint8_t* pPixels, uint32_t width, uint32_t height,
+                     uint32_t maxValue);
+
+// A frame-time distribution over every frame of a batch loop: one line of percentiles,
+// and <baseName>_frametimes.csv and .json as the demo writes them
+void OfflinePrintFrameStats(const char* label, const CDXUTFrameStats& stats);
+bool OfflineWriteFrameStats(const std::string& baseName, const CDXUTFrameStats& stats);
+
+// The triangles are set up once, the depth pre-pass fills the depth buffer, and the
+// shading pass hands every quad to the sink. Without a viewProj, from the default camera.
+void OfflineRunShadingPass(const OfflineOptions& options, const COfflineMesh& mesh, const Mat4& viewProj,
+                           COfflineRasterizer* pRasterizer, IOfflineQuadSink* pSink);
+void OfflineRunShadingPass(const OfflineOptions& options, const COfflineMesh& mesh, COfflineRasterizer* pRasterizer,
+                           IOfflineQuadSink* pSink);
+
+
+//--------------------------------------------------------------------------------------
+// Modes, each returning the process exit code
+//--------------------------------------------------------------------------------------
+int OfflineRunMethods(const OfflineOptions& options, const COfflineMesh& mesh);
+int OfflineRunStress(const OfflineOptions& options, const COfflineMesh& mesh);
+int OfflineRunPrepass(const OfflineOptions& options, const COfflineMesh& mesh);
+int OfflineRunHiZ(const OfflineOptions& options, const COfflineMesh& mesh);
+int OfflineRunCull(const OfflineOptions& options, const COfflineMesh& mesh);
+int OfflineRunCache(const OfflineOptions& options);
+int OfflineRunVisBuffer(const OfflineOptions& options, const COfflineMesh& mesh);
+int OfflineRunVRS(const OfflineOptions& options, const COfflineMesh& mesh);
+int OfflineRunMerge(const OfflineOptions& options, const COfflineMesh& mesh);
+int OfflineRunJitter(const OfflineOptions& options, const COfflineMesh& mesh);
+int OfflineRunMultiView(const OfflineOptions& options, const COfflineMesh& mesh);
+int OfflineRunComposite(const OfflineOptions& options, const COfflineMesh& mesh);
+int OfflineRunVideo(const OfflineOptions& options, const COfflineMesh& mesh);
+int OfflineRunTiles(const OfflineOptions& options, const COfflineMesh& mesh);
+int OfflineRunSizes(const OfflineOptions& options, const COfflineMesh& mesh);
+int OfflineRunAccumulate(const OfflineOptions& options, const COfflineMesh& mesh);
+int OfflineRunInstances(const OfflineOptions& options, const COfflineMesh& mesh);
+int OfflineRunScene(const OfflineOptions& options);
+int OfflineRunRegress(const OfflineOptions& options, const COfflineMesh& mesh);
+
+#endif
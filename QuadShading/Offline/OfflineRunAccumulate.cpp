@@ -0,0 +1,115 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineRunAccumulate.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+#include "OfflineRun.h"
+#include "OfflineAccumulator.h"
+#include "OfflineCompositor.h"
+#include "OfflineMethods.h"
+#include "OfflineMultiView.h"
+#include "DXUTframestats.h"
+
+#include <stdio.h>
+#include <string>
+
+
+//--------------------------------------------------------------------------------------
+// The camera path, as -video shoots it, folded into running statistics. Each frame's
+// totals are written as they come, and the mean, moving average and maximum heatmaps
+// and the distribution of frame times at the end.
+//--------------------------------------------------------------------------------------
+int OfflineRunAccumulate(const OfflineOptions& options, const COfflineMesh& mesh)
+{
+    COfflineOrbitPath orbit;
+    COfflineKeyframePath keyframes;
+    const IOfflineCameraPath* pPath = OfflineGetCameraPath(options, mesh, &orbit, &keyframes);
+    if (!pPath)
+        return 1;
+
+    const uint32_t gridWidth  = OfflineGetQuadGridSize(options.width);
+    const uint32_t gridHeight = OfflineGetQuadGridSize(options.height);
+
+    COfflineAccumulator accumulator;
+    accumulator.Resize(gridWidth, gridHeight, options.emaAlpha);
+
+    std::string prefix = options.outputPrefix;
+    FILE* pCSV = fopen((prefix + "_accum.csv").c_str(), "wt");
+    if (!pCSV)
+    {
+        fprintf(stderr, "Failed to write %s_accum.csv\n", options.outputPrefix);
+        return 1;
+    }
+    fprintf(pCSV, "frame,quads,live1,live2,live3,live4,efficiency\n");
+
+    COfflineRasterizer rasterizer;
+    COfflineViewOverdraw overdraw;
+    CDXUTFrameStats frameTimes;
+    uint64_t shadeNs = 0, accumulateNs = 0;
+    for (uint32_t frame = 0; frame < pPath->GetNumFrames(); frame++)
+    {
+        OfflineCamera camera;
+        pPath->GetCamera(frame, &camera);
+
+        uint64_t start = DXUTGetHighResTimeNs();
+        rasterizer.Reset();
+        overdraw.Resize(gridWidth, gridHeight);
+        OfflineRunShadingPass(options, mesh, OfflineGetViewProjection(camera, options.width, options.height),
+                              &rasterizer, &overdraw);
+        uint64_t shaded = DXUTGetHighResTimeNs();
+        OfflineLiveTotals totals = accumulator.Accumulate(overdraw.GetOverdraw(), false);
+        uint64_t end = DXUTGetHighResTimeNs();
+        shadeNs      += shaded - start;
+        accumulateNs += end - shaded;
+        frameTimes.AddSample(end - start);
+
+        fprintf(pCSV, "%u,%llu,%llu,%llu,%llu,%llu,%.6f\n", frame, (unsigned long long)totals.Quads,
+                (unsigned long long)totals.LiveStats[0], (unsigned long long)totals.LiveStats[1],
+                (unsigned long long)totals.LiveStats[2], (unsigned long long)totals.LiveStats[3],
+                OfflineGetEfficiency(totals));
+    }
+    bool ok = fclose(pCSV) == 0;
+
+    OfflineLiveTotals summaries[3] =
+    {
+        accumulator.GetMeanTotals(), accumulator.GetAverageTotals(), accumulator.GetPeakTotals()
+    };
+    static const char* summaryNames[3] = { "mean", "ema", "peak" };
+
+    printf("%-10s %12s %10s %10s %10s %10s %11s\n", "frames", "quads", "1 live", "2 live", "3 live", "4 live",
+           "efficiency");
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        const OfflineLiveTotals& totals = summaries[i];
+        printf("%-10s %12llu %10llu %10llu %10llu %10llu %10.2f%%\n", summaryNames[i], (unsigned long long)totals.Quads,
+               (unsigned long long)totals.LiveStats[0], (unsigned long long)totals.LiveStats[1],
+               (unsigned long long)totals.LiveStats[2], (unsigned long long)totals.LiveStats[3],
+               100.0*OfflineGetEfficiency(totals));
+    }
+    printf("%u frames: shade %.2f s, accumulate %.3f s; peak at frame %u; %.1f MB of running statistics\n",
+           accumulator.GetNumFrames(), shadeNs*1e-9, accumulateNs*1e-9, accumulator.GetPeakFrame(),
+           accumulator.GetMemoryUsed()/(1024.0*1024.0));
+    OfflinePrintFrameStats("frame times", frameTimes);
+    ok = ok && OfflineWriteFrameStats(prefix + "_accum", frameTimes);
+
+    const char* ext = OfflineGetImageFormatName(options.imageFormat);
+    COfflineOverdraw resolved;
+    OfflineImage image;
+    for (int s = 0; s < OFFLINE_NB_ACCUM_STATS && ok; s++)
+    {
+        accumulator.Resolve((OFFLINE_ACCUM_STAT)s, &resolved);
+        OfflineComposeHeatmap(resolved, false, options.width, options.height, &image);
+
+        std::string fileName = prefix + "_accum_" + OfflineGetAccumStatName((OFFLINE_ACCUM_STAT)s) + "." + ext;
+        ok = OfflineWriteImage(fileName.c_str(), image, options.imageFormat);
+    }
+
+    if (!ok)
+    {
+        fprintf(stderr, "Failed to write %s_accum*\n", options.outputPrefix);
+        return 1;
+    }
+
+    return 0;
+}
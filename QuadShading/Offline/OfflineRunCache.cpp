@@ -0,0 +1,134 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineRunCache.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+#include "OfflineRun.h"
+#include "DXUTcacheindex.h"
+#include "DXUTframestats.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+
+#define OFFLINE_CACHE_BENCH_NAMES   10000
+
+
+//--------------------------------------------------------------------------------------
+// The resource cache's key lookup without a device: generated texture names found
+// through CDXUTCacheIndex and the cache's path hashing, against the linear scan of
+// every entry the cache used to make. Each name is looked up under another spelling
+// of its path, which both must still find.
+//--------------------------------------------------------------------------------------
+struct OfflineCacheKey
+{
+    std::wstring Source;
+    uint32_t     Format;
+};
+
+static uint32_t HashCacheKey(const wchar_t* pSource, uint32_t format)
+{
+    return DXUTHashValue(DXUTHashPath(DXUT_HASH_BASIS, pSource), format);
+}
+
+static int FindCacheKeyIndexed(const std::vector<OfflineCacheKey>& keys, const CDXUTCacheIndex& index,
+                               const OfflineCacheKey& key, uint32_t* pProbes)
+{
+    uint32_t hash = HashCacheKey(key.Source.c_str(), key.Format);
+    int slot;
+    for (int i = index.FirstMatch(hash, &slot); i >= 0; i = index.NextMatch(hash, &slot))
+    {
+        (*pProbes)++;
+        if (keys[i].Format == key.Format && DXUTPathsEqual(keys[i].Source.c_str(), key.Source.c_str()))
+            return i;
+    }
+    return -1;
+}
+
+static int FindCacheKeyLinear(const std::vector<OfflineCacheKey>& keys, const OfflineCacheKey& key)
+{
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        if (keys[i].Format == key.Format && DXUTPathsEqual(keys[i].Source.c_str(), key.Source.c_str()))
+            return (int)i;
+    }
+    return -1;
+}
+
+static std::wstring WidenASCII(const char* str)
+{
+    return std::wstring(str, str + strlen(str));
+}
+
+int OfflineRunCache(const OfflineOptions& options)
+{
+    static const char* maps[3] = { "diffuse", "normal", "specular" };
+
+    // As a material library would name them, and the spelling a scene might ask for
+    std::vector<OfflineCacheKey> keys(OFFLINE_CACHE_BENCH_NAMES), lookups(OFFLINE_CACHE_BENCH_NAMES);
+    for (uint32_t i = 0; i < OFFLINE_CACHE_BENCH_NAMES; i++)
+    {
+        char name[128];
+        sprintf(name, "Media\\Materials\\Set%02u\\material%04u_%s.dds", i/300, i/3, maps[i%3]);
+        keys[i].Source = WidenASCII(name);
+        keys[i].Format = i%3;
+
+        sprintf(name, "./Media/Materials/Set%02u/material%04u_%s.dds", i/300, i/3, maps[i%3]);
+        lookups[i].Source = WidenASCII(name);
+        lookups[i].Format = i%3;
+    }
+
+    uint64_t start = DXUTGetHighResTimeNs();
+    CDXUTCacheIndex index;
+    for (uint32_t i = 0; i < OFFLINE_CACHE_BENCH_NAMES; i++)
+        index.Insert(HashCacheKey(keys[i].Source.c_str(), keys[i].Format), (int)i);
+    uint64_t insertNs = DXUTGetHighResTimeNs() - start;
+
+    // Best of a few runs each
+    std::vector<int> indexed(OFFLINE_CACHE_BENCH_NAMES), linear(OFFLINE_CACHE_BENCH_NAMES);
+    uint64_t indexedNs = ~0ull, linearNs = ~0ull;
+    uint32_t probes = 0;
+    for (uint32_t run = 0; run < options.runs; run++)
+    {
+        probes = 0;
+        start = DXUTGetHighResTimeNs();
+        for (uint32_t i = 0; i < OFFLINE_CACHE_BENCH_NAMES; i++)
+            indexed[i] = FindCacheKeyIndexed(keys, index, lookups[i], &probes);
+        indexedNs = std::min(indexedNs, DXUTGetHighResTimeNs() - start);
+
+        start = DXUTGetHighResTimeNs();
+        for (uint32_t i = 0; i < OFFLINE_CACHE_BENCH_NAMES; i++)
+            linear[i] = FindCacheKeyLinear(keys, lookups[i]);
+        linearNs = std::min(linearNs, DXUTGetHighResTimeNs() - start);
+    }
+
+    uint32_t misses = 0;
+    for (uint32_t i = 0; i < OFFLINE_CACHE_BENCH_NAMES; i++)
+        misses += indexed[i] != (int)i || linear[i] != (int)i ? 1 : 0;
+
+    const double perLookup = 1.0/OFFLINE_CACHE_BENCH_NAMES;
+    printf("%u names, indexed in %.3f ms; %.2f candidates per lookup\n", OFFLINE_CACHE_BENCH_NAMES, insertNs*1e-6,
+           probes*perLookup);
+    printf("Lookup: %.1f ns indexed, %.1f ns linear (%.1fx), %u misses\n", indexedNs*perLookup, linearNs*perLookup,
+           indexedNs ? (double)linearNs/(double)indexedNs : 0.0, misses);
+
+    std::string fileName = std::string(options.outputPrefix) + "_cache.json";
+    FILE* pFile = fopen(fileName.c_str(), "wt");
+    if (!pFile)
+    {
+        fprintf(stderr, "Failed to write %s\n", fileName.c_str());
+        return 1;
+    }
+
+    fprintf(pFile, "{\n  \"names\": %u,\n  \"runs\": %u,\n  \"candidatesPerLookup\": %.3f,\n  \"misses\": %u,\n",
+            OFFLINE_CACHE_BENCH_NAMES, options.runs, probes*perLookup, misses);
+    fprintf(pFile, "  \"ms\": { \"insert\": %.3f, \"indexed\": %.3f, \"linear\": %.3f },\n", insertNs*1e-6,
+            indexedNs*1e-6, linearNs*1e-6);
+    fprintf(pFile, "  \"nsPerLookup\": { \"indexed\": %.1f, \"linear\": %.1f }\n}\n", indexedNs*perLookup,
+            linearNs*perLookup);
+    fclose(pFile);
+
+    return misses ? 1 : 0;
+}
@@ -0,0 +1,107 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineRunComposite.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+#include "OfflineRun.h"
+#include "OfflineCompositor.h"
+#include "OfflineJitter.h"
+#include "OfflineMethods.h"
+#include "DXUTframestats.h"
+
+#include <stdio.h>
+#include <string>
+
+
+//--------------------------------------------------------------------------------------
+// The frame VisPS1 or VisPS2 shows for each method, then -frames jittered frames of the
+// reference method handed to writer threads, as a batch run producing heatmaps would
+//--------------------------------------------------------------------------------------
+int OfflineRunComposite(const OfflineOptions& options, const COfflineMesh& mesh)
+{
+    COfflineRasterizer rasterizer;
+    COfflineMethods methods;
+    methods.Resize(OfflineGetQuadGridSize(options.width), OfflineGetQuadGridSize(options.height));
+    OfflineRunShadingPass(options, mesh, &rasterizer, &methods);
+
+    std::string prefix = options.outputPrefix;
+    const char* ext = OfflineGetImageFormatName(options.imageFormat);
+
+    printf("%-10s %10s %10s %12s\n", "method", "compose ms", "write ms", "bytes");
+    OfflineImage image;
+    for (int m = 0; m < OFFLINE_NB_METHODS; m++)
+    {
+        const char* name = OfflineGetMethodName((OFFLINE_METHOD)m);
+
+        uint64_t start = DXUTGetHighResTimeNs();
+        OfflineComposeHeatmap(methods.GetOverdraw((OFFLINE_METHOD)m), m == OFFLINE_METHOD_SLICES, options.width,
+                              options.height, &image);
+        uint64_t composeNs = DXUTGetHighResTimeNs() - start;
+
+        std::string fileName = prefix + "_" + name + "." + ext;
+        start = DXUTGetHighResTimeNs();
+        if (!OfflineWriteImage(fileName.c_str(), image, options.imageFormat))
+        {
+            fprintf(stderr, "Failed to write %s\n", fileName.c_str());
+            return 1;
+        }
+        uint64_t writeNs = DXUTGetHighResTimeNs() - start;
+
+        FILE* pFile = fopen(fileName.c_str(), "rb");
+        long size = 0;
+        if (pFile)
+        {
+            fseek(pFile, 0, SEEK_END);
+            size = ftell(pFile);
+            fclose(pFile);
+        }
+        printf("%-10s %10.3f %10.3f %12ld\n", name, composeNs*1e-6, writeNs*1e-6, size);
+    }
+
+    if (!options.frames)
+        return 0;
+
+    // The writers take each image's pixels, so the queue bounds what is held in memory
+    COfflineImageWriter writer;
+    writer.Start(options.threads, OFFLINE_IMAGE_DEFAULT_QUEUE*options.threads);
+
+    Mat4 viewProj = OfflineGetViewProjection(OfflineGetDefaultCamera(mesh), options.width, options.height);
+    uint64_t shadeNs = 0, composeNs = 0;
+    uint64_t start = DXUTGetHighResTimeNs();
+    for (uint32_t i = 0; i < options.frames; i++)
+    {
+        float x, y;
+        OfflineGetJitterOffset(i, &x, &y);
+
+        uint64_t frameStart = DXUTGetHighResTimeNs();
+        rasterizer.Reset();
+        methods.Clear();
+        OfflineRunShadingPass(options, mesh, OfflineJitterViewProjection(viewProj, x, y, options.width, options.height),
+                              &rasterizer, &methods);
+        uint64_t shaded = DXUTGetHighResTimeNs();
+        OfflineComposeHeatmap(methods.GetOverdraw(OFFLINE_REFERENCE_METHOD),
+                              OFFLINE_REFERENCE_METHOD == OFFLINE_METHOD_SLICES, options.width, options.height, &image);
+        shadeNs   += shaded - frameStart;
+        composeNs += DXUTGetHighResTimeNs() - shaded;
+
+        char suffix[32];
+        sprintf(suffix, "_frame%05u.", i);
+        writer.Submit(prefix + suffix + ext, options.imageFormat, &image);
+    }
+    uint64_t submitNs = DXUTGetHighResTimeNs() - start;
+    uint32_t failures = writer.Finish();
+    uint64_t totalNs  = DXUTGetHighResTimeNs() - start;
+
+    printf("%u frames on %u writer threads: %.1f s (shade %.1f, compose %.1f, submit blocked %.1f, drain %.1f), "
+           "%.1f frames/s, %.1f MB\n", options.frames, options.threads, totalNs*1e-9, shadeNs*1e-9,
+           composeNs*1e-9, (submitNs - shadeNs - composeNs)*1e-9, (totalNs - submitNs)*1e-9,
+           options.frames/(totalNs*1e-9), writer.GetBytesWritten()/(1024.0*1024.0));
+    if (failures)
+    {
+        fprintf(stderr, "Failed to write %u of %u frames\n", failures, options.frames);
+        return 1;
+    }
+
+    return 0;
+}
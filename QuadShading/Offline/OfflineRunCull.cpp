@@ -0,0 +1,128 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineRunCull.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+#include "OfflineRun.h"
+#include "OfflineCull.h"
+#include "DXUTframestats.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <string>
+
+
+//--------------------------------------------------------------------------------------
+// The triangle culling stage on its own: what it rejects, per subset and in all, and
+// the SIMD path against the scalar one, which must agree on every triangle
+//--------------------------------------------------------------------------------------
+int OfflineRunCull(const OfflineOptions& options, const COfflineMesh& mesh)
+{
+    Mat4 viewProj = OfflineGetViewProjection(OfflineGetDefaultCamera(mesh), options.width, options.height);
+
+    std::vector<Vec4> clip(mesh.GetNumVertices());
+    for (uint32_t i = 0; i < mesh.GetNumVertices(); i++)
+        clip[i] = TransformPoint(mesh.GetPositions()[i], viewProj);
+
+    uint64_t start = DXUTGetHighResTimeNs();
+    std::vector<OfflineSnappedVertex> snapped(mesh.GetNumVertices());
+    OfflineSnapVertices(&clip[0], mesh.GetNumVertices(), options.width, options.height, &snapped[0]);
+    uint64_t snapNs = DXUTGetHighResTimeNs() - start;
+
+    // Best of a few runs each, the stage being far quicker than a timer tick
+    const uint32_t nbTriangles = mesh.GetNumTriangles();
+    std::vector<uint8_t> results(nbTriangles), reference(nbTriangles);
+    uint64_t simdNs = ~0ull, scalarNs = ~0ull;
+    for (uint32_t run = 0; run < std::max(options.runs, 1u); run++)
+    {
+        start = DXUTGetHighResTimeNs();
+        OfflineCullTriangles(&snapped[0], mesh.GetIndices(), nbTriangles, options.width, options.height, &results[0]);
+        simdNs = std::min(simdNs, DXUTGetHighResTimeNs() - start);
+
+        start = DXUTGetHighResTimeNs();
+        OfflineCullTrianglesScalar(&snapped[0], mesh.GetIndices(), nbTriangles, options.width, options.height,
+                                   &reference[0]);
+        scalarNs = std::min(scalarNs, DXUTGetHighResTimeNs() - start);
+    }
+
+    uint32_t mismatches = 0;
+    for (uint32_t t = 0; t < nbTriangles; t++)
+        mismatches += results[t] != reference[t] ? 1 : 0;
+
+    // Counts per subset, in the order the demo draws them
+    std::vector<uint32_t> drawCounts((size_t)mesh.GetNumDraws()*OFFLINE_NB_CULL_RESULTS, 0);
+    uint32_t counts[OFFLINE_NB_CULL_RESULTS] = { 0 };
+    for (uint32_t d = 0; d < mesh.GetNumDraws(); d++)
+    {
+        const OfflineDraw& draw = mesh.GetDraw(d);
+        for (uint32_t t = draw.IndexStart/3; t < (draw.IndexStart + draw.IndexCount)/3; t++)
+        {
+            drawCounts[(size_t)d*OFFLINE_NB_CULL_RESULTS + results[t]]++;
+            counts[results[t]]++;
+        }
+    }
+
+    // What setup makes of the same view, once clipping has had its say
+    COfflineRasterizer rasterizer;
+    rasterizer.SetViewport(options.width, options.height);
+    start = DXUTGetHighResTimeNs();
+    rasterizer.SetupMesh(mesh, viewProj, 0);
+    uint64_t setupNs = DXUTGetHighResTimeNs() - start;
+    const OfflineRasterStats& stats = rasterizer.GetStats();
+
+    printf("Triangles: %u, snapped %u vertices in %.3f ms\n", nbTriangles, mesh.GetNumVertices(), snapNs*1e-6);
+    for (int r = 0; r < OFFLINE_NB_CULL_RESULTS; r++)
+    {
+        printf("  %-12s %10u %6.2f%%\n", OfflineGetCullResultName((OFFLINE_CULL_RESULT)r), counts[r],
+               nbTriangles ? 100.0*counts[r]/nbTriangles : 0.0);
+    }
+    printf("Cull stage: %.3f ms SIMD, %.3f ms scalar (%.2fx), %u mismatches\n", simdNs*1e-6, scalarNs*1e-6,
+           simdNs ? (double)scalarNs/(double)simdNs : 0.0, mismatches);
+    printf("Setup: %.3f ms, %llu triangles set up from %llu\n", setupNs*1e-6,
+           (unsigned long long)stats.TrianglesSetUp, (unsigned long long)stats.TrianglesIn);
+
+    std::string fileName = std::string(options.outputPrefix) + "_cull.json";
+    FILE* pFile = fopen(fileName.c_str(), "wt");
+    if (!pFile)
+    {
+        fprintf(stderr, "Failed to write %s\n", fileName.c_str());
+        return 1;
+    }
+
+    fprintf(pFile, "{\n  \"mesh\": ");
+    OfflineWriteJSONString(pFile, options.meshFile);
+    fprintf(pFile, ",\n  \"width\": %u,\n  \"height\": %u,\n  \"triangles\": %u,\n  \"results\": {",
+            options.width, options.height, nbTriangles);
+    for (int r = 0; r < OFFLINE_NB_CULL_RESULTS; r++)
+    {
+        fprintf(pFile, "%s \"%s\": { \"count\": %u, \"percent\": %.3f }", r ? "," : "",
+                OfflineGetCullResultName((OFFLINE_CULL_RESULT)r), counts[r], nbTriangles ? 100.0*counts[r]/nbTriangles : 0.0);
+    }
+    fprintf(pFile, " },\n  \"ms\": { \"snap\": %.3f, \"simd\": %.3f, \"scalar\": %.3f, \"setup\": %.3f },\n",
+            snapNs*1e-6, simdNs*1e-6, scalarNs*1e-6, setupNs*1e-6);
+    fprintf(pFile, "  \"mismatches\": %u,\n", mismatches);
+    fprintf(pFile, "  \"setup\": { \"in\": %llu, \"outside\": %llu, \"clipped\": %llu, \"backFacing\": %llu, "
+                   "\"zeroArea\": %llu, \"noSamples\": %llu, \"setUp\": %llu },\n",
+            (unsigned long long)stats.TrianglesIn, (unsigned long long)stats.TrianglesOutside,
+            (unsigned long long)stats.TrianglesClipped, (unsigned long long)stats.TrianglesBackFacing,
+            (unsigned long long)stats.TrianglesZeroArea, (unsigned long long)stats.TrianglesNoSamples,
+            (unsigned long long)stats.TrianglesSetUp);
+    fprintf(pFile, "  \"draws\": [\n");
+    for (uint32_t d = 0; d < mesh.GetNumDraws(); d++)
+    {
+        const OfflineDraw& draw = mesh.GetDraw(d);
+        fprintf(pFile, "    { \"mesh\": %u, \"material\": %u, \"triangles\": %u", draw.Mesh, draw.MaterialID,
+                draw.IndexCount/3);
+        for (int r = 0; r < OFFLINE_NB_CULL_RESULTS; r++)
+        {
+            fprintf(pFile, ", \"%s\": %u", OfflineGetCullResultName((OFFLINE_CULL_RESULT)r),
+                    drawCounts[(size_t)d*OFFLINE_NB_CULL_RESULTS + r]);
+        }
+        fprintf(pFile, " }%s\n", d + 1 < mesh.GetNumDraws() ? "," : "");
+    }
+    fprintf(pFile, "  ]\n}\n");
+    fclose(pFile);
+
+    return mismatches ? 1 : 0;
+}
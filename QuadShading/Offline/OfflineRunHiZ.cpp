@@ -0,0 +1,108 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineRunHiZ.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+#include "OfflineRun.h"
+#include "OfflineHiZ.h"
+#include "DXUTframestats.h"
+
+#include <stdio.h>
+#include <string>
+
+
+//--------------------------------------------------------------------------------------
+// Builds a Hi-Z pyramid from the pre-pass and compares the shading pass over every
+// triangle with the shading pass over the clusters that survive culling. Both have to
+// launch exactly the same quads.
+//--------------------------------------------------------------------------------------
+int OfflineRunHiZ(const OfflineOptions& options, const COfflineMesh& mesh)
+{
+    Mat4 viewProj = OfflineGetViewProjection(OfflineGetDefaultCamera(mesh), options.width, options.height);
+
+    COfflineRasterizer rasterizer;
+    rasterizer.SetViewport(options.width, options.height);
+    rasterizer.SetupMesh(mesh, viewProj, 0);
+
+    COfflineDepthBuffer depth;
+    depth.Resize(options.width, options.height, options.depthFormat);
+    depth.Clear(1.0f);
+    rasterizer.Rasterize(&depth, OFFLINE_DEPTH_PREPASS, NULL);
+
+    uint64_t start = DXUTGetHighResTimeNs();
+    COfflineHiZ hiZ;
+    hiZ.Build(depth);
+    uint64_t buildNs = DXUTGetHighResTimeNs() - start;
+
+    start = DXUTGetHighResTimeNs();
+    std::vector<uint8_t> clusterVisible;
+    OfflineCullStats cull;
+    hiZ.CullMesh(mesh, viewProj, &clusterVisible, &cull);
+    uint64_t cullNs = DXUTGetHighResTimeNs() - start;
+
+    // Setup and shading, without and with culling
+    COfflineRasterizer all;
+    start = DXUTGetHighResTimeNs();
+    all.SetViewport(options.width, options.height);
+    all.SetupMesh(mesh, viewProj, 0);
+    all.Rasterize(&depth, OFFLINE_DEPTH_EARLY_TEST, NULL);
+    uint64_t allNs = DXUTGetHighResTimeNs() - start;
+
+    COfflineRasterizer culled;
+    start = DXUTGetHighResTimeNs();
+    culled.SetViewport(options.width, options.height);
+    culled.SetupMesh(mesh, viewProj, 0, clusterVisible.empty() ? NULL : &clusterVisible[0]);
+    culled.Rasterize(&depth, OFFLINE_DEPTH_EARLY_TEST, NULL);
+    uint64_t culledNs = DXUTGetHighResTimeNs() - start;
+
+    const OfflineRasterStats& allStats    = all.GetStats();
+    const OfflineRasterStats& culledStats = culled.GetStats();
+    bool exact = allStats.QuadsLive == culledStats.QuadsLive && allStats.PixelsLive == culledStats.PixelsLive;
+
+    double trianglesCulled = cull.TrianglesIn ? 100.0*cull.TrianglesCulled/cull.TrianglesIn : 0.0;
+    double clustersCulled  = mesh.GetNumClusters() ?
+                             100.0*(cull.ClustersOutside + cull.ClustersOccluded)/mesh.GetNumClusters() : 0.0;
+    double drawsCulled     = cull.DrawsTested ? 100.0*(cull.DrawsOutside + cull.DrawsOccluded)/cull.DrawsTested : 0.0;
+    double speedUp         = (double)allNs/(double)(culledNs + buildNs + cullNs);
+
+    printf("Hi-Z: %u levels from %ux%u %s\n", hiZ.GetNumLevels(), options.width, options.height,
+           OfflineGetDepthFormatName(options.depthFormat));
+    printf("Draws:     %u tested, %u outside, %u occluded (%.1f%% culled)\n", cull.DrawsTested,
+           cull.DrawsOutside, cull.DrawsOccluded, drawsCulled);
+    printf("Clusters:  %u in all, %u outside, %u occluded (%.1f%% culled)\n", mesh.GetNumClusters(),
+           cull.ClustersOutside, cull.ClustersOccluded, clustersCulled);
+    printf("Triangles: %llu in, %llu culled (%.1f%%)\n", (unsigned long long)cull.TrianglesIn,
+           (unsigned long long)cull.TrianglesCulled, trianglesCulled);
+    printf("Shading pass: %.2f ms for all triangles, %.2f ms culled + %.2f ms build + %.2f ms cull (%.2fx)\n",
+           allNs*1e-6, culledNs*1e-6, buildNs*1e-6, cullNs*1e-6, speedUp);
+    printf("Quads launched: %llu without culling, %llu with (%s)\n", (unsigned long long)allStats.QuadsLive,
+           (unsigned long long)culledStats.QuadsLive, exact ? "exact" : "MISMATCH");
+
+    std::string fileName = std::string(options.outputPrefix) + "_hiz.json";
+    FILE* pFile = fopen(fileName.c_str(), "wt");
+    if (!pFile)
+    {
+        fprintf(stderr, "Failed to write %s\n", fileName.c_str());
+        return 1;
+    }
+
+    fprintf(pFile, "{\n  \"mesh\": ");
+    OfflineWriteJSONString(pFile, options.meshFile);
+    fprintf(pFile, ",\n  \"width\": %u,\n  \"height\": %u,\n  \"depthFormat\": \"%s\",\n  \"levels\": %u,\n",
+            options.width, options.height, OfflineGetDepthFormatName(options.depthFormat), hiZ.GetNumLevels());
+    fprintf(pFile, "  \"draws\": { \"tested\": %u, \"outside\": %u, \"occluded\": %u, \"culledPercent\": %.2f },\n",
+            cull.DrawsTested, cull.DrawsOutside, cull.DrawsOccluded, drawsCulled);
+    fprintf(pFile, "  \"clusters\": { \"total\": %u, \"tested\": %u, \"outside\": %u, \"occluded\": %u, \"culledPercent\": %.2f },\n",
+            mesh.GetNumClusters(), cull.ClustersTested, cull.ClustersOutside, cull.ClustersOccluded, clustersCulled);
+    fprintf(pFile, "  \"triangles\": { \"in\": %llu, \"culled\": %llu, \"culledPercent\": %.2f },\n",
+            (unsigned long long)cull.TrianglesIn, (unsigned long long)cull.TrianglesCulled, trianglesCulled);
+    fprintf(pFile, "  \"ms\": { \"build\": %.3f, \"cull\": %.3f, \"shadeAll\": %.3f, \"shadeCulled\": %.3f },\n",
+            buildNs*1e-6, cullNs*1e-6, allNs*1e-6, culledNs*1e-6);
+    fprintf(pFile, "  \"speedUp\": %.3f,\n  \"quadsAll\": %llu,\n  \"quadsCulled\": %llu,\n  \"exact\": %s\n}\n",
+            speedUp, (unsigned long long)allStats.QuadsLive, (unsigned long long)culledStats.QuadsLive,
+            exact ? "true" : "false");
+    fclose(pFile);
+
+    return exact ? 0 : 1;
+}
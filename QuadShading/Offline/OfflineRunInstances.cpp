@@ -0,0 +1,111 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineRunInstances.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+#include "OfflineRun.h"
+#include "OfflineMethods.h"
+#include "DXUTframestats.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+
+//--------------------------------------------------------------------------------------
+// Shades 1, 4, 16 and so on copies of the mesh up to -instances, or the instances in
+// -instance-file, timing setup and rasterization, and writes what each instance of the
+// last run launched to <prefix>_instances.csv
+//--------------------------------------------------------------------------------------
+int OfflineRunInstances(const OfflineOptions& options, const COfflineMesh& mesh)
+{
+    std::vector<Mat4> fileWorlds;
+    std::vector<uint32_t> counts;
+    if (options.instanceLayout == OFFLINE_INSTANCES_FILE)
+    {
+        if (!OfflineLoadInstances(options.instanceFile, &fileWorlds))
+        {
+            fprintf(stderr, "Failed to read instances from %s\n", options.instanceFile);
+            return 1;
+        }
+        counts.push_back((uint32_t)fileWorlds.size());
+    }
+    else
+    {
+        for (uint32_t count = 1; count < options.instances; count *= 4)
+            counts.push_back(count);
+        counts.push_back(options.instances);
+    }
+
+    printf("%-9s %9s %8s %10s %10s %10s %10s %11s %10s %11s\n", "instances", "culled", "threads", "set up",
+           "setup ms", "raster ms", "quads", "efficiency", "Mtris/s", "kinst/s");
+
+    COfflineInstancedScene scene;
+    COfflineInstanceAttribution attribution;
+    COfflineDepthBuffer depth;
+    depth.Resize(options.width, options.height, options.depthFormat);
+
+    std::vector<Mat4> worlds;
+    for (size_t r = 0; r < counts.size(); r++)
+    {
+        if (options.instanceLayout == OFFLINE_INSTANCES_FILE)
+            worlds = fileWorlds;
+        else if (options.instanceLayout == OFFLINE_INSTANCES_SCATTER)
+            OfflineMakeInstanceScatter(mesh, counts[r], &worlds);
+        else
+            OfflineMakeInstanceGrid(mesh, counts[r], &worlds);
+
+        scene.SetInstances(mesh, worlds);
+        attribution.Resize(counts[r]);
+
+        Vec3 boundsMin, boundsMax;
+        scene.GetBounds(&boundsMin, &boundsMax);
+        OfflineCamera camera = OfflineGetDefaultCamera(mesh);
+        OfflineFrameBounds(boundsMin, boundsMax, &camera);
+        Mat4 viewProj = OfflineGetViewProjection(camera, options.width, options.height);
+
+        uint64_t start = DXUTGetHighResTimeNs();
+        scene.Setup(viewProj, options.width, options.height, options.threads);
+        uint64_t setUp = DXUTGetHighResTimeNs();
+        depth.Clear(1.0f);
+        scene.Rasterize(&depth, OFFLINE_DEPTH_PREPASS, NULL);
+        scene.Rasterize(&depth, OFFLINE_DEPTH_EARLY_TEST, &attribution);
+        uint64_t end = DXUTGetHighResTimeNs();
+
+        OfflineLiveTotals totals;
+        memset(&totals, 0, sizeof(totals));
+        for (uint32_t i = 0; i < counts[r]; i++)
+            OfflineAddLiveTotals(&totals, attribution.GetInstance(i));
+
+        const OfflineRasterStats stats = scene.GetStats();
+        const double seconds = (end - start)*1e-9;
+        printf("%-9u %9u %8u %10llu %10.2f %10.2f %10llu %10.2f%% %10.2f %11.2f\n", counts[r],
+               scene.GetInstancesCulled(), options.threads, (unsigned long long)stats.TrianglesSetUp,
+               (setUp - start)*1e-6, (end - setUp)*1e-6, (unsigned long long)totals.Quads,
+               100.0*OfflineGetEfficiency(totals),
+               seconds > 0.0 ? (stats.TrianglesIn + stats.TrianglesSkipped)*1e-6/seconds : 0.0,
+               seconds > 0.0 ? counts[r]*1e-3/seconds : 0.0);
+    }
+
+    std::string fileName = std::string(options.outputPrefix) + "_instances.csv";
+    FILE* pFile = fopen(fileName.c_str(), "wt");
+    if (!pFile)
+    {
+        fprintf(stderr, "Failed to write %s\n", fileName.c_str());
+        return 1;
+    }
+
+    fprintf(pFile, "instance,x,y,z,quads,live1,live2,live3,live4,efficiency\n");
+    for (uint32_t i = 0; i < (uint32_t)worlds.size(); i++)
+    {
+        const OfflineLiveTotals& totals = attribution.GetInstance(i);
+        fprintf(pFile, "%u,%g,%g,%g,%llu,%llu,%llu,%llu,%llu,%.6f\n", i, worlds[i].m[3][0], worlds[i].m[3][1],
+                worlds[i].m[3][2], (unsigned long long)totals.Quads, (unsigned long long)totals.LiveStats[0],
+                (unsigned long long)totals.LiveStats[1], (unsigned long long)totals.LiveStats[2],
+                (unsigned long long)totals.LiveStats[3], OfflineGetEfficiency(totals));
+    }
+    fclose(pFile);
+
+    return 0;
+}
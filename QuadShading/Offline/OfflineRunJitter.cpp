@@ -0,0 +1,185 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineRunJitter.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+#include "OfflineRun.h"
+#include "OfflineJitter.h"
+#include "OfflineMethods.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+
+
+//--------------------------------------------------------------------------------------
+// Samples of a jitter sweep, shared by the threads running them
+//--------------------------------------------------------------------------------------
+struct JitterSweep
+{
+    const OfflineOptions*               pOptions;
+    const COfflineMesh*                 pMesh;
+    Mat4                                viewProj;
+    std::vector<COfflineJitterSample>*  pSamples;   // the last one un-jittered
+    std::atomic<uint32_t>               nextSample;
+};
+
+static void JitterWorker(JitterSweep* pSweep)
+{
+    const OfflineOptions& options = *pSweep->pOptions;
+    const uint32_t jittered = (uint32_t)pSweep->pSamples->size() - 1;
+
+    COfflineRasterizer rasterizer;
+    for (uint32_t i = pSweep->nextSample++; i <= jittered; i = pSweep->nextSample++)
+    {
+        float x = 0.0f, y = 0.0f;
+        if (i < jittered)
+            OfflineGetJitterOffset(i, &x, &y);
+
+        COfflineJitterSample& sample = (*pSweep->pSamples)[i];
+        rasterizer.Reset();
+        sample.Resize(OfflineGetQuadGridSize(options.width), OfflineGetQuadGridSize(options.height),
+                      options.jitterRegion);
+        OfflineRunShadingPass(options, *pSweep->pMesh,
+                              OfflineJitterViewProjection(pSweep->viewProj, x, y, options.width, options.height),
+                              &rasterizer, &sample);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Quad efficiency per region under -jitter-count Halton offsets, shaded in parallel
+//--------------------------------------------------------------------------------------
+int OfflineRunJitter(const OfflineOptions& options, const COfflineMesh& mesh)
+{
+    if (options.jitterRegion < 2 || (options.jitterRegion & 1))
+    {
+        fprintf(stderr, "Invalid jitter region size %u: must be even\n", options.jitterRegion);
+        return 1;
+    }
+
+    std::vector<COfflineJitterSample> samples(options.jitterCount + 1);
+
+    JitterSweep sweep;
+    sweep.pOptions   = &options;
+    sweep.pMesh      = &mesh;
+    sweep.viewProj   = OfflineGetViewProjection(OfflineGetDefaultCamera(mesh), options.width, options.height);
+    sweep.pSamples   = &samples;
+    sweep.nextSample = 0;
+
+    uint32_t threads = std::min(options.threads, (uint32_t)samples.size());
+    {
+        std::vector<std::thread> workers;
+        for (uint32_t i = 1; i < threads; i++)
+            workers.push_back(std::thread(JitterWorker, &sweep));
+        JitterWorker(&sweep);
+        for (size_t i = 0; i < workers.size(); i++)
+            workers[i].join();
+    }
+
+    // In sequence order, so that the sums don't depend on the threads
+    const COfflineJitterSample& unjittered = samples.back();
+    COfflineJitterStats stats;
+    stats.Resize(unjittered.GetRegionsX(), unjittered.GetRegionsY());
+    for (uint32_t i = 0; i < options.jitterCount; i++)
+        stats.AddSample(samples[i]);
+
+    printf("%-10s %7s %7s %10s %10s %8s %8s %8s %8s\n", "sample", "x", "y", "quads", "efficiency", "1 live",
+           "2 live", "3 live", "4 live");
+    for (uint32_t i = 0; i < samples.size(); i++)
+    {
+        float x = 0.0f, y = 0.0f;
+        char name[16] = "unjittered";
+        if (i < options.jitterCount)
+        {
+            OfflineGetJitterOffset(i, &x, &y);
+            sprintf(name, "%u", i);
+        }
+
+        const OfflineLiveTotals& totals = samples[i].GetTotals();
+        printf("%-10s %7.3f %7.3f %10llu %9.2f%% %8llu %8llu %8llu %8llu\n", name, x, y,
+               (unsigned long long)totals.Quads, 100.0*OfflineGetEfficiency(totals),
+               (unsigned long long)totals.LiveStats[0], (unsigned long long)totals.LiveStats[1],
+               (unsigned long long)totals.LiveStats[2], (unsigned long long)totals.LiveStats[3]);
+    }
+
+    OfflineJitterRegionStats total = stats.GetTotalStats();
+    uint64_t unjitteredQuads = unjittered.GetTotals().Quads;
+    printf("mean of %u: %.1f quads (std dev %.1f, un-jittered %+.2f%%), efficiency %.2f%% (std dev %.2f%%)\n",
+           options.jitterCount, total.MeanQuads, sqrt(total.QuadsVariance),
+           total.MeanQuads ? 100.0*((double)unjitteredQuads/total.MeanQuads - 1.0) : 0.0, 100.0*total.MeanEfficiency,
+           100.0*sqrt(total.EfficiencyVariance));
+
+    // Mean efficiency, and its spread scaled to the largest, one pixel per region
+    const uint32_t regions = stats.GetRegionsX()*stats.GetRegionsY();
+    double maxStdDev = 0.0;
+    for (uint32_t r = 0; r < regions; r++)
+        maxStdDev = std::max(maxStdDev, sqrt(stats.GetRegionStats(r).EfficiencyVariance));
+
+    std::vector<uint8_t> meanMap(regions), stdDevMap(regions);
+    for (uint32_t r = 0; r < regions; r++)
+    {
+        OfflineJitterRegionStats region = stats.GetRegionStats(r);
+        meanMap[r]   = (uint8_t)(255.0*region.MeanEfficiency + 0.5);
+        stdDevMap[r] = maxStdDev > 0.0 ? (uint8_t)(255.0*sqrt(region.EfficiencyVariance)/maxStdDev + 0.5) : 0;
+    }
+
+    std::string prefix = options.outputPrefix;
+    if (!OfflineWritePGM(prefix + "_jitter_mean.pgm", &meanMap[0], stats.GetRegionsX(), stats.GetRegionsY(), 255) ||
+        !OfflineWritePGM(prefix + "_jitter_stddev.pgm", &stdDevMap[0], stats.GetRegionsX(), stats.GetRegionsY(), 255))
+    {
+        fprintf(stderr, "Failed to write %s_jitter_*.pgm\n", options.outputPrefix);
+        return 1;
+    }
+
+    std::string fileName = prefix + "_jitter.json";
+    FILE* pFile = fopen(fileName.c_str(), "wt");
+    if (!pFile)
+    {
+        fprintf(stderr, "Failed to write %s\n", fileName.c_str());
+        return 1;
+    }
+
+    fprintf(pFile, "{\n  \"mesh\": ");
+    OfflineWriteJSONString(pFile, options.meshFile);
+    fprintf(pFile, ",\n  \"width\": %u,\n  \"height\": %u,\n  \"regionSize\": %u,\n  \"regionsX\": %u,\n"
+                   "  \"regionsY\": %u,\n", options.width, options.height, options.jitterRegion, stats.GetRegionsX(),
+            stats.GetRegionsY());
+    fprintf(pFile, "  \"unjittered\": { \"quads\": %llu, \"livePixels\": %llu },\n",
+            (unsigned long long)unjitteredQuads, (unsigned long long)OfflineGetLivePixels(unjittered.GetTotals()));
+    fprintf(pFile, "  \"mean\": { \"quads\": %.3f, \"quadsVariance\": %.3f, \"efficiency\": %.6f, "
+                   "\"efficiencyVariance\": %.9f },\n", total.MeanQuads, total.QuadsVariance, total.MeanEfficiency,
+            total.EfficiencyVariance);
+
+    fprintf(pFile, "  \"samples\": [\n");
+    for (uint32_t i = 0; i < options.jitterCount; i++)
+    {
+        float x, y;
+        OfflineGetJitterOffset(i, &x, &y);
+
+        const OfflineLiveTotals& totals = samples[i].GetTotals();
+        fprintf(pFile, "    { \"x\": %.6f, \"y\": %.6f, \"quads\": %llu, \"livePixels\": %llu, "
+                       "\"liveStats\": [%llu, %llu, %llu, %llu] }%s\n", x, y, (unsigned long long)totals.Quads,
+                (unsigned long long)OfflineGetLivePixels(totals), (unsigned long long)totals.LiveStats[0],
+                (unsigned long long)totals.LiveStats[1], (unsigned long long)totals.LiveStats[2],
+                (unsigned long long)totals.LiveStats[3], i + 1 < options.jitterCount ? "," : "");
+    }
+
+    // Row by row, regions no sample reached with zero efficiency
+    fprintf(pFile, "  ],\n  \"regions\": [\n");
+    for (uint32_t r = 0; r < regions; r++)
+    {
+        OfflineJitterRegionStats region = stats.GetRegionStats(r);
+        fprintf(pFile, "    { \"samples\": %u, \"quads\": %.3f, \"quadsVariance\": %.3f, \"efficiency\": %.6f, "
+                       "\"efficiencyVariance\": %.9f }%s\n", region.Samples, region.MeanQuads, region.QuadsVariance,
+                region.MeanEfficiency, region.EfficiencyVariance, r + 1 < regions ? "," : "");
+    }
+    fprintf(pFile, "  ]\n}\n");
+    fclose(pFile);
+
+    return 0;
+}
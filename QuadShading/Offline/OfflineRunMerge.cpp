@@ -0,0 +1,83 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineRunMerge.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+#include "OfflineRun.h"
+#include "OfflineLockStress.h"
+#include "OfflineQuadMerge.h"
+
+#include <stdio.h>
+#include <string>
+
+
+//--------------------------------------------------------------------------------------
+// Quad-fragment merging of the shading pass, for windows from none up to -merge-window
+//--------------------------------------------------------------------------------------
+int OfflineRunMerge(const OfflineOptions& options, const COfflineMesh& mesh)
+{
+    COfflineRasterizer rasterizer;
+    COfflineFragmentRecorder fragments;
+    fragments.SetGrid(OfflineGetQuadGridSize(options.width), OfflineGetQuadGridSize(options.height));
+    OfflineRunShadingPass(options, mesh, &rasterizer, &fragments);
+
+    COfflineQuadMerger merger;
+    merger.SetMesh(mesh);
+
+    std::vector<uint32_t> windows(1, 0);
+    for (uint32_t window = 1; window < options.mergeWindow; window *= 2)
+        windows.push_back(window);
+    if (options.mergeWindow)
+        windows.push_back(options.mergeWindow);
+
+    std::vector<OfflineMergeStats> results;
+    for (int rule = 0; rule < OFFLINE_NB_MERGE_RULES; rule++)
+    {
+        for (size_t i = 0; i < windows.size(); i++)
+            results.push_back(merger.Run(fragments, windows[i], (OFFLINE_MERGE_RULE)rule));
+    }
+
+    // Savings are against shading every quad as it comes
+    const OfflineMergeStats& unmerged = results[0];
+    printf("%-9s %7s %10s %12s %10s %8s %8s %8s %8s\n", "rule", "window", "quads", "invocations", "helpers",
+           "saved", "1 live", "2 live", "4 live");
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const OfflineMergeStats& stats = results[i];
+        printf("%-9s %7u %10llu %12llu %10llu %7.1f%% %8u %8u %8u\n", OfflineGetMergeRuleName(stats.Rule), stats.Window,
+               (unsigned long long)stats.QuadsOut, (unsigned long long)stats.Invocations,
+               (unsigned long long)stats.HelperLanes,
+               unmerged.Invocations ? 100.0*(1.0 - (double)stats.Invocations/(double)unmerged.Invocations) : 0.0,
+               stats.LiveStats[0], stats.LiveStats[1], stats.LiveStats[3]);
+    }
+
+    std::string fileName = std::string(options.outputPrefix) + "_merge.json";
+    FILE* pFile = fopen(fileName.c_str(), "wt");
+    if (!pFile)
+    {
+        fprintf(stderr, "Failed to write %s\n", fileName.c_str());
+        return 1;
+    }
+
+    fprintf(pFile, "{\n  \"mesh\": ");
+    OfflineWriteJSONString(pFile, options.meshFile);
+    fprintf(pFile, ",\n  \"width\": %u,\n  \"height\": %u,\n  \"quads\": %u,\n  \"results\": [\n", options.width,
+            options.height, fragments.GetNumFragments());
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const OfflineMergeStats& stats = results[i];
+        fprintf(pFile, "    { \"rule\": \"%s\", \"window\": %u, \"quads\": %llu, \"merges\": %llu, \"invocations\": %llu, "
+                       "\"helperLanes\": %llu, \"invocationsSaved\": %llu, \"helperLanesSaved\": %llu, "
+                       "\"liveStats\": [%u, %u, %u, %u] }%s\n",
+                OfflineGetMergeRuleName(stats.Rule), stats.Window, (unsigned long long)stats.QuadsOut,
+                (unsigned long long)stats.Merges, (unsigned long long)stats.Invocations,
+                (unsigned long long)stats.HelperLanes, (unsigned long long)(unmerged.Invocations - stats.Invocations),
+                (unsigned long long)(unmerged.HelperLanes - stats.HelperLanes), stats.LiveStats[0], stats.LiveStats[1],
+                stats.LiveStats[2], stats.LiveStats[3], i + 1 < results.size() ? "," : "");
+    }
+    fprintf(pFile, "  ]\n}\n");
+    fclose(pFile);
+
+    return 0;
+}
@@ -0,0 +1,100 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineRunMethods.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+#include "OfflineRun.h"
+#include "OfflineMethods.h"
+
+#include <stdio.h>
+#include <string>
+
+
+//--------------------------------------------------------------------------------------
+static bool WriteMethodsJSON(const std::string& fileName, const OfflineOptions& options,
+                             const COfflineRasterizer& rasterizer, const COfflineMethods& methods)
+{
+    FILE* pFile = fopen(fileName.c_str(), "wt");
+    if (!pFile)
+        return false;
+
+    const OfflineRasterStats& stats = rasterizer.GetStats();
+
+    fprintf(pFile, "{\n  \"mesh\": ");
+    OfflineWriteJSONString(pFile, options.meshFile);
+    fprintf(pFile, ",\n  \"width\": %u,\n  \"height\": %u,\n  \"depthFormat\": \"%s\",\n", options.width, options.height,
+            OfflineGetDepthFormatName(options.depthFormat));
+    fprintf(pFile, "  \"triangles\": { \"in\": %llu, \"outside\": %llu, \"clipped\": %llu, \"backFacing\": %llu, "
+                   "\"zeroArea\": %llu, \"noSamples\": %llu, \"setUp\": %llu },\n",
+            (unsigned long long)stats.TrianglesIn, (unsigned long long)stats.TrianglesOutside,
+            (unsigned long long)stats.TrianglesClipped, (unsigned long long)stats.TrianglesBackFacing,
+            (unsigned long long)stats.TrianglesZeroArea, (unsigned long long)stats.TrianglesNoSamples,
+            (unsigned long long)stats.TrianglesSetUp);
+    fprintf(pFile, "  \"reference\": \"%s\",\n  \"methods\": [\n", OfflineGetMethodName(OFFLINE_REFERENCE_METHOD));
+
+    for (int m = 0; m < OFFLINE_NB_METHODS; m++)
+    {
+        const COfflineOverdraw& overdraw = methods.GetOverdraw((OFFLINE_METHOD)m);
+
+        uint64_t quads = overdraw.GetTotalQuads(m == OFFLINE_METHOD_SLICES);
+
+        fprintf(pFile, "    { \"name\": \"%s\", \"quads\": %llu, \"slices\": [%llu, %llu, %llu, %llu], "
+                       "\"liveStats\": [%u, %u, %u, %u], \"disagreeingQuads\": %u }%s\n",
+                OfflineGetMethodName((OFFLINE_METHOD)m), (unsigned long long)quads,
+                (unsigned long long)overdraw.GetSliceTotal(0), (unsigned long long)overdraw.GetSliceTotal(1),
+                (unsigned long long)overdraw.GetSliceTotal(2), (unsigned long long)overdraw.GetSliceTotal(3),
+                overdraw.GetLiveStats(0), overdraw.GetLiveStats(1), overdraw.GetLiveStats(2), overdraw.GetLiveStats(3),
+                methods.GetDisagreementCount((OFFLINE_METHOD)m), m + 1 < OFFLINE_NB_METHODS ? "," : "");
+    }
+
+    fprintf(pFile, "  ]\n}\n");
+    fclose(pFile);
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// All four methods from one traversal
+//--------------------------------------------------------------------------------------
+int OfflineRunMethods(const OfflineOptions& options, const COfflineMesh& mesh)
+{
+    COfflineRasterizer rasterizer;
+    COfflineMethods methods;
+    methods.Resize(OfflineGetQuadGridSize(options.width), OfflineGetQuadGridSize(options.height));
+    OfflineRunShadingPass(options, mesh, &rasterizer, &methods);
+    methods.BuildDisagreementMap();
+
+    std::string prefix = options.outputPrefix;
+    if (!WriteMethodsJSON(prefix + ".json", options, rasterizer, methods) ||
+        !OfflineWritePGM(prefix + "_disagreement.pgm", methods.GetDisagreementMap(),
+                         OfflineGetQuadGridSize(options.width), OfflineGetQuadGridSize(options.height),
+                         (1 << OFFLINE_NB_METHODS) - 1))
+    {
+        fprintf(stderr, "Failed to write results to %s*\n", options.outputPrefix);
+        return 1;
+    }
+
+    printf("%-10s %12s %10s %10s %10s %10s %12s\n", "method", "quads", "1 live", "2 live", "3 live", "4 live", "disagreeing");
+    for (int m = 0; m < OFFLINE_NB_METHODS; m++)
+    {
+        const COfflineOverdraw& overdraw = methods.GetOverdraw((OFFLINE_METHOD)m);
+
+        uint64_t quads = overdraw.GetTotalQuads(m == OFFLINE_METHOD_SLICES);
+
+        printf("%-10s %12llu %10u %10u %10u %10u %12u\n", OfflineGetMethodName((OFFLINE_METHOD)m),
+               (unsigned long long)quads, overdraw.GetLiveStats(0), overdraw.GetLiveStats(1),
+               overdraw.GetLiveStats(2), overdraw.GetLiveStats(3), methods.GetDisagreementCount((OFFLINE_METHOD)m));
+    }
+
+    size_t   counterBytes = 0;
+    uint32_t wideTiles    = 0;
+    for (int m = 0; m < OFFLINE_NB_METHODS; m++)
+    {
+        counterBytes += methods.GetOverdraw((OFFLINE_METHOD)m).GetMemoryUsed();
+        wideTiles    += methods.GetOverdraw((OFFLINE_METHOD)m).GetNumWideTiles();
+    }
+    printf("counters: %.1f KB, %u tiles promoted to 32 bits\n", counterBytes/1024.0, wideTiles);
+
+    return 0;
+}
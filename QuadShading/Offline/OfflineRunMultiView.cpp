@@ -0,0 +1,173 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineRunMultiView.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+#include "OfflineRun.h"
+#include "OfflineMethods.h"
+#include "OfflineMultiView.h"
+#include "DXUTframestats.h"
+
+#include <float.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+
+
+//--------------------------------------------------------------------------------------
+// Every view of the -multiview sets from one traversal, checked against rendering each
+// view on its own
+//--------------------------------------------------------------------------------------
+int OfflineRunMultiView(const OfflineOptions& options, const COfflineMesh& mesh)
+{
+    OfflineCamera camera = OfflineGetDefaultCamera(mesh);
+
+    Vec3 sceneMin = MakeVec3(FLT_MAX, FLT_MAX, FLT_MAX);
+    Vec3 sceneMax = MakeVec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for (uint32_t d = 0; d < mesh.GetNumDraws(); d++)
+    {
+        sceneMin = Minimize(sceneMin, mesh.GetDraw(d).BoundsMin);
+        sceneMax = Maximize(sceneMax, mesh.GetDraw(d).BoundsMax);
+    }
+
+    // A key light from above, behind the camera
+    std::vector<OfflineView> views;
+    if (options.viewSets & OFFLINE_VIEWS_CASCADES)
+    {
+        OfflineAddCascadeViews(camera, (float)options.width/(float)options.height, sceneMin, sceneMax,
+                               MakeVec3(0.5f, -1.0f, 1.0f), options.cascades, options.viewSize, &views);
+    }
+    if (options.viewSets & OFFLINE_VIEWS_CUBE)
+        OfflineAddCubeViews(camera, options.viewSize, &views);
+    if (options.viewSets & OFFLINE_VIEWS_STEREO)
+        OfflineAddStereoViews(camera, options.width, options.height, options.ipd, &views);
+
+    const Mat4 world = MatrixIdentity();
+    COfflineMultiView multiView;
+    multiView.SetViews(views);
+
+    // Best of a few runs each, so that neither pays for first touching its memory
+    uint64_t sharedSetupNs = ~0ull, sharedRasterNs = ~0ull;
+    for (uint32_t run = 0; run < options.runs; run++)
+    {
+        uint64_t start = DXUTGetHighResTimeNs();
+        multiView.Setup(mesh, world);
+        sharedSetupNs = std::min(sharedSetupNs, DXUTGetHighResTimeNs() - start);
+
+        start = DXUTGetHighResTimeNs();
+        multiView.Rasterize(options.depthFormat, options.threads);
+        sharedRasterNs = std::min(sharedRasterNs, DXUTGetHighResTimeNs() - start);
+    }
+
+    // The same views one at a time, each transforming every vertex from object space
+    std::vector<COfflineViewOverdraw> separate(multiView.GetNumViews());
+    COfflineRasterizer rasterizer;
+    COfflineDepthBuffer depth;
+    uint64_t separateSetupNs = ~0ull, separateRasterNs = ~0ull;
+    for (uint32_t run = 0; run < options.runs; run++)
+    {
+        uint64_t setupNs = 0, rasterNs = 0;
+        for (uint32_t v = 0; v < multiView.GetNumViews(); v++)
+        {
+            const OfflineView& view = multiView.GetView(v);
+
+            uint64_t start = DXUTGetHighResTimeNs();
+            rasterizer.Reset();
+            rasterizer.SetViewport(view.Width, view.Height);
+            rasterizer.SetupMesh(mesh, MatrixMultiply(world, view.ViewProj), 0);
+            setupNs += DXUTGetHighResTimeNs() - start;
+
+            start = DXUTGetHighResTimeNs();
+            depth.Resize(view.Width, view.Height, options.depthFormat);
+            depth.Clear(1.0f);
+            separate[v].Resize(OfflineGetQuadGridSize(view.Width), OfflineGetQuadGridSize(view.Height));
+            rasterizer.Rasterize(&depth, OFFLINE_DEPTH_PREPASS, NULL);
+            rasterizer.Rasterize(&depth, OFFLINE_DEPTH_EARLY_TEST, &separate[v]);
+            rasterNs += DXUTGetHighResTimeNs() - start;
+        }
+        separateSetupNs  = std::min(separateSetupNs, setupNs);
+        separateRasterNs = std::min(separateRasterNs, rasterNs);
+    }
+
+    uint32_t mismatches = 0;
+    for (uint32_t v = 0; v < multiView.GetNumViews(); v++)
+    {
+        const COfflineOverdraw& shared = multiView.GetOverdraw(v).GetOverdraw();
+        const COfflineOverdraw& single = separate[v].GetOverdraw();
+        for (uint32_t live = 0; live < 4; live++)
+            mismatches += shared.GetLiveStats(live) != single.GetLiveStats(live) ? 1 : 0;
+        for (uint32_t y = 0; y < shared.GetHeight(); y++)
+        {
+            for (uint32_t x = 0; x < shared.GetWidth(); x++)
+                mismatches += shared.Get(x, y, 0) != single.Get(x, y, 0) ? 1 : 0;
+        }
+    }
+
+    std::string fileName = std::string(options.outputPrefix) + "_multiview.json";
+    FILE* pFile = fopen(fileName.c_str(), "wt");
+    if (!pFile)
+    {
+        fprintf(stderr, "Failed to write %s\n", fileName.c_str());
+        return 1;
+    }
+
+    fprintf(pFile, "{\n  \"mesh\": ");
+    OfflineWriteJSONString(pFile, options.meshFile);
+    fprintf(pFile, ",\n  \"worldVertices\": %u,\n  \"clusters\": %u,\n", multiView.GetNumWorldVertices(),
+            mesh.GetNumClusters());
+    fprintf(pFile, "  \"ms\": { \"sharedSetup\": %.3f, \"sharedRaster\": %.3f, \"separateSetup\": %.3f, "
+                   "\"separateRaster\": %.3f },\n  \"mismatches\": %u,\n  \"views\": [\n", sharedSetupNs*1e-6,
+            sharedRasterNs*1e-6, separateSetupNs*1e-6, separateRasterNs*1e-6, mismatches);
+
+    printf("%-10s %11s %9s %9s %10s %10s %8s %8s %8s %8s %10s\n", "view", "size", "clusters", "set up", "quads",
+           "live", "1 live", "2 live", "3 live", "4 live", "efficiency");
+
+    OfflineLiveTotals total;
+    memset(&total, 0, sizeof(total));
+    for (uint32_t v = 0; v < multiView.GetNumViews(); v++)
+    {
+        const OfflineView& view = multiView.GetView(v);
+        const OfflineLiveTotals totals = multiView.GetOverdraw(v).GetOverdraw().GetLiveTotals(false);
+        const OfflineRasterStats& stats = multiView.GetRasterizer(v).GetStats();
+
+        char size[16];
+        sprintf(size, "%ux%u", view.Width, view.Height);
+        printf("%-10s %11s %9u %9llu %10llu %10llu %8llu %8llu %8llu %8llu %9.2f%%\n", view.Name, size,
+               multiView.GetClustersBinned(v), (unsigned long long)stats.TrianglesSetUp,
+               (unsigned long long)totals.Quads, (unsigned long long)OfflineGetLivePixels(totals),
+               (unsigned long long)totals.LiveStats[0], (unsigned long long)totals.LiveStats[1],
+               (unsigned long long)totals.LiveStats[2], (unsigned long long)totals.LiveStats[3],
+               100.0*OfflineGetEfficiency(totals));
+
+        fprintf(pFile, "    { \"name\": \"%s\", \"width\": %u, \"height\": %u, \"clustersBinned\": %u, "
+                       "\"trianglesSetUp\": %llu, \"quads\": %llu, \"livePixels\": %llu, "
+                       "\"liveStats\": [%llu, %llu, %llu, %llu], \"efficiency\": %.6f },\n",
+                view.Name, view.Width, view.Height, multiView.GetClustersBinned(v),
+                (unsigned long long)stats.TrianglesSetUp, (unsigned long long)totals.Quads,
+                (unsigned long long)OfflineGetLivePixels(totals), (unsigned long long)totals.LiveStats[0],
+                (unsigned long long)totals.LiveStats[1], (unsigned long long)totals.LiveStats[2],
+                (unsigned long long)totals.LiveStats[3], OfflineGetEfficiency(totals));
+
+        OfflineAddLiveTotals(&total, totals);
+    }
+
+    printf("%-10s %11s %9s %9s %10llu %10llu %8llu %8llu %8llu %8llu %9.2f%%\n", "total", "", "", "",
+           (unsigned long long)total.Quads, (unsigned long long)OfflineGetLivePixels(total),
+           (unsigned long long)total.LiveStats[0], (unsigned long long)total.LiveStats[1],
+           (unsigned long long)total.LiveStats[2], (unsigned long long)total.LiveStats[3],
+           100.0*OfflineGetEfficiency(total));
+    printf("%u views from one traversal: setup %.3f ms, raster %.3f ms; one at a time: setup %.3f ms, raster %.3f ms; "
+           "%u mismatches\n", multiView.GetNumViews(), sharedSetupNs*1e-6, sharedRasterNs*1e-6, separateSetupNs*1e-6,
+           separateRasterNs*1e-6, mismatches);
+
+    fprintf(pFile, "    { \"name\": \"total\", \"quads\": %llu, \"livePixels\": %llu, "
+                   "\"liveStats\": [%llu, %llu, %llu, %llu], \"efficiency\": %.6f }\n  ]\n}\n",
+            (unsigned long long)total.Quads, (unsigned long long)OfflineGetLivePixels(total),
+            (unsigned long long)total.LiveStats[0], (unsigned long long)total.LiveStats[1],
+            (unsigned long long)total.LiveStats[2], (unsigned long long)total.LiveStats[3], OfflineGetEfficiency(total));
+    fclose(pFile);
+
+    return mismatches ? 1 : 0;
+}
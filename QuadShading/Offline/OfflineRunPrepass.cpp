@@ -0,0 +1,88 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineRunPrepass.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+#include "OfflineRun.h"
+#include "OfflinePrepass.h"
+
+#include <stdio.h>
+#include <string>
+
+
+//--------------------------------------------------------------------------------------
+static void WriteDepthPassJSON(FILE* pFile, const char* name, const OfflineDepthPassStats& stats, bool last)
+{
+    fprintf(pFile, "      \"%s\": { \"triangles\": %llu, \"depthTests\": %llu, \"quadsCovered\": %llu, "
+                   "\"quadsShaded\": %llu, \"pixelsShaded\": %llu, \"cost\": %.0f }%s\n",
+            name, (unsigned long long)stats.Triangles, (unsigned long long)stats.DepthTests,
+            (unsigned long long)stats.QuadsCovered, (unsigned long long)stats.QuadsLive,
+            (unsigned long long)stats.PixelsLive, stats.Cost, last ? "" : ",");
+}
+
+
+//--------------------------------------------------------------------------------------
+// Render()'s depth pre-pass against a single pass in submission order
+//--------------------------------------------------------------------------------------
+int OfflineRunPrepass(const OfflineOptions& options, const COfflineMesh& mesh)
+{
+    COfflineRasterizer rasterizer;
+    rasterizer.SetViewport(options.width, options.height);
+    rasterizer.SetupMesh(mesh, OfflineGetViewProjection(OfflineGetDefaultCamera(mesh), options.width, options.height),
+                         0);
+
+    OfflineDepthCostModel model = OfflineGetDefaultDepthCostModel();
+    model.ShadedQuadCost = options.quadCost;
+
+    COfflinePrepassComparison comparison;
+    comparison.Run(&rasterizer, options.depthFormat, model);
+
+    const OfflinePrepassStrategy& with    = comparison.GetWithPrepass();
+    const OfflinePrepassStrategy& without = comparison.GetWithoutPrepass();
+    const char* depthFormat = OfflineGetDepthFormatName(options.depthFormat);
+
+    printf("%-16s %12s %12s %12s %12s %14s\n", "strategy", "depth tests", "quads", "pixels", "helpers", "cost");
+    printf("%-16s %12llu %12llu %12llu %12s %14.0f\n", "pre-pass: depth",
+           (unsigned long long)with.DepthPass.DepthTests, (unsigned long long)with.DepthPass.QuadsLive,
+           (unsigned long long)with.DepthPass.PixelsLive, "", with.DepthPass.Cost);
+    printf("%-16s %12llu %12llu %12llu %12llu %14.0f\n", "pre-pass: shade",
+           (unsigned long long)with.ShadingPass.DepthTests, (unsigned long long)with.ShadingPass.QuadsLive,
+           (unsigned long long)with.ShadingPass.PixelsLive,
+           (unsigned long long)(4*with.ShadingPass.QuadsLive - with.ShadingPass.PixelsLive), with.ShadingPass.Cost);
+    printf("%-16s %12llu %12llu %12llu %12llu %14.0f\n", "no pre-pass",
+           (unsigned long long)without.ShadingPass.DepthTests, (unsigned long long)without.ShadingPass.QuadsLive,
+           (unsigned long long)without.ShadingPass.PixelsLive,
+           (unsigned long long)(4*without.ShadingPass.QuadsLive - without.ShadingPass.PixelsLive),
+           without.ShadingPass.Cost);
+    printf("Total cost %.0f with the pre-pass, %.0f without (%s depth, %.1f per shaded quad): the pre-pass %s\n",
+           with.Cost, without.Cost, depthFormat, options.quadCost,
+           comparison.PrepassPaysOff() ? "pays off" : "does not pay off");
+    printf("Break-even cost per shaded quad: %.2f\n", comparison.GetBreakEvenQuadCost());
+
+    std::string fileName = std::string(options.outputPrefix) + "_prepass.json";
+    FILE* pFile = fopen(fileName.c_str(), "wt");
+    if (!pFile)
+    {
+        fprintf(stderr, "Failed to write %s\n", fileName.c_str());
+        return 1;
+    }
+
+    fprintf(pFile, "{\n  \"mesh\": ");
+    OfflineWriteJSONString(pFile, options.meshFile);
+    fprintf(pFile, ",\n  \"width\": %u,\n  \"height\": %u,\n  \"depthFormat\": \"%s\",\n",
+            options.width, options.height, depthFormat);
+    fprintf(pFile, "  \"costModel\": { \"triangle\": %g, \"depthTest\": %g, \"depthQuad\": %g, \"shadedQuad\": %g },\n",
+            model.TriangleCost, model.DepthTestCost, model.DepthQuadCost, model.ShadedQuadCost);
+    fprintf(pFile, "  \"withPrepass\": {\n");
+    WriteDepthPassJSON(pFile, "depthPass", with.DepthPass, false);
+    WriteDepthPassJSON(pFile, "shadingPass", with.ShadingPass, false);
+    fprintf(pFile, "      \"cost\": %.0f\n  },\n  \"withoutPrepass\": {\n", with.Cost);
+    WriteDepthPassJSON(pFile, "shadingPass", without.ShadingPass, false);
+    fprintf(pFile, "      \"cost\": %.0f\n  },\n", without.Cost);
+    fprintf(pFile, "  \"prepassPaysOff\": %s,\n  \"breakEvenQuadCost\": %.3f\n}\n",
+            comparison.PrepassPaysOff() ? "true" : "false", comparison.GetBreakEvenQuadCost());
+    fclose(pFile);
+
+    return 0;
+}
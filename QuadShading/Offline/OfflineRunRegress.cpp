@@ -0,0 +1,136 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineRunRegress.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#include "OfflineRun.h"
+#include "OfflineCompositor.h"
+#include "OfflineMethods.h"
+#include "OfflineRegression.h"
+#include "DXUTframestats.h"
+
+#include <stdio.h>
+#include <string>
+
+
+//--------------------------------------------------------------------------------------
+// Shades the regression poses through all four methods and checks them against the
+// -regress golden file, at the size and depth format it was written with. Each pose
+// that fails lists what moved and writes its heatmap with the failed tiles marked to
+// <prefix>_regress_<pose>. -regress-update writes the file instead, keeping the
+// tolerances of the one it replaces.
+//--------------------------------------------------------------------------------------
+int OfflineRunRegress(const OfflineOptions& options, const COfflineMesh& mesh)
+{
+    uint64_t start = DXUTGetHighResTimeNs();
+
+    OfflineGolden golden;
+    bool loaded = OfflineLoadGolden(options.goldenFile, &golden);
+    OfflineOptions poseOptions = options;
+    if (options.bUpdateGolden)
+    {
+        golden.Width       = options.width;
+        golden.Height      = options.height;
+        golden.DepthFormat = options.depthFormat;
+        golden.Triangles   = mesh.GetNumTriangles();
+        golden.Vertices    = mesh.GetNumVertices();
+        golden.Results.clear();
+    }
+    else if (!loaded)
+    {
+        fprintf(stderr, "Failed to read golden statistics from %s\n", options.goldenFile);
+        return 1;
+    }
+    else if (golden.Triangles != mesh.GetNumTriangles() || golden.Vertices != mesh.GetNumVertices())
+    {
+        fprintf(stderr, "%s is for a mesh of %u triangles and %u vertices, not %s\n", options.goldenFile,
+                golden.Triangles, golden.Vertices, options.meshFile);
+        return 1;
+    }
+    poseOptions.width       = golden.Width;
+    poseOptions.height      = golden.Height;
+    poseOptions.depthFormat = golden.DepthFormat;
+
+    COfflineRasterizer rasterizer;
+    COfflineMethods methods;
+    const uint32_t gridWidth  = OfflineGetQuadGridSize(golden.Width);
+    const uint32_t gridHeight = OfflineGetQuadGridSize(golden.Height);
+
+    printf("%-10s %12s %11s %9s\n", "pose", "quads", "efficiency", "result");
+    uint32_t failedPoses = 0;
+    for (uint32_t p = 0; p < OfflineGetNumRegressPoses(); p++)
+    {
+        const char* pose = OfflineGetRegressPose(p).Name;
+        OfflineCamera camera;
+        OfflineGetRegressCamera(p, OfflineGetDefaultCamera(mesh), &camera);
+
+        methods.Resize(gridWidth, gridHeight);
+        rasterizer.Reset();
+        OfflineRunShadingPass(poseOptions, mesh, OfflineGetViewProjection(camera, golden.Width, golden.Height),
+                              &rasterizer, &methods);
+
+        OfflineRegressResult result;
+        result.Pose = pose;
+        OfflineCaptureRegressResult(methods, &result);
+
+        OfflineLiveTotals totals;
+        totals.Quads = result.Quads[OFFLINE_REFERENCE_METHOD];
+        for (uint32_t s = 0; s < OFFLINE_NB_SLICES; s++)
+            totals.LiveStats[s] = result.LiveStats[OFFLINE_REFERENCE_METHOD][s];
+
+        if (options.bUpdateGolden)
+        {
+            golden.Results.push_back(result);
+            printf("%-10s %12llu %10.2f%% %9s\n", pose, (unsigned long long)totals.Quads,
+                   100.0*OfflineGetEfficiency(totals), "written");
+            continue;
+        }
+
+        std::vector<std::string> failures;
+        std::vector<uint8_t> tileFailed;
+        const OfflineRegressResult* pGolden = OfflineFindRegressResult(golden, pose);
+        if (pGolden)
+            OfflineCompareRegressResults(*pGolden, result, golden.Tolerances, &failures, &tileFailed);
+        else
+            failures.push_back("no golden statistics for this pose");
+
+        printf("%-10s %12llu %10.2f%% %9s\n", pose, (unsigned long long)totals.Quads,
+               100.0*OfflineGetEfficiency(totals), failures.empty() ? "ok" : "FAILED");
+        for (size_t f = 0; f < failures.size(); f++)
+            printf("    %s\n", failures[f].c_str());
+
+        if (failures.empty())
+            continue;
+        failedPoses++;
+
+        if (pGolden)
+        {
+            OfflineImage image;
+            OfflineComposeHeatmap(methods.GetOverdraw(OFFLINE_REFERENCE_METHOD), false, golden.Width, golden.Height,
+                                  &image);
+            OfflineDrawRegressDelta(*pGolden, result, tileFailed, &image);
+
+            std::string fileName = std::string(options.outputPrefix) + "_regress_" + pose + "." +
+                                   OfflineGetImageFormatName(options.imageFormat);
+            if (!OfflineWriteImage(fileName.c_str(), image, options.imageFormat))
+                fprintf(stderr, "Failed to write %s\n", fileName.c_str());
+        }
+    }
+
+    const double seconds = (DXUTGetHighResTimeNs() - start)*1e-9;
+    if (options.bUpdateGolden)
+    {
+        if (!OfflineSaveGolden(options.goldenFile, golden))
+        {
+            fprintf(stderr, "Failed to write %s\n", options.goldenFile);
+            return 1;
+        }
+        printf("%u poses at %ux%u written to %s in %.2f s\n", OfflineGetNumRegressPoses(), golden.Width,
+               golden.Height, options.goldenFile, seconds);
+        return 0;
+    }
+
+    printf("%u of %u poses failed at %ux%u, in %.2f s\n", failedPoses, OfflineGetNumRegressPoses(), golden.Width,
+           golden.Height, seconds);
+    return failedPoses ? 1 : 0;
+}
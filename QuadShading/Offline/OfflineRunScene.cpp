@@ -0,0 +1,137 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineRunScene.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#include "OfflineRun.h"
+#include "OfflineCompositor.h"
+#include "OfflineMethods.h"
+#include "OfflineMultiView.h"
+#include "OfflineScene.h"
+#include "DXUTframestats.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <string>
+
+
+//--------------------------------------------------------------------------------------
+// Shades every camera of -scene, a frame at a time, with each quad costed by its
+// asset's material overrides or -quad-cost. Prints each camera's mean and then where
+// the cost went by asset, and writes the first frame's heatmap to <prefix>_scene and
+// the distribution of frame times to <prefix>_scene_frametimes.
+//--------------------------------------------------------------------------------------
+int OfflineRunScene(const OfflineOptions& options)
+{
+    COfflineScene scene;
+    uint64_t start = DXUTGetHighResTimeNs();
+    if (!scene.Load(options.sceneFile, options.threads))
+    {
+        fprintf(stderr, "%s\n", scene.GetError().c_str());
+        return 1;
+    }
+    if (scene.GetInstances().empty())
+    {
+        fprintf(stderr, "%s has no instances\n", options.sceneFile);
+        return 1;
+    }
+    printf("%u assets, %u instances, %u meshes loaded in %.2f ms on %u threads\n", scene.GetNumAssets(),
+           (uint32_t)scene.GetInstances().size(), scene.GetNumMeshes(), (DXUTGetHighResTimeNs() - start)*1e-6,
+           std::min(options.threads, scene.GetNumMeshes()));
+
+    COfflineInstancedScene instanced;
+    instanced.SetInstances(scene.GetInstances());
+
+    Vec3 boundsMin, boundsMax;
+    instanced.GetBounds(&boundsMin, &boundsMax);
+    OfflineCamera framing = OfflineGetDefaultCamera(scene.GetMesh(0));
+    OfflineFrameBounds(boundsMin, boundsMax, &framing);
+
+    // Without cameras the scene is looked at once, framed
+    std::vector<COfflineOrbitPath> paths(std::max(scene.GetNumCameras(), 1u));
+    if (scene.GetNumCameras())
+    {
+        for (uint32_t c = 0; c < scene.GetNumCameras(); c++)
+            scene.GetCameraPath(c, framing, &paths[c]);
+    }
+    else
+        paths[0].Setup(framing, 1, 1);
+
+    COfflineSceneCost sceneCost, cameraCost;
+    sceneCost.Setup(scene, options.quadCost);
+    COfflineDepthBuffer depth;
+    depth.Resize(options.width, options.height, options.depthFormat);
+    COfflineViewOverdraw overdraw;
+    overdraw.Resize(OfflineGetQuadGridSize(options.width), OfflineGetQuadGridSize(options.height));
+
+    printf("%-16s %8s %12s %11s %14s %10s %10s\n", "camera", "frames", "quads/frame", "efficiency", "cost/frame",
+           "ms/frame", "p99 ms");
+    CDXUTFrameStats sceneFrames, cameraFrames;
+    uint32_t totalFrames = 0;
+    for (size_t c = 0; c < paths.size(); c++)
+    {
+        cameraCost.Setup(scene, options.quadCost);
+        cameraFrames.Reset();
+
+        for (uint32_t frame = 0; frame < paths[c].GetNumFrames(); frame++)
+        {
+            OfflineCamera camera;
+            paths[c].GetCamera(frame, &camera);
+
+            uint64_t frameStart = DXUTGetHighResTimeNs();
+            instanced.Setup(OfflineGetViewProjection(camera, options.width, options.height), options.width,
+                            options.height, options.threads);
+            depth.Clear(1.0f);
+            instanced.Rasterize(&depth, OFFLINE_DEPTH_PREPASS, NULL);
+            instanced.Rasterize(&depth, OFFLINE_DEPTH_EARLY_TEST, &cameraCost);
+            uint64_t frameNs = DXUTGetHighResTimeNs() - frameStart;
+            cameraFrames.AddSample(frameNs);
+            sceneFrames.AddSample(frameNs);
+
+            if (c == 0 && frame == 0)
+                instanced.Rasterize(&depth, OFFLINE_DEPTH_EARLY_TEST, &overdraw);
+        }
+
+        const uint32_t frames = paths[c].GetNumFrames();
+        const OfflineSceneStats totals = cameraCost.GetTotals();
+        DXUTFrameStatsSummary frameTimes;
+        cameraFrames.GetSummary(0, &frameTimes);
+        printf("%-16s %8u %12.0f %10.2f%% %14.0f %10.2f %10.2f\n",
+               scene.GetNumCameras() ? scene.GetCamera((uint32_t)c).Name.c_str() : "framed", frames,
+               (double)totals.Liveness.Quads/frames, 100.0*OfflineGetEfficiency(totals.Liveness), totals.Cost/frames,
+               frameTimes.fMeanMs, frameTimes.fP99Ms);
+
+        sceneCost.Add(cameraCost);
+        totalFrames += frames;
+    }
+    OfflinePrintFrameStats("frame times", sceneFrames);
+
+    const OfflineSceneStats totals = sceneCost.GetTotals();
+    printf("\n%-16s %-24s %9s %14s %11s %8s\n", "asset", "mesh", "instances", "quads/frame", "efficiency",
+           "cost");
+    for (uint32_t a = 0; a < scene.GetNumAssets(); a++)
+    {
+        const OfflineSceneAsset& asset = scene.GetAsset(a);
+        const OfflineSceneStats& stats = sceneCost.GetAsset(a);
+
+        const std::string& file = scene.GetMeshFile(asset.Mesh);
+        size_t slash = file.find_last_of("/\\");
+        printf("%-16s %-24s %9u %14.0f %10.2f%% %7.1f%%\n", asset.Name.c_str(),
+               file.c_str() + (slash == std::string::npos ? 0 : slash + 1), asset.Instances,
+               (double)stats.Liveness.Quads/totalFrames, 100.0*OfflineGetEfficiency(stats.Liveness),
+               totals.Cost > 0.0 ? 100.0*stats.Cost/totals.Cost : 0.0);
+    }
+
+    OfflineImage image;
+    OfflineComposeHeatmap(overdraw.GetOverdraw(), false, options.width, options.height, &image);
+    std::string prefix = std::string(options.outputPrefix) + "_scene";
+    if (!OfflineWriteImage((prefix + "." + OfflineGetImageFormatName(options.imageFormat)).c_str(), image,
+                           options.imageFormat) ||
+        !OfflineWriteFrameStats(prefix, sceneFrames))
+    {
+        fprintf(stderr, "Failed to write %s*\n", prefix.c_str());
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,126 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineRunSizes.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+#include "OfflineRun.h"
+#include "OfflineMethods.h"
+#include "OfflineSizeHistogram.h"
+
+#include <stdio.h>
+#include <string>
+
+
+//--------------------------------------------------------------------------------------
+static void WriteSizeBucketJSON(FILE* pFile, const OfflineSizeBucket& bucket)
+{
+    const OfflineLiveTotals& live = bucket.Liveness;
+    fprintf(pFile, "\"triangles\": %u, \"quads\": %llu, \"liveStats\": [%llu, %llu, %llu, %llu]", bucket.Triangles,
+            (unsigned long long)live.Quads, (unsigned long long)live.LiveStats[0], (unsigned long long)live.LiveStats[1],
+            (unsigned long long)live.LiveStats[2], (unsigned long long)live.LiveStats[3]);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Shading-pass quads by the area and edge ratio of their triangles: a table by area,
+// the full area by ratio by liveness histogram as CSV, and both as JSON
+//--------------------------------------------------------------------------------------
+int OfflineRunSizes(const OfflineOptions& options, const COfflineMesh& mesh)
+{
+    COfflineRasterizer rasterizer;
+    COfflineSizeHistogram histogram;
+    OfflineRunShadingPass(options, mesh, &rasterizer, &histogram);
+
+    uint64_t totalQuads = 0;
+    for (uint32_t a = 0; a < OFFLINE_AREA_BUCKETS; a++)
+        totalQuads += histogram.GetAreaBucket(a).Liveness.Quads;
+
+    printf("%-14s %10s %10s %8s %8s %8s %8s %10s %8s\n", "area (pixels)", "triangles", "quads", "1 live", "2 live",
+           "3 live", "4 live", "efficiency", "share");
+    for (uint32_t a = 0; a < OFFLINE_AREA_BUCKETS; a++)
+    {
+        OfflineSizeBucket bucket = histogram.GetAreaBucket(a);
+        const OfflineLiveTotals& live = bucket.Liveness;
+        if (!live.Quads)
+            continue;
+
+        char range[32];
+        sprintf(range, "%g+", OfflineGetAreaBucketMin(a));
+        printf("%-14s %10u %10llu %8llu %8llu %8llu %8llu %9.2f%% %7.2f%%\n", range, bucket.Triangles,
+               (unsigned long long)live.Quads, (unsigned long long)live.LiveStats[0],
+               (unsigned long long)live.LiveStats[1], (unsigned long long)live.LiveStats[2],
+               (unsigned long long)live.LiveStats[3], 100.0*OfflineGetEfficiency(live),
+               totalQuads ? 100.0*live.Quads/totalQuads : 0.0);
+    }
+
+    // Open-ended upper bounds are left empty
+    std::string prefix = options.outputPrefix;
+    FILE* pCSV = fopen((prefix + "_sizes.csv").c_str(), "wt");
+    FILE* pFile = fopen((prefix + "_sizes.json").c_str(), "wt");
+    if (!pCSV || !pFile)
+    {
+        if (pCSV)
+            fclose(pCSV);
+        if (pFile)
+            fclose(pFile);
+        fprintf(stderr, "Failed to write %s_sizes.*\n", options.outputPrefix);
+        return 1;
+    }
+
+    fprintf(pCSV, "areaMin,areaMax,ratioMin,ratioMax,triangles,quads,live1,live2,live3,live4,efficiency\n");
+    for (uint32_t a = 0; a < OFFLINE_AREA_BUCKETS; a++)
+    {
+        for (uint32_t r = 0; r < OFFLINE_RATIO_BUCKETS; r++)
+        {
+            const OfflineSizeBucket& bucket = histogram.GetBucket(a, r);
+            const OfflineLiveTotals& live = bucket.Liveness;
+            fprintf(pCSV, "%g,", OfflineGetAreaBucketMin(a));
+            if (a + 1 < OFFLINE_AREA_BUCKETS)
+                fprintf(pCSV, "%g", OfflineGetAreaBucketMin(a + 1));
+            fprintf(pCSV, ",%g,", OfflineGetRatioBucketMin(r));
+            if (r + 1 < OFFLINE_RATIO_BUCKETS)
+                fprintf(pCSV, "%g", OfflineGetRatioBucketMin(r + 1));
+            fprintf(pCSV, ",%u,%llu,%llu,%llu,%llu,%llu,%.6f\n", bucket.Triangles, (unsigned long long)live.Quads,
+                    (unsigned long long)live.LiveStats[0], (unsigned long long)live.LiveStats[1],
+                    (unsigned long long)live.LiveStats[2], (unsigned long long)live.LiveStats[3],
+                    OfflineGetEfficiency(live));
+        }
+    }
+    fclose(pCSV);
+
+    fprintf(pFile, "{\n  \"mesh\": ");
+    OfflineWriteJSONString(pFile, options.meshFile);
+    fprintf(pFile, ",\n  \"width\": %u,\n  \"height\": %u,\n  \"quads\": %llu,\n  \"areaMin\": [",
+            options.width, options.height, (unsigned long long)totalQuads);
+    for (uint32_t a = 0; a < OFFLINE_AREA_BUCKETS; a++)
+        fprintf(pFile, "%g%s", OfflineGetAreaBucketMin(a), a + 1 < OFFLINE_AREA_BUCKETS ? ", " : "");
+    fprintf(pFile, "],\n  \"ratioMin\": [");
+    for (uint32_t r = 0; r < OFFLINE_RATIO_BUCKETS; r++)
+        fprintf(pFile, "%g%s", OfflineGetRatioBucketMin(r), r + 1 < OFFLINE_RATIO_BUCKETS ? ", " : "");
+
+    // By area, then by area and ratio
+    fprintf(pFile, "],\n  \"byArea\": [\n");
+    for (uint32_t a = 0; a < OFFLINE_AREA_BUCKETS; a++)
+    {
+        fprintf(pFile, "    { ");
+        WriteSizeBucketJSON(pFile, histogram.GetAreaBucket(a));
+        fprintf(pFile, " }%s\n", a + 1 < OFFLINE_AREA_BUCKETS ? "," : "");
+    }
+    fprintf(pFile, "  ],\n  \"byAreaAndRatio\": [\n");
+    for (uint32_t a = 0; a < OFFLINE_AREA_BUCKETS; a++)
+    {
+        fprintf(pFile, "    [\n");
+        for (uint32_t r = 0; r < OFFLINE_RATIO_BUCKETS; r++)
+        {
+            fprintf(pFile, "      { ");
+            WriteSizeBucketJSON(pFile, histogram.GetBucket(a, r));
+            fprintf(pFile, " }%s\n", r + 1 < OFFLINE_RATIO_BUCKETS ? "," : "");
+        }
+        fprintf(pFile, "    ]%s\n", a + 1 < OFFLINE_AREA_BUCKETS ? "," : "");
+    }
+    fprintf(pFile, "  ]\n}\n");
+    fclose(pFile);
+
+    return 0;
+}
@@ -0,0 +1,176 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineRunStress.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+#include "OfflineRun.h"
+#include "OfflineLockStress.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+#include <string>
+
+
+//--------------------------------------------------------------------------------------
+// CAS failures per quad on a log scale, so that isolated collisions still show up
+//--------------------------------------------------------------------------------------
+static bool WriteContentionPGM(const std::string& fileName, const COfflineLockStress& stress)
+{
+    uint32_t maxFailures = 0;
+    for (uint32_t y = 0; y < stress.GetHeight(); y++)
+    {
+        for (uint32_t x = 0; x < stress.GetWidth(); x++)
+            maxFailures = std::max(maxFailures, stress.GetContention(x, y));
+    }
+
+    std::vector<uint8_t> pixels((size_t)stress.GetWidth()*stress.GetHeight(), 0);
+    if (maxFailures)
+    {
+        double scale = 255.0/log(1.0 + maxFailures);
+        for (uint32_t y = 0; y < stress.GetHeight(); y++)
+        {
+            for (uint32_t x = 0; x < stress.GetWidth(); x++)
+                pixels[(size_t)y*stress.GetWidth() + x] = (uint8_t)(log(1.0 + stress.GetContention(x, y))*scale + 0.5);
+        }
+    }
+
+    return OfflineWritePGM(fileName, pixels.empty() ? NULL : &pixels[0], stress.GetWidth(), stress.GetHeight(), 255);
+}
+
+
+//--------------------------------------------------------------------------------------
+static void WriteStressResultJSON(FILE* pFile, const OfflineStressResult& result)
+{
+    fprintf(pFile, "{ \"mode\": \"%s\", \"threads\": %u, \"ms\": %.3f, \"invocations\": %llu, "
+                   "\"expectedQuads\": %llu, \"countedQuads\": %llu, \"lostQuads\": %llu, \"extraQuads\": %llu, "
+                   "\"expectedLiveStats\": [%llu, %llu, %llu, %llu], \"liveStats\": [%llu, %llu, %llu, %llu], "
+                   "\"statsOutOfRange\": %llu, \"budgetExhausted\": %llu, \"casFailures\": %llu, "
+                   "\"leakedLocks\": %u, \"residualCounts\": %u, \"maxIterations\": %u, \"exact\": %s }",
+            OfflineGetStressModeName(result.Mode), result.Threads, result.ElapsedNs*1e-6,
+            (unsigned long long)result.Invocations, (unsigned long long)result.ExpectedQuads,
+            (unsigned long long)result.CountedQuads, (unsigned long long)result.LostQuads,
+            (unsigned long long)result.ExtraQuads,
+            (unsigned long long)result.ExpectedLiveStats[0], (unsigned long long)result.ExpectedLiveStats[1],
+            (unsigned long long)result.ExpectedLiveStats[2], (unsigned long long)result.ExpectedLiveStats[3],
+            (unsigned long long)result.LiveStats[0], (unsigned long long)result.LiveStats[1],
+            (unsigned long long)result.LiveStats[2], (unsigned long long)result.LiveStats[3],
+            (unsigned long long)result.StatsOutOfRange, (unsigned long long)result.BudgetExhausted,
+            (unsigned long long)result.CASFailures, result.LeakedLocks, result.ResidualCounts, result.MaxIterations,
+            result.IsExact() ? "true" : "false");
+}
+
+
+//--------------------------------------------------------------------------------------
+// Replays the shading pass's quads through ScenePS1's lock, with the lanes of each wave
+// in lockstep as on the GPU and then with every lane on its own, and through the
+// lock-free alternative. Each mode is run several times, since the interleaving of the
+// threads changes from run to run.
+//--------------------------------------------------------------------------------------
+int OfflineRunStress(const OfflineOptions& options, const COfflineMesh& mesh)
+{
+    COfflineFragmentRecorder fragments;
+    if (options.replayFile)
+    {
+        if (!fragments.Load(options.replayFile))
+        {
+            fprintf(stderr, "Failed to load %s\n", options.replayFile);
+            return 1;
+        }
+    }
+    else
+    {
+        COfflineRasterizer rasterizer;
+        fragments.SetGrid(OfflineGetQuadGridSize(options.width), OfflineGetQuadGridSize(options.height));
+        OfflineRunShadingPass(options, mesh, &rasterizer, &fragments);
+    }
+
+    if (options.recordFile && !fragments.Save(options.recordFile))
+    {
+        fprintf(stderr, "Failed to write %s\n", options.recordFile);
+        return 1;
+    }
+
+    uint32_t aliasedIDs = fragments.CountAliasedIDs();
+    printf("%u quads (%ux%u grid), %u with a primitive ID aliasing the previous quad's\n",
+           fragments.GetNumFragments(), fragments.GetGridWidth(), fragments.GetGridHeight(), aliasedIDs);
+
+    std::vector<OfflineStressResult> results;
+    std::vector<OfflineStressHotSpot> hotSpots;
+
+    COfflineLockStress stress;
+    for (int mode = 0; mode < OFFLINE_NB_STRESS_MODES; mode++)
+    {
+        // Contention is only of interest for the lock as the GPU runs it
+        if (mode == OFFLINE_STRESS_LOCKSTEP)
+            stress.ClearContention();
+
+        for (uint32_t run = 0; run < options.runs; run++)
+            results.push_back(stress.Run(fragments, (OFFLINE_STRESS_MODE)mode, options.threads));
+
+        if (mode == OFFLINE_STRESS_LOCKSTEP)
+        {
+            stress.GetHotSpots(16, &hotSpots);
+            std::string prefix = options.outputPrefix;
+            if (!WriteContentionPGM(prefix + "_contention.pgm", stress))
+                fprintf(stderr, "Failed to write %s_contention.pgm\n", options.outputPrefix);
+        }
+    }
+
+    printf("%-12s %9s %10s %8s %8s %10s %8s %10s %6s %6s  %s\n", "mode", "ms", "counted", "lost", "extra",
+           "exhausted", "leaked", "CAS fails", "iters", "stats", "");
+    bool lockSafe = true;
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const OfflineStressResult& result = results[i];
+        bool exact = result.IsExact();
+        if (result.Mode == OFFLINE_STRESS_LOCKSTEP)
+            lockSafe = lockSafe && exact;
+
+        printf("%-12s %9.2f %10llu %8llu %8llu %10llu %8u %10llu %6u %6s  %s\n", OfflineGetStressModeName(result.Mode),
+               result.ElapsedNs*1e-6, (unsigned long long)result.CountedQuads, (unsigned long long)result.LostQuads,
+               (unsigned long long)result.ExtraQuads, (unsigned long long)result.BudgetExhausted, result.LeakedLocks,
+               (unsigned long long)result.CASFailures, result.MaxIterations,
+               result.LiveStats[0] == result.ExpectedLiveStats[0] && result.LiveStats[1] == result.ExpectedLiveStats[1] &&
+               result.LiveStats[2] == result.ExpectedLiveStats[2] && result.LiveStats[3] == result.ExpectedLiveStats[3] ?
+               "ok" : "wrong", exact ? "exact" : "INEXACT");
+    }
+
+    if (!hotSpots.empty())
+    {
+        printf("Hottest quads under lockstep:");
+        for (size_t i = 0; i < hotSpots.size() && i < 8; i++)
+            printf(" (%u,%u):%u", hotSpots[i].X, hotSpots[i].Y, hotSpots[i].CASFailures);
+        printf("\n");
+    }
+    printf("ScenePS1 lock %s on %u threads over %u runs\n", lockSafe ? "exact" : "INEXACT", options.threads, options.runs);
+
+    std::string fileName = std::string(options.outputPrefix) + "_stress.json";
+    FILE* pFile = fopen(fileName.c_str(), "wt");
+    if (!pFile)
+    {
+        fprintf(stderr, "Failed to write %s\n", fileName.c_str());
+        return 1;
+    }
+
+    fprintf(pFile, "{\n  \"quads\": %u,\n  \"gridWidth\": %u,\n  \"gridHeight\": %u,\n  \"aliasedIDs\": %u,\n",
+            fragments.GetNumFragments(), fragments.GetGridWidth(), fragments.GetGridHeight(), aliasedIDs);
+    fprintf(pFile, "  \"lockstepExact\": %s,\n  \"runs\": [\n", lockSafe ? "true" : "false");
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        fprintf(pFile, "    ");
+        WriteStressResultJSON(pFile, results[i]);
+        fprintf(pFile, "%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(pFile, "  ],\n  \"hotSpots\": [");
+    for (size_t i = 0; i < hotSpots.size(); i++)
+    {
+        fprintf(pFile, "%s{ \"x\": %u, \"y\": %u, \"casFailures\": %u }", i ? ", " : "",
+                hotSpots[i].X, hotSpots[i].Y, hotSpots[i].CASFailures);
+    }
+    fprintf(pFile, "]\n}\n");
+    fclose(pFile);
+
+    return 0;
+}
@@ -0,0 +1,142 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineRunTiles.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+#include "OfflineRun.h"
+#include "OfflineMethods.h"
+#include "OfflineTiles.h"
+#include "DXUTframestats.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+
+
+//--------------------------------------------------------------------------------------
+// Region queries checked against summing the full-resolution counts directly
+//--------------------------------------------------------------------------------------
+static bool CheckTileQuery(const COfflineTilePyramid& pyramid, const COfflineOverdraw& overdraw, bool bSlices,
+                           uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1)
+{
+    OfflineTileStats expected;
+    OfflineClearTileStats(&expected);
+    for (uint32_t y = y0; y < y1; y++)
+    {
+        for (uint32_t x = x0; x < x1; x++)
+        {
+            uint32_t count = overdraw.GetQuadCount(x, y, bSlices);
+            expected.Quads++;
+            expected.Max  = std::max(expected.Max, count);
+            expected.Sum += count;
+            expected.Histogram[std::min(count, (uint32_t)OFFLINE_TILE_BINS - 1)]++;
+        }
+    }
+
+    OfflineTileStats stats = pyramid.QueryRegion(x0, y0, x1, y1);
+    return memcmp(&stats, &expected, sizeof(stats)) == 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+// The reference method's overdraw as a tile pyramid, timed over -runs builds
+//--------------------------------------------------------------------------------------
+int OfflineRunTiles(const OfflineOptions& options, const COfflineMesh& mesh)
+{
+    COfflineRasterizer rasterizer;
+    COfflineMethods methods;
+    methods.Resize(OfflineGetQuadGridSize(options.width), OfflineGetQuadGridSize(options.height));
+    OfflineRunShadingPass(options, mesh, &rasterizer, &methods);
+
+    const COfflineOverdraw& overdraw = methods.GetOverdraw(OFFLINE_REFERENCE_METHOD);
+    const bool bSlices = OFFLINE_REFERENCE_METHOD == OFFLINE_METHOD_SLICES;
+
+    COfflineTilePyramid pyramid;
+    uint64_t buildNs = ~0ull;
+    for (uint32_t run = 0; run < options.runs; run++)
+    {
+        uint64_t start = DXUTGetHighResTimeNs();
+        pyramid.Build(overdraw, bSlices, options.threads);
+        buildNs = std::min(buildNs, DXUTGetHighResTimeNs() - start);
+    }
+
+    // The whole grid, the middle quarter, and a region cutting through coarse tiles
+    const uint32_t w = overdraw.GetWidth(), h = overdraw.GetHeight();
+    const uint32_t align = OFFLINE_TILE_BASE_SIZE;
+    uint32_t failures = 0;
+    failures += CheckTileQuery(pyramid, overdraw, bSlices, 0, 0, w, h) ? 0 : 1;
+    failures += CheckTileQuery(pyramid, overdraw, bSlices, w/4/align*align, h/4/align*align, 3*w/4/align*align,
+                               3*h/4/align*align) ? 0 : 1;
+    failures += CheckTileQuery(pyramid, overdraw, bSlices, 5*align, 3*align, std::min(25*align, w/align*align),
+                               std::min(22*align, h/align*align)) ? 0 : 1;
+
+    printf("built in %.3f ms on %u threads, %u of 3 region queries disagree with the counts\n", buildNs*1e-6,
+           options.threads, failures);
+    printf("%-6s %8s %8s %10s %6s %10s %12s\n", "tile", "pixels", "tiles", "non-empty", "max", "mean", "over budget");
+    for (uint32_t l = 0; l < OFFLINE_TILE_LEVELS; l++)
+    {
+        const uint32_t tiles = pyramid.GetTilesX(l)*pyramid.GetTilesY(l);
+
+        uint32_t nonEmpty = 0, max = 0;
+        double meanSum = 0.0;
+        for (uint32_t y = 0; y < pyramid.GetTilesY(l); y++)
+        {
+            for (uint32_t x = 0; x < pyramid.GetTilesX(l); x++)
+            {
+                const OfflineTileStats& tile = pyramid.GetTile(l, x, y);
+                if (!tile.Sum)
+                    continue;
+                nonEmpty++;
+                max      = std::max(max, tile.Max);
+                meanSum += (double)tile.Sum/tile.Quads;
+            }
+        }
+
+        uint32_t over = pyramid.CountTilesOver(l, options.tileBudget);
+        printf("%-6u %8u %8u %10u %6u %10.3f %11.2f%%\n", COfflineTilePyramid::GetTileSize(l),
+               2*COfflineTilePyramid::GetTileSize(l), tiles, nonEmpty, max, nonEmpty ? meanSum/nonEmpty : 0.0,
+               tiles ? 100.0*over/tiles : 0.0);
+    }
+
+    std::string fileName = std::string(options.outputPrefix) + "_tiles.json";
+    FILE* pFile = fopen(fileName.c_str(), "wt");
+    if (!pFile)
+    {
+        fprintf(stderr, "Failed to write %s\n", fileName.c_str());
+        return 1;
+    }
+
+    fprintf(pFile, "{\n  \"mesh\": ");
+    OfflineWriteJSONString(pFile, options.meshFile);
+    fprintf(pFile, ",\n  \"method\": \"%s\",\n  \"gridWidth\": %u,\n  \"gridHeight\": %u,\n  \"buildMs\": %.3f,\n"
+                   "  \"budget\": %.3f,\n  \"queryFailures\": %u,\n  \"levels\": [\n",
+            OfflineGetMethodName(OFFLINE_REFERENCE_METHOD), w, h, buildNs*1e-6, options.tileBudget, failures);
+
+    // Row by row, with the histogram's last bin holding everything past it
+    for (uint32_t l = 0; l < OFFLINE_TILE_LEVELS; l++)
+    {
+        fprintf(pFile, "    { \"tileSize\": %u, \"tilesX\": %u, \"tilesY\": %u, \"overBudget\": %u, \"tiles\": [\n",
+                COfflineTilePyramid::GetTileSize(l), pyramid.GetTilesX(l), pyramid.GetTilesY(l),
+                pyramid.CountTilesOver(l, options.tileBudget));
+        for (uint32_t y = 0; y < pyramid.GetTilesY(l); y++)
+        {
+            for (uint32_t x = 0; x < pyramid.GetTilesX(l); x++)
+            {
+                const OfflineTileStats& tile = pyramid.GetTile(l, x, y);
+                fprintf(pFile, "      { \"quads\": %u, \"sum\": %llu, \"max\": %u, \"histogram\": [", tile.Quads,
+                        (unsigned long long)tile.Sum, tile.Max);
+                for (uint32_t i = 0; i < OFFLINE_TILE_BINS; i++)
+                    fprintf(pFile, "%u%s", tile.Histogram[i], i + 1 < OFFLINE_TILE_BINS ? ", " : "");
+                bool last = y + 1 == pyramid.GetTilesY(l) && x + 1 == pyramid.GetTilesX(l);
+                fprintf(pFile, "] }%s\n", last ? "" : ",");
+            }
+        }
+        fprintf(pFile, "    ] }%s\n", l + 1 < OFFLINE_TILE_LEVELS ? "," : "");
+    }
+    fprintf(pFile, "  ]\n}\n");
+    fclose(pFile);
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,111 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineRunVRS.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+#include "OfflineRun.h"
+#include "OfflineLockStress.h"
+#include "OfflineVRS.h"
+
+#include <stdio.h>
+#include <string>
+
+
+//--------------------------------------------------------------------------------------
+static void WriteVRSStatsJSON(FILE* pFile, const char* name, const OfflineVRSStats& stats,
+                              const OfflineVRSStats& fullRate, bool last)
+{
+    fprintf(pFile, "    { \"rates\": \"%s\", \"quads\": %llu, \"invocations\": %llu, \"shaded\": %llu, \"helperLanes\": %llu, "
+                   "\"invocationsSaved\": %lld, \"helperLanesChange\": %lld, \"tiles\": [%u, %u, %u, %u] }%s\n",
+            name, (unsigned long long)stats.Quads, (unsigned long long)stats.Invocations,
+            (unsigned long long)stats.Shaded, (unsigned long long)stats.HelperLanes,
+            (long long)fullRate.Invocations - (long long)stats.Invocations,
+            (long long)stats.HelperLanes - (long long)fullRate.HelperLanes,
+            stats.Tiles[0], stats.Tiles[1], stats.Tiles[2], stats.Tiles[3], last ? "" : ",");
+}
+
+static void PrintVRSStats(const char* name, const OfflineVRSStats& stats, const OfflineVRSStats& fullRate)
+{
+    double saved = fullRate.Invocations ? 100.0*(1.0 - (double)stats.Invocations/(double)fullRate.Invocations) : 0.0;
+    printf("%-10s %10llu %12llu %10llu %10llu %7.1f%% %+11lld\n", name, (unsigned long long)stats.Quads,
+           (unsigned long long)stats.Invocations, (unsigned long long)stats.Shaded,
+           (unsigned long long)stats.HelperLanes, saved,
+           (long long)stats.HelperLanes - (long long)fullRate.HelperLanes);
+}
+
+
+//--------------------------------------------------------------------------------------
+// The shading pass at each coarse rate, and under a shading-rate image picked from
+// the tiles' liveness or loaded with -vrs-rates
+//--------------------------------------------------------------------------------------
+int OfflineRunVRS(const OfflineOptions& options, const COfflineMesh& mesh)
+{
+    COfflineRasterizer rasterizer;
+    COfflineFragmentRecorder fragments;
+    fragments.SetGrid(OfflineGetQuadGridSize(options.width), OfflineGetQuadGridSize(options.height));
+    OfflineRunShadingPass(options, mesh, &rasterizer, &fragments);
+
+    COfflineVRS vrs;
+    if (!vrs.Simulate(fragments, options.vrsTile))
+    {
+        fprintf(stderr, "Invalid VRS tile size %u: must be a multiple of 4\n", options.vrsTile);
+        return 1;
+    }
+
+    if (options.vrsRatesFile)
+    {
+        if (!vrs.LoadRates(options.vrsRatesFile))
+        {
+            fprintf(stderr, "Failed to load a %ux%u shading-rate image from %s\n", vrs.GetTilesX(), vrs.GetTilesY(),
+                    options.vrsRatesFile);
+            return 1;
+        }
+    }
+    else
+        vrs.ChooseRates();
+
+    OfflineVRSStats uniform[OFFLINE_NB_SHADING_RATES];
+    for (int rate = 0; rate < OFFLINE_NB_SHADING_RATES; rate++)
+        uniform[rate] = vrs.GetUniformStats((OFFLINE_SHADING_RATE)rate);
+    OfflineVRSStats image = vrs.GetStats();
+    const char* imageName = options.vrsRatesFile ? "image" : "auto";
+
+    printf("%ux%u tiles of %u pixels; rate image (%s): %u 1x1, %u 1x2, %u 2x1, %u 2x2\n", vrs.GetTilesX(),
+           vrs.GetTilesY(), vrs.GetTileSize(), imageName, image.Tiles[0], image.Tiles[1], image.Tiles[2], image.Tiles[3]);
+    printf("%-10s %10s %12s %10s %10s %8s %11s\n", "rates", "quads", "invocations", "shaded", "helpers", "saved",
+           "helpers +/-");
+    for (int rate = 0; rate < OFFLINE_NB_SHADING_RATES; rate++)
+        PrintVRSStats(OfflineGetShadingRateName((OFFLINE_SHADING_RATE)rate), uniform[rate], uniform[0]);
+    PrintVRSStats(imageName, image, uniform[0]);
+
+    std::string prefix = options.outputPrefix;
+    if (!vrs.SaveRates((prefix + "_vrs_rates.pgm").c_str()) || !vrs.WriteHeatmap((prefix + "_vrs_rates.ppm").c_str()))
+    {
+        fprintf(stderr, "Failed to write %s_vrs_rates.*\n", options.outputPrefix);
+        return 1;
+    }
+
+    std::string fileName = prefix + "_vrs.json";
+    FILE* pFile = fopen(fileName.c_str(), "wt");
+    if (!pFile)
+    {
+        fprintf(stderr, "Failed to write %s\n", fileName.c_str());
+        return 1;
+    }
+
+    fprintf(pFile, "{\n  \"mesh\": ");
+    OfflineWriteJSONString(pFile, options.meshFile);
+    fprintf(pFile, ",\n  \"width\": %u,\n  \"height\": %u,\n  \"tileSize\": %u,\n  \"tilesX\": %u,\n  \"tilesY\": %u,\n",
+            options.width, options.height, vrs.GetTileSize(), vrs.GetTilesX(), vrs.GetTilesY());
+    fprintf(pFile, "  \"rateImage\": ");
+    OfflineWriteJSONString(pFile, options.vrsRatesFile ? options.vrsRatesFile : "auto");
+    fprintf(pFile, ",\n  \"results\": [\n");
+    for (int rate = 0; rate < OFFLINE_NB_SHADING_RATES; rate++)
+        WriteVRSStatsJSON(pFile, OfflineGetShadingRateName((OFFLINE_SHADING_RATE)rate), uniform[rate], uniform[0], false);
+    WriteVRSStatsJSON(pFile, imageName, image, uniform[0], true);
+    fprintf(pFile, "  ]\n}\n");
+    fclose(pFile);
+
+    return 0;
+}
@@ -0,0 +1,60 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineRunVideo.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#include "OfflineRun.h"
+
+#include <stdio.h>
+#include <string>
+
+
+//--------------------------------------------------------------------------------------
+// Heatmaps along the camera path, streamed to -video, with the distributions of frame
+// and shading times written to <prefix>_video_frametimes and _video_shade_frametimes
+//--------------------------------------------------------------------------------------
+int OfflineRunVideo(const OfflineOptions& options, const COfflineMesh& mesh)
+{
+    COfflineOrbitPath orbit;
+    COfflineKeyframePath keyframes;
+    const IOfflineCameraPath* pPath = OfflineGetCameraPath(options, mesh, &orbit, &keyframes);
+    if (!pPath)
+        return 1;
+
+    OfflineVideoSettings settings;
+    settings.Width        = options.width;
+    settings.Height       = options.height;
+    settings.DepthFormat  = options.depthFormat;
+    settings.Format       = options.videoFormat;
+    settings.Fps          = options.fps;
+    settings.ShadeThreads = options.threads;
+
+    COfflineVideoExporter exporter;
+    bool ok = exporter.Export(mesh, *pPath, settings, options.videoFile);
+
+    const OfflineVideoStats& stats = exporter.GetStats();
+    double seconds = stats.TotalNs*1e-9;
+    printf("%u of %u frames to %s in %.2f s (%.1f frames/s), %.1f MB, %u slots\n", stats.Frames, pPath->GetNumFrames(),
+           options.videoFile, seconds, seconds > 0.0 ? stats.Frames/seconds : 0.0, stats.Bytes/(1024.0*1024.0),
+           stats.Slots);
+    printf("busy: shade %.2f s on %u threads, colour %.2f s, encode %.2f s (waited %.2f s)\n", stats.ShadeNs*1e-9,
+           options.threads, stats.ColourNs*1e-9, stats.EncodeNs*1e-9, stats.EncodeWaitNs*1e-9);
+    OfflinePrintFrameStats("shade times", exporter.GetShadeTimes());
+    OfflinePrintFrameStats("frame times", exporter.GetFrameTimes());
+
+    if (!ok)
+    {
+        fprintf(stderr, "Failed to write %s\n", options.videoFile);
+        return 1;
+    }
+
+    std::string prefix = options.outputPrefix;
+    if (!OfflineWriteFrameStats(prefix + "_video", exporter.GetFrameTimes()) ||
+        !OfflineWriteFrameStats(prefix + "_video_shade", exporter.GetShadeTimes()))
+    {
+        fprintf(stderr, "Failed to write %s_video*\n", options.outputPrefix);
+        return 1;
+    }
+
+    return 0;
+}
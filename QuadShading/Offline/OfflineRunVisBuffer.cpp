@@ -0,0 +1,144 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineRunVisBuffer.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+#include "OfflineRun.h"
+#include "OfflineMethods.h"
+#include "OfflineVisBuffer.h"
+#include "DXUTframestats.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <string>
+
+
+//--------------------------------------------------------------------------------------
+// One depth-tested pass into a visibility buffer, then the quad metrics from its 2x2
+// blocks. A saved buffer can be re-analysed without the mesh.
+//--------------------------------------------------------------------------------------
+int OfflineRunVisBuffer(const OfflineOptions& options, const COfflineMesh& mesh)
+{
+    COfflineVisibilityBuffer visBuffer;
+    COfflineMethods methods;
+    bool haveForward = false;
+    uint64_t visPassNs = 0;
+
+    if (options.visFile)
+    {
+        if (!visBuffer.Load(options.visFile))
+        {
+            fprintf(stderr, "Failed to load %s\n", options.visFile);
+            return 1;
+        }
+    }
+    else
+    {
+        COfflineRasterizer rasterizer;
+        rasterizer.SetViewport(options.width, options.height);
+        rasterizer.SetupMesh(mesh, OfflineGetViewProjection(OfflineGetDefaultCamera(mesh), options.width, options.height),
+                             0);
+
+        COfflineDepthBuffer depth;
+        depth.Resize(options.width, options.height, options.depthFormat);
+        depth.Clear(1.0f);
+        visBuffer.Resize(options.width, options.height, options.depthFormat);
+
+        uint64_t start = DXUTGetHighResTimeNs();
+        rasterizer.Rasterize(&depth, OFFLINE_DEPTH_EARLY_WRITE, &visBuffer);
+        visPassNs = DXUTGetHighResTimeNs() - start;
+
+        // Forward shading as the demo does it, to check the deferred metrics against
+        methods.Resize(OfflineGetQuadGridSize(options.width), OfflineGetQuadGridSize(options.height));
+        depth.Clear(1.0f);
+        rasterizer.Rasterize(&depth, OFFLINE_DEPTH_PREPASS, NULL);
+        rasterizer.Rasterize(&depth, OFFLINE_DEPTH_EARLY_TEST, &methods);
+        haveForward = true;
+
+        std::string fileName = std::string(options.outputPrefix) + ".qsvb";
+        if (!visBuffer.Save(fileName.c_str()))
+        {
+            fprintf(stderr, "Failed to write %s\n", fileName.c_str());
+            return 1;
+        }
+    }
+
+    OfflineVisCostModel model;
+    model.ShadedQuadCost = options.quadCost;
+    model.PixelFetchCost = options.fetchCost;
+
+    OfflineVisStats stats;
+    std::vector<uint8_t> quadMap;
+    uint64_t start = DXUTGetHighResTimeNs();
+    visBuffer.Analyse(model, options.threads, &stats, &quadMap);
+    uint64_t analyseNs = DXUTGetHighResTimeNs() - start;
+
+    // Pixels where more than one triangle passed LESS_EQUAL are shaded more than once
+    // forward, but only the last is left in the buffer
+    const COfflineOverdraw& reference = methods.GetOverdraw(OFFLINE_METHOD_COVERAGE);
+    uint64_t inlineQuads = haveForward ? reference.GetTotalQuads(false) : 0;
+
+    double forwardLanes = 100.0*OfflineGetEfficiency(stats.PixelsCovered, stats.ForwardQuads);
+    double visLanes     = 100.0*OfflineGetEfficiency(stats.PixelsCovered, stats.BlocksCovered);
+    double quadSavings  = stats.ForwardQuads ? 100.0*(1.0 - (double)stats.BlocksCovered/(double)stats.ForwardQuads) : 0.0;
+
+    printf("Visibility buffer: %ux%u %s, %llu pixels covered\n", visBuffer.GetWidth(), visBuffer.GetHeight(),
+           OfflineGetDepthFormatName(visBuffer.GetFormat()), (unsigned long long)stats.PixelsCovered);
+    if (haveForward)
+    {
+        printf("Forward quads: %llu from the buffer, %llu shaded inline (%llu from depth ties)\n",
+               (unsigned long long)stats.ForwardQuads, (unsigned long long)inlineQuads,
+               (unsigned long long)(inlineQuads - std::min(inlineQuads, stats.ForwardQuads)));
+    }
+    printf("Live stats: %u %u %u %u, at most %u quads per block\n", stats.LiveStats[0], stats.LiveStats[1],
+           stats.LiveStats[2], stats.LiveStats[3], stats.MaxQuadsPerBlock);
+    printf("%-18s %10s %8s %14s\n", "shading", "quads", "lanes", "cost");
+    printf("%-18s %10llu %7.1f%% %14.0f\n", "forward", (unsigned long long)stats.ForwardQuads, forwardLanes,
+           stats.ForwardCost);
+    printf("%-18s %10u %7.1f%% %14.0f\n", "visibility buffer", stats.BlocksCovered, visLanes, stats.VisibilityCost);
+    printf("Visibility-buffer shading saves %.1f%% of quads; %.3f ms quad pass on %u threads",
+           quadSavings, analyseNs*1e-6, options.threads);
+    if (visPassNs)
+        printf(", %.3f ms visibility pass", visPassNs*1e-6);
+    printf("\n");
+
+    std::string prefix = options.outputPrefix;
+    if (!OfflineWritePGM(prefix + "_visquads.pgm", quadMap.empty() ? NULL : &quadMap[0],
+                         OfflineGetQuadGridSize(visBuffer.GetWidth()), OfflineGetQuadGridSize(visBuffer.GetHeight()), 4))
+    {
+        fprintf(stderr, "Failed to write %s_visquads.pgm\n", options.outputPrefix);
+        return 1;
+    }
+
+    std::string fileName = prefix + "_visbuffer.json";
+    FILE* pFile = fopen(fileName.c_str(), "wt");
+    if (!pFile)
+    {
+        fprintf(stderr, "Failed to write %s\n", fileName.c_str());
+        return 1;
+    }
+
+    fprintf(pFile, "{\n  \"source\": ");
+    OfflineWriteJSONString(pFile, options.visFile ? options.visFile : options.meshFile);
+    fprintf(pFile, ",\n  \"width\": %u,\n  \"height\": %u,\n  \"depthFormat\": \"%s\",\n", visBuffer.GetWidth(),
+            visBuffer.GetHeight(), OfflineGetDepthFormatName(visBuffer.GetFormat()));
+    fprintf(pFile, "  \"costModel\": { \"shadedQuad\": %.2f, \"pixelFetch\": %.2f },\n", model.ShadedQuadCost,
+            model.PixelFetchCost);
+    fprintf(pFile, "  \"pixelsCovered\": %llu,\n  \"blocksCovered\": %u,\n  \"maxQuadsPerBlock\": %u,\n",
+            (unsigned long long)stats.PixelsCovered, stats.BlocksCovered, stats.MaxQuadsPerBlock);
+    fprintf(pFile, "  \"forward\": { \"quads\": %llu, \"liveStats\": [%u, %u, %u, %u], \"laneUtilisation\": %.4f, "
+                   "\"cost\": %.0f",
+            (unsigned long long)stats.ForwardQuads, stats.LiveStats[0], stats.LiveStats[1], stats.LiveStats[2],
+            stats.LiveStats[3], forwardLanes/100.0, stats.ForwardCost);
+    if (haveForward)
+        fprintf(pFile, ", \"inlineQuads\": %llu", (unsigned long long)inlineQuads);
+    fprintf(pFile, " },\n  \"visibilityBuffer\": { \"quads\": %u, \"laneUtilisation\": %.4f, \"cost\": %.0f },\n",
+            stats.BlocksCovered, visLanes/100.0, stats.VisibilityCost);
+    fprintf(pFile, "  \"quadSavingsPercent\": %.2f,\n  \"ms\": { \"visibilityPass\": %.3f, \"quadPass\": %.3f },\n"
+                   "  \"threads\": %u\n}\n",
+            quadSavings, visPassNs*1e-6, analyseNs*1e-6, options.threads);
+    fclose(pFile);
+
+    return 0;
+}
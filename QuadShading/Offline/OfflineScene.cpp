@@ -0,0 +1,340 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineScene.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+#include "OfflineScene.h"
+#include "DXUTcacheindex.h"
+#include "DXUTprofiler.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <thread>
+
+#define OFFLINE_SCENE_MAX_LINE      1024
+
+//--------------------------------------------------------------------------------------
+// COfflineScene
+//--------------------------------------------------------------------------------------
+COfflineScene::COfflineScene()
+{
+}
+
+
+//--------------------------------------------------------------------------------------
+// Mesh files are gathered while parsing and loaded at the end, each once, so the
+// instances can only point at them after that
+//--------------------------------------------------------------------------------------
+bool COfflineScene::Load(const char* fileName, uint32_t threads)
+{
+    DXUT_PROFILE_SCOPE(L"Offline Scene Load");
+
+    m_Meshes.clear();
+    m_MeshFiles.clear();
+    m_Assets.clear();
+    m_Instances.clear();
+    m_InstanceAssets.clear();
+    m_Cameras.clear();
+    m_Error.clear();
+
+    FILE* pFile = fopen(fileName, "rt");
+    if (!pFile)
+    {
+        m_Error = std::string("Failed to open ") + fileName;
+        return false;
+    }
+
+    std::string directory = fileName;
+    size_t slash = directory.find_last_of("/\\");
+    directory = slash == std::string::npos ? "" : directory.substr(0, slash + 1);
+
+    char line[OFFLINE_SCENE_MAX_LINE];
+    uint32_t lineNumber = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), pFile))
+    {
+        lineNumber++;
+        ok = ParseLine(line, directory);
+    }
+    fclose(pFile);
+
+    if (!ok)
+    {
+        char location[32];
+        sprintf(location, "(%u): ", lineNumber);
+        m_Error = fileName + std::string(location) + m_Error;
+        return false;
+    }
+
+    m_Meshes.resize(m_MeshFiles.size());
+    std::vector<uint8_t> loaded(m_MeshFiles.size(), 0);
+    std::atomic<uint32_t> next(0);
+
+    std::vector<std::thread> workers;
+    for (uint32_t i = 1; i < std::min(threads, (uint32_t)m_MeshFiles.size()); i++)
+        workers.push_back(std::thread(&COfflineScene::LoadMeshes, this, &loaded, &next));
+    LoadMeshes(&loaded, &next);
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+
+    for (size_t m = 0; m < m_MeshFiles.size(); m++)
+    {
+        if (!loaded[m])
+        {
+            m_Error = "Failed to load " + m_MeshFiles[m];
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < m_Instances.size(); i++)
+        m_Instances[i].pMesh = &m_Meshes[m_Assets[m_InstanceAssets[i]].Mesh];
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineScene::LoadMeshes(std::vector<uint8_t>* pLoaded, std::atomic<uint32_t>* pNext)
+{
+    for (uint32_t m = (*pNext)++; m < m_MeshFiles.size(); m = (*pNext)++)
+        (*pLoaded)[m] = m_Meshes[m].Load(m_MeshFiles[m].c_str()) && m_Meshes[m].GetNumTriangles() ? 1 : 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool COfflineScene::ParseLine(const char* pLine, const std::string& directory)
+{
+    char keyword[16], name[256];
+    int  length = 0;
+    if (sscanf(pLine, " %15s%n", keyword, &length) < 1 || keyword[0] == '#')
+        return true;
+
+    const char* pArgs = pLine + length;
+    if (sscanf(pArgs, " %255s%n", name, &length) < 1)
+    {
+        m_Error = std::string("Missing name after ") + keyword;
+        return false;
+    }
+    pArgs += length;
+
+    if (strcmp(keyword, "mesh") == 0)
+    {
+        char file[OFFLINE_SCENE_MAX_LINE];
+        if (sscanf(pArgs, " %1023s", file) < 1)
+        {
+            m_Error = "Missing file for mesh " + std::string(name);
+            return false;
+        }
+        if (FindAsset(name) >= 0)
+        {
+            m_Error = "Mesh " + std::string(name) + " is already defined";
+            return false;
+        }
+
+        // Paths are taken relative to the scene unless they are absolute
+        std::string path = file;
+        if (path[0] != '/' && path[0] != '\\' && (path.size() < 2 || path[1] != ':'))
+            path = directory + path;
+
+        OfflineSceneAsset asset;
+        asset.Name = name;
+        asset.Mesh = FindMeshFile(path);
+        asset.Instances = 0;
+        m_Assets.push_back(asset);
+        return true;
+    }
+
+    if (strcmp(keyword, "instance") == 0 || strcmp(keyword, "material") == 0)
+    {
+        int asset = FindAsset(name);
+        if (asset < 0)
+        {
+            m_Error = "Unknown mesh " + std::string(name);
+            return false;
+        }
+
+        if (keyword[0] == 'i')
+        {
+            float x, y, z, yaw = 0.0f, scale = 1.0f;
+            if (sscanf(pArgs, "%f %f %f %f %f", &x, &y, &z, &yaw, &scale) < 3)
+            {
+                m_Error = "Expected a position for an instance of " + std::string(name);
+                return false;
+            }
+
+            OfflineInstance instance;
+            instance.pMesh = NULL;
+            instance.World = OfflineMakeInstanceWorld(MakeVec3(0, 0, 0), MakeVec3(x, y, z), yaw*3.14159265f/180.0f,
+                                                      scale);
+            m_Instances.push_back(instance);
+            m_InstanceAssets.push_back((uint32_t)asset);
+            m_Assets[asset].Instances++;
+            return true;
+        }
+
+        uint32_t material;
+        double   cost;
+        if (sscanf(pArgs, "%u %lf", &material, &cost) < 2 || cost < 0.0 || material > 0xffff)
+        {
+            m_Error = "Expected a material ID and a cost for " + std::string(name);
+            return false;
+        }
+
+        std::vector<double>& costs = m_Assets[asset].MaterialCosts;
+        if (costs.size() <= material)
+            costs.resize(material + 1, -1.0);
+        costs[material] = cost;
+        return true;
+    }
+
+    if (strcmp(keyword, "camera") == 0 || strcmp(keyword, "orbit") == 0)
+    {
+        OfflineSceneCamera camera;
+        camera.Name    = name;
+        camera.Frames  = 1;
+        camera.bOrbit  = keyword[0] == 'o';
+        camera.bFramed = false;
+
+        if (camera.bOrbit)
+        {
+            int frames = 0;
+            if (sscanf(pArgs, "%d%n", &frames, &length) < 1 || frames < 1)
+            {
+                m_Error = "Expected a frame count for orbit " + camera.Name;
+                return false;
+            }
+            camera.Frames = (uint32_t)frames;
+            pArgs += length;
+        }
+
+        if (!ParseCamera(pArgs, &camera.Start))
+        {
+            if (!camera.bOrbit || sscanf(pArgs, " %15s", keyword) == 1)
+            {
+                m_Error = "Expected an eye and target for camera " + camera.Name;
+                return false;
+            }
+            camera.bFramed = true;
+        }
+
+        m_Cameras.push_back(camera);
+        return true;
+    }
+
+    m_Error = std::string("Unknown keyword ") + keyword;
+    return false;
+}
+
+
+//--------------------------------------------------------------------------------------
+// The clip planes are the demo's
+//--------------------------------------------------------------------------------------
+bool COfflineScene::ParseCamera(const char* pArgs, OfflineCamera* pCamera)
+{
+    float fov = 45.0f;
+    if (sscanf(pArgs, "%f %f %f %f %f %f %f", &pCamera->eye.x, &pCamera->eye.y, &pCamera->eye.z, &pCamera->at.x,
+               &pCamera->at.y, &pCamera->at.z, &fov) < 6)
+        return false;
+
+    pCamera->up    = MakeVec3(0, 1, 0);
+    pCamera->fovY  = fov*3.141592654f/180.0f;
+    pCamera->zNear = 0.01f;
+    pCamera->zFar  = 5000.0f;
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+int COfflineScene::FindAsset(const char* name) const
+{
+    for (size_t i = 0; i < m_Assets.size(); i++)
+    {
+        if (m_Assets[i].Name == name)
+            return (int)i;
+    }
+    return -1;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Paths are compared as the resource cache compares them, so "./hebe.sdkmesh" and
+// "hebe.sdkmesh" are one file; a new one is added
+//--------------------------------------------------------------------------------------
+uint32_t COfflineScene::FindMeshFile(const std::string& path)
+{
+    for (size_t m = 0; m < m_MeshFiles.size(); m++)
+    {
+        if (DXUTPathsEqual(m_MeshFiles[m].c_str(), path.c_str()))
+            return (uint32_t)m;
+    }
+
+    m_MeshFiles.push_back(path);
+    return (uint32_t)m_MeshFiles.size() - 1;
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineScene::GetCameraPath(uint32_t i, const OfflineCamera& framing, COfflineOrbitPath* pPath) const
+{
+    const OfflineSceneCamera& camera = m_Cameras[i];
+    const OfflineCamera& start = camera.bFramed ? framing : camera.Start;
+
+    // A fixed camera is an orbit that never turns
+    pPath->Setup(start, camera.Frames, camera.bOrbit ? camera.Frames : 0xffffffff);
+}
+
+
+//--------------------------------------------------------------------------------------
+// COfflineSceneCost
+//--------------------------------------------------------------------------------------
+COfflineSceneCost::COfflineSceneCost() : m_pScene(NULL),
+                                         m_DefaultCost(0.0)
+{
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineSceneCost::Setup(const COfflineScene& scene, double defaultCost)
+{
+    OfflineSceneStats empty;
+    memset(&empty, 0, sizeof(empty));
+
+    m_pScene      = &scene;
+    m_DefaultCost = defaultCost;
+    m_Assets.assign(scene.GetNumAssets(), empty);
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineSceneCost::Add(const COfflineSceneCost& other)
+{
+    for (size_t a = 0; a < m_Assets.size(); a++)
+    {
+        OfflineAddLiveTotals(&m_Assets[a].Liveness, other.m_Assets[a].Liveness);
+        m_Assets[a].Cost += other.m_Assets[a].Cost;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineSceneCost::OnQuad(const OfflineTriangle& tri, const OfflineQuad& quad)
+{
+    OfflineSceneStats& stats = m_Assets[m_pScene->GetInstanceAsset(tri.Instance)];
+    OfflineAddQuad(&stats.Liveness, quad.Live);
+    stats.Cost += m_pScene->GetQuadCost(tri.Instance, tri.Draw, m_DefaultCost);
+}
+
+
+//--------------------------------------------------------------------------------------
+OfflineSceneStats COfflineSceneCost::GetTotals() const
+{
+    OfflineSceneStats totals;
+    memset(&totals, 0, sizeof(totals));
+    for (size_t a = 0; a < m_Assets.size(); a++)
+    {
+        OfflineAddLiveTotals(&totals.Liveness, m_Assets[a].Liveness);
+        totals.Cost += m_Assets[a].Cost;
+    }
+    return totals;
+}
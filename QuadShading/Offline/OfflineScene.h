@@ -0,0 +1,135 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineScene.h
+//
+// Scene files for the offline overshading engine. InitDevice loads hebe.sdkmesh and
+// nothing else; a scene file lists any number of .sdkmesh assets, where instances of
+// them go, what a quad of each of their materials costs to shade, and the cameras to
+// look through. Every mesh file is loaded once, however many assets and instances use
+// it or however its path is spelled, with the files spread across threads. A line per
+// entry, # for comments:
+//
+//   mesh     <asset> <file.sdkmesh>                    relative to the scene file
+//   instance <asset> <x> <y> <z> [<yaw> [<scale>]]     yaw in degrees about y
+//   material <asset> <material ID> <cost>              per shaded quad, in depth tests
+//   camera   <name> <eye x y z> <at x y z> [<fov>]     a fixed view, fov in degrees
+//   orbit    <name> <frames> [<eye x y z> <at x y z> [<fov>]]
+//
+// An orbit without an eye and target starts from the camera that frames the scene.
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef OFFLINE_SCENE_H
+#define OFFLINE_SCENE_H
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "OfflineCameraPath.h"
+#include "OfflineInstances.h"
+#include "OfflineMesh.h"
+#include "OfflineMethods.h"
+#include "OfflineRaster.h"
+
+struct OfflineSceneAsset
+{
+    std::string         Name;
+    uint32_t            Mesh;           // into the scene's meshes, which assets may share
+    uint32_t            Instances;      // of this asset, not of its mesh
+    std::vector<double> MaterialCosts;  // by material ID; negative for the default cost
+};
+
+struct OfflineSceneCamera
+{
+    std::string         Name;
+    OfflineCamera       Start;
+    uint32_t            Frames;
+    bool                bOrbit;
+    bool                bFramed;        // starts from the camera that frames the scene
+};
+
+
+//--------------------------------------------------------------------------------------
+class COfflineScene
+{
+public:
+                        COfflineScene();
+
+    // Reads the file, then loads each mesh file it names on one of the threads
+    bool                Load(const char* fileName, uint32_t threads);
+    const std::string&  GetError() const        { return m_Error; }
+
+    uint32_t            GetNumMeshes() const    { return (uint32_t)m_Meshes.size(); }
+    const COfflineMesh& GetMesh(uint32_t i) const { return m_Meshes[i]; }
+    const std::string&  GetMeshFile(uint32_t i) const { return m_MeshFiles[i]; }
+
+    uint32_t            GetNumAssets() const    { return (uint32_t)m_Assets.size(); }
+    const OfflineSceneAsset& GetAsset(uint32_t i) const { return m_Assets[i]; }
+
+    const std::vector<OfflineInstance>& GetInstances() const { return m_Instances; }
+    uint32_t            GetInstanceAsset(uint32_t instance) const { return m_InstanceAssets[instance]; }
+
+    // What a quad of one of the instance's draws costs: the asset's override for the
+    // draw's material, or defaultCost
+    double              GetQuadCost(uint32_t instance, uint32_t draw, double defaultCost) const
+    {
+        const OfflineSceneAsset& asset = m_Assets[m_InstanceAssets[instance]];
+        uint32_t material = m_Meshes[asset.Mesh].GetDraw(draw).MaterialID;
+        double cost = material < asset.MaterialCosts.size() ? asset.MaterialCosts[material] : -1.0;
+        return cost < 0.0 ? defaultCost : cost;
+    }
+
+    uint32_t            GetNumCameras() const   { return (uint32_t)m_Cameras.size(); }
+    const OfflineSceneCamera& GetCamera(uint32_t i) const { return m_Cameras[i]; }
+
+    // A camera as a path, given the camera that frames the scene
+    void                GetCameraPath(uint32_t i, const OfflineCamera& framing, COfflineOrbitPath* pPath) const;
+
+protected:
+    bool                ParseLine(const char* pLine, const std::string& directory);
+    bool                ParseCamera(const char* pArgs, OfflineCamera* pCamera);
+    int                 FindAsset(const char* name) const;
+    uint32_t            FindMeshFile(const std::string& path);
+    void                LoadMeshes(std::vector<uint8_t>* pLoaded, std::atomic<uint32_t>* pNext);
+
+    std::vector<COfflineMesh>       m_Meshes;
+    std::vector<std::string>        m_MeshFiles;
+    std::vector<OfflineSceneAsset>  m_Assets;
+    std::vector<OfflineInstance>    m_Instances;
+    std::vector<uint32_t>           m_InstanceAssets;
+    std::vector<OfflineSceneCamera> m_Cameras;
+    std::string                     m_Error;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Quads and their cost, per asset
+//--------------------------------------------------------------------------------------
+struct OfflineSceneStats
+{
+    OfflineLiveTotals Liveness;
+    double            Cost;
+};
+
+class COfflineSceneCost : public IOfflineQuadSink
+{
+public:
+                        COfflineSceneCost();
+
+    void                Setup(const COfflineScene& scene, double defaultCost);
+    void                Add(const COfflineSceneCost& other);
+
+    virtual void        OnQuad(const OfflineTriangle& tri, const OfflineQuad& quad);
+
+    const OfflineSceneStats& GetAsset(uint32_t asset) const { return m_Assets[asset]; }
+    OfflineSceneStats   GetTotals() const;
+
+protected:
+    const COfflineScene*            m_pScene;
+    double                          m_DefaultCost;
+    std::vector<OfflineSceneStats>  m_Assets;
+};
+
+#endif
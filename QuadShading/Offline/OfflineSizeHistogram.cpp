@@ -0,0 +1,109 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineSizeHistogram.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#include "OfflineSizeHistogram.h"
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+//--------------------------------------------------------------------------------------
+float OfflineGetAreaBucketMin(uint32_t bucket)
+{
+    return bucket ? ldexpf(1.0f, (int)bucket - 1 + OFFLINE_AREA_MIN_LOG2) : 0.0f;
+}
+
+
+//--------------------------------------------------------------------------------------
+float OfflineGetRatioBucketMin(uint32_t bucket)
+{
+    return ldexpf(1.0f, (int)bucket);
+}
+
+
+//--------------------------------------------------------------------------------------
+// From the snapped 16.8 positions, as the triangle was rasterized. A zero-length edge
+// gives an infinite ratio.
+//--------------------------------------------------------------------------------------
+void OfflineMeasureTriangle(const OfflineTriangle& tri, float* pArea, float* pRatio)
+{
+    const double scale = 1.0/256.0;
+
+    double shortest = DBL_MAX, longest = 0.0;
+    for (int i = 0; i < 3; i++)
+    {
+        int j = i == 2 ? 0 : i + 1;
+        double dx = (tri.X[j] - tri.X[i])*scale;
+        double dy = (tri.Y[j] - tri.Y[i])*scale;
+        double length = sqrt(dx*dx + dy*dy);
+        shortest = std::min(shortest, length);
+        longest  = std::max(longest, length);
+    }
+
+    double cross = (double)(tri.X[1] - tri.X[0])*(tri.Y[2] - tri.Y[0]) -
+                   (double)(tri.X[2] - tri.X[0])*(tri.Y[1] - tri.Y[0]);
+    *pArea  = (float)(0.5*fabs(cross)*scale*scale);
+    *pRatio = shortest > 0.0 ? (float)(longest/shortest) : FLT_MAX;
+}
+
+
+//--------------------------------------------------------------------------------------
+// COfflineSizeHistogram
+//--------------------------------------------------------------------------------------
+COfflineSizeHistogram::COfflineSizeHistogram()
+{
+    Clear();
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineSizeHistogram::Clear()
+{
+    memset(m_Buckets, 0, sizeof(m_Buckets));
+    m_pLastTriangle = NULL;
+    m_pLastBucket   = NULL;
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineSizeHistogram::OnQuad(const OfflineTriangle& tri, const OfflineQuad& quad)
+{
+    if (&tri != m_pLastTriangle)
+    {
+        float area, ratio;
+        OfflineMeasureTriangle(tri, &area, &ratio);
+
+        int areaExponent, ratioExponent;
+        frexpf(area, &areaExponent);        // area in [2^(e-1), 2^e)
+        frexpf(ratio, &ratioExponent);
+
+        int a = area > 0.0f ? areaExponent - OFFLINE_AREA_MIN_LOG2 : 0;
+        int r = ratioExponent - 1;
+        a = std::min(std::max(a, 0), OFFLINE_AREA_BUCKETS - 1);
+        r = std::min(std::max(r, 0), OFFLINE_RATIO_BUCKETS - 1);
+
+        m_pLastTriangle = &tri;
+        m_pLastBucket   = &m_Buckets[a][r];
+        m_pLastBucket->Triangles++;
+    }
+
+    OfflineAddQuad(&m_pLastBucket->Liveness, quad.Live);
+}
+
+
+//--------------------------------------------------------------------------------------
+OfflineSizeBucket COfflineSizeHistogram::GetAreaBucket(uint32_t area) const
+{
+    OfflineSizeBucket sum;
+    memset(&sum, 0, sizeof(sum));
+    for (uint32_t r = 0; r < OFFLINE_RATIO_BUCKETS; r++)
+    {
+        const OfflineSizeBucket& bucket = m_Buckets[area][r];
+        sum.Triangles += bucket.Triangles;
+        OfflineAddLiveTotals(&sum.Liveness, bucket.Liveness);
+    }
+    return sum;
+}
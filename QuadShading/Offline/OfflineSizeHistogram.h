@@ -0,0 +1,68 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineSizeHistogram.h
+//
+// Liveness against triangle shape for the offline overshading engine. liveStatsUAV
+// only says how many quads had 1, 2, 3 or 4 live pixels; here every quad of the shading
+// pass is also bucketed by the screen-space area of the triangle that launched it, on a
+// log2 scale, and by that triangle's longest over shortest edge, so the histogram shows
+// which sizes and shapes of triangle waste the most lanes.
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef OFFLINE_SIZE_HISTOGRAM_H
+#define OFFLINE_SIZE_HISTOGRAM_H
+
+#include <stdint.h>
+
+#include "OfflineMethods.h"
+#include "OfflineRaster.h"
+
+// Area buckets double from 1/16 of a pixel: bucket 0 is anything smaller, and the last
+// is 2^14 pixels or more
+#define OFFLINE_AREA_MIN_LOG2       -4
+#define OFFLINE_AREA_BUCKETS        20
+
+// Edge ratio buckets double from 1: [1, 2), [2, 4) and so on, the last open-ended
+#define OFFLINE_RATIO_BUCKETS       6
+
+struct OfflineSizeBucket
+{
+    uint32_t          Triangles;    // that launched at least one quad
+    OfflineLiveTotals Liveness;
+};
+
+// Lower bound of a bucket; the upper bound is the next bucket's, or none for the last
+float OfflineGetAreaBucketMin(uint32_t bucket);
+float OfflineGetRatioBucketMin(uint32_t bucket);
+
+// Screen-space area in pixels and longest over shortest edge of a set-up triangle
+void OfflineMeasureTriangle(const OfflineTriangle& tri, float* pArea, float* pRatio);
+
+
+//--------------------------------------------------------------------------------------
+// Counts like the reference method, split by the launching triangle's area and shape
+//--------------------------------------------------------------------------------------
+class COfflineSizeHistogram : public IOfflineQuadSink
+{
+public:
+                        COfflineSizeHistogram();
+
+    void                Clear();
+
+    virtual void        OnQuad(const OfflineTriangle& tri, const OfflineQuad& quad);
+
+    const OfflineSizeBucket& GetBucket(uint32_t area, uint32_t ratio) const { return m_Buckets[area][ratio]; }
+
+    // The ratio axis summed away
+    OfflineSizeBucket   GetAreaBucket(uint32_t area) const;
+
+protected:
+    OfflineSizeBucket   m_Buckets[OFFLINE_AREA_BUCKETS][OFFLINE_RATIO_BUCKETS];
+
+    // Quads of a triangle arrive together, so its buckets are found once
+    const OfflineTriangle*  m_pLastTriangle;
+    OfflineSizeBucket*      m_pLastBucket;
+};
+
+#endif
@@ -0,0 +1,223 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineTiles.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#include "OfflineTiles.h"
+#include "DXUTprofiler.h"
+
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+//--------------------------------------------------------------------------------------
+void OfflineClearTileStats(OfflineTileStats* pStats)
+{
+    memset(pStats, 0, sizeof(*pStats));
+}
+
+
+//--------------------------------------------------------------------------------------
+void OfflineMergeTileStats(OfflineTileStats* pDest, const OfflineTileStats& source)
+{
+    pDest->Quads += source.Quads;
+    pDest->Max    = std::max(pDest->Max, source.Max);
+    pDest->Sum   += source.Sum;
+    for (uint32_t i = 0; i < OFFLINE_TILE_BINS; i++)
+        pDest->Histogram[i] += source.Histogram[i];
+}
+
+
+//--------------------------------------------------------------------------------------
+// COfflineTilePyramid
+//--------------------------------------------------------------------------------------
+COfflineTilePyramid::COfflineTilePyramid() : m_GridWidth(0),
+                                             m_GridHeight(0)
+{
+    for (uint32_t l = 0; l < OFFLINE_TILE_LEVELS; l++)
+    {
+        m_Levels[l].TilesX = 0;
+        m_Levels[l].TilesY = 0;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+uint32_t COfflineTilePyramid::GetTileSize(uint32_t level)
+{
+    uint32_t size = OFFLINE_TILE_BASE_SIZE;
+    for (uint32_t l = 0; l < level; l++)
+        size *= OFFLINE_TILE_FANOUT;
+    return size;
+}
+
+
+//--------------------------------------------------------------------------------------
+// A band is one row of the coarsest tiles; bands share no tiles at any level, so the
+// threads need no locks
+//--------------------------------------------------------------------------------------
+void COfflineTilePyramid::Build(const COfflineOverdraw& overdraw, bool bSlices, uint32_t threads)
+{
+    DXUT_PROFILE_SCOPE(L"Offline Tile Pyramid");
+
+    m_GridWidth  = overdraw.GetWidth();
+    m_GridHeight = overdraw.GetHeight();
+    for (uint32_t l = 0; l < OFFLINE_TILE_LEVELS; l++)
+    {
+        uint32_t size = GetTileSize(l);
+        Level& level = m_Levels[l];
+        level.TilesX = (m_GridWidth + size - 1)/size;
+        level.TilesY = (m_GridHeight + size - 1)/size;
+        level.Tiles.resize((size_t)level.TilesX*level.TilesY);
+    }
+
+    const uint32_t bands = m_Levels[OFFLINE_TILE_LEVELS - 1].TilesY;
+    std::atomic<uint32_t> nextBand(0);
+
+    std::vector<std::thread> workers;
+    for (uint32_t i = 1; i < std::min(threads, bands); i++)
+        workers.push_back(std::thread(&COfflineTilePyramid::ReduceBands, this, &overdraw, bSlices, &nextBand));
+    ReduceBands(&overdraw, bSlices, &nextBand);
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineTilePyramid::ReduceBands(const COfflineOverdraw* pOverdraw, bool bSlices,
+                                      std::atomic<uint32_t>* pNextBand)
+{
+    const uint32_t bands = m_Levels[OFFLINE_TILE_LEVELS - 1].TilesY;
+    for (uint32_t band = (*pNextBand)++; band < bands; band = (*pNextBand)++)
+        ReduceBand(*pOverdraw, bSlices, band);
+}
+
+
+//--------------------------------------------------------------------------------------
+// The band's base tiles straight from the counts, then each coarser level from the
+// four by four tiles beneath it
+//--------------------------------------------------------------------------------------
+void COfflineTilePyramid::ReduceBand(const COfflineOverdraw& overdraw, bool bSlices, uint32_t band)
+{
+    const uint32_t bandSize = GetTileSize(OFFLINE_TILE_LEVELS - 1);
+    const uint32_t firstRow = band*bandSize;
+    const uint32_t endRow   = std::min(firstRow + bandSize, m_GridHeight);
+
+    Level& base = m_Levels[0];
+    for (uint32_t ty = firstRow/OFFLINE_TILE_BASE_SIZE; ty*OFFLINE_TILE_BASE_SIZE < endRow; ty++)
+    {
+        for (uint32_t tx = 0; tx < base.TilesX; tx++)
+            OfflineClearTileStats(&base.Tiles[(size_t)ty*base.TilesX + tx]);
+    }
+
+    for (uint32_t y = firstRow; y < endRow; y++)
+    {
+        OfflineTileStats* pRow = &base.Tiles[(size_t)(y/OFFLINE_TILE_BASE_SIZE)*base.TilesX];
+        for (uint32_t x = 0; x < m_GridWidth; x++)
+        {
+            uint32_t count = overdraw.GetQuadCount(x, y, bSlices);
+
+            OfflineTileStats& tile = pRow[x/OFFLINE_TILE_BASE_SIZE];
+            tile.Quads++;
+            tile.Max  = std::max(tile.Max, count);
+            tile.Sum += count;
+            tile.Histogram[std::min(count, (uint32_t)OFFLINE_TILE_BINS - 1)]++;
+        }
+    }
+
+    for (uint32_t l = 1; l < OFFLINE_TILE_LEVELS; l++)
+    {
+        const Level& children = m_Levels[l - 1];
+        Level& level = m_Levels[l];
+        const uint32_t size = GetTileSize(l);
+
+        for (uint32_t ty = firstRow/size; ty*size < endRow; ty++)
+        {
+            for (uint32_t tx = 0; tx < level.TilesX; tx++)
+            {
+                OfflineTileStats& tile = level.Tiles[(size_t)ty*level.TilesX + tx];
+                OfflineClearTileStats(&tile);
+
+                const uint32_t endY = std::min((ty + 1)*OFFLINE_TILE_FANOUT, children.TilesY);
+                const uint32_t endX = std::min((tx + 1)*OFFLINE_TILE_FANOUT, children.TilesX);
+                for (uint32_t cy = ty*OFFLINE_TILE_FANOUT; cy < endY; cy++)
+                {
+                    for (uint32_t cx = tx*OFFLINE_TILE_FANOUT; cx < endX; cx++)
+                        OfflineMergeTileStats(&tile, children.Tiles[(size_t)cy*children.TilesX + cx]);
+                }
+            }
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+OfflineTileStats COfflineTilePyramid::QueryRegion(uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1) const
+{
+    OfflineTileStats stats;
+    OfflineClearTileStats(&stats);
+
+    const uint32_t align = OFFLINE_TILE_BASE_SIZE;
+    uint32_t region[4] =
+    {
+        x0/align*align,
+        y0/align*align,
+        std::min((std::min(x1, m_GridWidth) + align - 1)/align*align, m_GridWidth),
+        std::min((std::min(y1, m_GridHeight) + align - 1)/align*align, m_GridHeight)
+    };
+    if (region[0] >= region[2] || region[1] >= region[3])
+        return stats;
+
+    const uint32_t top  = OFFLINE_TILE_LEVELS - 1;
+    const uint32_t size = GetTileSize(top);
+    for (uint32_t ty = region[1]/size; ty*size < region[3]; ty++)
+    {
+        for (uint32_t tx = region[0]/size; tx*size < region[2]; tx++)
+            QueryTile(top, tx, ty, region, &stats);
+    }
+    return stats;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Tiles cut by the region's edges are split into their children; base tiles are never
+// cut, as the region is aligned to them
+//--------------------------------------------------------------------------------------
+void COfflineTilePyramid::QueryTile(uint32_t level, uint32_t x, uint32_t y, const uint32_t region[4],
+                                    OfflineTileStats* pStats) const
+{
+    const uint32_t size = GetTileSize(level);
+    const uint32_t x0 = x*size, y0 = y*size;
+    const uint32_t x1 = std::min(x0 + size, m_GridWidth);
+    const uint32_t y1 = std::min(y0 + size, m_GridHeight);
+    if (x1 <= region[0] || y1 <= region[1] || x0 >= region[2] || y0 >= region[3])
+        return;
+
+    if (level == 0 || (x0 >= region[0] && y0 >= region[1] && x1 <= region[2] && y1 <= region[3]))
+    {
+        OfflineMergeTileStats(pStats, GetTile(level, x, y));
+        return;
+    }
+
+    const Level& children = m_Levels[level - 1];
+    const uint32_t endY = std::min((y + 1)*OFFLINE_TILE_FANOUT, children.TilesY);
+    const uint32_t endX = std::min((x + 1)*OFFLINE_TILE_FANOUT, children.TilesX);
+    for (uint32_t cy = y*OFFLINE_TILE_FANOUT; cy < endY; cy++)
+    {
+        for (uint32_t cx = x*OFFLINE_TILE_FANOUT; cx < endX; cx++)
+            QueryTile(level - 1, cx, cy, region, pStats);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+uint32_t COfflineTilePyramid::CountTilesOver(uint32_t level, double budget) const
+{
+    const std::vector<OfflineTileStats>& tiles = m_Levels[level].Tiles;
+
+    uint32_t count = 0;
+    for (size_t i = 0; i < tiles.size(); i++)
+        count += tiles[i].Quads && (double)tiles[i].Sum > budget*tiles[i].Quads ? 1 : 0;
+    return count;
+}
@@ -0,0 +1,86 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineTiles.h
+//
+// Region statistics for the offline overshading engine. The quad grid of an overdraw
+// buffer is reduced, in one pass over it, into a pyramid of 8x8, 32x32 and 128x128 quad
+// tiles, each holding the sum, maximum and a histogram of the counts beneath it. Bands
+// of the coarsest tiles are reduced on separate threads, each level built from the one
+// below as mips are. Queries on regions, tile budgets and the like are then answered
+// from the tiles alone, without going back to the full-resolution counts.
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef OFFLINE_TILES_H
+#define OFFLINE_TILES_H
+
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+
+#include "OfflineMethods.h"
+
+#define OFFLINE_TILE_LEVELS         3       // 8, 32 and 128 quads square
+#define OFFLINE_TILE_BASE_SIZE      8
+#define OFFLINE_TILE_FANOUT         4       // tiles across a parent
+#define OFFLINE_TILE_BINS           16      // counts of 0 to 14, then 15 or more
+#define OFFLINE_TILE_DEFAULT_BUDGET 2.0
+
+struct OfflineTileStats
+{
+    uint32_t Quads;                         // in the grid, fewer on its right and bottom edges
+    uint32_t Max;
+    uint64_t Sum;
+    uint32_t Histogram[OFFLINE_TILE_BINS];
+};
+
+void OfflineClearTileStats(OfflineTileStats* pStats);
+void OfflineMergeTileStats(OfflineTileStats* pDest, const OfflineTileStats& source);
+
+
+//--------------------------------------------------------------------------------------
+class COfflineTilePyramid
+{
+public:
+                        COfflineTilePyramid();
+
+    // Reduces each quad's count, as the visualisation shows it, across the threads
+    void                Build(const COfflineOverdraw& overdraw, bool bSlices, uint32_t threads);
+
+    uint32_t            GetGridWidth() const                    { return m_GridWidth; }
+    uint32_t            GetGridHeight() const                   { return m_GridHeight; }
+    static uint32_t     GetTileSize(uint32_t level);
+    uint32_t            GetTilesX(uint32_t level) const         { return m_Levels[level].TilesX; }
+    uint32_t            GetTilesY(uint32_t level) const         { return m_Levels[level].TilesY; }
+    const OfflineTileStats& GetTile(uint32_t level, uint32_t x, uint32_t y) const
+    {
+        return m_Levels[level].Tiles[(size_t)y*m_Levels[level].TilesX + x];
+    }
+
+    // Stats for the quads from (x0, y0) up to (x1, y1), widened out to whole 8x8 tiles,
+    // from the coarsest tiles that fit inside
+    OfflineTileStats    QueryRegion(uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1) const;
+
+    // Tiles whose mean count per quad is over the budget
+    uint32_t            CountTilesOver(uint32_t level, double budget) const;
+
+protected:
+    struct Level
+    {
+        uint32_t                        TilesX;
+        uint32_t                        TilesY;
+        std::vector<OfflineTileStats>   Tiles;
+    };
+
+    void                ReduceBands(const COfflineOverdraw* pOverdraw, bool bSlices,
+                                    std::atomic<uint32_t>* pNextBand);
+    void                ReduceBand(const COfflineOverdraw& overdraw, bool bSlices, uint32_t band);
+    void                QueryTile(uint32_t level, uint32_t x, uint32_t y, const uint32_t region[4],
+                                  OfflineTileStats* pStats) const;
+
+    uint32_t            m_GridWidth;
+    uint32_t            m_GridHeight;
+    Level               m_Levels[OFFLINE_TILE_LEVELS];
+};
+
+#endif
@@ -0,0 +1,265 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineVRS.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+#include "OfflineVRS.h"
+#include "OfflineMethods.h"
+#include "DXUTprofiler.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+// log2 of each rate's coarse pixel width and height
+static const uint32_t s_RateShiftX[OFFLINE_NB_SHADING_RATES] = { 0, 0, 1, 1 };
+static const uint32_t s_RateShiftY[OFFLINE_NB_SHADING_RATES] = { 0, 1, 0, 1 };
+
+//--------------------------------------------------------------------------------------
+const char* OfflineGetShadingRateName(OFFLINE_SHADING_RATE rate)
+{
+    static const char* names[OFFLINE_NB_SHADING_RATES] =
+    {
+        "1x1",
+        "1x2",
+        "2x1",
+        "2x2"
+    };
+    return names[rate];
+}
+
+
+
+//--------------------------------------------------------------------------------------
+// COfflineVRS
+//--------------------------------------------------------------------------------------
+COfflineVRS::COfflineVRS() : m_Width(0),
+                             m_Height(0),
+                             m_TileSize(OFFLINE_VRS_DEFAULT_TILE),
+                             m_TilesX(0),
+                             m_TilesY(0)
+{
+}
+
+
+//--------------------------------------------------------------------------------------
+bool COfflineVRS::Simulate(const COfflineFragmentRecorder& fragments, uint32_t tileSize)
+{
+    DXUT_PROFILE_SCOPE(L"Offline VRS");
+
+    if (tileSize < 4 || tileSize%4)
+        return false;
+
+    m_Width    = fragments.GetGridWidth()*2;
+    m_Height   = fragments.GetGridHeight()*2;
+    m_TileSize = tileSize;
+    m_TilesX   = (m_Width + tileSize - 1)/tileSize;
+    m_TilesY   = (m_Height + tileSize - 1)/tileSize;
+    m_Quads.assign((size_t)m_TilesX*m_TilesY*OFFLINE_NB_SHADING_RATES, 0);
+    m_Shaded.assign((size_t)m_TilesX*m_TilesY*OFFLINE_NB_SHADING_RATES, 0);
+    m_Rates.assign((size_t)m_TilesX*m_TilesY, OFFLINE_SHADING_RATE_1X1);
+
+    // Each triangle's quads arrive together, so its coarse quads can be gathered and
+    // counted before moving on to the next
+    std::vector<CoarseQuad> quads;
+    const OfflineFragmentQuad* pFragments = fragments.GetFragments();
+    for (uint32_t i = 0; i < fragments.GetNumFragments(); i++)
+    {
+        const OfflineFragmentQuad& fragment = pFragments[i];
+        if (i && (fragment.Triangle != pFragments[i - 1].Triangle || fragment.Instance != pFragments[i - 1].Instance))
+            FlushTriangle(&quads);
+
+        for (uint32_t lane = 0; lane < 4; lane++)
+        {
+            if (!(fragment.Live & (1 << lane)))
+                continue;
+
+            uint32_t x = 2*fragment.X + (lane & 1);
+            uint32_t y = 2*fragment.Y + (lane >> 1);
+            for (int rate = 0; rate < OFFLINE_NB_SHADING_RATES; rate++)
+            {
+                uint32_t cx = x >> s_RateShiftX[rate];
+                uint32_t cy = y >> s_RateShiftY[rate];
+
+                CoarseQuad quad;
+                quad.Key  = ((uint64_t)rate << 48) | ((uint64_t)(cy >> 1) << 24) | (cx >> 1);
+                quad.Mask = 1 << ((cx & 1) + 2*(cy & 1));
+                quads.push_back(quad);
+            }
+        }
+    }
+    FlushTriangle(&quads);
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineVRS::FlushTriangle(std::vector<CoarseQuad>* pQuads)
+{
+    std::vector<CoarseQuad>& quads = *pQuads;
+    std::sort(quads.begin(), quads.end(), [](const CoarseQuad& a, const CoarseQuad& b) { return a.Key < b.Key; });
+
+    for (size_t i = 0; i < quads.size(); )
+    {
+        uint64_t key  = quads[i].Key;
+        uint32_t mask = 0;
+        for (; i < quads.size() && quads[i].Key == key; i++)
+            mask |= quads[i].Mask;
+
+        uint32_t rate = (uint32_t)(key >> 48);
+        uint32_t x    = ((uint32_t)key & 0xffffff) << (s_RateShiftX[rate] + 1);
+        uint32_t y    = ((uint32_t)(key >> 24) & 0xffffff) << (s_RateShiftY[rate] + 1);
+        size_t   tile = (size_t)(y/m_TileSize)*m_TilesX + x/m_TileSize;
+
+        m_Quads[tile*OFFLINE_NB_SHADING_RATES + rate]++;
+        m_Shaded[tile*OFFLINE_NB_SHADING_RATES + rate] += OfflineCountLanes(mask);
+    }
+    quads.clear();
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineVRS::ChooseRates()
+{
+    for (size_t tile = 0; tile < m_Rates.size(); tile++)
+    {
+        uint32_t quads    = GetTileQuads((uint32_t)tile, OFFLINE_SHADING_RATE_1X1);
+        uint32_t shaded   = GetTileShaded((uint32_t)tile, OFFLINE_SHADING_RATE_1X1);
+        double   liveness = quads ? shaded/(4.0*quads) : 1.0;
+
+        OFFLINE_SHADING_RATE rate = OFFLINE_SHADING_RATE_1X1;
+        if (liveness <= OFFLINE_VRS_2X2_LIVENESS)
+            rate = OFFLINE_SHADING_RATE_2X2;
+        else if (liveness <= OFFLINE_VRS_COARSE_LIVENESS)
+        {
+            rate = GetTileQuads((uint32_t)tile, OFFLINE_SHADING_RATE_1X2) <
+                   GetTileQuads((uint32_t)tile, OFFLINE_SHADING_RATE_2X1) ?
+                   OFFLINE_SHADING_RATE_1X2 : OFFLINE_SHADING_RATE_2X1;
+        }
+        m_Rates[tile] = (uint8_t)rate;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineVRS::SetUniformRate(OFFLINE_SHADING_RATE rate)
+{
+    std::fill(m_Rates.begin(), m_Rates.end(), (uint8_t)rate);
+}
+
+
+//--------------------------------------------------------------------------------------
+bool COfflineVRS::LoadRates(const char* fileName)
+{
+    FILE* pFile = fopen(fileName, "rb");
+    if (!pFile)
+        return false;
+
+    uint32_t width, height, maxValue;
+    bool ok = fscanf(pFile, "P5 %u %u %u", &width, &height, &maxValue) == 3 && fgetc(pFile) != EOF &&
+              width == m_TilesX && height == m_TilesY && maxValue < 256;
+
+    std::vector<uint8_t> values((size_t)m_TilesX*m_TilesY);
+    if (ok && !values.empty())
+        ok = fread(&values[0], 1, values.size(), pFile) == values.size();
+    fclose(pFile);
+
+    std::vector<uint8_t> rates(values.size());
+    for (size_t i = 0; ok && i < values.size(); i++)
+    {
+        ok = false;
+        for (int rate = 0; rate < OFFLINE_NB_SHADING_RATES; rate++)
+        {
+            if (values[i] == OfflineGetShadingRateValue((OFFLINE_SHADING_RATE)rate))
+            {
+                rates[i] = (uint8_t)rate;
+                ok = true;
+            }
+        }
+    }
+
+    if (ok)
+        m_Rates = rates;
+    return ok;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool COfflineVRS::SaveRates(const char* fileName) const
+{
+    FILE* pFile = fopen(fileName, "wb");
+    if (!pFile)
+        return false;
+
+    std::vector<uint8_t> values(m_Rates.size());
+    for (size_t i = 0; i < m_Rates.size(); i++)
+        values[i] = OfflineGetShadingRateValue((OFFLINE_SHADING_RATE)m_Rates[i]);
+
+    fprintf(pFile, "P5\n%u %u\n255\n", m_TilesX, m_TilesY);
+    bool ok = values.empty() || fwrite(&values[0], 1, values.size(), pFile) == values.size();
+    fclose(pFile);
+    return ok;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool COfflineVRS::WriteHeatmap(const char* fileName) const
+{
+    static const uint8_t colours[OFFLINE_NB_SHADING_RATES][3] =
+    {
+        { 40, 40, 40 },     // 1x1
+        { 0, 160, 255 },    // 1x2
+        { 0, 200, 0 },      // 2x1
+        { 255, 64, 0 }      // 2x2
+    };
+
+    FILE* pFile = fopen(fileName, "wb");
+    if (!pFile)
+        return false;
+
+    fprintf(pFile, "P6\n%u %u\n255\n", m_TilesX, m_TilesY);
+    bool ok = true;
+    for (size_t i = 0; ok && i < m_Rates.size(); i++)
+        ok = fwrite(colours[m_Rates[i]], 3, 1, pFile) == 1;
+    fclose(pFile);
+    return ok;
+}
+
+
+//--------------------------------------------------------------------------------------
+OfflineVRSStats COfflineVRS::GetStats() const
+{
+    OfflineVRSStats stats;
+    memset(&stats, 0, sizeof(stats));
+
+    for (size_t tile = 0; tile < m_Rates.size(); tile++)
+    {
+        OFFLINE_SHADING_RATE rate = (OFFLINE_SHADING_RATE)m_Rates[tile];
+        stats.Quads  += GetTileQuads((uint32_t)tile, rate);
+        stats.Shaded += GetTileShaded((uint32_t)tile, rate);
+        stats.Tiles[rate]++;
+    }
+    stats.Invocations = 4*stats.Quads;
+    stats.HelperLanes = stats.Invocations - stats.Shaded;
+    return stats;
+}
+
+
+//--------------------------------------------------------------------------------------
+OfflineVRSStats COfflineVRS::GetUniformStats(OFFLINE_SHADING_RATE rate) const
+{
+    OfflineVRSStats stats;
+    memset(&stats, 0, sizeof(stats));
+
+    for (size_t tile = 0; tile < m_Rates.size(); tile++)
+    {
+        stats.Quads  += GetTileQuads((uint32_t)tile, rate);
+        stats.Shaded += GetTileShaded((uint32_t)tile, rate);
+    }
+    stats.Tiles[rate] = (uint32_t)m_Rates.size();
+    stats.Invocations = 4*stats.Quads;
+    stats.HelperLanes = stats.Invocations - stats.Shaded;
+    return stats;
+}
@@ -0,0 +1,123 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineVRS.h
+//
+// Variable-rate shading estimates for the offline overshading engine. The shading
+// pass's quad stream is replayed at each coarse rate: a coarse pixel is shaded if any of
+// its pixels is live, and coarse pixels are shaded in 2x2 quads just as full-rate ones
+// are, so a triangle launches a quad wherever it touches a 2x2 block of coarse pixels.
+// Every rate is simulated for every tile at once, so that any shading-rate image, picked
+// automatically from each tile's liveness or loaded from a file, can then be costed.
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef OFFLINE_VRS_H
+#define OFFLINE_VRS_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "OfflineLockStress.h"
+
+#define OFFLINE_VRS_DEFAULT_TILE    16
+
+// Tiles whose full-rate quads have at most this fraction of live lanes are coarsened,
+// to 2x2 below the lower threshold
+#define OFFLINE_VRS_COARSE_LIVENESS 0.6
+#define OFFLINE_VRS_2X2_LIVENESS    0.4
+
+// Coarse pixel sizes as width x height, in the order of D3D12_SHADING_RATE
+enum OFFLINE_SHADING_RATE
+{
+    OFFLINE_SHADING_RATE_1X1,
+    OFFLINE_SHADING_RATE_1X2,
+    OFFLINE_SHADING_RATE_2X1,
+    OFFLINE_SHADING_RATE_2X2,
+    OFFLINE_NB_SHADING_RATES
+};
+
+const char* OfflineGetShadingRateName(OFFLINE_SHADING_RATE rate);
+
+// log2 of the width in bits 2-3 and of the height in bits 0-1, as a D3D12 shading-rate
+// image stores them
+inline uint8_t OfflineGetShadingRateValue(OFFLINE_SHADING_RATE rate)
+{
+    static const uint8_t values[OFFLINE_NB_SHADING_RATES] = { 0x0, 0x1, 0x4, 0x5 };
+    return values[rate];
+}
+
+struct OfflineVRSStats
+{
+    uint64_t Quads;             // coarse quads launched
+    uint64_t Invocations;       // four per quad
+    uint64_t Shaded;            // invocations on a live coarse pixel
+    uint64_t HelperLanes;
+    uint32_t Tiles[OFFLINE_NB_SHADING_RATES];
+};
+
+
+//--------------------------------------------------------------------------------------
+class COfflineVRS
+{
+public:
+                        COfflineVRS();
+
+    // Replays the stream at every rate. The tile size is in pixels, a multiple of 4 so
+    // that no quad of any rate straddles two tiles.
+    bool                Simulate(const COfflineFragmentRecorder& fragments, uint32_t tileSize);
+
+    uint32_t            GetTileSize() const     { return m_TileSize; }
+    uint32_t            GetTilesX() const       { return m_TilesX; }
+    uint32_t            GetTilesY() const       { return m_TilesY; }
+
+    // The rate image: coarser where full-rate quads are poorly used, and between 1x2
+    // and 2x1 whichever launches fewer quads
+    void                ChooseRates();
+    void                SetUniformRate(OFFLINE_SHADING_RATE rate);
+    OFFLINE_SHADING_RATE GetRate(uint32_t tileX, uint32_t tileY) const
+    {
+        return (OFFLINE_SHADING_RATE)m_Rates[(size_t)tileY*m_TilesX + tileX];
+    }
+
+    // Binary PGMs of D3D12_SHADING_RATE values, one pixel per tile
+    bool                LoadRates(const char* fileName);
+    bool                SaveRates(const char* fileName) const;
+
+    // One colour per rate, one pixel per tile
+    bool                WriteHeatmap(const char* fileName) const;
+
+    // Totals under the current rate image, or with one rate everywhere
+    OfflineVRSStats     GetStats() const;
+    OfflineVRSStats     GetUniformStats(OFFLINE_SHADING_RATE rate) const;
+
+    // Quads launched and coarse pixels shaded in a tile at a rate
+    uint32_t            GetTileQuads(uint32_t tile, OFFLINE_SHADING_RATE rate) const
+    {
+        return m_Quads[(size_t)tile*OFFLINE_NB_SHADING_RATES + rate];
+    }
+    uint32_t            GetTileShaded(uint32_t tile, OFFLINE_SHADING_RATE rate) const
+    {
+        return m_Shaded[(size_t)tile*OFFLINE_NB_SHADING_RATES + rate];
+    }
+
+protected:
+    // A coarse quad touched by the current triangle, and the coarse pixels it covers
+    struct CoarseQuad
+    {
+        uint64_t Key;           // rate, then position
+        uint32_t Mask;
+    };
+
+    void                FlushTriangle(std::vector<CoarseQuad>* pQuads);
+
+    uint32_t                m_Width;
+    uint32_t                m_Height;
+    uint32_t                m_TileSize;
+    uint32_t                m_TilesX;
+    uint32_t                m_TilesY;
+    std::vector<uint32_t>   m_Quads;    // per tile and rate
+    std::vector<uint32_t>   m_Shaded;
+    std::vector<uint8_t>    m_Rates;    // OFFLINE_SHADING_RATE per tile
+};
+
+#endif
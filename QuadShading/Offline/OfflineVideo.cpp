@@ -0,0 +1,351 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineVideo.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+#include "OfflineVideo.h"
+#include "OfflineCompositor.h"
+#include "DXUTframestats.h"
+#include "DXUTprofiler.h"
+
+#include <string.h>
+#include <algorithm>
+#include <thread>
+
+//--------------------------------------------------------------------------------------
+const char* OfflineGetVideoFormatName(OFFLINE_VIDEO_FORMAT format)
+{
+    static const char* names[OFFLINE_NB_VIDEO_FORMATS] =
+    {
+        "y4m",
+        "rgb"
+    };
+    return names[format];
+}
+
+
+//--------------------------------------------------------------------------------------
+// COfflineVideoWriter
+//--------------------------------------------------------------------------------------
+COfflineVideoWriter::COfflineVideoWriter() : m_pFile(NULL),
+                                             m_Format(OFFLINE_VIDEO_Y4M),
+                                             m_Width(0),
+                                             m_Height(0),
+                                             m_BytesWritten(0)
+{
+}
+
+
+//--------------------------------------------------------------------------------------
+COfflineVideoWriter::~COfflineVideoWriter()
+{
+    Close();
+}
+
+
+//--------------------------------------------------------------------------------------
+bool COfflineVideoWriter::Open(const char* fileName, OFFLINE_VIDEO_FORMAT format, uint32_t width, uint32_t height,
+                               uint32_t fps)
+{
+    Close();
+
+    m_pFile = fopen(fileName, "wb");
+    if (!m_pFile)
+        return false;
+
+    m_Format       = format;
+    m_Width        = width;
+    m_Height       = height;
+    m_BytesWritten = 0;
+
+    if (format == OFFLINE_VIDEO_Y4M)
+    {
+        uint32_t chroma = ((width + 1)/2)*((height + 1)/2);
+        m_Buffer.resize((size_t)width*height + 2*chroma);
+
+        char header[96];
+        int length = sprintf(header, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C420jpeg\n", width, height, fps);
+        return Write(header, length);
+    }
+
+    m_Buffer.resize((size_t)width*height*3);
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// BT.601 in 8-bit fixed point, with each chroma sample the mean of a 2x2 block. Blocks
+// line up with quads, so only the pie chart's edges lose colour.
+//--------------------------------------------------------------------------------------
+bool COfflineVideoWriter::WriteFrame(const OfflineImage& image)
+{
+    DXUT_PROFILE_SCOPE(L"Offline Video Encode");
+
+    if (!m_pFile || image.Width != m_Width || image.Height != m_Height)
+        return false;
+
+    if (m_Format == OFFLINE_VIDEO_RGB)
+    {
+        uint8_t* pDest = &m_Buffer[0];
+        for (size_t i = 0; i < (size_t)m_Width*m_Height; i++, pDest += 3)
+            memcpy(pDest, &image.Pixels[i*4], 3);
+        return Write(&m_Buffer[0], m_Buffer.size());
+    }
+
+    const uint32_t chromaWidth  = (m_Width + 1)/2;
+    const uint32_t chromaHeight = (m_Height + 1)/2;
+    uint8_t* pY = &m_Buffer[0];
+    uint8_t* pU = pY + (size_t)m_Width*m_Height;
+    uint8_t* pV = pU + (size_t)chromaWidth*chromaHeight;
+
+    for (uint32_t y = 0; y < m_Height; y++)
+    {
+        const uint8_t* pSource = image.GetRow(y);
+        for (uint32_t x = 0; x < m_Width; x++, pSource += 4)
+        {
+            int r = pSource[0], g = pSource[1], b = pSource[2];
+            *pY++ = (uint8_t)(((66*r + 129*g + 25*b + 128) >> 8) + 16);
+        }
+    }
+
+    for (uint32_t cy = 0; cy < chromaHeight; cy++)
+    {
+        const uint32_t y0 = 2*cy;
+        const uint32_t y1 = std::min(y0 + 1, m_Height - 1);
+        for (uint32_t cx = 0; cx < chromaWidth; cx++)
+        {
+            const uint32_t x0 = 2*cx;
+            const uint32_t x1 = std::min(x0 + 1, m_Width - 1);
+            const uint8_t* p[4] =
+            {
+                image.GetRow(y0) + x0*4, image.GetRow(y0) + x1*4, image.GetRow(y1) + x0*4, image.GetRow(y1) + x1*4
+            };
+
+            int r = 0, g = 0, b = 0;
+            for (int i = 0; i < 4; i++)
+            {
+                r += p[i][0];
+                g += p[i][1];
+                b += p[i][2];
+            }
+
+            // Four pixels' sums, so the rounding and shift take in the division
+            *pU++ = (uint8_t)(((-38*r - 74*g + 112*b + 512) >> 10) + 128);
+            *pV++ = (uint8_t)(((112*r - 94*g - 18*b + 512) >> 10) + 128);
+        }
+    }
+
+    static const char frameHeader[] = "FRAME\n";
+    return Write(frameHeader, sizeof(frameHeader) - 1) && Write(&m_Buffer[0], m_Buffer.size());
+}
+
+
+//--------------------------------------------------------------------------------------
+bool COfflineVideoWriter::Close()
+{
+    if (!m_pFile)
+        return true;
+
+    bool ok = fclose(m_pFile) == 0;
+    m_pFile = NULL;
+    return ok;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool COfflineVideoWriter::Write(const void* pData, size_t size)
+{
+    if (fwrite(pData, 1, size, m_pFile) != size)
+        return false;
+
+    m_BytesWritten += size;
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// COfflineVideoExporter
+//--------------------------------------------------------------------------------------
+COfflineVideoExporter::COfflineVideoExporter() : m_pMesh(NULL),
+                                                 m_pPath(NULL),
+                                                 m_NextFrame(0),
+                                                 m_Abandoned(false)
+{
+    memset(&m_Settings, 0, sizeof(m_Settings));
+    memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+
+//--------------------------------------------------------------------------------------
+// The calling thread is the encoder, taking frames strictly in order and returning
+// each slot to the shading threads once the frame is on its way to disk
+//--------------------------------------------------------------------------------------
+bool COfflineVideoExporter::Export(const COfflineMesh& mesh, const IOfflineCameraPath& path,
+                                   const OfflineVideoSettings& settings, const char* fileName)
+{
+    DXUT_PROFILE_SCOPE(L"Offline Video Export");
+
+    memset(&m_Stats, 0, sizeof(m_Stats));
+    m_ShadeTimes.Reset();
+    m_FrameTimes.Reset();
+    if (!m_Writer.Open(fileName, settings.Format, settings.Width, settings.Height, settings.Fps))
+        return false;
+
+    m_pMesh     = &mesh;
+    m_pPath     = &path;
+    m_Settings  = settings;
+    m_NextFrame = 0;
+    m_Abandoned = false;
+
+    const uint32_t threads = std::max(settings.ShadeThreads, 1u);
+    const uint32_t slots   = OFFLINE_VIDEO_SLOTS_PER_THREAD*threads + 2;
+    m_Slots.resize(slots);
+    for (uint32_t s = 0; s < slots; s++)
+    {
+        m_Slots[s].Frame = s;
+        m_Slots[s].State = SLOT_FREE;
+    }
+
+    uint64_t start = DXUTGetHighResTimeNs();
+
+    std::vector<std::thread> workers;
+    for (uint32_t i = 0; i < threads; i++)
+        workers.push_back(std::thread(&COfflineVideoExporter::ShadeWorker, this));
+    workers.push_back(std::thread(&COfflineVideoExporter::ColourWorker, this));
+
+    bool ok = true;
+    uint64_t lastWritten = start;
+    const uint32_t frames = path.GetNumFrames();
+    for (uint32_t frame = 0; frame < frames && ok; frame++)
+    {
+        Slot& slot = m_Slots[frame%slots];
+
+        uint64_t waitStart = DXUTGetHighResTimeNs();
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            WaitForSlot(lock, slot, frame, SLOT_COLOURED);
+        }
+        uint64_t encodeStart = DXUTGetHighResTimeNs();
+
+        ok = m_Writer.WriteFrame(slot.Image);
+
+        uint64_t encodeEnd = DXUTGetHighResTimeNs();
+        m_FrameTimes.AddSample(encodeEnd - lastWritten);
+        lastWritten = encodeEnd;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stats.EncodeWaitNs += encodeStart - waitStart;
+            m_Stats.EncodeNs     += encodeEnd - encodeStart;
+            if (ok)
+            {
+                m_Stats.Frames++;
+                slot.Frame += slots;
+                slot.State  = SLOT_FREE;
+            }
+            else
+                m_Abandoned = true;
+        }
+        m_SlotChanged.notify_all();
+    }
+
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+    ok = m_Writer.Close() && ok;
+
+    m_Stats.Slots   = slots;
+    m_Stats.Bytes   = m_Writer.GetBytesWritten();
+    m_Stats.TotalNs = DXUTGetHighResTimeNs() - start;
+    return ok;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool COfflineVideoExporter::WaitForSlot(std::unique_lock<std::mutex>& lock, const Slot& slot, uint32_t frame,
+                                        SLOT_STATE state)
+{
+    while (!m_Abandoned && (slot.Frame != frame || slot.State != state))
+        m_SlotChanged.wait(lock);
+    return !m_Abandoned;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Frames are taken in order but may finish out of order; each thread keeps its own
+// rasterizer and depth buffer
+//--------------------------------------------------------------------------------------
+void COfflineVideoExporter::ShadeWorker()
+{
+    const uint32_t width  = m_Settings.Width;
+    const uint32_t height = m_Settings.Height;
+    const uint32_t frames = m_pPath->GetNumFrames();
+
+    COfflineRasterizer rasterizer;
+    rasterizer.SetViewport(width, height);
+    COfflineDepthBuffer depth;
+    depth.Resize(width, height, m_Settings.DepthFormat);
+
+    for (;;)
+    {
+        uint32_t frame;
+        Slot*    pSlot;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            frame = m_NextFrame++;
+            if (frame >= frames)
+                return;
+            pSlot = &m_Slots[frame%m_Slots.size()];
+            if (!WaitForSlot(lock, *pSlot, frame, SLOT_FREE))
+                return;
+        }
+        uint64_t start = DXUTGetHighResTimeNs();
+
+        OfflineCamera camera;
+        m_pPath->GetCamera(frame, &camera);
+        Mat4 view = MatrixLookAtLH(camera.eye, camera.at, camera.up);
+        Mat4 proj = MatrixPerspectiveFovLH(camera.fovY, (float)width/(float)height, camera.zNear, camera.zFar);
+
+        rasterizer.Reset();
+        rasterizer.SetupMesh(*m_pMesh, MatrixMultiply(view, proj), 0);
+        depth.Clear(1.0f);
+        pSlot->Overdraw.Resize(OfflineGetQuadGridSize(width), OfflineGetQuadGridSize(height));
+        rasterizer.Rasterize(&depth, OFFLINE_DEPTH_PREPASS, NULL);
+        rasterizer.Rasterize(&depth, OFFLINE_DEPTH_EARLY_TEST, &pSlot->Overdraw);
+
+        uint64_t end = DXUTGetHighResTimeNs();
+        m_ShadeTimes.AddSample(end - start);
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stats.ShadeNs += end - start;
+            pSlot->State = SLOT_SHADED;
+        }
+        m_SlotChanged.notify_all();
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineVideoExporter::ColourWorker()
+{
+    const uint32_t frames = m_pPath->GetNumFrames();
+    for (uint32_t frame = 0; frame < frames; frame++)
+    {
+        Slot& slot = m_Slots[frame%m_Slots.size()];
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            if (!WaitForSlot(lock, slot, frame, SLOT_SHADED))
+                return;
+        }
+        uint64_t start = DXUTGetHighResTimeNs();
+
+        OfflineComposeHeatmap(slot.Overdraw.GetOverdraw(), false, m_Settings.Width, m_Settings.Height, &slot.Image);
+
+        uint64_t end = DXUTGetHighResTimeNs();
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stats.ColourNs += end - start;
+            slot.State = SLOT_COLOURED;
+        }
+        m_SlotChanged.notify_all();
+    }
+}
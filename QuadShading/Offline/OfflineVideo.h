@@ -0,0 +1,152 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineVideo.h
+//
+// Heatmap video of a camera path for the offline overshading engine. Frames pass
+// through a fixed ring of slots in three stages that run at once: shading threads
+// rasterize frames into a slot's overdraw buffer, a colouring thread composes each
+// shaded slot into a heatmap, and the calling thread encodes the heatmaps in frame
+// order into a YUV4MPEG2 or raw RGB stream and hands the slot back. Nothing is held per
+// frame, so memory stays the same for ten frames or a hundred thousand.
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef OFFLINE_VIDEO_H
+#define OFFLINE_VIDEO_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include "OfflineCameraPath.h"
+#include "OfflineImage.h"
+#include "OfflineMesh.h"
+#include "OfflineMultiView.h"
+#include "OfflineRaster.h"
+#include "DXUTframestats.h"
+
+#define OFFLINE_VIDEO_DEFAULT_FPS       30
+#define OFFLINE_VIDEO_SLOTS_PER_THREAD  2       // frames in flight per shading thread, plus two
+
+enum OFFLINE_VIDEO_FORMAT
+{
+    OFFLINE_VIDEO_Y4M,          // YUV4MPEG2, 4:2:0 with BT.601 studio range
+    OFFLINE_VIDEO_RGB,          // headerless rgb24 frames
+    OFFLINE_NB_VIDEO_FORMATS
+};
+
+const char* OfflineGetVideoFormatName(OFFLINE_VIDEO_FORMAT format);
+
+
+//--------------------------------------------------------------------------------------
+// A video file written a frame at a time
+//--------------------------------------------------------------------------------------
+class COfflineVideoWriter
+{
+public:
+                        COfflineVideoWriter();
+                        ~COfflineVideoWriter();
+
+    bool                Open(const char* fileName, OFFLINE_VIDEO_FORMAT format, uint32_t width, uint32_t height,
+                             uint32_t fps);
+    bool                WriteFrame(const OfflineImage& image);
+    bool                Close();
+
+    uint64_t            GetBytesWritten() const { return m_BytesWritten; }
+
+protected:
+    bool                Write(const void* pData, size_t size);
+
+    FILE*                   m_pFile;
+    OFFLINE_VIDEO_FORMAT    m_Format;
+    uint32_t                m_Width;
+    uint32_t                m_Height;
+    std::vector<uint8_t>    m_Buffer;       // one frame's planes or rows
+    uint64_t                m_BytesWritten;
+};
+
+
+//--------------------------------------------------------------------------------------
+struct OfflineVideoSettings
+{
+    uint32_t                Width;
+    uint32_t                Height;
+    OFFLINE_DEPTH_FORMAT    DepthFormat;
+    OFFLINE_VIDEO_FORMAT    Format;
+    uint32_t                Fps;
+    uint32_t                ShadeThreads;
+};
+
+// Busy times are summed over the threads of each stage
+struct OfflineVideoStats
+{
+    uint32_t Frames;
+    uint32_t Slots;
+    uint64_t Bytes;
+    uint64_t ShadeNs;
+    uint64_t ColourNs;
+    uint64_t EncodeNs;
+    uint64_t EncodeWaitNs;      // the encoder waiting on the stages before it
+    uint64_t TotalNs;
+};
+
+
+//--------------------------------------------------------------------------------------
+class COfflineVideoExporter
+{
+public:
+                        COfflineVideoExporter();
+
+    // Shades, colours and writes every frame of the path. Returns false if the file
+    // can't be written.
+    bool                Export(const COfflineMesh& mesh, const IOfflineCameraPath& path,
+                               const OfflineVideoSettings& settings, const char* fileName);
+
+    const OfflineVideoStats& GetStats() const { return m_Stats; }
+
+    // Per frame: how long shading took, and the gap since the frame before it was written
+    const CDXUTFrameStats& GetShadeTimes() const { return m_ShadeTimes; }
+    const CDXUTFrameStats& GetFrameTimes() const { return m_FrameTimes; }
+
+protected:
+    enum SLOT_STATE
+    {
+        SLOT_FREE,
+        SLOT_SHADED,
+        SLOT_COLOURED
+    };
+
+    // Frame i always goes through slot i modulo the slot count
+    struct Slot
+    {
+        uint32_t                Frame;
+        SLOT_STATE              State;
+        COfflineViewOverdraw    Overdraw;
+        OfflineImage            Image;
+    };
+
+    void                ShadeWorker();
+    void                ColourWorker();
+
+    // Waits, with m_Mutex held, until the slot reaches the state for the frame or the
+    // export is abandoned
+    bool                WaitForSlot(std::unique_lock<std::mutex>& lock, const Slot& slot, uint32_t frame,
+                                    SLOT_STATE state);
+
+    const COfflineMesh*         m_pMesh;
+    const IOfflineCameraPath*   m_pPath;
+    OfflineVideoSettings        m_Settings;
+    COfflineVideoWriter         m_Writer;
+    std::vector<Slot>           m_Slots;
+    std::mutex                  m_Mutex;
+    std::condition_variable     m_SlotChanged;
+    uint32_t                    m_NextFrame;    // to shade
+    bool                        m_Abandoned;
+    OfflineVideoStats           m_Stats;
+    CDXUTFrameStats             m_ShadeTimes;
+    CDXUTFrameStats             m_FrameTimes;
+};
+
+#endif
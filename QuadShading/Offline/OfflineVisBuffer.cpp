@@ -0,0 +1,321 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineVisBuffer.cpp
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#define _CRT_SECURE_NO_WARNINGS
+#include "OfflineVisBuffer.h"
+#include "DXUTprofiler.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <thread>
+
+#define OFFLINE_VIS_FILE_VERSION    1
+
+//--------------------------------------------------------------------------------------
+// Structures
+//--------------------------------------------------------------------------------------
+struct OfflineVisFileHeader
+{
+    char     Magic[4];              // "QSVB"
+    uint32_t Version;
+    uint32_t Width;
+    uint32_t Height;
+    uint32_t DepthFormat;           // OFFLINE_DEPTH_FORMAT
+    uint32_t NumRuns;
+};
+
+// Pixels in a row with the same triangle and instance. Followed in the file by the
+// depths of the covered pixels, in order.
+struct OfflineVisRun
+{
+    uint32_t Triangle;
+    uint16_t Instance;
+    uint16_t Length;
+};
+
+
+//--------------------------------------------------------------------------------------
+OfflineVisCostModel OfflineGetDefaultVisCostModel()
+{
+    OfflineVisCostModel model;
+    model.ShadedQuadCost = 32.0;
+    model.PixelFetchCost = 4.0;
+    return model;
+}
+
+
+//--------------------------------------------------------------------------------------
+// COfflineVisibilityBuffer
+//--------------------------------------------------------------------------------------
+COfflineVisibilityBuffer::COfflineVisibilityBuffer() : m_Width(0),
+                                                       m_Height(0),
+                                                       m_Format(OFFLINE_DEPTH_FORMAT_D24_UNORM)
+{
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineVisibilityBuffer::Resize(uint32_t width, uint32_t height, OFFLINE_DEPTH_FORMAT format)
+{
+    m_Width  = width;
+    m_Height = height;
+    m_Format = format;
+    m_Pixels.resize((size_t)width*height);
+    Clear();
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineVisibilityBuffer::Clear()
+{
+    OfflineVisPixel empty;
+    empty.Triangle = OFFLINE_VIS_EMPTY;
+    empty.Instance = 0;
+    empty.Depth    = OfflineEncodeDepth(1.0f, m_Format);
+    std::fill(m_Pixels.begin(), m_Pixels.end(), empty);
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineVisibilityBuffer::OnQuad(const OfflineTriangle& tri, const OfflineQuad& quad)
+{
+    for (uint32_t lane = 0; lane < 4; lane++)
+    {
+        if (!(quad.Live & (1 << lane)))
+            continue;
+
+        OfflineVisPixel& pixel = m_Pixels[(size_t)(2*quad.Y + (lane >> 1))*m_Width + 2*quad.X + (lane & 1)];
+        pixel.Triangle = tri.Triangle;
+        pixel.Instance = tri.Instance;
+        pixel.Depth    = OfflineEncodeDepth(quad.Depth[lane], m_Format);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+bool COfflineVisibilityBuffer::Save(const char* fileName) const
+{
+    std::vector<OfflineVisRun> runs;
+    std::vector<uint8_t> depths;
+    const uint32_t depthBytes = m_Format == OFFLINE_DEPTH_FORMAT_D24_UNORM ? 3 : 4;
+
+    for (uint32_t y = 0; y < m_Height; y++)
+    {
+        for (uint32_t x = 0; x < m_Width; x++)
+        {
+            const OfflineVisPixel& pixel = GetPixel(x, y);
+            if (pixel.Instance > 0xffff)
+                return false;
+
+            if (x && runs.back().Triangle == pixel.Triangle && runs.back().Instance == pixel.Instance)
+                runs.back().Length++;
+            else
+            {
+                OfflineVisRun run;
+                run.Triangle = pixel.Triangle;
+                run.Instance = (uint16_t)pixel.Instance;
+                run.Length   = 1;
+                runs.push_back(run);
+            }
+
+            if (pixel.Triangle != OFFLINE_VIS_EMPTY)
+            {
+                for (uint32_t i = 0; i < depthBytes; i++)
+                    depths.push_back((uint8_t)(pixel.Depth >> (8*i)));
+            }
+        }
+    }
+
+    FILE* pFile = fopen(fileName, "wb");
+    if (!pFile)
+        return false;
+
+    OfflineVisFileHeader header;
+    memcpy(header.Magic, "QSVB", 4);
+    header.Version     = OFFLINE_VIS_FILE_VERSION;
+    header.Width       = m_Width;
+    header.Height      = m_Height;
+    header.DepthFormat = m_Format;
+    header.NumRuns     = (uint32_t)runs.size();
+
+    bool ok = fwrite(&header, sizeof(header), 1, pFile) == 1;
+    if (ok && !runs.empty())
+        ok = fwrite(&runs[0], sizeof(runs[0]), runs.size(), pFile) == runs.size();
+    if (ok && !depths.empty())
+        ok = fwrite(&depths[0], 1, depths.size(), pFile) == depths.size();
+    fclose(pFile);
+    return ok;
+}
+
+
+//--------------------------------------------------------------------------------------
+bool COfflineVisibilityBuffer::Load(const char* fileName)
+{
+    Resize(0, 0, OFFLINE_DEPTH_FORMAT_D24_UNORM);
+
+    FILE* pFile = fopen(fileName, "rb");
+    if (!pFile)
+        return false;
+
+    OfflineVisFileHeader header;
+    std::vector<OfflineVisRun> runs;
+    bool ok = fread(&header, sizeof(header), 1, pFile) == 1 &&
+              memcmp(header.Magic, "QSVB", 4) == 0 && header.Version == OFFLINE_VIS_FILE_VERSION &&
+              header.Width > 0 && header.Height > 0 && header.Width <= 16384 && header.Height <= 16384 &&
+              header.DepthFormat <= OFFLINE_DEPTH_FORMAT_D32_FLOAT && header.NumRuns <= (uint64_t)header.Width*header.Height;
+    if (ok)
+    {
+        runs.resize(header.NumRuns);
+        ok = runs.empty() || fread(&runs[0], sizeof(runs[0]), runs.size(), pFile) == runs.size();
+    }
+
+    if (ok)
+    {
+        Resize(header.Width, header.Height, (OFFLINE_DEPTH_FORMAT)header.DepthFormat);
+        const uint32_t depthBytes = m_Format == OFFLINE_DEPTH_FORMAT_D24_UNORM ? 3 : 4;
+
+        // Runs have to tile each row exactly
+        size_t pixel = 0;
+        for (size_t i = 0; ok && i < runs.size(); i++)
+        {
+            const OfflineVisRun& run = runs[i];
+            ok = run.Length > 0 && (pixel%m_Width) + run.Length <= m_Width;
+            for (uint32_t j = 0; ok && j < run.Length; j++, pixel++)
+            {
+                OfflineVisPixel& dest = m_Pixels[pixel];
+                dest.Triangle = run.Triangle;
+                dest.Instance = run.Instance;
+                if (run.Triangle == OFFLINE_VIS_EMPTY)
+                    continue;
+
+                uint8_t bytes[4] = { 0, 0, 0, 0 };
+                ok = fread(bytes, 1, depthBytes, pFile) == depthBytes;
+                dest.Depth = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+            }
+        }
+        ok = ok && pixel == m_Pixels.size();
+    }
+    fclose(pFile);
+
+    if (!ok)
+        Resize(0, 0, OFFLINE_DEPTH_FORMAT_D24_UNORM);
+    return ok;
+}
+
+
+//--------------------------------------------------------------------------------------
+void COfflineVisibilityBuffer::Analyse(const OfflineVisCostModel& model, uint32_t threads, OfflineVisStats* pStats,
+                                       std::vector<uint8_t>* pQuadMap) const
+{
+    DXUT_PROFILE_SCOPE(L"Offline Visibility Quad Pass");
+
+    // Blocks on the quad grid, the last row or column of odd sizes half outside
+    const uint32_t gridWidth  = OfflineGetQuadGridSize(m_Width);
+    const uint32_t gridHeight = OfflineGetQuadGridSize(m_Height);
+
+    uint8_t* pMap = NULL;
+    if (pQuadMap)
+    {
+        pQuadMap->assign((size_t)gridWidth*gridHeight, 0);
+        pMap = pQuadMap->empty() ? NULL : &(*pQuadMap)[0];
+    }
+
+    threads = std::max(1u, std::min(threads, gridHeight));
+    std::vector<OfflineVisStats> stats(threads);
+    std::vector<std::thread> workers;
+    for (uint32_t i = 0; i < threads; i++)
+    {
+        uint32_t firstRow = (uint32_t)((uint64_t)gridHeight*i/threads);
+        uint32_t endRow   = (uint32_t)((uint64_t)gridHeight*(i + 1)/threads);
+        if (i + 1 < threads)
+            workers.push_back(std::thread(&COfflineVisibilityBuffer::AnalyseRows, this, firstRow, endRow, &stats[i], pMap));
+        else
+            AnalyseRows(firstRow, endRow, &stats[i], pMap);
+    }
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+
+    memset(pStats, 0, sizeof(*pStats));
+    for (uint32_t i = 0; i < threads; i++)
+    {
+        pStats->BlocksCovered += stats[i].BlocksCovered;
+        pStats->PixelsCovered += stats[i].PixelsCovered;
+        pStats->ForwardQuads  += stats[i].ForwardQuads;
+        for (int j = 0; j < 4; j++)
+            pStats->LiveStats[j] += stats[i].LiveStats[j];
+        pStats->MaxQuadsPerBlock = std::max(pStats->MaxQuadsPerBlock, stats[i].MaxQuadsPerBlock);
+    }
+
+    pStats->ForwardCost    = (double)pStats->ForwardQuads*model.ShadedQuadCost;
+    pStats->VisibilityCost = (double)pStats->BlocksCovered*model.ShadedQuadCost +
+                             (double)pStats->PixelsCovered*model.PixelFetchCost;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Each block's distinct triangles are the quads forward shading launches there, and
+// the number of pixels each one covers is that quad's liveness
+//--------------------------------------------------------------------------------------
+void COfflineVisibilityBuffer::AnalyseRows(uint32_t firstRow, uint32_t endRow, OfflineVisStats* pStats,
+                                           uint8_t* pQuadMap) const
+{
+    memset(pStats, 0, sizeof(*pStats));
+
+    // Lanes past the edge of odd sizes see nothing, as helper lanes outside the viewport
+    OfflineVisPixel outside;
+    outside.Triangle = OFFLINE_VIS_EMPTY;
+    outside.Instance = 0;
+    outside.Depth    = 0;
+
+    const uint32_t gridWidth = OfflineGetQuadGridSize(m_Width);
+    for (uint32_t by = firstRow; by < endRow; by++)
+    {
+        const uint32_t y0 = 2*by, y1 = 2*by + 1;
+        for (uint32_t bx = 0; bx < gridWidth; bx++)
+        {
+            const uint32_t x0 = 2*bx, x1 = 2*bx + 1;
+            const bool     inX = x1 < m_Width, inY = y1 < m_Height;
+            const OfflineVisPixel* pixels[4] =
+            {
+                &GetPixel(x0, y0),                  inX ? &GetPixel(x1, y0) : &outside,
+                inY ? &GetPixel(x0, y1) : &outside, inX && inY ? &GetPixel(x1, y1) : &outside
+            };
+
+            uint32_t quads = 0;
+            uint32_t done  = 0;
+            for (uint32_t lane = 0; lane < 4; lane++)
+            {
+                if (pixels[lane]->Triangle == OFFLINE_VIS_EMPTY || (done & (1 << lane)))
+                    continue;
+
+                // This lane's quad: every lane showing the same triangle
+                uint32_t live = 0;
+                for (uint32_t other = lane; other < 4; other++)
+                {
+                    if (pixels[other]->Triangle == pixels[lane]->Triangle &&
+                        pixels[other]->Instance == pixels[lane]->Instance)
+                    {
+                        done |= 1 << other;
+                        live++;
+                    }
+                }
+
+                quads++;
+                pStats->PixelsCovered += live;
+                pStats->LiveStats[live - 1]++;
+            }
+
+            if (!quads)
+                continue;
+
+            pStats->BlocksCovered++;
+            pStats->ForwardQuads += quads;
+            pStats->MaxQuadsPerBlock = std::max(pStats->MaxQuadsPerBlock, quads);
+            if (pQuadMap)
+                pQuadMap[(size_t)by*gridWidth + bx] = (uint8_t)quads;
+        }
+    }
+}
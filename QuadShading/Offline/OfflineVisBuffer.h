@@ -0,0 +1,95 @@
+//--------------------------------------------------------------------------------------
+// File: OfflineVisBuffer.h
+//
+// Visibility buffer for the offline overshading engine: the triangle, instance and depth
+// left in each pixel by one depth-tested pass. Quad metrics are then derived from the
+// buffer's 2x2 blocks in a separate pass, which needs no rasterization and splits across
+// threads, and buffers can be saved and re-analysed later under other cost models.
+//
+// The same blocks also give the cost of visibility-buffer shading, where a full-screen
+// pass shades each covered block once whatever the triangles in it, to set against the
+// one quad per triangle per block of forward shading.
+//
+// Copyright (c) 2014 Stephen Hill
+//--------------------------------------------------------------------------------------
+#pragma once
+#ifndef OFFLINE_VIS_BUFFER_H
+#define OFFLINE_VIS_BUFFER_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "OfflineRaster.h"
+
+#define OFFLINE_VIS_EMPTY   0xffffffff  // Triangle of a pixel no triangle reached
+
+struct OfflineVisPixel
+{
+    uint32_t Triangle;          // OfflineTriangle::Triangle
+    uint32_t Instance;
+    uint32_t Depth;             // encoded as in COfflineDepthBuffer
+};
+
+// Costs for re-analysing a buffer, in the units of OfflineDepthCostModel
+struct OfflineVisCostModel
+{
+    double ShadedQuadCost;      // a 2x2 quad of the material shader, forward or deferred
+    double PixelFetchCost;      // per covered pixel, visibility buffer only: fetching the
+                                // triangle and rebuilding its attributes
+};
+
+OfflineVisCostModel OfflineGetDefaultVisCostModel();
+
+struct OfflineVisStats
+{
+    uint32_t BlocksCovered;     // 2x2 blocks with at least one covered pixel
+    uint64_t PixelsCovered;
+    uint64_t ForwardQuads;      // a quad per distinct triangle and instance in each block
+    uint32_t LiveStats[4];      // forward quads with 1-4 covered pixels, as liveStatsUAV
+    uint32_t MaxQuadsPerBlock;
+    double   ForwardCost;
+    double   VisibilityCost;    // BlocksCovered quads, plus the per-pixel fetch
+};
+
+
+//--------------------------------------------------------------------------------------
+// Written by the live lanes of a pass that tests and writes depth, in which the last
+// lane to pass at a pixel is the one left visible
+//--------------------------------------------------------------------------------------
+class COfflineVisibilityBuffer : public IOfflineQuadSink
+{
+public:
+                        COfflineVisibilityBuffer();
+
+    void                Resize(uint32_t width, uint32_t height, OFFLINE_DEPTH_FORMAT format);
+    void                Clear();
+
+    virtual void        OnQuad(const OfflineTriangle& tri, const OfflineQuad& quad);
+
+    // Triangles run-length encoded along rows, with depth only for covered pixels and
+    // in three bytes for D24_UNORM. Instances must fit in 16 bits.
+    bool                Save(const char* fileName) const;
+    bool                Load(const char* fileName);
+
+    uint32_t            GetWidth() const    { return m_Width; }
+    uint32_t            GetHeight() const   { return m_Height; }
+    OFFLINE_DEPTH_FORMAT GetFormat() const  { return m_Format; }
+    const OfflineVisPixel& GetPixel(uint32_t x, uint32_t y) const { return m_Pixels[(size_t)y*m_Width + x]; }
+
+    // The quad pass: every 2x2 block on its own, in bands of rows across the given
+    // number of threads. pQuadMap, if given, gets the forward quads of each block on
+    // the (width >> 1) x (height >> 1) grid of the UAVs.
+    void                Analyse(const OfflineVisCostModel& model, uint32_t threads, OfflineVisStats* pStats,
+                                std::vector<uint8_t>* pQuadMap) const;
+
+protected:
+    void                AnalyseRows(uint32_t firstRow, uint32_t endRow, OfflineVisStats* pStats,
+                                    uint8_t* pQuadMap) const;
+
+    uint32_t                        m_Width;
+    uint32_t                        m_Height;
+    OFFLINE_DEPTH_FORMAT            m_Format;
+    std::vector<OfflineVisPixel>    m_Pixels;
+};
+
+#endif
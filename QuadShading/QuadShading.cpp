@@ -15,6 +15,10 @@
 #include "DXUT.h"
 #include "DXUTcamera.h"
 #include "SDKMesh.h"
+#include "DXUTframestats.h"
+#include "DXUTprofiler.h"
+#include "Offline/OfflineAnalysis.h"
+#include "Offline/OfflineCameraPath.h"
 
 //--------------------------------------------------------------------------------------
 // Structures
@@ -100,6 +104,15 @@ const DWORD                g_NbMethods = 4;
 CDXUTSDKMesh g_Mesh;
 CModelViewerCamera g_Camera;
 
+COfflineKeyframePath       g_CameraPath;        // -camera-path, stepped a frame at a time
+uint32_t                   g_CameraPathFrame = 0;
+D3DXMATRIX                 g_CameraPathView;
+COfflineKeyframePath       g_RecordedPath;      // views keyed with K, for -record-path
+uint64_t                   g_RecordStart = 0;
+
+const uint32_t             g_FrameStatsWindows[] = { 120, 1000 };
+CDXUTFrameStats            g_FrameStats(g_FrameStatsWindows, ARRAYSIZE(g_FrameStatsWindows));
+
 
 //--------------------------------------------------------------------------------------
 // Forward declarations
@@ -109,6 +122,11 @@ HRESULT InitDevice();
 void CleanupDevice();
 LRESULT CALLBACK    WndProc(HWND, UINT, WPARAM, LPARAM);
 void Render();
+void WriteFrameStats(LPCWSTR szFileName);
+void WriteProfile(LPCWSTR szFileName);
+void UpdateCameraPath();
+void RecordCameraKey();
+int RunOffline(LPWSTR* pArgs, int nArgs);
 
 
 //--------------------------------------------------------------------------------------
@@ -118,7 +136,43 @@ void Render();
 int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLine, int nCmdShow)
 {
     UNREFERENCED_PARAMETER(hPrevInstance);
-    UNREFERENCED_PARAMETER(lpCmdLine);
+
+    // Optional "-framestats <file>": dump frame-time statistics on exit (.csv or .json)
+    // Optional "-trace <file>": dump the CPU profile on exit (Chrome .json or binary)
+    // Optional "-camera-path <file>": play back keyframed views, one step a frame, and quit
+    // Optional "-record-path <file>": save the views keyed with K on exit
+    // Optional "-offline ...": run the CPU overshading analysis instead of the demo
+    WCHAR szFrameStatsFile[MAX_PATH] = L"";
+    WCHAR szTraceFile[MAX_PATH] = L"";
+    char szCameraPathFile[MAX_PATH] = "";
+    char szRecordPathFile[MAX_PATH] = "";
+    int nArgs = 0;
+    LPWSTR* pArgs = lpCmdLine[0] ? CommandLineToArgvW(lpCmdLine, &nArgs) : NULL;
+    if (pArgs)
+    {
+        for (int i = 0; i < nArgs; i++)
+        {
+            if (_wcsicmp(pArgs[i], L"-offline") == 0)
+            {
+                int result = RunOffline(pArgs, nArgs);
+                LocalFree(pArgs);
+                return result;
+            }
+        }
+
+        for (int i = 0; i + 1 < nArgs; i++)
+        {
+            if (_wcsicmp(pArgs[i], L"-framestats") == 0)
+                wcscpy_s(szFrameStatsFile, MAX_PATH, pArgs[i + 1]);
+            else if (_wcsicmp(pArgs[i], L"-trace") == 0)
+                wcscpy_s(szTraceFile, MAX_PATH, pArgs[i + 1]);
+            else if (_wcsicmp(pArgs[i], L"-camera-path") == 0)
+                WideCharToMultiByte(CP_ACP, 0, pArgs[i + 1], -1, szCameraPathFile, MAX_PATH, NULL, NULL);
+            else if (_wcsicmp(pArgs[i], L"-record-path") == 0)
+                WideCharToMultiByte(CP_ACP, 0, pArgs[i + 1], -1, szRecordPathFile, MAX_PATH, NULL, NULL);
+        }
+        LocalFree(pArgs);
+    }
 
     if (FAILED(InitWindow(hInstance, nCmdShow)))
         return 0;
@@ -129,6 +183,22 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLi
         return 0;
     }
 
+    // The clip planes are g_Projection's; the views, and the field of view, the path's
+    OfflineCamera pathBase;
+    pathBase.eye   = MakeVec3(0, 0, 0);
+    pathBase.at    = MakeVec3(0, 0, 1);
+    pathBase.up    = MakeVec3(0, 1, 0);
+    pathBase.fovY  = XM_PIDIV4;
+    pathBase.zNear = 0.01f;
+    pathBase.zFar  = 5000.0f;
+    g_CameraPath.Setup(pathBase, OFFLINE_DEFAULT_PATH_FPS);
+    if (szCameraPathFile[0] && !g_CameraPath.Load(szCameraPathFile))
+    {
+        MessageBoxA(NULL, szCameraPathFile, "Failed to read camera keys", MB_OK);
+        CleanupDevice();
+        return 0;
+    }
+
     // Main message loop
     MSG msg = {0};
     while (WM_QUIT != msg.message)
@@ -140,12 +210,23 @@ int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLi
         }
         else
         {
+            g_FrameStats.BeginFrame();
             Render();
+            g_FrameStats.EndFrame();
         }
     }
 
     CleanupDevice();
 
+    if (szFrameStatsFile[0])
+        WriteFrameStats(szFrameStatsFile);
+
+    if (szTraceFile[0])
+        WriteProfile(szTraceFile);
+
+    if (szRecordPathFile[0] && g_RecordedPath.GetNumKeys())
+        g_RecordedPath.Save(szRecordPathFile);
+
     return (int)msg.wParam;
 }
 
@@ -528,8 +609,9 @@ HRESULT InitDevice()
     D3D11_UNORDERED_ACCESS_VIEW_DESC descUAV;
     D3D11_SHADER_RESOURCE_VIEW_DESC descSRV;
 
-    DWORD uavWidth  = width  >> 1;
-    DWORD uavHeight = height >> 1;
+    // One texel per quad, including the half-covered quads on odd sizes
+    DWORD uavWidth  = (width  + 1) >> 1;
+    DWORD uavHeight = (height + 1) >> 1;
 
     // Create fragment count buffer
     ZeroMemory(&desc2D, sizeof(D3D11_TEXTURE2D_DESC));
@@ -636,6 +718,9 @@ HRESULT InitDevice()
     g_pd3dDevice->CreateDepthStencilState(&descDS, &g_sceneDepthDS);
 
     g_Mesh.Create(g_pd3dDevice, L"hebe.sdkmesh");
+#if defined(DEBUG) || defined(_DEBUG)
+    DXUTOutputSDKMeshAllocStats();
+#endif
 
     D3DXVECTOR3 vecAt = g_Mesh.GetMeshBBoxCenter(0);
     D3DXVECTOR3 vecEye = vecAt - D3DXVECTOR3(0, 0, 16.0f);
@@ -732,6 +817,8 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
         case WM_KEYDOWN:
             if (wParam == VK_SPACE)
                 g_Method = (g_Method + 1) % g_NbMethods;
+            else if (wParam == 'K')
+                RecordCameraKey();
             break;
 
         default:
@@ -802,21 +889,31 @@ void RenderMesh(
 //--------------------------------------------------------------------------------------
 void Render()
 {
+    CDXUTPerfEventGenerator eventGenerator(DXUT_PERFEVENTCOLOR, L"Frame");
+
     // Update our time
     static float t = 0.0f;
-    if (g_driverType == D3D_DRIVER_TYPE_REFERENCE)
+    if (g_CameraPath.GetNumKeys())
+    {
+        DXUT_BeginPerfEvent(DXUT_PERFEVENTCOLOR3, L"Camera Update");
+        UpdateCameraPath();
+        DXUT_EndPerfEvent();
+    }
+    else if (g_driverType == D3D_DRIVER_TYPE_REFERENCE)
     {
         t += (float)XM_PI * 0.0125f;
     }
     else
     {
-        static DWORD dwTimeStart = 0;
-        DWORD dwTimeCur = GetTickCount();
-        if (dwTimeStart == 0)
-            dwTimeStart = dwTimeCur;
-        t = (dwTimeCur - dwTimeStart) / 1000.0f;
+        static uint64_t timeStart = 0;
+        uint64_t timeCur = DXUTGetHighResTimeNs();
+        if (timeStart == 0)
+            timeStart = timeCur;
+        t = (float)((timeCur - timeStart) * 1e-9);
 
+        DXUT_BeginPerfEvent(DXUT_PERFEVENTCOLOR3, L"Camera Update");
         g_Camera.FrameMove(t);
+        DXUT_EndPerfEvent();
     }
 
     //
@@ -842,9 +939,11 @@ void Render()
     //
     // Update variables that change once per frame
     //
+    DXUT_BeginPerfEvent(DXUT_PERFEVENTCOLOR3, L"Frame Transforms");
     CBChangesEveryFrame cb;
-    D3DXMatrixTranspose(&cb.mView, g_Camera.GetViewMatrix());
+    D3DXMatrixTranspose(&cb.mView, g_CameraPath.GetNumKeys() ? &g_CameraPathView : g_Camera.GetViewMatrix());
     g_pImmediateContext->UpdateSubresource(g_pCBChangesEveryFrame, 0, NULL, &cb, 0, 0);
+    DXUT_EndPerfEvent();
 
     //
     // Render the mesh
@@ -920,3 +1019,128 @@ void Render()
     //
     g_pSwapChain->Present(0, 0);
 }
+
+
+//--------------------------------------------------------------------------------------
+// Step the scripted camera a frame, whatever the time, so that every run sees the same
+// views. The field of view may change along the path, so the projection follows it.
+// The last frame asks to quit.
+//--------------------------------------------------------------------------------------
+void UpdateCameraPath()
+{
+    OfflineCamera camera;
+    g_CameraPath.GetCamera(g_CameraPathFrame, &camera);
+    if (++g_CameraPathFrame >= g_CameraPath.GetNumFrames())
+        PostQuitMessage(0);
+
+    D3DXVECTOR3 vecEye(camera.eye.x, camera.eye.y, camera.eye.z);
+    D3DXVECTOR3 vecAt(camera.at.x, camera.at.y, camera.at.z);
+    D3DXVECTOR3 vecUp(camera.up.x, camera.up.y, camera.up.z);
+    D3DXMatrixLookAtLH(&g_CameraPathView, &vecEye, &vecAt, &vecUp);
+
+    RECT rc;
+    GetClientRect(g_hWnd, &rc);
+    g_Projection = XMMatrixPerspectiveFovLH(camera.fovY, (rc.right - rc.left)/(FLOAT)(rc.bottom - rc.top),
+                                            camera.zNear, camera.zFar);
+
+    CBChangeOnResize cbChangesOnResize;
+    cbChangesOnResize.mProjection = XMMatrixTranspose(g_Projection);
+    g_pImmediateContext->UpdateSubresource(g_pCBChangeOnResize, 0, NULL, &cbChangesOnResize, 0, 0);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Key the interactive view at the time since the first key. The up axis is taken from
+// the view matrix, as CModelViewerCamera rolls it, so the key rebuilds the same view.
+//--------------------------------------------------------------------------------------
+void RecordCameraKey()
+{
+    uint64_t timeCur = DXUTGetHighResTimeNs();
+    if (g_RecordedPath.GetNumKeys() == 0)
+        g_RecordStart = timeCur;
+
+    const D3DXMATRIX* pView = g_Camera.GetViewMatrix();
+    const D3DXVECTOR3* pEye = g_Camera.GetEyePt();
+    const D3DXVECTOR3* pAt  = g_Camera.GetLookAtPt();
+
+    OfflineCameraKey key;
+    key.Time = (float)((timeCur - g_RecordStart)*1e-9);
+    key.Eye  = MakeVec3(pEye->x, pEye->y, pEye->z);
+    key.At   = MakeVec3(pAt->x, pAt->y, pAt->z);
+    key.Up   = MakeVec3(pView->_12, pView->_22, pView->_32);
+    key.FovY = XM_PIDIV4;
+    g_RecordedPath.AddKey(key);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Write the collected frame-time statistics, as JSON if the extension asks for it and
+// CSV otherwise
+//--------------------------------------------------------------------------------------
+void WriteFrameStats(LPCWSTR szFileName)
+{
+    FILE* pFile = NULL;
+    if (_wfopen_s(&pFile, szFileName, L"wt") != 0 || !pFile)
+        return;
+
+    LPCWSTR szExt = wcsrchr(szFileName, L'.');
+    if (szExt && _wcsicmp(szExt, L".json") == 0)
+        g_FrameStats.WriteJSON(pFile);
+    else
+        g_FrameStats.WriteCSV(pFile);
+
+    fclose(pFile);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Write the CPU profile recorded through the DXUT perf-event markers, as a Chrome trace
+// if the extension asks for it and in the compact binary format otherwise
+//--------------------------------------------------------------------------------------
+void WriteProfile(LPCWSTR szFileName)
+{
+    FILE* pFile = NULL;
+    if (_wfopen_s(&pFile, szFileName, L"wb") != 0 || !pFile)
+        return;
+
+    LPCWSTR szExt = wcsrchr(szFileName, L'.');
+    if (szExt && _wcsicmp(szExt, L".json") == 0)
+        DXUTProfilerWriteChromeTrace(pFile);
+    else
+        DXUTProfilerWriteBinary(pFile);
+
+    fclose(pFile);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Hand the command line over to the offline analysis, which takes UTF-8 arguments and
+// reports on stdout. Output goes to the console we were started from, if any, unless
+// it has already been redirected.
+//--------------------------------------------------------------------------------------
+int RunOffline(LPWSTR* pArgs, int nArgs)
+{
+    if (GetFileType(GetStdHandle(STD_OUTPUT_HANDLE)) == FILE_TYPE_UNKNOWN && AttachConsole(ATTACH_PARENT_PROCESS))
+    {
+        FILE* pStream = NULL;
+        freopen_s(&pStream, "CONOUT$", "w", stdout);
+        freopen_s(&pStream, "CONOUT$", "w", stderr);
+    }
+
+    char** argv = new char*[nArgs];
+    for (int i = 0; i < nArgs; i++)
+    {
+        int nBytes = WideCharToMultiByte(CP_UTF8, 0, pArgs[i], -1, NULL, 0, NULL, NULL);
+        argv[i] = new char[nBytes > 0 ? nBytes : 1];
+        argv[i][0] = 0;
+        WideCharToMultiByte(CP_UTF8, 0, pArgs[i], -1, argv[i], nBytes, NULL, NULL);
+    }
+
+    int result = OfflineMain(nArgs, argv);
+
+    for (int i = 0; i < nArgs; i++)
+        delete[] argv[i];
+    delete[] argv;
+
+    return result;
+}